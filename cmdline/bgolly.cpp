@@ -17,6 +17,23 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#ifdef ZLIB
+#include <zlib.h>
+#endif
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
 
 using std::cerr ;
 using std::cout ;
@@ -55,6 +72,127 @@ public:
 } ;
 nullrender renderer ;
 
+/*
+ *   This renderer keeps an RGBA image of the viewport in memory, in the
+ *   algorithm's default colors, for writing frames without a GUI.  It
+ *   keeps its frame, so each draw only repaints what changed.
+ */
+class imagerender : public liferender {
+public:
+   imagerender() : wd(0), ht(0) {}
+   virtual ~imagerender() {}
+   void setsize(int w, int h) ;
+   void setcolors(const char *algoname, int numstates) ;
+   virtual void pixblit(int x, int y, int w, int h, unsigned char* pm, int pmscale) ;
+   virtual void getcolors(unsigned char** r, unsigned char** g, unsigned char** b,
+                          unsigned char* dead_alpha, unsigned char* live_alpha) {
+      *r = red ;
+      *g = green ;
+      *b = blue ;
+      *dead_alpha = *live_alpha = 255 ;
+   }
+   virtual int keepsframe() { return 1 ; }
+   virtual void damage(int x, int y, int w, int h) ;
+   vector<unsigned char> pixels ;   // wd*ht RGBA pixels, top row first
+   int wd, ht ;
+private:
+   bool clip(int &x, int &y, int &w, int &h) ;
+   unsigned char red[256], green[256], blue[256] ;
+} ;
+imagerender framerenderer ;
+
+void imagerender::setsize(int w, int h) {
+   wd = w ;
+   ht = h ;
+   pixels.assign((size_t)w * h * 4, 255) ;
+   newframe() ;
+}
+
+// same as a new layer in the GUI:  either the listed colors, or state 0
+// plus a gradient over the live states
+void imagerender::setcolors(const char *algoname, int numstates) {
+   staticAlgoInfo *ai = staticAlgoInfo::byName(algoname) ;
+   for (int i=0; i<256; i++) {
+      red[i] = ai->defr[i] ;
+      green[i] = ai->defg[i] ;
+      blue[i] = ai->defb[i] ;
+   }
+   if (red[0] == red[1] && green[0] == green[1] && blue[0] == blue[1]) {
+      // unset, so the GUI would start state 0 at its dark gray
+      red[0] = green[0] = blue[0] = 48 ;
+   }
+   if (ai->defgradient && numstates > 1) {
+      // the same steps as CreateColorGradient in the GUI
+      int n = numstates - 2 ;
+      double rstep = n ? (double)(ai->defr2 - ai->defr1) / n : 0 ;
+      double gstep = n ? (double)(ai->defg2 - ai->defg1) / n : 0 ;
+      double bstep = n ? (double)(ai->defb2 - ai->defb1) / n : 0 ;
+      for (int i=1; i<numstates; i++) {
+         red[i] = (int)(ai->defr1 + (i - 1) * rstep + 0.5) ;
+         green[i] = (int)(ai->defg1 + (i - 1) * gstep + 0.5) ;
+         blue[i] = (int)(ai->defb1 + (i - 1) * bstep + 0.5) ;
+      }
+      if (n > 0) {
+         red[numstates-1] = ai->defr2 ;
+         green[numstates-1] = ai->defg2 ;
+         blue[numstates-1] = ai->defb2 ;
+      }
+   }
+   newframe() ;
+}
+
+bool imagerender::clip(int &x, int &y, int &w, int &h) {
+   if (x < 0) {
+      w += x ;
+      x = 0 ;
+   }
+   if (y < 0) {
+      h += y ;
+      y = 0 ;
+   }
+   if (x + w > wd)
+      w = wd - x ;
+   if (y + h > ht)
+      h = ht - y ;
+   return w > 0 && h > 0 ;
+}
+
+void imagerender::damage(int x, int y, int w, int h) {
+   if (!clip(x, y, w, h))
+      return ;
+   for (int j=y; j<y+h; j++) {
+      unsigned char *p = &pixels[((size_t)j * wd + x) * 4] ;
+      for (int i=0; i<w; i++) {
+         *p++ = red[0] ;
+         *p++ = green[0] ;
+         *p++ = blue[0] ;
+         *p++ = 255 ;
+      }
+   }
+}
+
+void imagerender::pixblit(int x, int y, int w, int h, unsigned char* pm, int pmscale) {
+   int x0 = x, y0 = y, pmwd = w / pmscale ;
+   if (!clip(x, y, w, h))
+      return ;
+   for (int j=y; j<y+h; j++) {
+      unsigned char *p = &pixels[((size_t)j * wd + x) * 4] ;
+      if (pmscale == 1) {
+         memcpy(p, pm + ((size_t)(j - y0) * pmwd + x - x0) * 4, (size_t)w * 4) ;
+      } else {
+         // each byte is the state of a pmscale by pmscale cell
+         const unsigned char *row = pm + (size_t)((j - y0) / pmscale) * pmwd ;
+         for (int i=x; i<x+w; i++) {
+            unsigned char state = row[(i - x0) / pmscale] ;
+            *p++ = red[state] ;
+            *p++ = green[state] ;
+            *p++ = blue[state] ;
+            *p++ = 255 ;
+         }
+      }
+   }
+}
+
 // the RuleLoader algo looks for .rule files in the temp_rules directory,
 // then in the user_rules directory, then in the supplied_rules directory
 char* temp_rules = (char *)"";
@@ -127,17 +265,24 @@ struct options {
 } ;
 bigint maxgen = -1, inc = 0 ;
 int maxmem = 256 ;
+int nthreads = 1 ;
+int gzthreads = 1 ;
 int hyperxxx ;   // renamed hyper to avoid conflict with windows.h
 int render, autofit, quiet, popcount, progress ;
 int hashlife ;
 char *algoName = 0 ;
 int verbose ;
 int timeline ;
+int detectperiod ;
+int censussoups, soupsize = 16, soupdensity = 50, soupseed = 1 ;
 int stepthresh, stepfactor ;
 char *liferule = 0 ;
 char *outfilename = 0 ;
 char *renderscale = (char *)"1" ;
+char *rendersize = (char *)"1000x1000" ;
+char *framename = 0 ;
 char *testscript = 0 ;
+char *serverpath = 0 ;
 int outputgzip, outputismc ;
 int numberoffset ; // where to insert file name numbers
 options options[] = {
@@ -145,6 +290,7 @@ options options[] = {
   { "-i", "--stepsize", "Step size", 'I', &inc },
   { "-M", "--maxmemory", "Max memory to use in megabytes", 'i', &maxmem },
   { "-T", "--maxtime", "Max duration", 'i', &maxtime },
+  { "",   "--threads", "Number of threads to use", 'i', &nthreads },
   { "-b", "--benchmark", "Show timestamps", 'b', &benchmark },
   { "-2", "--exponential", "Use exponentially increasing steps", 'b', &hyperxxx },
   { "-q", "--quiet", "Don't show population; twice, don't show anything", 'b', &quiet },
@@ -154,18 +300,37 @@ options options[] = {
   { "-a", "--algorithm", "Select algorithm by name", 's', &algoName },
   { "-o", "--output", "Output file (*.rle, *.mc, *.rle.gz, *.mc.gz)", 's',
                                                                &outfilename },
+  { "",   "--gzip-threads", "Number of threads compressing .gz output",
+                                                          'i', &gzthreads },
   { "-v", "--verbose", "Verbose", 'b', &verbose },
   { "-t", "--timeline", "Use timeline", 'b', &timeline },
+  { "",   "--detect-period", "Step until the pattern repeats with at most this period",
+                                                       'i', &detectperiod },
+  { "",   "--census", "Run this many random soups and print a census of the ash",
+                                                        'i', &censussoups },
+  { "",   "--soupsize", "Soup width and height for --census (default 16)",
+                                                           'i', &soupsize },
+  { "",   "--density", "Percentage of live cells in a soup (default 50)",
+                                                        'i', &soupdensity },
+  { "",   "--seed", "Random seed for --census (default 1)", 'i', &soupseed },
   { "",   "--render", "Render (benchmarking)", 'b', &render },
   { "",   "--progress", "Render during progress dialog (debugging)", 'b', &progress },
   { "",   "--popcount", "Popcount (benchmarking)", 'b', &popcount },
-  { "",   "--scale", "Rendering scale", 's', &renderscale },
+  { "",   "--scale", "Rendering scale (1:N zooms out, N:1 in; N a power of 2)",
+                                                         's', &renderscale },
+  { "",   "--size", "Rendering viewport in pixels (default 1000x1000)",
+                                                          's', &rendersize },
+  { "",   "--frames", "Write each generation shown as a frame (*.png, *.rgba, - for stdout)",
+                                                           's', &framename },
 //{ "",   "--stepthreshold", "Stepsize >= gencount/this (default 1)",
 //                                                          'i', &stepthresh },
 //{ "",   "--stepfactor", "How much to scale step by (default 2)",
 //                                                        'i', &stepfactor },
-  { "",   "--autofit", "Autofit before each render", 'b', &autofit },
+  { "",   "--autofit", "Autofit before each render; twice, only if the pattern leaves the view",
+                                                             'b', &autofit },
   { "",   "--exec", "Run testing script", 's', &testscript },
+  { "",   "--server", "Serve binary requests on this Unix socket (- for stdin)",
+                                                        's', &serverpath },
   { 0, 0, 0, 0, 0 }
 } ;
 
@@ -193,7 +358,6 @@ void usage(const char *s) {
 
 #define STRINGIFY(ARG) STR2(ARG)
 #define STR2(ARG) #ARG
-#define MAXRLE 1000000000
 void writepat(int fc) {
    char *thisfilename = outfilename ;
    char tmpfilename[256] ;
@@ -209,17 +373,224 @@ void writepat(int fc) {
    cerr << "(->" << thisfilename << flush ;
    bigint t, l, b, r ;
    imp->findedges(&t, &l, &b, &r) ;
-   if (!outputismc && (t < -MAXRLE || l < -MAXRLE || b > MAXRLE || r > MAXRLE))
-      lifefatal("Pattern too large to write in RLE format") ;
    const char *err = writepattern(thisfilename, *imp,
                                   outputismc ? MC_format : RLE_format,
                                   outputgzip ? gzip_compression : no_compression,
-                                  t.toint(), l.toint(), b.toint(), r.toint()) ;
+                                  t, l, b, r, gzthreads) ;
    if (err != 0)
       lifewarning(err) ;
    cerr << ")" << flush ;
 }
 
+/*
+ *   Frames for --frames.  The algorithm draws each frame into
+ *   framerenderer between steps, since draw reads what step rewrites,
+ *   but the pixels are then copied into a ring of FRAMESLOTS slots that
+ *   another thread encodes and writes; compressing and writing a frame
+ *   overlaps with stepping to the next one.
+ */
+#define FRAMESLOTS 4
+
+struct framewriter {
+   std::thread thread ;
+   std::mutex mut ;
+   std::condition_variable cond ;
+   vector<unsigned char> slot[FRAMESLOTS] ;
+   int number[FRAMESLOTS] ;
+   int next ;                    // slot to be filled next
+   int take ;                    // slot to be written next
+   int count ;                   // slots filled and not yet written
+   bool stop ;
+   const char *error ;           // first failure, reported by put
+   FILE *raw ;                   // destination of raw frames; 0 for PNG files
+   framewriter() : next(0), take(0), count(0), stop(false), error(0), raw(0) {}
+   void run() ;
+   void put(const vector<unsigned char> &pixels, int n) ;
+   void finish() ;
+} ;
+
+framewriter *frames = 0 ;
+int framecount ;
+int frameoffset ;   // where to insert frame numbers; 0 for raw frames
+int renderwd = 1000, renderht = 1000, rendermag ;
+
+#ifdef ZLIB
+void pngput32(std::string &out, unsigned int v) {
+   out += (char)(v >> 24) ;
+   out += (char)(v >> 16) ;
+   out += (char)(v >> 8) ;
+   out += (char)v ;
+}
+void pngchunk(std::string &out, const char *type, const unsigned char *data, size_t len) {
+   pngput32(out, (unsigned int)len) ;
+   size_t start = out.size() ;
+   out.append(type, 4) ;
+   out.append((const char *)data, len) ;
+   pngput32(out, (unsigned int)crc32(0, (const Bytef *)out.data() + start, (uInt)(len + 4))) ;
+}
+// frames are opaque, so they are written as 8-bit RGB; every row uses
+// the Sub filter, which turns runs of one color into runs of zeros
+const char *encodepng(const vector<unsigned char> &pixels, int wd, int ht, std::string &out) {
+   size_t rowbytes = 1 + 3 * (size_t)wd ;
+   vector<unsigned char> filtered(rowbytes * ht) ;
+   for (int j=0; j<ht; j++) {
+      const unsigned char *p = &pixels[(size_t)j * wd * 4] ;
+      unsigned char *q = &filtered[j * rowbytes] ;
+      *q++ = 1 ;
+      unsigned char r = 0, g = 0, b = 0 ;
+      for (int i=0; i<wd; i++, p += 4) {
+         *q++ = (unsigned char)(p[0] - r) ;
+         *q++ = (unsigned char)(p[1] - g) ;
+         *q++ = (unsigned char)(p[2] - b) ;
+         r = p[0] ;
+         g = p[1] ;
+         b = p[2] ;
+      }
+   }
+   uLongf zlen = compressBound((uLong)filtered.size()) ;
+   vector<unsigned char> z(zlen) ;
+   if (compress2(&z[0], &zlen, &filtered[0], (uLong)filtered.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+      return "Cannot compress frame" ;
+   static const unsigned char signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' } ;
+   out.assign((const char *)signature, 8) ;
+   std::string ihdr ;
+   pngput32(ihdr, wd) ;
+   pngput32(ihdr, ht) ;
+   ihdr += (char)8 ;     // bit depth
+   ihdr += (char)2 ;     // RGB
+   ihdr.append(3, (char)0) ;   // deflate, adaptive filtering, no interlace
+   pngchunk(out, "IHDR", (const unsigned char *)ihdr.data(), ihdr.size()) ;
+   pngchunk(out, "IDAT", &z[0], zlen) ;
+   pngchunk(out, "IEND", 0, 0) ;
+   return 0 ;
+}
+#endif
+
+// called by the writer thread, so it must not use lifefatal and friends
+const char *writeframe(const vector<unsigned char> &pixels, int n) {
+   if (frames->raw) {
+      if (fwrite(&pixels[0], 1, pixels.size(), frames->raw) != pixels.size() ||
+          fflush(frames->raw) != 0)
+         return "Cannot write raw frames" ;
+      return 0 ;
+   }
+#ifdef ZLIB
+   std::string png ;
+   const char *err = encodepng(pixels, framerenderer.wd, framerenderer.ht, png) ;
+   if (err)
+      return err ;
+   char thisfilename[256] ;
+   sprintf(thisfilename, "%.*s-%06d%s", frameoffset, framename, n,
+           framename + frameoffset) ;
+   FILE *f = fopen(thisfilename, "wb") ;
+   if (f == 0)
+      return "Cannot create frame file" ;
+   bool ok = fwrite(png.data(), 1, png.size(), f) == png.size() ;
+   if (fclose(f) != 0)
+      ok = false ;
+   return ok ? 0 : "Cannot write frame file" ;
+#else
+   return "PNG frames need zlib" ;
+#endif
+}
+
+void framewriter::run() {
+   std::unique_lock<std::mutex> lock(mut) ;
+   while (true) {
+      cond.wait(lock, [this] { return stop || count > 0 ; }) ;
+      if (count == 0)
+         break ;
+      int s = take ;
+      lock.unlock() ;
+      const char *err = writeframe(slot[s], number[s]) ;
+      lock.lock() ;
+      if (err && !error)
+         error = err ;
+      take = (take + 1) % FRAMESLOTS ;
+      count-- ;
+      cond.notify_all() ;
+   }
+}
+
+void framewriter::put(const vector<unsigned char> &pixels, int n) {
+   std::unique_lock<std::mutex> lock(mut) ;
+   cond.wait(lock, [this] { return count < FRAMESLOTS ; }) ;
+   const char *err = error ;
+   int s = next ;
+   lock.unlock() ;
+   if (err)
+      lifefatal(err) ;
+   // the writer leaves a slot alone until it is counted
+   slot[s] = pixels ;
+   number[s] = n ;
+   lock.lock() ;
+   next = (next + 1) % FRAMESLOTS ;
+   count++ ;
+   cond.notify_all() ;
+}
+
+// write what is queued and stop the writer
+void framewriter::finish() {
+   if (!thread.joinable())
+      return ;
+   {
+      std::unique_lock<std::mutex> lock(mut) ;
+      stop = true ;
+      cond.notify_all() ;
+   }
+   thread.join() ;
+   if (raw != 0 && raw != stdout && fclose(raw) != 0 && !error)
+      error = "Cannot write raw frames" ;
+}
+
+// at exit, however we get there, the queued frames still get written
+void endframes() {
+   if (frames && frames->thread.joinable()) {
+      frames->finish() ;
+      if (frames->error)
+         cerr << "Frames incomplete: " << frames->error << endl ;
+   }
+}
+
+void startframes() {
+   framerenderer.setsize(renderwd, renderht) ;
+   framerenderer.setcolors(algoName, imp->NumCellStates()) ;
+   frames = new framewriter() ;
+   if (strcmp(framename, "-") == 0) {
+#ifdef _WIN32
+      _setmode(1, _O_BINARY) ;
+#endif
+      frames->raw = stdout ;
+   } else if (frameoffset == 0) {
+      frames->raw = fopen(framename, "wb") ;
+      if (frames->raw == 0)
+         lifefatal("Cannot create frame file") ;
+   }
+   frames->thread = std::thread(&framewriter::run, frames) ;
+   atexit(endframes) ;
+}
+
+void renderframe() {
+   imp->draw(viewport, framerenderer) ;
+   frames->put(framerenderer.pixels, framecount++) ;
+}
+
+// 1:N zooms out and N:1 zooms in; N alone means N:1
+int scalemag(const char *s) {
+   int a = 0, b = 1 ;
+   if (sscanf(s, "%d:%d", &a, &b) < 1 || a < 1 || b < 1 || (a > 1 && b > 1))
+      lifefatal("Bad scale; use 1:N or N:1") ;
+   int n = a > 1 ? a : b ;
+   int mag = 0 ;
+   while (mag < 30 && (1 << mag) < n)
+      mag++ ;
+   if ((1 << mag) != n)
+      lifefatal("Scale must be a power of 2") ;
+   if (a > 1 && mag > MAX_MAG)
+      lifefatal("Scale is too large") ;
+   return a > 1 ? mag : -mag ;
+}
+
 const int MAXCMDLENGTH = 2048 ;
 struct cmdbase {
    cmdbase(const char *cmdarg, const char *argsarg) {
@@ -454,6 +825,7 @@ lifealgo *createUniverse() {
    if (imp == 0)
       lifefatal("Could not create universe") ;
    imp->setMaxMemory(maxmem) ;
+   imp->setNumThreads(nthreads) ;
    return imp ;
 }
 
@@ -495,6 +867,843 @@ struct edgescmd : public cmdbase {
    }
 } edges_inst ;
 
+/*
+ *   Soup census.  Each soup is a square of random cells, filled the way
+ *   Selection::RandomFill does it from a generator seeded with --seed
+ *   and the soup number, so the census does not depend on how many
+ *   threads run it.  A soup runs until its population has been periodic
+ *   for a while.  The ash is then split into objects (cells connected
+ *   in some phase of the ash), and each object runs on its own and is
+ *   named like apgsearch does: xs<pop>_ for still lifes, xp<period>_
+ *   for oscillators and xq<period>_ for spaceships, followed by the
+ *   extended Wechsler code of its smallest phase and orientation.
+ *   Every worker thread keeps one universe for all its soups.
+ */
+const int CENSUSMAXP = 60 ;             // longest ash period we look for
+const int CENSUSMAXCOORD = 1000000 ;    // give up on ash spread wider
+int censusmaxgens ;
+std::atomic<int> censusnext ;
+vector<lifealgo *> censusalgos ;
+vector<lifepoll> censuspollers ;   // default_poller is not thread safe
+vector<std::map<std::string, long long> > censusresults ;
+std::mutex censuslock ;
+unsigned long long soupmix(unsigned long long &s) {
+   unsigned long long z = (s += 0x9e3779b97f4a7c15ULL) ;
+   z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL ;
+   z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL ;
+   return z ^ (z >> 31) ;
+}
+// list the live cells; false if the pattern is too spread out
+bool censuscells(lifealgo *algo, vector<pair<int, int> > &cells) {
+   cells.clear() ;
+   if (algo->isEmpty())
+      return true ;
+   bigint t, l, b, r ;
+   algo->findedges(&t, &l, &b, &r) ;
+   if (t < -CENSUSMAXCOORD || l < -CENSUSMAXCOORD ||
+       b > CENSUSMAXCOORD || r > CENSUSMAXCOORD)
+      return false ;
+   int minx = l.toint() ;
+   int maxx = r.toint() ;
+   int v ;
+   for (int y=t.toint(); y<=b.toint(); y++) {
+      for (int x=minx; x<=maxx; x++) {
+         int dx = algo->nextcell(x, y, v) ;
+         if (dx < 0)
+            break ;
+         x += dx ;
+         if (x > maxx)
+            break ;
+         cells.push_back(make_pair(x, y)) ;
+      }
+   }
+   return true ;
+}
+bool censusclear(lifealgo *algo, vector<pair<int, int> > &cells) {
+   if (!censuscells(algo, cells))
+      return false ;
+   for (unsigned int i=0; i<cells.size(); i++)
+      algo->setcell(cells[i].first, cells[i].second, 0) ;
+   algo->endofpattern() ;
+   return true ;
+}
+// extended Wechsler format: strips of five rows, one digit per column
+const char *ewfdigits = "0123456789abcdefghijklmnopqrstuvwxyz" ;
+std::string wechsler(const vector<pair<int, int> > &cells) {
+   int wd = 0, ht = 0 ;
+   for (unsigned int i=0; i<cells.size(); i++) {
+      wd = std::max(wd, cells[i].first + 1) ;
+      ht = std::max(ht, cells[i].second + 1) ;
+   }
+   int strips = (ht + 4) / 5 ;
+   vector<int> cols(wd * strips) ;
+   for (unsigned int i=0; i<cells.size(); i++)
+      cols[cells[i].second / 5 * wd + cells[i].first] |=
+                                              1 << (cells[i].second % 5) ;
+   std::string s ;
+   for (int k=0; k<strips; k++) {
+      if (k > 0)
+         s += 'z' ;
+      int zeros = 0 ;
+      for (int x=0; x<wd; x++) {
+         int v = cols[k * wd + x] ;
+         if (v == 0) {
+            zeros++ ;
+            continue ;
+         }
+         while (zeros >= 4) {
+            int n = std::min(zeros, 39) ;
+            s += 'y' ;
+            s += ewfdigits[n - 4] ;
+            zeros -= n ;
+         }
+         if (zeros > 0)
+            s += "0wx"[zeros - 1] ;
+         zeros = 0 ;
+         s += ewfdigits[v] ;
+      }
+   }
+   return s ;
+}
+// the shortest, then alphabetically first, code over the 8 orientations
+void censuscanon(const vector<pair<int, int> > &cells, std::string &best) {
+   vector<pair<int, int> > t(cells.size()) ;
+   for (int o=0; o<8; o++) {
+      int minx = 0, miny = 0 ;
+      for (unsigned int i=0; i<cells.size(); i++) {
+         int x = (o & 1) ? -cells[i].first : cells[i].first ;
+         int y = (o & 2) ? -cells[i].second : cells[i].second ;
+         if (o & 4)
+            std::swap(x, y) ;
+         t[i] = make_pair(x, y) ;
+         if (i == 0 || x < minx)
+            minx = x ;
+         if (i == 0 || y < miny)
+            miny = y ;
+      }
+      for (unsigned int i=0; i<t.size(); i++) {
+         t[i].first -= minx ;
+         t[i].second -= miny ;
+      }
+      std::string s = wechsler(t) ;
+      if (best.empty() || s.size() < best.size() ||
+          (s.size() == best.size() && s < best))
+         best = s ;
+   }
+}
+// run one object of the ash on its own in an empty universe
+std::string censusobject(lifealgo *algo, const vector<pair<int, int> > &obj,
+                         vector<pair<int, int> > &cells) {
+   for (unsigned int i=0; i<obj.size(); i++)
+      algo->setcell(obj[i].first, obj[i].second, 1) ;
+   algo->endofpattern() ;
+   bigint gen0 = algo->getGeneration() ;
+   perioddetector pd(CENSUSMAXP) ;
+   for (int g=0; !pd.observe(*algo) && g<=CENSUSMAXP; g++)
+      algo->step() ;
+   std::string key = "zz_UNCLASSIFIED" ;
+   if (pd.period > 0 && pd.firstgen == gen0) {
+      std::string best ;
+      for (int i=0; i<pd.period; i++) {
+         if (!censuscells(algo, cells))
+            break ;
+         censuscanon(cells, best) ;
+         algo->step() ;
+      }
+      char prefix[32] ;
+      if (pd.dx != 0 || pd.dy != 0)
+         sprintf(prefix, "xq%d_", pd.period) ;
+      else if (pd.period == 1)
+         sprintf(prefix, "xs%d_", (int)obj.size()) ;
+      else
+         sprintf(prefix, "xp%d_", pd.period) ;
+      key = prefix + best ;
+   }
+   if (!censusclear(algo, cells))
+      key = "zz_UNCLASSIFIED" ;
+   return key ;
+}
+unsigned long long censuskey(int x, int y) {
+   return ((unsigned long long)(unsigned int)x << 32) | (unsigned int)y ;
+}
+int censusroot(vector<int> &parent, int a) {
+   while (parent[a] != a)
+      a = parent[a] = parent[parent[a]] ;
+   return a ;
+}
+// union cell j with the cell at x,y if that is live in some phase
+void censusjoin(vector<int> &parent,
+                std::unordered_map<unsigned long long, int> &index,
+                int j, int x, int y) {
+   std::unordered_map<unsigned long long, int>::iterator it =
+                                                   index.find(censuskey(x, y)) ;
+   if (it == index.end())
+      return ;
+   int a = censusroot(parent, j) ;
+   int b = censusroot(parent, it->second) ;
+   if (a != b)
+      parent[std::max(a, b)] = std::min(a, b) ;
+}
+// the shortest period of the recent populations, or 0
+int censusperiod(const std::deque<double> &pops) {
+   int n = (int)pops.size() ;
+   for (int p=1; p<=CENSUSMAXP; p++) {
+      int i = n - 1 ;
+      while (i >= n - 1 - 2 * CENSUSMAXP && pops[i] == pops[i-p])
+         i-- ;
+      if (i < n - 1 - 2 * CENSUSMAXP)
+         return p ;
+   }
+   return 0 ;
+}
+// returns false if the universe is left in an unknown state
+bool censussoup(lifealgo *algo, int soup, std::map<std::string, long long> &census) {
+   unsigned long long rs = ((unsigned long long)(unsigned int)soupseed << 32) |
+                           (unsigned int)soup ;
+   soupmix(rs) ;
+   for (int y=0; y<soupsize; y++)
+      for (int x=0; x<soupsize; x++)
+         if (soupmix(rs) % 100 < (unsigned long long)soupdensity)
+            algo->setcell(x, y, 1) ;
+   algo->endofpattern() ;
+   std::deque<double> pops ;
+   int period = 0 ;
+   for (int g=0; g<=censusmaxgens; g++) {
+      pops.push_back(algo->getPopulation().todouble()) ;
+      if ((int)pops.size() > 3 * CENSUSMAXP)
+         pops.pop_front() ;
+      if ((int)pops.size() == 3 * CENSUSMAXP && g % CENSUSMAXP == 0 &&
+          (period = censusperiod(pops)) != 0)
+         break ;
+      algo->step() ;
+   }
+   vector<pair<int, int> > ash, cells ;
+   if (period == 0) {
+      census["PATHOLOGICAL"]++ ;
+      return censusclear(algo, cells) ;
+   }
+   // cells live in any phase of the ash, so objects like the toad whose
+   // phases fall apart still come out in one piece; the population of
+   // such objects may not change, so look at a few phases regardless
+   std::unordered_map<unsigned long long, int> index ;
+   vector<int> parent ;
+   vector<pair<int, int> > all ;
+   for (int i=0; i<std::max(period, 8); i++) {
+      if (!censuscells(algo, cells)) {
+         census["PATHOLOGICAL"]++ ;
+         return false ;
+      }
+      if (i == 0)
+         ash = cells ;
+      for (unsigned int j=0; j<cells.size(); j++) {
+         unsigned long long k = censuskey(cells[j].first, cells[j].second) ;
+         if (index.insert(make_pair(k, (int)all.size())).second) {
+            parent.push_back((int)all.size()) ;
+            all.push_back(cells[j]) ;
+         }
+      }
+      algo->step() ;
+   }
+   if (!censusclear(algo, cells))
+      return false ;
+   for (unsigned int j=0; j<all.size(); j++)
+      for (int dy=-1; dy<=1; dy++)
+         for (int dx=-1; dx<=1; dx++)
+            censusjoin(parent, index, j, all[j].first + dx, all[j].second + dy) ;
+   std::map<int, int> objectof ;
+   vector<vector<pair<int, int> > > objects ;
+   for (unsigned int j=0; j<ash.size(); j++) {
+      int a = censusroot(parent, index[censuskey(ash[j].first, ash[j].second)]) ;
+      if (objectof.insert(make_pair(a, (int)objects.size())).second)
+         objects.push_back(vector<pair<int, int> >()) ;
+      objects[objectof[a]].push_back(ash[j]) ;
+   }
+   vector<std::string> keys(objects.size()) ;
+   bool failed = false ;
+   for (unsigned int i=0; i<objects.size(); i++) {
+      keys[i] = censusobject(algo, objects[i], cells) ;
+      if (keys[i][0] == 'z')
+         failed = true ;
+   }
+   if (failed) {
+      // pieces of objects like the pulsar only meet through births across
+      // a gap, so join each piece that failed on its own with everything
+      // within two cells of it and try the bigger objects
+      for (unsigned int j=0; j<all.size(); j++) {
+         std::map<int, int>::iterator it = objectof.find(censusroot(parent, j)) ;
+         if (it == objectof.end() || keys[it->second][0] != 'z')
+            continue ;
+         for (int dy=-2; dy<=2; dy++)
+            for (int dx=-2; dx<=2; dx++)
+               censusjoin(parent, index, j, all[j].first + dx, all[j].second + dy) ;
+      }
+      std::map<int, vector<int> > groups ;
+      for (std::map<int, int>::iterator it=objectof.begin(); it != objectof.end(); it++)
+         groups[censusroot(parent, it->first)].push_back(it->second) ;
+      for (std::map<int, vector<int> >::iterator it=groups.begin(); it != groups.end(); it++) {
+         vector<int> &g = it->second ;
+         if (g.size() < 2)
+            continue ;
+         vector<pair<int, int> > merged ;
+         for (unsigned int i=0; i<g.size(); i++) {
+            merged.insert(merged.end(), objects[g[i]].begin(), objects[g[i]].end()) ;
+            keys[g[i]].clear() ;
+         }
+         keys[g[0]] = censusobject(algo, merged, cells) ;
+      }
+   }
+   for (unsigned int i=0; i<keys.size(); i++)
+      if (!keys[i].empty())
+         census[keys[i]]++ ;
+   return true ;
+}
+lifealgo *censusuniverse(int worker) {
+   lifealgo *algo = createUniverse() ;
+   algo->setNumThreads(1) ;
+   algo->setpoll(&censuspollers[worker]) ;
+   const char *err = algo->setrule(liferule ? liferule : algo->DefaultRule()) ;
+   if (err)
+      lifefatal(err) ;
+   if (algo->NumCellStates() != 2)
+      lifefatal("Census needs a two-state rule") ;
+   if (algo->gridwd > 0 || algo->gridht > 0)
+      lifefatal("Census needs an unbounded universe") ;
+   algo->setIncrement(1) ;
+   return algo ;
+}
+class censustask : public lifetask {
+public:
+   virtual void run(int worker) {
+      for (;;) {
+         int soup = censusnext++ ;
+         if (soup >= censussoups)
+            break ;
+         if (!censussoup(censusalgos[worker], soup, censusresults[worker])) {
+            // start this worker over with a fresh universe
+            std::lock_guard<std::mutex> lk(censuslock) ;
+            delete censusalgos[worker] ;
+            censusalgos[worker] = censusuniverse(worker) ;
+         }
+      }
+   }
+} ;
+bool censusorder(const pair<long long, std::string> &a,
+                 const pair<long long, std::string> &b) {
+   if (a.first != b.first)
+      return a.first > b.first ;
+   return a.second < b.second ;
+}
+void runcensus() {
+   if (soupsize < 1 || soupsize > 4096)
+      lifefatal("Soup size must be from 1 to 4096") ;
+   if (soupdensity < 1 || soupdensity > 100)
+      lifefatal("Density must be from 1 to 100") ;
+   censusmaxgens = (maxgen > 0 && maxgen < 1000000000) ? maxgen.toint() : 100000 ;
+   int nworkers = nthreads < 1 ? 1 : nthreads ;
+   censuspollers.resize(nworkers) ;
+   for (int i=0; i<nworkers; i++)
+      censusalgos.push_back(censusuniverse(i)) ;
+   censusresults.resize(nworkers) ;
+   double t0 = gollySecondCount() ;
+   {
+      lifethreads threads(nworkers) ;
+      lifetaskgroup g ;
+      vector<censustask> tasks(nworkers) ;
+      for (int i=0; i<nworkers; i++)
+         threads.spawn(0, &tasks[i], g) ;
+      threads.wait(0, g) ;
+   }
+   double secs = gollySecondCount() - t0 ;
+   std::map<std::string, long long> census ;
+   long long objects = 0 ;
+   for (int i=0; i<nworkers; i++)
+      for (std::map<std::string, long long>::iterator it=censusresults[i].begin();
+           it != censusresults[i].end(); it++) {
+         census[it->first] += it->second ;
+         objects += it->second ;
+      }
+   vector<pair<long long, std::string> > sorted ;
+   for (std::map<std::string, long long>::iterator it=census.begin();
+        it != census.end(); it++)
+      sorted.push_back(make_pair(it->second, it->first)) ;
+   std::sort(sorted.begin(), sorted.end(), censusorder) ;
+   cout << "Census of " << censussoups << " soups, " << soupsize << "x"
+        << soupsize << " at " << soupdensity << "%, seed " << soupseed
+        << ", rule " << censusalgos[0]->getrule() << endl ;
+   for (unsigned int i=0; i<sorted.size(); i++)
+      cout << sorted[i].first << " " << sorted[i].second << endl ;
+   cout << objects << " objects in " << secs << " seconds, "
+        << (secs > 0 ? censussoups / secs : 0) << " soups per second" << endl ;
+   exit(0) ;
+}
+
+/*
+ *   Server mode.  bgolly --server reads binary requests from a Unix
+ *   socket (or stdin and stdout for --server -) and keeps any number of
+ *   named universes alive between them.  Every request and reply is a
+ *   little-endian u32 byte count followed by that many bytes.  A
+ *   request starts with a u8 opcode; a reply starts with a u8 status,
+ *   0 for success or 1 for an error followed by the message.  Strings
+ *   are a u32 length and the bytes; bigints are sent as decimal
+ *   strings.  Cell lists are a u32 count and that many i32 x,y,state
+ *   triples; rectangles are i32 x,y,wd,ht and wd*ht state bytes, row by
+ *   row.  Replies come back in request order, and every request
+ *   already read is answered before waiting for more, so clients may
+ *   pipeline as deep as they like.
+ *
+ *   op  request                           reply
+ *    1  new name algo rule                -
+ *    2  delete name                       -
+ *    3  load name file                    -
+ *    4  save name file (.rle/.mc[.gz])    -
+ *    5  setrule name rule                 -
+ *    6  step name increment               generation population
+ *    7  info name                         generation population rule
+ *                                         algo top left bottom right
+ *    8  setcells name cells               -
+ *    9  getcells name x y wd ht           cells (whole pattern if wd or
+ *                                         ht is 0)
+ *   10  setrect name x y wd ht bytes      -
+ *   11  getrect name x y wd ht            bytes
+ *   12  list                              u32 count, names
+ *   13  quit                              -
+ *
+ *   An empty algo or rule asks for the default; an empty pattern has
+ *   empty edge strings.
+ */
+enum { SRV_NEW = 1, SRV_DELETE, SRV_LOAD, SRV_SAVE, SRV_SETRULE, SRV_STEP,
+       SRV_INFO, SRV_SETCELLS, SRV_GETCELLS, SRV_SETRECT, SRV_GETRECT,
+       SRV_LIST, SRV_QUIT } ;
+const unsigned int SERVERMAXRECT = 1 << 30 ;   // bytes in one getrect
+std::map<std::string, lifealgo *> universes ;
+std::map<std::string, std::string> universealgos ;
+std::string servermsg ;
+/*
+ *   While serving, warnings become the error message of the current
+ *   request instead of going to stdout, which may be our reply stream.
+ */
+class servererrors : public stderrors {
+public:
+   virtual void fatal(const char *s) { cerr << "Fatal error: " << s << endl ; exit(10) ; }
+   virtual void warning(const char *s) {
+      if (!servermsg.empty())
+         servermsg += "\n" ;
+      servermsg += s ;
+   }
+   virtual void status(const char *) {}
+} ;
+servererrors servererrors_instance ;
+struct serverreader {
+   serverreader(const unsigned char *parg, unsigned int len) :
+      p(parg), end(parg + len), bad(false) {}
+   bool need(size_t n) {
+      if ((size_t)(end - p) < n)
+         bad = true ;
+      return !bad ;
+   }
+   unsigned int u32() {
+      if (!need(4))
+         return 0 ;
+      unsigned int v = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24) ;
+      p += 4 ;
+      return v ;
+   }
+   int i32() { return (int)u32() ; }
+   std::string str() {
+      unsigned int n = u32() ;
+      if (!need(n))
+         return std::string() ;
+      std::string r((const char *)p, n) ;
+      p += n ;
+      return r ;
+   }
+   const unsigned char *bytes(size_t n) {
+      if (!need(n))
+         return 0 ;
+      const unsigned char *r = p ;
+      p += n ;
+      return r ;
+   }
+   const unsigned char *p, *end ;
+   bool bad ;
+} ;
+void serverput32(std::string &out, unsigned int v) {
+   char b[4] = { (char)v, (char)(v >> 8), (char)(v >> 16), (char)(v >> 24) } ;
+   out.append(b, 4) ;
+}
+void serverputstr(std::string &out, const std::string &s) {
+   serverput32(out, (unsigned int)s.size()) ;
+   out += s ;
+}
+void serverreply(std::string &out, int status, const std::string &body) {
+   serverput32(out, (unsigned int)body.size() + 1) ;
+   out += (char)status ;
+   out += body ;
+}
+lifealgo *serveruniverse(const std::string &algo, const std::string &rule) {
+   const char *name = algo.empty() ? "QuickLife" : algo.c_str() ;
+   if (strcmp(name, "RuleTable") == 0 || strcmp(name, "RuleTree") == 0)
+      name = "RuleLoader" ;
+   staticAlgoInfo *ai = staticAlgoInfo::byName(name) ;
+   if (ai == 0) {
+      lifewarning("No such algorithm") ;
+      return 0 ;
+   }
+   lifealgo *u = (ai->creator)() ;
+   if (u == 0) {
+      lifewarning("Could not create universe") ;
+      return 0 ;
+   }
+   u->setMaxMemory(maxmem) ;
+   u->setNumThreads(nthreads) ;
+   const char *err = u->setrule(rule.empty() ? u->DefaultRule() : rule.c_str()) ;
+   if (err) {
+      lifewarning(err) ;
+      delete u ;
+      return 0 ;
+   }
+   return u ;
+}
+class servervisitor : public lifecellvisitor {
+public:
+   servervisitor(std::string &b) : body(b), count(0) {}
+   virtual void cell(int x, int y, int state) {
+      serverput32(body, x) ;
+      serverput32(body, y) ;
+      serverput32(body, state) ;
+      count++ ;
+   }
+   std::string &body ;
+   unsigned int count ;
+} ;
+// append the live cells in a rect (or the whole pattern if wd or ht is
+// 0) as a count and x,y,state triples; false if beyond editing limits
+bool servercells(lifealgo *u, int x, int y, int wd, int ht, std::string &body) {
+   size_t countat = body.size() ;
+   serverput32(body, 0) ;
+   servervisitor v(body) ;
+   if (wd <= 0 || ht <= 0) {
+      if (u->visitallcells(v) < 0)
+         return false ;
+   } else {
+      u->visitcells(v, x, y, wd, ht) ;
+   }
+   std::string c ;
+   serverput32(c, v.count) ;
+   body.replace(countat, 4, c) ;
+   return true ;
+}
+// handle one request; returns true if we should quit
+bool serverrequest(const unsigned char *req, unsigned int len, std::string &out) {
+   serverreader r(req, len) ;
+   std::string body ;
+   servermsg.clear() ;
+   bool ok = true, quit = false ;
+   int op = r.need(1) ? *r.bytes(1) : 0 ;
+   lifealgo *u = 0 ;
+   std::string name ;
+   if (op != SRV_LIST && op != SRV_QUIT) {
+      name = r.str() ;
+      std::map<std::string, lifealgo *>::iterator it = universes.find(name) ;
+      if (it != universes.end())
+         u = it->second ;
+      else if (op != SRV_NEW && !r.bad) {
+         lifewarning("No such universe") ;
+         ok = false ;
+      }
+   }
+   bool bounded = u && u->unbounded && (u->gridwd > 0 || u->gridht > 0) ;
+   if (ok) switch (op) {
+case SRV_NEW:
+      {
+         std::string algo = r.str() ;
+         std::string rule = r.str() ;
+         if (r.bad)
+            break ;
+         lifealgo *nu = serveruniverse(algo, rule) ;
+         if (nu == 0) {
+            ok = false ;
+            break ;
+         }
+         delete u ;
+         universes[name] = nu ;
+         universealgos[name] = algo.empty() ? "QuickLife" : algo ;
+      }
+      break ;
+case SRV_DELETE:
+      delete u ;
+      universes.erase(name) ;
+      universealgos.erase(name) ;
+      break ;
+case SRV_LOAD:
+      {
+         std::string file = r.str() ;
+         if (r.bad)
+            break ;
+         const char *err = readpattern(file.c_str(), *u) ;
+         if (err) {
+            lifewarning(err) ;
+            ok = false ;
+         }
+      }
+      break ;
+case SRV_SAVE:
+      {
+         std::string file = r.str() ;
+         if (r.bad)
+            break ;
+         pattern_format format = RLE_format ;
+         output_compression compression = no_compression ;
+         const char *f = file.c_str() ;
+         if (endswith(f, ".mc")) {
+            format = MC_format ;
+#ifdef ZLIB
+         } else if (endswith(f, ".rle.gz")) {
+            compression = gzip_compression ;
+         } else if (endswith(f, ".mc.gz")) {
+            format = MC_format ;
+            compression = gzip_compression ;
+#endif
+         }
+         bigint t, l, b, rt ;
+         u->findedges(&t, &l, &b, &rt) ;
+         const char *err = writepattern(f, *u, format, compression,
+                                        t, l, b, rt, gzthreads) ;
+         if (err) {
+            lifewarning(err) ;
+            ok = false ;
+         }
+      }
+      break ;
+case SRV_SETRULE:
+      {
+         std::string rule = r.str() ;
+         if (r.bad)
+            break ;
+         const char *err = u->setrule(rule.c_str()) ;
+         if (err) {
+            lifewarning(err) ;
+            ok = false ;
+         }
+      }
+      break ;
+case SRV_STEP:
+      {
+         std::string incstr = r.str() ;
+         if (r.bad)
+            break ;
+         bigint n(incstr.c_str()) ;
+         if (bounded) {
+            // bounded grid, so must step by 1
+            u->setIncrement(1) ;
+            for (bigint i = 0 ; ok && i < n ; i += 1) {
+               ok = u->CreateBorderCells() ;
+               u->step() ;
+               ok = ok && u->DeleteBorderCells() ;
+            }
+         } else if (n > 0) {
+            u->setIncrement(n) ;
+            u->step() ;
+         }
+         serverputstr(body, u->getGeneration().tostring(0)) ;
+         serverputstr(body, u->getPopulation().tostring(0)) ;
+      }
+      break ;
+case SRV_INFO:
+      serverputstr(body, u->getGeneration().tostring(0)) ;
+      serverputstr(body, u->getPopulation().tostring(0)) ;
+      serverputstr(body, u->getrule()) ;
+      serverputstr(body, universealgos[name]) ;
+      if (u->isEmpty()) {
+         for (int i=0; i<4; i++)
+            serverputstr(body, "") ;
+      } else {
+         bigint t, l, b, rt ;
+         u->findedges(&t, &l, &b, &rt) ;
+         serverputstr(body, t.tostring(0)) ;
+         serverputstr(body, l.tostring(0)) ;
+         serverputstr(body, b.tostring(0)) ;
+         serverputstr(body, rt.tostring(0)) ;
+      }
+      break ;
+case SRV_SETCELLS:
+      {
+         unsigned int n = r.u32() ;
+         if (r.bad || !r.need((size_t)n * 12))
+            break ;
+         std::vector<int> cells((size_t)n * 3) ;
+         for (size_t i=0; i<cells.size(); i++)
+            cells[i] = r.i32() ;
+         if (n > 0 && u->setcells(&cells[0], (int)n, true) < 0) {
+            lifewarning("Cell state out of range or cell beyond editing limits") ;
+            ok = false ;
+         }
+         u->endofpattern() ;
+      }
+      break ;
+case SRV_GETCELLS:
+      {
+         int x = r.i32(), y = r.i32(), wd = r.i32(), ht = r.i32() ;
+         if (r.bad)
+            break ;
+         if (!servercells(u, x, y, wd, ht, body)) {
+            lifewarning("Pattern is beyond editing limits") ;
+            ok = false ;
+         }
+      }
+      break ;
+case SRV_SETRECT:
+      {
+         int x = r.i32(), y = r.i32(), wd = r.i32(), ht = r.i32() ;
+         if (r.bad || wd < 0 || ht < 0) {
+            r.bad = true ;
+            break ;
+         }
+         const unsigned char *cells = r.bytes((size_t)wd * ht) ;
+         if (r.bad)
+            break ;
+         if (u->setrect(cells, x, y, wd, ht) < 0) {
+            lifewarning("Cell state out of range or cell beyond editing limits") ;
+            ok = false ;
+         }
+         u->endofpattern() ;
+      }
+      break ;
+case SRV_GETRECT:
+      {
+         int x = r.i32(), y = r.i32(), wd = r.i32(), ht = r.i32() ;
+         if (r.bad || wd < 0 || ht < 0) {
+            r.bad = true ;
+            break ;
+         }
+         if ((double)wd * ht > SERVERMAXRECT) {
+            lifewarning("Rectangle is too big") ;
+            ok = false ;
+            break ;
+         }
+         size_t at = body.size() ;
+         body.resize(at + (size_t)wd * ht) ;
+         if (wd > 0 && ht > 0)
+            u->getcells((unsigned char *)&body[at], x, y, wd, ht) ;
+      }
+      break ;
+case SRV_LIST:
+      serverput32(body, (unsigned int)universes.size()) ;
+      for (std::map<std::string, lifealgo *>::iterator it=universes.begin();
+           it != universes.end(); it++)
+         serverputstr(body, it->first) ;
+      break ;
+case SRV_QUIT:
+      quit = true ;
+      break ;
+default:
+      lifewarning("Unknown request") ;
+      ok = false ;
+      break ;
+   }
+   if (r.bad) {
+      servermsg = "Malformed request" ;
+      ok = false ;
+   }
+   if (ok)
+      serverreply(out, 0, body) ;
+   else
+      serverreply(out, 1, servermsg) ;
+   return quit ;
+}
+int serverread(int fd, char *buf, int len) {
+#ifdef _WIN32
+   return _read(fd, buf, len) ;
+#else
+   return (int)read(fd, buf, len) ;
+#endif
+}
+bool serverwrite(int fd, const std::string &out) {
+   size_t done = 0 ;
+   while (done < out.size()) {
+#ifdef _WIN32
+      int n = _write(fd, out.data() + done, (unsigned int)(out.size() - done)) ;
+#else
+      int n = (int)write(fd, out.data() + done, out.size() - done) ;
+#endif
+      if (n <= 0)
+         return false ;
+      done += n ;
+   }
+   return true ;
+}
+// serve one client; returns true if it asked us to quit
+bool serveconnection(int in, int out) {
+   std::string inbuf, outbuf ;
+   size_t pos = 0 ;
+   vector<char> chunk(1 << 16) ;
+   for (;;) {
+      // answer everything that has arrived before blocking for more
+      while (inbuf.size() - pos >= 4) {
+         const unsigned char *p = (const unsigned char *)inbuf.data() + pos ;
+         unsigned int len = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24) ;
+         if (inbuf.size() - pos - 4 < len)
+            break ;
+         bool quit = serverrequest(p + 4, len, outbuf) ;
+         pos += 4 + (size_t)len ;
+         if (quit) {
+            serverwrite(out, outbuf) ;
+            return true ;
+         }
+      }
+      if (!outbuf.empty()) {
+         if (!serverwrite(out, outbuf))
+            return false ;
+         outbuf.clear() ;
+      }
+      inbuf.erase(0, pos) ;
+      pos = 0 ;
+      int n = serverread(in, &chunk[0], (int)chunk.size()) ;
+      if (n <= 0)
+         return false ;
+      inbuf.append(&chunk[0], n) ;
+   }
+}
+void runserver(const char *path) {
+   lifeerrors::seterrorhandler(&servererrors_instance) ;
+   if (strcmp(path, "-") == 0) {
+#ifdef _WIN32
+      _setmode(0, _O_BINARY) ;
+      _setmode(1, _O_BINARY) ;
+#endif
+      serveconnection(0, 1) ;
+      exit(0) ;
+   }
+#ifdef _WIN32
+   lifefatal("Only --server - is supported on Windows") ;
+#else
+   struct sockaddr_un addr ;
+   memset(&addr, 0, sizeof(addr)) ;
+   addr.sun_family = AF_UNIX ;
+   if (strlen(path) >= sizeof(addr.sun_path))
+      lifefatal("Socket path too long") ;
+   strcpy(addr.sun_path, path) ;
+   unlink(path) ;
+   int s = socket(AF_UNIX, SOCK_STREAM, 0) ;
+   if (s < 0 || bind(s, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+       listen(s, 8) != 0)
+      lifefatal("Cannot listen on socket") ;
+   cerr << "Serving on " << path << endl ;
+   for (;;) {
+      int c = accept(s, 0, 0) ;
+      if (c < 0)
+         continue ;
+      bool quit = serveconnection(c, c) ;
+      close(c) ;
+      if (quit)
+         break ;
+   }
+   close(s) ;
+   unlink(path) ;
+#endif
+   exit(0) ;
+}
+
 void runtestscript(const char *testscript) {
    FILE *cmdfile = 0 ;
    if (strcmp(testscript, "-") != 0)
@@ -518,12 +1727,23 @@ void runtestscript(const char *testscript) {
 }
 
 int main(int argc, char *argv[]) {
-   cout << "This is bgolly " STRINGIFY(VERSION) " Copyright 2005-2026 The Golly Gang."
-        << endl ;
-   cout << "-" ;
-   for (int i=0; i<argc; i++)
-      cout << " " << argv[i] ;
-   cout << endl << flush ;
+   // stdout carries the replies when serving on stdin, so no banner then
+   bool stdioserver = false ;
+   for (int i=1; i+1<argc; i++) {
+      if (strcmp(argv[i], "--server") == 0)
+         stdioserver = (strcmp(argv[i+1], "-") == 0) ;
+      // stdout carries the frames, so everything else goes to stderr
+      if (strcmp(argv[i], "--frames") == 0 && strcmp(argv[i+1], "-") == 0)
+         cout.rdbuf(cerr.rdbuf()) ;
+   }
+   if (!stdioserver) {
+      cout << "This is bgolly " STRINGIFY(VERSION) " Copyright 2005-2026 The Golly Gang."
+           << endl ;
+      cout << "-" ;
+      for (int i=0; i<argc; i++)
+         cout << " " << argv[i] ;
+      cout << endl << flush ;
+   }
    qlifealgo::doInitializeAlgoInfo(staticAlgoInfo::tick()) ;
    hlifealgo::doInitializeAlgoInfo(staticAlgoInfo::tick()) ;
    generationsalgo::doInitializeAlgoInfo(staticAlgoInfo::tick()) ;
@@ -572,10 +1792,26 @@ case 's':
       if (!hit)
          usage("Bad option given") ;
    }
-   if (argc < 2 && !testscript)
+   if (argc < 2 && !testscript && !censussoups && !serverpath)
       usage("No pattern argument given") ;
    if (argc > 2)
       usage("Extra stuff after pattern argument") ;
+   if (sscanf(rendersize, "%dx%d", &renderwd, &renderht) != 2 ||
+       renderwd < 1 || renderht < 1 || renderwd > 32768 || renderht > 32768)
+      lifefatal("Rendering size must be WIDTHxHEIGHT") ;
+   rendermag = scalemag(renderscale) ;
+   if (framename && strcmp(framename, "-") != 0) {
+      if (endswith(framename, ".rgba")) {
+#ifdef ZLIB
+      } else if (endswith(framename, ".png")) {
+         frameoffset = numberoffset ;
+#endif
+      } else {
+         lifefatal("Frame filename must end with .png or .rgba, or be -.") ;
+      }
+      if (strlen(framename) > 200)
+         lifefatal("Frame filename too long") ;
+   }
    if (outfilename) {
       if (endswith(outfilename, ".rle")) {
       } else if (endswith(outfilename, ".mc")) {
@@ -604,7 +1840,12 @@ case 's':
       hlifealgo::setVerbose(1) ;
    }
    imp->setMaxMemory(maxmem) ;
+   imp->setNumThreads(nthreads) ;
    timestamp() ;
+   if (censussoups > 0)
+      runcensus() ;
+   if (serverpath)
+      runserver(serverpath) ;
    if (testscript) {
       if (argc > 1) {
          filename = argv[1] ;
@@ -629,6 +1870,15 @@ case 's':
    }
    if (inc != 0)
       imp->setIncrement(inc) ;
+   viewport.resize(renderwd, renderht) ;
+   viewport.setmag(rendermag) ;
+   if (framename) {
+      // start centered on the pattern; only autofit changes the scale
+      imp->fit(viewport, 1) ;
+      if (!autofit)
+         viewport.setmag(rendermag) ;
+      startframes() ;
+   }
    if (timeline) {
       int lowbit = inc.lowbitset() ;
       bigint t = 1 ;
@@ -638,6 +1888,26 @@ case 's':
          lifefatal("Bad increment for timeline") ;
       imp->startrecording(2, lowbit) ;
    }
+   if (detectperiod > 0) {
+      imp->setIncrement(1) ;
+      perioddetector pd(detectperiod) ;
+      while (!pd.observe(*imp)) {
+         if (maxgen >= 0 && imp->getGeneration() >= maxgen)
+            break ;
+         if (boundedgrid && !imp->CreateBorderCells()) break ;
+         imp->step() ;
+         if (boundedgrid && !imp->DeleteBorderCells()) break ;
+      }
+      if (pd.period > 0)
+         cout << "Period " << pd.period << " displacement " << pd.dx << " "
+              << pd.dy << " from generation " << pd.firstgen.tostring() << endl ;
+      else
+         cout << "No period found by generation "
+              << imp->getGeneration().tostring() << endl ;
+      if (outfilename != 0)
+         writepat(-1) ;
+      exit(0) ;
+   }
    int fc = 0 ;
    for (;;) {
       if (benchmark)
@@ -660,9 +1930,11 @@ case 's':
       if (popcount)
          imp->getPopulation() ;
       if (autofit)
-        imp->fit(viewport, 1) ;
+        imp->fit(viewport, autofit < 2) ;
       if (render)
         imp->draw(viewport, renderer) ;
+      if (framename)
+        renderframe() ;
       if (maxgen >= 0 && imp->getGeneration() >= maxgen)
          break ;
       if (!hyperxxx && maxgen > 0 && inc == 0) {
@@ -684,6 +1956,11 @@ case 's':
       if (hyperxxx)
          imp->setIncrement(imp->getGeneration()) ;
    }
+   if (frames) {
+      frames->finish() ;
+      if (frames->error)
+         lifefatal(frames->error) ;
+   }
    if (maxgen >= 0 && outfilename != 0)
       writepat(-1) ;
    exit(0) ;
@@ -13,8 +13,10 @@ using namespace std ;
 /**
  *   Static data.
  */
-static const int MAX_SIMPLE = 0x3fffffff ;
-static const int MIN_SIMPLE = -0x40000000 ;
+static const intptr_t MAX_SIMPLE = (intptr_t)(~(uintptr_t)0 >> 2) ;
+static const intptr_t MIN_SIMPLE = -MAX_SIMPLE - 1 ;
+// the highest shift that still makes sense for a direct value
+static const int SIMPLE_SHIFT = 8 * (int)sizeof(intptr_t) - 1 ;
 char *bigint::printbuf ;
 int *bigint::work ;
 int bigint::printbuflen ;
@@ -24,12 +26,11 @@ int bigint::sepcount = 3 ;
 /**
  *   Routines.
  */
-bigint::bigint(G_INT64 i) {
-   if (i <= INT_MAX && i >= INT_MIN)
-      fromint((int)i) ;
+void bigint::fromint64(G_INT64 i) {
+   if (i <= MAX_SIMPLE && i >= MIN_SIMPLE)
+      v.i = ((intptr_t)i << 1) | 1 ;
    else {
-      v.i = 0 ;
-      vectorize(0) ;
+      v.p = new int[4] ;
       v.p[0] = 3 ;
       v.p[1] = (int)(i & 0x7fffffff) ;
       v.p[2] = (int)((i >> 31) & 0x7fffffff) ;
@@ -44,10 +45,10 @@ bigint::bigint(G_INT64 i) {
 bigint::bigint(const char *s) {
    if (*s == '2' && s[1] == '^') {
       long x = atol(s+2) ;
-      if (x < 31)
-         fromint(1 << x) ;
+      if (x < 62)
+         fromint64((G_INT64)1 << x) ;
       else {
-         int sz = 2 + int((x + 1) / 31) ;
+         int sz = 2 + int(x / 31) ;
          int asz = sz ;
          while (asz & (asz - 1))
             asz &= asz - 1 ;
@@ -78,7 +79,7 @@ bigint::bigint(const char *s) {
       }
    }
 }
-static int *copyarr(int *p) {
+int *bigint::copyarr(const int *p) {
    int sz = *p ;
    while (sz & (sz - 1))
       sz &= sz - 1 ;
@@ -91,17 +92,11 @@ static int *copyarr(int *p) {
 #endif
    return r ;
 }
-bigint::bigint(const bigint &a) {
-   if (a.v.i & 1)
-      v.i = a.v.i ;
-   else
-      v.p = copyarr(a.v.p) ;
-}
 /**
  *   We special-case the p=0 case so we can "initialize" bigint memory
  *   with zero.
  */
-bigint &bigint::operator=(const bigint &b) {
+bigint &bigint::assign(const bigint &b) {
    if (&b != this) {
       if (0 == (v.i & 1))
          if (v.p)
@@ -113,15 +108,12 @@ bigint &bigint::operator=(const bigint &b) {
    }
    return *this ;
 }
-bigint::~bigint() {
-   if (0 == (v.i & 1))
-      delete [] v.p ;
-}
 bigint::bigint(const bigint &a, const bigint &b, const bigint &c, const bigint &d) {
-   const int checkmask = 0xf0000001 ;
+   // hot path:  with the top three bits of each value clear (or all
+   // set) the sum cannot overflow
+   const intptr_t checkmask = (intptr_t)(~(~(uintptr_t)0 >> 4) | 1) ;
    if ((a.v.i & checkmask) == 1 && (b.v.i & checkmask) == 1 &&
        (c.v.i & checkmask) == 1 && (d.v.i & checkmask) == 1) {
-      // hot path
       v.i = a.v.i + b.v.i + c.v.i + d.v.i - 3 ;
       return ;
    }
@@ -141,16 +133,18 @@ const char *bigint::tostring(char sep) const {
       printbuf = new char[2 * lenreq] ;
       printbuflen = 2 * lenreq ;
    }
-   int sz = 1 ;
+   int sz = 3 ;
    if (0 == (v.i & 1))
       sz = size() ;
    ensurework(sz) ;
    int neg = sign() < 0 ;
    if (v.i & 1) {
+      G_INT64 c = v.i >> 1 ;
       if (neg)
-         work[0] = -(v.i >> 1) ;
-      else
-         work[0] = v.i >> 1 ;
+         c = -c ;
+      work[0] = (int)(c & 0x7fffffff) ;
+      work[1] = (int)((c >> 31) & 0x7fffffff) ;
+      work[2] = (int)(c >> 62) ;
    } else {
       if (neg) {
          int carry = 1 ;
@@ -220,28 +214,52 @@ void bigint::grow(int osz, int nsz) {
    v.p[nsz] = av ;
    v.p[0] = nsz ;
 }
-bigint& bigint::operator+=(const bigint &a) {
-   if (a.v.i & 1)
-      add_smallint(a.v.i >> 1) ;
-   else {
-      if (v.i & 1)
-         vectorize(v.i >> 1) ;
-      ripple(a, 0) ;
+/**
+ *   The slow paths of += and -=; here either the sum of two direct
+ *   values overflowed or one of the operands is an array.
+ */
+bigint& bigint::add(const bigint &a) {
+   if (v.i & a.v.i & 1) {
+      fromint64((G_INT64)(v.i >> 1) + (a.v.i >> 1)) ;
+      return *this ;
    }
+   if (v.i & 1)
+      vectorize(v.i >> 1) ;
+   if (a.v.i & 1) {
+      intptr_t c = a.v.i >> 1 ;
+      if (c > -0x40000000 && c < 0x40000000) {
+         ripple((int)c, 1) ;
+      } else {
+         bigint t ;
+         t.vectorize(c) ;
+         ripple(t, 0) ;
+      }
+   } else
+      ripple(a, 0) ;
    return *this ;
 }
-bigint& bigint::operator-=(const bigint &a) {
-   if (a.v.i & 1)
-      add_smallint(-(a.v.i >> 1)) ;
-   else {
-      if (v.i & 1)
-         vectorize(v.i >> 1) ;
-      ripplesub(a, 1) ;
+bigint& bigint::sub(const bigint &a) {
+   if (v.i & a.v.i & 1) {
+      fromint64((G_INT64)(v.i >> 1) - (a.v.i >> 1)) ;
+      return *this ;
    }
+   if (v.i & 1)
+      vectorize(v.i >> 1) ;
+   if (a.v.i & 1) {
+      intptr_t c = a.v.i >> 1 ;
+      if (c > -0x40000000 && c < 0x40000000) {
+         ripple(-(int)c, 1) ;
+      } else {
+         bigint t ;
+         t.vectorize(c) ;
+         ripplesub(t, 1) ;
+      }
+   } else
+      ripplesub(a, 1) ;
    return *this ;
 }
 int bigint::sign() const {
-   int si = v.i ;
+   intptr_t si = v.i ;
    if (0 == (si & 1))
       si = v.p[size()] ;
    if (si > 0)
@@ -255,7 +273,7 @@ int bigint::size() const {
 }
 void bigint::add_smallint(int a) {
    if (v.i & 1)
-      fromint((v.i >> 1) + a) ;
+      fromint64((G_INT64)(v.i >> 1) + a) ;
    else
       ripple(a, 1) ;
 }
@@ -266,14 +284,14 @@ void bigint::shrink(int pos) {
       v.p[pos] = v.p[pos+1] ;
       v.p[0] = pos ;
    }
-   if (pos == 1) {
-      int c = v.p[1] ;
-      delete [] v.p ;
-      v.i = 1 | (c << 1) ;
-   } else if (pos == 2 && ((v.p[2] ^ v.p[1]) & 0x40000000) == 0) {
-      int c = v.p[1] + (v.p[2] << 31) ;
-      delete [] v.p ;
-      v.i = 1 | (c << 1) ;
+   if (pos <= 3) {
+      G_INT64 c = v.p[pos] ;
+      for (int i=pos-1; i>0; i--)
+         c = c * G_MAKEINT64(0x80000000) + v.p[i] ;
+      if (c <= MAX_SIMPLE && c >= MIN_SIMPLE) {
+         delete [] v.p ;
+         v.i = ((intptr_t)c << 1) | 1 ;
+      }
    }
 }
 void grow(int osz, int nsz) ;
@@ -331,21 +349,19 @@ void bigint::ripplesub(const bigint &a, int carry) {
    ripple(carry + ~a.v.p[pos], pos) ;
 }
 // make sure it's in vector form; may leave it not canonical!
-void bigint::vectorize(int i) {
+void bigint::vectorize(G_INT64 i) {
    v.p = new int[4] ;
-   v.p[0] = 2 ;
-   v.p[1] = i & 0x7fffffff ;
+   v.p[0] = 3 ;
+   v.p[1] = (int)(i & 0x7fffffff) ;
+   v.p[2] = (int)((i >> 31) & 0x7fffffff) ;
    if (i < 0)
-      v.p[2] = -1 ;
+      v.p[3] = -1 ;
    else
-      v.p[2] = 0 ;
-#ifdef SLOWCHECK
-   v.p[3] = 0xdeadbeef ;
-#endif
+      v.p[3] = 0 ;
 }
 void bigint::fromint(int i) {
    if (i <= MAX_SIMPLE && i >= MIN_SIMPLE)
-      v.i = (i << 1) | 1 ;
+      v.i = ((intptr_t)i << 1) | 1 ;
    else
       vectorize(i) ;
 }
@@ -366,8 +382,7 @@ void bigint::mul_smallint(int a) {
    }
    if (v.i & 1) {
       if (MIN_SIMPLE / a <= (v.i >> 1) && (v.i >> 1) <= MAX_SIMPLE / a) {
-         c = (v.i >> 1) * a ;
-         fromint((v.i >> 1) * a) ;
+         v.i = (((v.i >> 1) * a) << 1) | 1 ;
          return ;
       }
       vectorize(v.i >> 1) ;
@@ -396,8 +411,7 @@ void bigint::mul_smallint(int a) {
 }
 void bigint::div_smallint(int a) {
    if (v.i & 1) {
-      int r = (v.i >> 1) / a ;
-      fromint(r) ;
+      v.i = (((v.i >> 1) / a) << 1) | 1 ;
       return ;
    }
    if (v.p[v.p[0]] < 0)
@@ -414,12 +428,12 @@ void bigint::div_smallint(int a) {
 }
 int bigint::mod_smallint(int a) {
    if (v.i & 1)
-      return (((v.i >> 1) % a) + a) % a ;
+      return (int)((((v.i >> 1) % a) + a) % a) ;
    int pos = v.p[0] ;
    int mm = (2 * ((1 << 30) % a) % a) ;
    int r = 0 ;
    while (pos > 0) {
-      r = (mm * r + v.p[pos]) % a ;
+      r = (int)(((G_INT64)mm * r + v.p[pos]) % a) ;
       pos-- ;
    }
    return (r + a) % a ;
@@ -440,8 +454,8 @@ void bigint::div2() {
 }
 bigint& bigint::operator>>=(int i) {
    if (v.i & 1) {
-      if (i > 31)
-         v.i = ((v.i >> 31) | 1) ;
+      if (i > SIMPLE_SHIFT)
+         v.i = ((v.i >> SIMPLE_SHIFT) | 1) ;
       else
          v.i = ((v.i >> i) | 1) ;
       return *this ;
@@ -473,8 +487,9 @@ bigint& bigint::operator<<=(int i) {
    if (v.i & 1) {
       if (v.i == 1)
          return *this ;
-      if (i < 30 && (v.i >> 31) == (v.i >> (31 - i))) {
-         v.i = ((v.i & ~1) << i) | 1 ;
+      if (i < SIMPLE_SHIFT - 1 &&
+          (v.i >> SIMPLE_SHIFT) == (v.i >> (SIMPLE_SHIFT - i))) {
+         v.i = (intptr_t)((uintptr_t)(v.i & ~1) << i) | 1 ;
          return *this ;
       }
       vectorize(v.i >> 1) ;
@@ -509,89 +524,57 @@ void bigint::mulpow2(int p) {
 }
 int bigint::even() const {
    if (v.i & 1)
-      return 1-((v.i >> 1) & 1) ;
+      return 1-(int)((v.i >> 1) & 1) ;
    else
       return 1-(v.p[1] & 1) ;
 }
 int bigint::odd() const {
    if (v.i & 1)
-      return ((v.i >> 1) & 1) ;
+      return (int)((v.i >> 1) & 1) ;
    else
       return (v.p[1] & 1) ;
 }
 int bigint::low31() const {
    if (v.i & 1)
-      return ((v.i >> 1) & 0x7fffffff) ;
+      return (int)((v.i >> 1) & 0x7fffffff) ;
    else
       return v.p[1] ;
 }
-int bigint::operator==(const bigint &b) const {
-   if ((b.v.i - v.i) & 1)
-      return 0 ;
-   if (v.i & 1)
-      return v.i == b.v.i ;
+// note:  only called when both are arrays
+int bigint::equal(const bigint &b) const {
    if (b.v.p[0] != v.p[0])
       return 0 ;
    return memcmp(v.p, b.v.p, sizeof(int) * (v.p[0] + 1)) == 0 ;
 }
-int bigint::operator!=(const bigint &b) const {
-   return !(*this == b) ;
-}
-int bigint::operator<(const bigint &b) const {
+/**
+ *   Comparison when at least one side is an array; since the forms
+ *   are canonical, an array is always outside the range of a direct
+ *   value, so its sign decides a mixed comparison.
+ */
+int bigint::compare(const bigint &b) const {
    if (b.v.i & 1)
       if (v.i & 1)
-         return v.i < b.v.i ;
+         return v.i < b.v.i ? -1 : v.i > b.v.i ;
       else
-         return v.p[v.p[0]] < 0 ;
+         return v.p[v.p[0]] < 0 ? -1 : 1 ;
    else
       if (v.i & 1)
-         return b.v.p[b.v.p[0]] >= 0 ;
+         return b.v.p[b.v.p[0]] >= 0 ? -1 : 1 ;
    int d = v.p[v.p[0]] - b.v.p[b.v.p[0]] ;
    if (d < 0)
-      return 1 ;
+      return -1 ;
    if (d > 0)
-      return 0 ;
-   if (v.p[0] > b.v.p[0])
-      return v.p[v.p[0]] < 0 ;
-   else if (v.p[0] < b.v.p[0])
-      return v.p[v.p[0]] >= 0 ;
-   for (int i=v.p[0]; i>0; i--)
-      if (v.p[i] < b.v.p[i])
-         return 1 ;
-      else if (v.p[i] > b.v.p[i])
-         return 0 ;
-   return 0 ;
-}
-int bigint::operator<=(const bigint &b) const {
-   if (b.v.i & 1)
-      if (v.i & 1)
-         return v.i <= b.v.i ;
-      else
-         return v.p[v.p[0]] < 0 ;
-   else
-      if (v.i & 1)
-         return b.v.p[b.v.p[0]] >= 0 ;
-   int d = v.p[v.p[0]] - b.v.p[b.v.p[0]] ;
-   if (d < 0)
       return 1 ;
-   if (d > 0)
-      return 0 ;
    if (v.p[0] > b.v.p[0])
-      return v.p[v.p[0]] < 0 ;
+      return v.p[v.p[0]] < 0 ? -1 : 1 ;
    else if (v.p[0] < b.v.p[0])
-      return v.p[v.p[0]] >= 0 ;
+      return v.p[v.p[0]] >= 0 ? -1 : 1 ;
    for (int i=v.p[0]; i>0; i--)
       if (v.p[i] < b.v.p[i])
-         return 1 ;
+         return -1 ;
       else if (v.p[i] > b.v.p[i])
-         return 0 ;
-   return 1 ;
-}
-int bigint::operator>(const bigint &b) const {
-   return !(*this <= b) ;
-}
-int bigint::operator>=(const bigint &b) const {
-   return !(*this < b) ;
+         return 1 ;
+   return 0 ;
 }
 static double mybpow(int n) {
    double r = 1 ;
@@ -688,16 +671,24 @@ double bigint::toscinot() const
  */
 int bigint::toint() const {
    if (v.i & 1)
-      return (v.i >> 1) ;
+      return (int)(v.i >> 1) ;
    return (v.p[v.p[0]] << 31) | v.p[1] ;
 }
+G_INT64 bigint::toint64() const {
+   if (v.i & 1)
+      return (v.i >> 1) ;
+   G_INT64 r = v.p[v.p[0]] ;
+   for (int i=v.p[0]-1; i>0; i--)
+      r = (r << 31) | v.p[i] ;
+   return r ;
+}
 /**
  *   How many bits required to represent this, approximately?
  *   Should overestimate but not by too much.
  */
 int bigint::bitsreq() const {
    if (v.i & 1)
-      return 31 ;
+      return SIMPLE_SHIFT ;
    return v.p[0] * 31 ;
 }
 /**
@@ -708,7 +699,7 @@ int bigint::lowbitset() const {
    if (v.i & 1) {
       if (v.i == 1)
          return -1 ;
-      for (int i=1; i<32; i++)
+      for (int i=1; i<=SIMPLE_SHIFT; i++)
          if ((v.i >> i) & 1)
             return i-1 ;
    }
@@ -731,10 +722,10 @@ void bigint::tochararr(char *fillme, int n) const {
    while (n > 0) {
       int w = 0 ;
       if (v.i & 1) {
-         if (at == 0)
-            w = v.i >> 1 ;
-         else
-            w = v.i >> 31 ;
+         int sh = 31 * at ;
+         if (sh > SIMPLE_SHIFT - 1)
+            sh = SIMPLE_SHIFT - 1 ;
+         w = (int)((v.i >> 1) >> sh) ;
       } else {
          if (at < v.p[0])
             w = v.p[at+1] ;
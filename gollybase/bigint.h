@@ -3,9 +3,11 @@
 
 /**
  *   Class bigint manages signed bigints using a very Lisp-ish approach.
- *   Integers from -0x40000000 through 0x3fffffff are represented
- *   by a direct instance of this four-byte class, with the lowest
- *   bit set.  Integers outside that range use a pointer to an
+ *   Integers that fit in a pointer-sized int less two bits (from
+ *   -2^62 through 2^62-1 on 64-bit platforms, -2^30 through 2^30-1
+ *   on 32-bit ones) are represented by a direct instance of this
+ *   pointer-sized class, with the lowest bit set.  Integers outside
+ *   that range use a pointer to an
  *   integer array; the first element is how many elements of
  *   that array are used.  The array itself is always a power of
  *   two in size, the smallest power of two greater than
@@ -20,7 +22,11 @@
  *   class, with +=, -=, and the like operators that will not
  *   allocate/free unnecessarily.
  *
- *   We'll add mempool support soon.
+ *   Copying, assignment, addition, subtraction and comparison of
+ *   direct values are done inline (the draw, population and
+ *   generation-count code does a lot of these); anything that
+ *   overflows or involves an array is passed to an out-of-line
+ *   routine.
  *
  *   If we are using an int array, each holds 31 bits of the number.
  *   All elements except the last are in the range 0..2^31-1; the
@@ -43,24 +49,28 @@
  *
  *   We never use an array size smaller than 4.
  *
- *   Nonnegative numbers are represented as follows:
+ *   Nonnegative numbers are represented as follows on 64-bit
+ *   platforms:
+ *
+ *   0..2^62-1     Directly, shifted left one with the low bit set
+ *   2^62..2^93-1  size=4, three 31-bit words then 0; array size is 8
+ *   ...
+ *   2^155..2^186-1  size=7, six 31-bit words than 0; array size is 8
+ *   2^186..2^217-1  size=8, seven 31-bit words then 0; array size is 16
+ *
+ *   and on 32-bit platforms:
  *
  *   0..2^30-1     Directly, shifted left one with the low bit set
  *   2^30..2^31-1  siz=2, low 31 bits then 0; array size is 4
  *   2^31..2^62-1  size=3, two 31-bit words then 0; array size is 4
  *   2^62..2^93-1  size=4, three 31-bit words then 0; array size is 8
  *   ...
- *   2^155..2^186-1  size=7, six 31-bit words than 0; array size is 8
- *   2^186..2^217-1  size=8, seven 31-bit words then 0; array size is 16
  *
  *   Negative numbers are analogous:
  *
- *   -1..-2^30     Directly, shifted left one with the low bit set
- *   -2^30-1..-2^31  siz=2, low 31 bits then -1; array size is 4
- *   -2^31-1..-2^62  size=3, two 31-bit words then -1; array size is 4
+ *   -1..-2^62     Directly, shifted left one with the low bit set
  *   -2^62-1..-2^93  size=4, three 31-bit words then -1; array size is 8
  *   ...
- *   -2^155-1..-2^186  size=7, six 31-bit words than -1; array size is 8
  *   -2^186-1..-2^217  size=8, seven 31-bit words then -1; array size is 16
  *
  *   The only upper bound on the size of these numbers is memory.
@@ -87,29 +97,81 @@
 #define G_INT64_FMT      "lld"
 #endif
 
+#include <stdint.h>
+
 class bigint {
 public:
    bigint() { v.i = 1 ; }
-   bigint(short i) { v.i = ((int)i << 1) + 1 ; }
+   bigint(short i) { v.i = ((intptr_t)i << 1) + 1 ; }
    bigint(int i) { fromint(i) ; }
-   bigint(G_INT64 i) ;
+   bigint(G_INT64 i) { fromint64(i) ; }
    bigint(const char *s) ;
-   bigint(const bigint &a) ;
+   bigint(const bigint &a) {
+      if (a.v.i & 1)
+         v.i = a.v.i ;
+      else
+         v.p = copyarr(a.v.p) ;
+   }
    // create a new bigint by adding four other bigints; fastpath for popcount
    bigint(const bigint &a, const bigint &b, const bigint &c, const bigint &d) ;
-   ~bigint() ;
-   bigint& operator=(const bigint &a) ;
-   bigint& operator+=(const bigint &a) ;
-   bigint& operator-=(const bigint &a) ;
+   ~bigint() {
+      if (0 == (v.i & 1))
+         delete [] v.p ;
+   }
+   bigint& operator=(const bigint &a) {
+      if (v.i & a.v.i & 1) {
+         v.i = a.v.i ;
+         return *this ;
+      }
+      return assign(a) ;
+   }
+   /*
+    *   For two direct values the shifted sum is v.i + a.v.i - 1; it
+    *   is only out of range if that overflows, which we detect from
+    *   the signs.
+    */
+   bigint& operator+=(const bigint &a) {
+      if (v.i & a.v.i & 1) {
+         intptr_t r = (intptr_t)((uintptr_t)v.i + (uintptr_t)(a.v.i - 1)) ;
+         if (((v.i ^ r) & (a.v.i ^ r)) >= 0) {
+            v.i = r ;
+            return *this ;
+         }
+      }
+      return add(a) ;
+   }
+   bigint& operator-=(const bigint &a) {
+      if (v.i & a.v.i & 1) {
+         intptr_t r = (intptr_t)((uintptr_t)v.i - (uintptr_t)(a.v.i - 1)) ;
+         if (((v.i ^ a.v.i) & (v.i ^ r)) >= 0) {
+            v.i = r ;
+            return *this ;
+         }
+      }
+      return sub(a) ;
+   }
    bigint& operator>>=(int i) ;
    bigint& operator<<=(int i) ;
    void mulpow2(int p) ;
-   int operator==(const bigint &b) const ;
-   int operator!=(const bigint &b) const ;
-   int operator<=(const bigint &b) const ;
-   int operator>=(const bigint &b) const ;
-   int operator<(const bigint &b) const ;
-   int operator>(const bigint &b) const ;
+   // a direct value and an array are never equal
+   int operator==(const bigint &b) const {
+      if ((v.i | b.v.i) & 1)
+         return v.i == b.v.i ;
+      return equal(b) ;
+   }
+   int operator!=(const bigint &b) const { return !(*this == b) ; }
+   int operator<=(const bigint &b) const {
+      if (v.i & b.v.i & 1)
+         return v.i <= b.v.i ;
+      return compare(b) <= 0 ;
+   }
+   int operator>=(const bigint &b) const { return !(*this < b) ; }
+   int operator<(const bigint &b) const {
+      if (v.i & b.v.i & 1)
+         return v.i < b.v.i ;
+      return compare(b) < 0 ;
+   }
+   int operator>(const bigint &b) const { return !(*this <= b) ; }
    int even() const ;
    int odd() const ;
    int low31() const ; // return the low 31 bits quickly
@@ -125,11 +187,12 @@ public:
    // note: a should be a small positive int, say 1..10,000
    void div2() ;
    // note:  a may only be a *31* bit int, not just 0 or 1
-   // note:  may only be called on arrayed bigints
    void add_smallint(int a) ;
    double todouble() const ;
    double toscinot() const ;
    int toint() const ;
+   // same, for values that fit in 63 bits
+   G_INT64 toint64() const ;
    // static values predefined
    static const bigint zero, one, two, three, minint, maxint ;
    // editing limits
@@ -139,6 +202,14 @@ public:
    // fill in one bit per char, up to n.
    void tochararr(char *ar, int siz) const ;
 private:
+   // out-of-line halves of the inline operators above
+   bigint& assign(const bigint &a) ;
+   bigint& add(const bigint &a) ;
+   bigint& sub(const bigint &a) ;
+   int equal(const bigint &b) const ;
+   // returns <0, 0 or >0
+   int compare(const bigint &b) const ;
+   static int *copyarr(const int *p) ;
    // note:  may only be called on arrayed bigints
    int size() const ;
    // do we need to shrink it to keep it canonical?
@@ -150,11 +221,13 @@ private:
    void ripple(const bigint &a, int carry) ;
    void ripplesub(const bigint &a, int carry) ;
    // make sure it's in vector form; may leave it not canonical!
-   void vectorize(int i) ;
+   // note:  i must be in the direct range
+   void vectorize(G_INT64 i) ;
    void fromint(int i) ;
+   void fromint64(G_INT64 i) ;
    void ensurework(int sz) const ;
    union {
-      int i ;
+      intptr_t i ;
       int *p ;
    } v ;
    static char *printbuf ;
@@ -17,6 +17,7 @@
 #include "util.h"
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 using namespace std ;
 /*
  *   Power of two hash sizes work fine.
@@ -55,7 +56,57 @@ g_uintptr_t ghnode_hash(void *a, void *b, void *c, void *d) {
    return r ;
 }
 #endif
-#define ghleaf_hash(a,b,c,d) (65537*(d)+257*(c)+17*(b)+5*(a))
+/*
+ *   A leaf is 16 bytes of cells; we hash it as two 64-bit words.
+ */
+static g_uintptr_t ghleaf_hash(const state *c) {
+   unsigned long long a, b ;
+   memcpy(&a, c, 8) ;
+   memcpy(&b, c+8, 8) ;
+   unsigned long long r = (a ^ (b * 0xC2B2AE3D27D4EB4FULL)) * 0x9E3779B97F4A7C15ULL ;
+   return (g_uintptr_t)(r ^ (r >> 32)) ;
+}
+static inline int ghleaf_eq(const state *c, const state *d) {
+   unsigned long long a0, a1, b0, b1 ;
+   memcpy(&a0, c, 8) ;
+   memcpy(&a1, c+8, 8) ;
+   memcpy(&b0, d, 8) ;
+   memcpy(&b1, d+8, 8) ;
+   return ((a0 ^ b0) | (a1 ^ b1)) == 0 ;
+}
+#ifndef CHAINEDHASH
+/*
+ *   Slots of the open-addressed table hold the node pointer with three
+ *   bits of the (remixed) hash in the low bits; nodes are always at
+ *   least 8-byte aligned.  We probe linearly.  Nothing is ever removed
+ *   from the table except by do_gc, which rebuilds it from scratch, so
+ *   a slot once filled stays filled and inserting is just a matter of
+ *   claiming the first empty slot with a compare-and-swap.
+ */
+#define SLOTTAGMASK ((g_uintptr_t)7)
+#define slotnode(v) ((ghnode *)((v) & ~SLOTTAGMASK))
+#define slottag(h) (((g_uintptr_t)(h) * (g_uintptr_t)0x9E3779B97F4A7C15ULL) \
+                                           >> (8 * sizeof(g_uintptr_t) - 3))
+#ifdef PRIMEMOD
+#define OLDHASHMOD(a) ((a)%oldhashprime)
+#define HASHNEXT(i) ((i)+1 == hashprime ? 0 : (i)+1)
+#define OLDHASHNEXT(i) ((i)+1 == oldhashprime ? 0 : (i)+1)
+#else
+#define OLDHASHMOD(a) ((a)&(oldhashmask))
+#define HASHNEXT(i) (((i)+1)&(hashmask))
+#define OLDHASHNEXT(i) (((i)+1)&(oldhashmask))
+#endif
+/*
+ *   How many slots of the old table each lookup migrates while the
+ *   table is growing.
+ */
+const g_uintptr_t MIGRATECHUNK = 256 ;
+static g_uintptr_t ghslot_hash(ghnode *p) {
+   if (is_ghnode(p))
+      return ghnode_hash(p->nw, p->ne, p->sw, p->se) ;
+   return ghleaf_hash(((ghleaf *)p)->c) ;
+}
+#endif
 /*
  *   Resize the hash.  The max load factor defined here does not actually
  *   yield the maximum load factor the hash will see, because when we
@@ -73,6 +124,7 @@ g_uintptr_t ghnode_hash(void *a, void *b, void *c, void *d) {
  *   handles a large load factor fairly well.
  */
 double ghashbase::maxloadfactor = 0.7 ;
+#ifdef CHAINEDHASH
 void ghashbase::resize() {
 #ifndef NOGCBEFORERESIZE
    if (okaytogc) {
@@ -112,8 +164,7 @@ void ghashbase::resize() {
          if (is_ghnode(p)) {
             h = ghnode_hash(p->nw, p->ne, p->sw, p->se) ;
          } else {
-            ghleaf *l = (ghleaf *)p ;
-            h = ghleaf_hash(l->nw, l->ne, l->sw, l->se) ;
+            h = ghleaf_hash(((ghleaf *)p)->c) ;
          }
          h = HASHMOD(h) ;
          p->next = nhashtab[h] ;
@@ -129,12 +180,111 @@ void ghashbase::resize() {
      lifestatus(statusline) ;
    }
 }
+#else
+/*
+ *   With the open-addressed table we cannot let the load factor run
+ *   away the way a chained table can, so if memory is too tight to
+ *   grow we let the load climb to 7/8 first, and past that we grow
+ *   anyway.  Growing does not rehash everything at once: we allocate
+ *   the new table, keep the old one around, and each subsequent lookup
+ *   claims and migrates the next MIGRATECHUNK slots of it.  Until all
+ *   chunks are done, lookups consult the old table and then the new
+ *   one; new nodes only ever go into the new one.
+ */
+void ghashbase::resize() {
+#ifndef NOGCBEFORERESIZE
+   if (okaytogc) {
+      do_gc(0) ;
+   }
+#endif
+   finishresize() ;
+   g_uintptr_t nhashprime = nexthashsize(2 * hashprime) ;
+   ghslot *nhashtab ;
+   if (hashprime > (totalthings >> 2)) {
+      if (alloced > maxmem ||
+          nhashprime * sizeof(ghslot) > (maxmem - alloced)) {
+         g_uintptr_t fulllimit = hashprime - (hashprime >> 3) ;
+         if (hashpop < fulllimit) {
+            hashlimit = fulllimit ;
+            return ;
+         }
+      }
+   }
+   if (verbose) {
+     sprintf(statusline, "Resizing hash to %" PRIuPTR "...", nhashprime) ;
+     lifestatus(statusline) ;
+   }
+   nhashtab = (ghslot *)calloc(nhashprime, sizeof(ghslot)) ;
+   if (nhashtab == 0)
+      lifefatal("Out of memory; try reducing the hash memory limit.") ;
+   alloced += sizeof(ghslot) * nhashprime ;
+   oldhashtab = hashtab ;
+   oldhashprime = hashprime ;
+   hashtab = nhashtab ;
+   hashprime = nhashprime ;
+#ifndef PRIMEMOD
+   oldhashmask = hashmask ;
+   hashmask = hashprime - 1 ;
+#endif
+   migratechunks = (oldhashprime + MIGRATECHUNK - 1) / MIGRATECHUNK ;
+   migrateclaimed = 0 ;
+   migratedone = 0 ;
+   migrating = 1 ;
+   hashlimit = (g_uintptr_t)(maxloadfactor * hashprime) ;
+   if (verbose) {
+     strcpy(statusline+strlen(statusline), " done.") ;
+     lifestatus(statusline) ;
+   }
+}
+/*
+ *   Claim the next chunk of the old table, if any is left, and copy its
+ *   entries into the new one.  The old table is never written while we
+ *   are migrating, and every entry in it is distinct, so we just need to
+ *   find an empty slot for each.
+ */
+void ghashbase::migratesome() {
+   g_uintptr_t c = migrateclaimed++ ;
+   if (c >= migratechunks)
+      return ;
+   g_uintptr_t i = c * MIGRATECHUNK, e = i + MIGRATECHUNK ;
+   if (e > oldhashprime)
+      e = oldhashprime ;
+   for (; i<e; i++) {
+      g_uintptr_t v = oldhashtab[i].load(std::memory_order_relaxed) ;
+      if (v == 0)
+         continue ;
+      g_uintptr_t h = HASHMOD(ghslot_hash(slotnode(v))) ;
+      for (;;) {
+         g_uintptr_t w = 0 ;
+         if (hashtab[h].compare_exchange_strong(w, v))
+            break ;
+         h = HASHNEXT(h) ;
+      }
+   }
+   if (++migratedone == migratechunks)
+      migrating = 0 ;
+}
+/*
+ *   Complete any migration in progress and release the old table.  Only
+ *   call this when nobody else can be looking at the table.
+ */
+void ghashbase::finishresize() {
+   while (migrating)
+      migratesome() ;
+   if (oldhashtab) {
+      free(oldhashtab) ;
+      alloced -= sizeof(ghslot) * oldhashprime ;
+      oldhashtab = 0 ;
+   }
+}
+#endif
 /*
  *   These next two routines are (nearly) our only hash table access
  *   routines; we simply look up the passed in information.  If we
  *   find it in the hash table, we return it; otherwise, we build a
  *   new ghnode and store it in the hash table, and return that.
  */
+#ifdef CHAINEDHASH
 ghnode *ghashbase::find_ghnode(ghnode *nw, ghnode *ne, ghnode *sw, ghnode *se) {
    ghnode *p ;
    g_uintptr_t h = ghnode_hash(nw,ne,sw,se) ;
@@ -165,14 +315,12 @@ ghnode *ghashbase::find_ghnode(ghnode *nw, ghnode *ne, ghnode *sw, ghnode *se) {
       resize() ;
    return p ;
 }
-ghleaf *ghashbase::find_ghleaf(state nw, state ne, state sw, state se) {
+ghleaf *ghashbase::find_ghleaf(const state *c, g_uintptr_t h) {
    ghleaf *p ;
    ghleaf *pred = 0 ;
-   g_uintptr_t h = ghleaf_hash(nw, ne, sw, se) ;
    h = HASHMOD(h) ;
    for (p=(ghleaf *)hashtab[h]; p; p = (ghleaf *)p->next) {
-      if (nw == p->nw && ne == p->ne && sw == p->sw && se == p->se &&
-          !is_ghnode(p)) {
+      if (!is_ghnode(p) && ghleaf_eq(c, p->c)) {
          if (pred) {
             pred->next = p->next ;
             p->next = hashtab[h] ;
@@ -183,20 +331,150 @@ ghleaf *ghashbase::find_ghleaf(state nw, state ne, state sw, state se) {
       pred = p ;
    }
    p = newghleaf() ;
+   memcpy(p->c, c, GHLEAFSIZE) ;
+   p->resvalid = 0 ;
+   p->isghnode = 0 ;
+   p->next = hashtab[h] ;
+   hashtab[h] = (ghnode *)p ;
+   hashpop++ ;
+   save((ghnode *)p) ;
+   if (hashpop > hashlimit)
+      resize() ;
+   return p ;
+}
+#else
+/*
+ *   The lookup proper.  If we don't find the node we build it and then
+ *   try to claim the empty slot we stopped at; if another thread got
+ *   there first we keep probing from there, and if it turns out to have
+ *   inserted the very node we wanted we give ours back and use theirs.
+ *   Allocating may gc, which rebuilds the table, in which case we start
+ *   the probe over.
+ */
+ghnode *ghashbase::lookup_ghnode(g_uintptr_t h, ghnode *nw, ghnode *ne,
+                                 ghnode *sw, ghnode *se) {
+   g_uintptr_t tag = slottag(h), i, v ;
+   ghnode *p ;
+   if (migrating) {
+      migratesome() ;
+      for (i=OLDHASHMOD(h); (v=oldhashtab[i].load(std::memory_order_acquire));
+                                                           i=OLDHASHNEXT(i)) {
+         p = slotnode(v) ;
+         if ((v & SLOTTAGMASK) == tag &&
+             nw == p->nw && ne == p->ne && sw == p->sw && se == p->se)
+            return save(p) ;
+      }
+   }
+   for (i=HASHMOD(h); (v=hashtab[i].load(std::memory_order_acquire));
+                                                              i=HASHNEXT(i)) {
+      p = slotnode(v) ; /* make sure to compare nw *first* */
+      if ((v & SLOTTAGMASK) == tag &&
+          nw == p->nw && ne == p->ne && sw == p->sw && se == p->se)
+         return save(p) ;
+   }
+   int gcs = gccount ;
+   p = newghnode() ;
+   p->next = 0 ;
    p->nw = nw ;
    p->ne = ne ;
    p->sw = sw ;
    p->se = se ;
-   p->leafpop = bigint((short)((nw != 0) + (ne != 0) + (sw != 0) + (se != 0))) ;
+   p->res = 0 ;
+   if (gccount != gcs)
+      i = HASHMOD(h) ;
+   for (v=(g_uintptr_t)p|tag;; i=HASHNEXT(i)) {
+      g_uintptr_t w = 0 ;
+      if (hashtab[i].compare_exchange_strong(w, v))
+         break ;
+      ghnode *q = slotnode(w) ;
+      if ((w & SLOTTAGMASK) == tag &&
+          nw == q->nw && ne == q->ne && sw == q->sw && se == q->se) {
+         p->next = freeghnodes ;
+         freeghnodes = p ;
+         return save(q) ;
+      }
+   }
+   hashpop++ ;
+   save(p) ;
+   if (hashpop > hashlimit)
+      resize() ;
+   return p ;
+}
+ghnode *ghashbase::find_ghnode(ghnode *nw, ghnode *ne, ghnode *sw, ghnode *se) {
+   return lookup_ghnode(ghnode_hash(nw,ne,sw,se), nw, ne, sw, se) ;
+}
+ghleaf *ghashbase::find_ghleaf(const state *c, g_uintptr_t h) {
+   g_uintptr_t tag = slottag(h), i, v ;
+   ghleaf *p ;
+   if (migrating) {
+      migratesome() ;
+      for (i=OLDHASHMOD(h); (v=oldhashtab[i].load(std::memory_order_acquire));
+                                                           i=OLDHASHNEXT(i)) {
+         p = (ghleaf *)slotnode(v) ;
+         if ((v & SLOTTAGMASK) == tag && !is_ghnode(p) &&
+             ghleaf_eq(c, p->c))
+            return (ghleaf *)save((ghnode *)p) ;
+      }
+   }
+   for (i=HASHMOD(h); (v=hashtab[i].load(std::memory_order_acquire));
+                                                              i=HASHNEXT(i)) {
+      p = (ghleaf *)slotnode(v) ;
+      if ((v & SLOTTAGMASK) == tag && !is_ghnode(p) &&
+          ghleaf_eq(c, p->c))
+         return (ghleaf *)save((ghnode *)p) ;
+   }
+   int gcs = gccount ;
+   p = newghleaf() ;
+   p->next = 0 ;
    p->isghnode = 0 ;
-   p->next = hashtab[h] ;
-   hashtab[h] = (ghnode *)p ;
+   memcpy(p->c, c, GHLEAFSIZE) ;
+   p->resvalid = 0 ;
+   if (gccount != gcs)
+      i = HASHMOD(h) ;
+   for (v=(g_uintptr_t)p|tag;; i=HASHNEXT(i)) {
+      g_uintptr_t w = 0 ;
+      if (hashtab[i].compare_exchange_strong(w, v))
+         break ;
+      ghleaf *q = (ghleaf *)slotnode(w) ;
+      if ((w & SLOTTAGMASK) == tag && !is_ghnode(q) &&
+          ghleaf_eq(c, q->c)) {
+         p->next = freeghnodes ;
+         freeghnodes = (ghnode *)p ;
+         return (ghleaf *)save((ghnode *)q) ;
+      }
+   }
    hashpop++ ;
    save((ghnode *)p) ;
    if (hashpop > hashlimit)
       resize() ;
    return p ;
 }
+#endif
+ghleaf *ghashbase::find_ghleaf(const state *c) {
+   return find_ghleaf(c, ghleaf_hash(c)) ;
+}
+/*
+ *   Leaves are split into 2x2 quadrants in a few places (macrocell files
+ *   are written in terms of them, for instance).  These are the offsets of
+ *   the nw, ne, sw, and se quadrants within a leaf.
+ */
+static const int ghquadoff[4] = { 0, 2, 8, 10 } ;
+static inline void copyquad(state *d, const state *s) {
+   d[0] = s[0] ;
+   d[1] = s[1] ;
+   d[4] = s[4] ;
+   d[5] = s[5] ;
+}
+/*
+ *   Build the leaf centered on the corner where four leaves meet.
+ */
+static void ghleafmid(state *c, const ghleaf *nw, const ghleaf *ne,
+                      const ghleaf *sw, const ghleaf *se) {
+   copyquad(c+ghquadoff[0], nw->c+ghquadoff[3]) ;
+   copyquad(c+ghquadoff[1], ne->c+ghquadoff[2]) ;
+   copyquad(c+ghquadoff[2], sw->c+ghquadoff[1]) ;
+   copyquad(c+ghquadoff[3], se->c+ghquadoff[0]) ;
+}
 /*
  *   The following routine does the same, but first it checks to see if
  *   the cached result is any good.  If it is, it directly returns that.
@@ -236,7 +514,8 @@ ghnode *ghashbase::getres(ghnode *n, int depth) {
      if (is_ghnode(n->nw)) {
        res = dorecurs_half(n->nw, n->ne, n->sw, n->se, depth) ;
      } else {
-       lifefatal("! can't happen") ;
+       res = (ghnode *)dorecurs_ghleaf_half((ghleaf *)n->nw, (ghleaf *)n->ne,
+                                            (ghleaf *)n->sw, (ghleaf *)n->se) ;
      }
    }
    pop(sp) ;
@@ -259,6 +538,9 @@ void ghashbase::setupprefetch(ghsetup_t &su, ghnode *nw, ghnode *ne, ghnode *sw,
    su.prefetch(hashtab + HASHMOD(su.h)) ;
 }
 ghnode *ghashbase::find_ghnode(ghsetup_t &su) {
+#ifndef CHAINEDHASH
+   return lookup_ghnode(su.h, su.nw, su.ne, su.sw, su.se) ;
+#else
    ghnode *p ;
    ghnode *pred = 0 ;
    g_uintptr_t h = HASHMOD(su.h) ;
@@ -286,6 +568,7 @@ ghnode *ghashbase::find_ghnode(ghsetup_t &su) {
    if (hashpop > hashlimit)
       resize() ;
    return p ;
+#endif
 }
 ghnode *ghashbase::dorecurs(ghnode *n, ghnode *ne, ghnode *t, ghnode *e, int depth) {
    int sp = gsp ;
@@ -359,7 +642,7 @@ ghnode *ghashbase::dorecurs(ghnode *n, ghnode *ne, ghnode *t,
 ghnode *ghashbase::dorecurs_half(ghnode *n, ghnode *ne, ghnode *t,
                                ghnode *e, int depth) {
    int sp = gsp ;
-   if (depth > 1) {
+   if (depth > 2) {
       ghnode
       *t00 = find_ghnode(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw),
       *t01 = find_ghnode(n->ne->se, ne->nw->sw, n->se->ne, ne->sw->nw),
@@ -385,47 +668,126 @@ ghnode *ghashbase::dorecurs_half(ghnode *n, ghnode *ne, ghnode *t,
       *t20 = getres(t, depth),
       *t21 = getres(find_ghnode(t->ne, e->nw, t->se, e->sw), depth),
       *t22 = getres(e, depth) ;
-      n = find_ghnode((ghnode *)find_ghleaf(((ghleaf *)t00)->se,
-                                             ((ghleaf *)t01)->sw,
-                                             ((ghleaf *)t10)->ne,
-                                             ((ghleaf *)t11)->nw),
-                    (ghnode *)find_ghleaf(((ghleaf *)t01)->se,
-                                             ((ghleaf *)t02)->sw,
-                                             ((ghleaf *)t11)->ne,
-                                             ((ghleaf *)t12)->nw),
-                    (ghnode *)find_ghleaf(((ghleaf *)t10)->se,
-                                             ((ghleaf *)t11)->sw,
-                                             ((ghleaf *)t20)->ne,
-                                             ((ghleaf *)t21)->nw),
-                    (ghnode *)find_ghleaf(((ghleaf *)t11)->se,
-                                             ((ghleaf *)t12)->sw,
-                                             ((ghleaf *)t21)->ne,
-                                             ((ghleaf *)t22)->nw)) ;
+      state c[4][GHLEAFSIZE] ;
+      ghleafmid(c[0], (ghleaf *)t00, (ghleaf *)t01, (ghleaf *)t10, (ghleaf *)t11) ;
+      ghleafmid(c[1], (ghleaf *)t01, (ghleaf *)t02, (ghleaf *)t11, (ghleaf *)t12) ;
+      ghleafmid(c[2], (ghleaf *)t10, (ghleaf *)t11, (ghleaf *)t20, (ghleaf *)t21) ;
+      ghleafmid(c[3], (ghleaf *)t11, (ghleaf *)t12, (ghleaf *)t21, (ghleaf *)t22) ;
+      n = find_ghnode((ghnode *)find_ghleaf(c[0]), (ghnode *)find_ghleaf(c[1]),
+                      (ghnode *)find_ghleaf(c[2]), (ghnode *)find_ghleaf(c[3])) ;
    }
    pop(sp) ;
    return save(n) ;
 }
 /*
- *   If the ghnode is a 16-ghnode, then the constituents are leaves, so we
- *   need a very similar but still somewhat different subroutine.  Since
- *   we do not (yet) garbage collect leaves, we don't need all that
- *   save/pop mumbo-jumbo.
+ *   If the ghnode is an 8x8 ghnode, then the constituents are leaves, so we
+ *   need a very similar but still somewhat different subroutine.  We lay
+ *   the four leaves out as an 8x8 grid, and take the one-generation result
+ *   of each of the nine 4x4 windows in it (the four corner windows are just
+ *   the leaves themselves) to get the 6x6 center one generation on.  The
+ *   windows are canonical leaves too, so their results are cached just like
+ *   everything else.
  */
+void ghashbase::ghleafres(ghleaf *n) {
+   if (n->resvalid)
+      return ;
+   slowcalcblock(n->c, 4, n->res, 2, 2) ;
+   n->resvalid = 1 ;
+}
+void ghashbase::slowcalcblock(const state *c, int stride, state *res,
+                              int wd, int ht) {
+   for (int y=0; y<ht; y++, c += stride)
+      for (int x=0; x<wd; x++) {
+         const state *p = c + x ;
+         *res++ = slowcalc(p[0], p[1], p[2],
+                           p[stride], p[stride+1], p[stride+2],
+                           p[2*stride], p[2*stride+1], p[2*stride+2]) ;
+      }
+}
+/*
+ *   Look up a handful of leaves, touching all their hash slots before
+ *   we walk any of them, and make sure each has its result.
+ */
+void ghashbase::find_ghleafres(ghleaf **l, state (*c)[GHLEAFSIZE], int n) {
+   g_uintptr_t h[5] ;
+   int i ;
+   for (i=0; i<n; i++) {
+      h[i] = ghleaf_hash(c[i]) ;
+#ifdef USEPREFETCH
+      PREFETCH(hashtab + HASHMOD(h[i])) ;
+#endif
+   }
+   for (i=0; i<n; i++) {
+      l[i] = find_ghleaf(c[i], h[i]) ;
+      ghleafres(l[i]) ;
+   }
+}
+void ghashbase::ghleafstep(state *h, ghleaf *nw, ghleaf *ne, ghleaf *sw,
+                           ghleaf *se) {
+   state g[64], c[5][GHLEAFSIZE] ;
+   ghleaf *l[9], *w[5] ;
+   int i, j, k, n = 0 ;
+   for (k=0; k<4; k++) {
+      memcpy(g+k*8, nw->c+k*4, 4) ;
+      memcpy(g+k*8+4, ne->c+k*4, 4) ;
+      memcpy(g+k*8+32, sw->c+k*4, 4) ;
+      memcpy(g+k*8+36, se->c+k*4, 4) ;
+   }
+   /* the five windows that straddle the leaves */
+   for (i=0; i<3; i++)
+      for (j=0; j<3; j++)
+         if ((i | j) & 1) {
+            for (k=0; k<4; k++)
+               memcpy(c[n]+k*4, g+(2*i+k)*8+2*j, 4) ;
+            n++ ;
+         }
+   find_ghleafres(w, c, n) ;
+   ghleafres(nw) ;
+   ghleafres(ne) ;
+   ghleafres(sw) ;
+   ghleafres(se) ;
+   l[0] = nw ; l[1] = w[0] ; l[2] = ne ;
+   l[3] = w[1] ; l[4] = w[2] ; l[5] = w[3] ;
+   l[6] = sw ; l[7] = w[4] ; l[8] = se ;
+   for (i=0; i<3; i++)
+      for (j=0; j<3; j++) {
+         const state *r = l[i*3+j]->res ;
+         state *p = h + 2*i*6 + 2*j ;
+         p[0] = r[0] ;
+         p[1] = r[1] ;
+         p[6] = r[2] ;
+         p[7] = r[3] ;
+      }
+}
 ghleaf *ghashbase::dorecurs_ghleaf(ghleaf *nw, ghleaf *ne, ghleaf *sw,
                                    ghleaf *se) {
-   return find_ghleaf(
-             slowcalc(nw->nw, nw->ne, ne->nw,
-                      nw->sw, nw->se, ne->sw,
-                      sw->nw, sw->ne, se->nw),
-             slowcalc(nw->ne, ne->nw, ne->ne,
-                      nw->se, ne->sw, ne->se,
-                      sw->ne, se->nw, se->ne),
-             slowcalc(nw->sw, nw->se, ne->sw,
-                      sw->nw, sw->ne, se->nw,
-                      sw->sw, sw->se, se->sw),
-             slowcalc(nw->se, ne->sw, ne->se,
-                      sw->ne, se->nw, se->ne,
-                      sw->se, se->sw, se->se)) ;
+   state h[36], c[4][GHLEAFSIZE], r[GHLEAFSIZE] ;
+   ghleaf *l[4] ;
+   int i, k ;
+   ghleafstep(h, nw, ne, sw, se) ;
+   for (i=0; i<4; i++)
+      for (k=0; k<4; k++)
+         memcpy(c[i]+k*4, h+((i & 2)+k)*6+(i & 1)*2, 4) ;
+   find_ghleafres(l, c, 4) ;
+   for (i=0; i<4; i++) {
+      state *p = r + (i & 2)*4 + (i & 1)*2 ;
+      p[0] = l[i]->res[0] ;
+      p[1] = l[i]->res[1] ;
+      p[4] = l[i]->res[2] ;
+      p[5] = l[i]->res[3] ;
+   }
+   return find_ghleaf(r) ;
+}
+/*
+ *   Same, but only one generation.
+ */
+ghleaf *ghashbase::dorecurs_ghleaf_half(ghleaf *nw, ghleaf *ne, ghleaf *sw,
+                                        ghleaf *se) {
+   state h[36], r[GHLEAFSIZE] ;
+   ghleafstep(h, nw, ne, sw, se) ;
+   for (int k=0; k<4; k++)
+      memcpy(r+k*4, h+(k+1)*6+1, 4) ;
+   return find_ghleaf(r) ;
 }
 /*
  *   We keep free ghnodes in a linked list for allocation, and we allocate
@@ -459,9 +821,7 @@ ghnode *ghashbase::newghnode() {
  *   Leaves are the same.
  */
 ghleaf *ghashbase::newghleaf() {
-   ghleaf *r = (ghleaf *)newghnode() ;
-   new(&(r->leafpop))bigint ;
-   return r ;
+   return (ghleaf *)newghnode() ;
 }
 /*
  *   Sometimes we want the new ghnode or ghleaf to be automatically cleared
@@ -471,9 +831,7 @@ ghnode *ghashbase::newclearedghnode() {
    return (ghnode *)memset(newghnode(), 0, sizeof(ghnode)) ;
 }
 ghleaf *ghashbase::newclearedghleaf() {
-   ghleaf *r = (ghleaf *)newclearedghnode() ;
-   new(&(r->leafpop))bigint ;
-   return r ;
+   return (ghleaf *)newclearedghnode() ;
 }
 ghashbase::ghashbase() {
    hashprime = nexthashsize(1000) ;
@@ -482,10 +840,22 @@ ghashbase::ghashbase() {
 #endif
    hashlimit = (g_uintptr_t)(maxloadfactor * hashprime) ;
    hashpop = 0 ;
+#ifdef CHAINEDHASH
    hashtab = (ghnode **)calloc(hashprime, sizeof(ghnode *)) ;
    if (hashtab == 0)
      lifefatal("Out of memory (1).") ;
    alloced = hashprime * sizeof(ghnode *) ;
+#else
+   hashtab = (ghslot *)calloc(hashprime, sizeof(ghslot)) ;
+   if (hashtab == 0)
+     lifefatal("Out of memory (1).") ;
+   alloced = hashprime * sizeof(ghslot) ;
+   oldhashtab = 0 ;
+   oldhashprime = migratechunks = 0 ;
+   migrateclaimed = 0 ;
+   migratedone = 0 ;
+   migrating = 0 ;
+#endif
    ngens = 0 ;
    stacksize = 0 ;
    halvesdone = 0 ;
@@ -510,7 +880,7 @@ ghashbase::ghashbase() {
    nonpow2 = 1 ;
    pow2step = 1 ;
    llsize = 0 ;
-   depth = 1 ;
+   depth = 2 ;
    hashed = 0 ;
    popValid = 0 ;
    needPop = 0 ;
@@ -522,12 +892,18 @@ ghashbase::ghashbase() {
    inc_hperf = running_hperf ;
    step_hperf = running_hperf ;
    softinterrupt = 0 ;
+   rowsmode = 0 ;
+   rowband = 0 ;
 }
 /**
  *   Destructor frees memory.
  */
 ghashbase::~ghashbase() {
    free(hashtab) ;
+#ifndef CHAINEDHASH
+   if (oldhashtab)
+      free(oldhashtab) ;
+#endif
    while (ghnodeblocks) {
       ghnode *r = ghnodeblocks ;
       ghnodeblocks = ghnodeblocks->next ;
@@ -587,6 +963,7 @@ void ghashbase::step() {
             pow2step += pow2step ;
       }
       gcstep = 0 ;
+      double gcstepstart = running_hperf.gcSeconds ;
       running_hperf.genval = generation.todouble() ;
       for (int i=0; i<nonpow2; i++) {
          ghnode *newroot = runpattern() ;
@@ -596,6 +973,11 @@ void ghashbase::step() {
          root = newroot ;
          depth = ghnode_depth(root) ;
       }
+      if (verbose && gcstep > 0) {
+         sprintf(statusline, "GC: %d collections, %g seconds this step",
+                 gcstep, running_hperf.gcSeconds - gcstepstart) ;
+         lifestatus(statusline) ;
+      }
       running_hperf.reportStep(step_hperf, inc_hperf, generation.todouble(), verbose) ;
       if (poller->isInterrupted() || !softinterrupt)
          break ;
@@ -651,7 +1033,7 @@ void ghashbase::pushroot_1() {
  *   Return the depth of this ghnode (2 is 8x8).
  */
 int ghashbase::ghnode_depth(ghnode *n) {
-   int depth = 0 ;
+   int depth = 1 ;
    while (is_ghnode(n)) {
       depth++ ;
       n = n->nw ;
@@ -674,8 +1056,10 @@ ghnode *ghashbase::zeroghnode(int depth) {
          zeroghnodea[nzeros++] = 0 ;
    }
    if (zeroghnodea[depth] == 0) {
-      if (depth == 0) {
-         zeroghnodea[depth] = (ghnode *)find_ghleaf(0, 0, 0, 0) ;
+      if (depth <= 1) {
+         state c[GHLEAFSIZE] ;
+         memset(c, 0, sizeof(c)) ;
+         zeroghnodea[depth] = (ghnode *)find_ghleaf(c) ;
       } else {
          ghnode *z = zeroghnode(depth-1) ;
          zeroghnodea[depth] = find_ghnode(z, z, z, z) ;
@@ -689,6 +1073,18 @@ ghnode *ghashbase::zeroghnode(int depth) {
 ghnode *ghashbase::pushroot(ghnode *n) {
    int depth = ghnode_depth(n) ;
    zeroghnode(depth+1) ; // ensure zeros are deep enough
+   if (depth == 1) {
+      /* a lone leaf; split its quadrants out to the new leaves' centers */
+      state c[4][GHLEAFSIZE], s[GHLEAFSIZE] ;
+      memcpy(s, ((ghleaf *)n)->c, GHLEAFSIZE) ;
+      memset(c, 0, sizeof(c)) ;
+      for (int i=0; i<4; i++)
+         copyquad(c[i]+ghquadoff[3-i], s+ghquadoff[i]) ;
+      return find_ghnode((ghnode *)find_ghleaf(c[0]),
+                         (ghnode *)find_ghleaf(c[1]),
+                         (ghnode *)find_ghleaf(c[2]),
+                         (ghnode *)find_ghleaf(c[3])) ;
+   }
    ghnode *z = zeroghnode(depth-1) ;
    return find_ghnode(find_ghnode(z, z, z, n->nw),
                     find_ghnode(z, z, n->ne, z),
@@ -706,35 +1102,16 @@ ghnode *ghashbase::pushroot(ghnode *n) {
  *   the ghnodes can be null.  We'll patch this up in due course.
  */
 ghnode *ghashbase::gsetbit(ghnode *n, int x, int y, int newstate, int depth) {
-   if (depth == 0) {
+   if (depth == 1) {
       ghleaf *l = (ghleaf *)n ;
+      int i = (1 - y) * 4 + (x + 2) ;
       if (hashed) {
-         state nw = l->nw ;
-         state sw = l->sw ;
-         state ne = l->ne ;
-         state se = l->se ;
-         if (x < 0)
-           if (y < 0)
-             sw = (state)newstate ;
-           else
-             nw = (state)newstate ;
-         else
-           if (y < 0)
-             se = (state)newstate ;
-           else
-             ne = (state)newstate ;
-         return save((ghnode *)find_ghleaf(nw, ne, sw, se)) ;
+         state c[GHLEAFSIZE] ;
+         memcpy(c, l->c, GHLEAFSIZE) ;
+         c[i] = (state)newstate ;
+         return save((ghnode *)find_ghleaf(c)) ;
       }
-      if (x < 0)
-        if (y < 0)
-          l->sw = (state)newstate ;
-        else
-          l->nw = (state)newstate ;
-      else
-        if (y < 0)
-          l->se = (state)newstate ;
-        else
-          l->ne = (state)newstate ;
+      l->c[i] = (state)newstate ;
       return (ghnode *)l ;
    } else {
       unsigned int w = 0, wh = 0 ;
@@ -774,7 +1151,7 @@ ghnode *ghashbase::gsetbit(ghnode *n, int x, int y, int newstate, int depth) {
          }
       }
       if (*nptr == 0) {
-         if (depth == 0)
+         if (depth == 1)
             *nptr = (ghnode *)newclearedghleaf() ;
          else
             *nptr = newclearedghnode() ;
@@ -808,18 +1185,8 @@ int ghashbase::getbit(ghnode *n, int x, int y, int depth) {
       n = &tnode ;
       depth-- ;
    }
-   if (depth == 0) {
-      ghleaf *l = (ghleaf *)n ;
-      if (x < 0)
-         if (y < 0)
-           return l->sw ;
-         else
-           return l->nw ;
-      else
-         if (y < 0)
-           return l->se ;
-         else
-           return l->ne ;
+   if (depth == 1) {
+      return ((ghleaf *)n)->c[(1 - y) * 4 + (x + 2)] ;
    } else {
       unsigned int w = 0, wh = 0 ;
       if (depth >= 32) {
@@ -856,27 +1223,13 @@ int ghashbase::getbit(ghnode *n, int x, int y, int depth) {
 int ghashbase::nextbit(ghnode *n, int x, int y, int depth, int &v) {
    if (n == 0 || n == zeroghnode(depth))
       return -1 ;
-   if (depth == 0) {
-      ghleaf *l = (ghleaf *)n ;
-      if (y < 0) {
-        if (x < 0 && l->sw) {
-          v = l->sw ;
-          return 0 ;
-        }
-        if (l->se) {
-          v = l->se ;
-          return -x ;
+   if (depth == 1) {
+      const state *row = ((ghleaf *)n)->c + (1 - y) * 4 ;
+      for (int i=x+2; i<4; i++)
+        if (row[i]) {
+          v = row[i] ;
+          return i - (x + 2) ;
         }
-      } else {
-        if (x < 0 && l->nw) {
-          v = l->nw ;
-          return 0 ;
-        }
-        if (l->ne) {
-          v = l->ne ;
-          return -x ;
-        }
-      }
       return -1 ; // none found
    } else {
       unsigned int w = 1 << depth ;
@@ -916,6 +1269,8 @@ int ghashbase::nextbit(ghnode *n, int x, int y, int depth, int &v) {
 int ghashbase::setcell(int x, int y, int newstate) {
    if (newstate < 0 || newstate >= maxCellStates)
      return -1 ;
+   if (rowsmode)
+      endrows() ;
    if (hashed) {
       clearstack() ;
       save(root) ;
@@ -948,6 +1303,163 @@ int ghashbase::setcell(int x, int y, int newstate) {
    }
    return 0 ;
 }
+/*
+ *   Loading a pattern a row at a time.  Rather than walking down from
+ *   the root for every cell, we collect the cells of each band of 4
+ *   rows, turn them into canonical leaves, and join each pair of
+ *   vertically adjacent bands of nodes into a band of nodes one level
+ *   up, so every ghnode is built once, from the bottom.  Rows are
+ *   counted from y = 1 so that the bands line up with the tree, whose
+ *   top edge is at 1 - 2^depth.  Nothing here is reachable from the
+ *   root until endrows, so gc stays off until then.
+ */
+int ghashbase::setrowcell(int x, int y, int newstate) {
+   if (newstate < 0 || newstate >= maxCellStates)
+      return -1 ;
+   long long band = ((long long)y - 1) >> 2 ;
+   if (!rowsmode) {
+      if (!isEmpty())
+         return setcell(x, y, newstate) ;
+      rowsmode = 1 ;
+      rowband = band ;
+   } else if (band != rowband) {
+      if (band < rowband) {
+         /* out of order; finish up and go on a cell at a time */
+         endrows() ;
+         return setcell(x, y, newstate) ;
+      }
+      flushrowband() ;
+      rowband = band ;
+   }
+   rowcells.push_back(x) ;
+   rowcells.push_back((int)(((long long)y - 1) & 3)) ;
+   rowcells.push_back(newstate) ;
+   return 0 ;
+}
+/*
+ *   Sort key for the cells of a band: the column of leaves they lie in.
+ */
+struct ghrowcellorder {
+   ghrowcellorder(const int *c) : cells(c) {}
+   bool operator()(int a, int b) const {
+      return (cells[3*a] >> 2) < (cells[3*b] >> 2) ;
+   }
+   const int *cells ;
+} ;
+void ghashbase::flushrowband() {
+   int n = (int)(rowcells.size() / 3) ;
+   if (n == 0)
+      return ;
+   const int *cells = &rowcells[0] ;
+   std::vector<int> order(n) ;
+   for (int i=0; i<n; i++)
+      order[i] = i ;
+   std::stable_sort(order.begin(), order.end(), ghrowcellorder(cells)) ;
+   std::vector<std::pair<long long, ghnode *> > leaves ;
+   ghnode *z = zeroghnode(1) ;
+   for (int i=0; i<n; ) {
+      int col = cells[3*order[i]] >> 2 ;
+      state c[GHLEAFSIZE] ;
+      memset(c, 0, sizeof(c)) ;
+      for (; i<n && (cells[3*order[i]] >> 2) == col; i++) {
+         const int *cell = cells + 3 * order[i] ;
+         c[cell[1] * 4 + (cell[0] & 3)] = (state)cell[2] ;
+      }
+      ghnode *l = (ghnode *)find_ghleaf(c) ;
+      if (l != z)
+         leaves.push_back(std::make_pair((long long)col, l)) ;
+   }
+   rowcells.clear() ;
+   pushrowband(1, rowband, leaves) ;
+}
+/*
+ *   Add a band of nodes (sorted by column) at the given depth, joining
+ *   the pending pair at that depth first if this band isn't part of it.
+ */
+void ghashbase::pushrowband(int depth, long long band,
+                            std::vector<std::pair<long long, ghnode *> > &nodes) {
+   if ((int)rowpend.size() <= depth)
+      rowpend.resize(depth + 1) ;
+   if (rowpend[depth].pair != (band >> 1))
+      joinrowbands(depth) ;
+   rowpend[depth].pair = band >> 1 ;
+   rowpend[depth].half[band & 1].swap(nodes) ;
+}
+void ghashbase::joinrowbands(int depth) {
+   std::vector<std::pair<long long, ghnode *> > t, b, up ;
+   t.swap(rowpend[depth].half[0]) ;
+   b.swap(rowpend[depth].half[1]) ;
+   if (t.empty() && b.empty())
+      return ;
+   ghnode *z = zeroghnode(depth) ;
+   size_t i = 0, j = 0 ;
+   while (i < t.size() || j < b.size()) {
+      long long col ;
+      if (j == b.size() || (i < t.size() && t[i].first < b[j].first))
+         col = t[i].first >> 1 ;
+      else
+         col = b[j].first >> 1 ;
+      ghnode *q[4] = { z, z, z, z } ;
+      for (; i < t.size() && (t[i].first >> 1) == col; i++)
+         q[t[i].first & 1] = t[i].second ;
+      for (; j < b.size() && (b[j].first >> 1) == col; j++)
+         q[2 + (b[j].first & 1)] = b[j].second ;
+      up.push_back(std::make_pair(col, find_ghnode(q[0], q[1], q[2], q[3]))) ;
+   }
+   pushrowband(depth + 1, rowpend[depth].pair, up) ;
+}
+/*
+ *   Put sub (of depth subdepth, corner at sx,sy) into ghnode n (corner
+ *   at x,y), in row-band coordinates.
+ */
+ghnode *ghashbase::putghnode(ghnode *n, int depth, long long x, long long y,
+                             ghnode *sub, int subdepth, long long sx,
+                             long long sy) {
+   if (depth == subdepth)
+      return sub ;
+   long long half = 1LL << depth ;
+   depth-- ;
+   ghnode *nw = n->nw, *ne = n->ne, *sw = n->sw, *se = n->se ;
+   if (sy < y + half) {
+      if (sx < x + half)
+         nw = putghnode(nw, depth, x, y, sub, subdepth, sx, sy) ;
+      else
+         ne = putghnode(ne, depth, x + half, y, sub, subdepth, sx, sy) ;
+   } else {
+      if (sx < x + half)
+         sw = putghnode(sw, depth, x, y + half, sub, subdepth, sx, sy) ;
+      else
+         se = putghnode(se, depth, x + half, y + half, sub, subdepth, sx, sy) ;
+   }
+   return find_ghnode(nw, ne, sw, se) ;
+}
+/*
+ *   What is left at the end is at most a pair of bands at each depth;
+ *   these go into the (empty) root from the top.
+ */
+void ghashbase::endrows() {
+   flushrowband() ;
+   rowsmode = 0 ;
+   for (int d=1; d<(int)rowpend.size(); d++) {
+      for (int h=0; h<2; h++) {
+         std::vector<std::pair<long long, ghnode *> > &v = rowpend[d].half[h] ;
+         long long sy = (2 * rowpend[d].pair + h) << (d + 1) ;
+         for (size_t i=0; i<v.size(); i++) {
+            long long sx = v[i].first << (d + 1) ;
+            long long w = 2LL << d ;
+            while (sx < -(1LL << depth) || sx + w > (1LL << depth) ||
+                   sy < -(1LL << depth) || sy + w > (1LL << depth)) {
+               root = pushroot(root) ;
+               depth++ ;
+            }
+            long long corner = -(1LL << depth) ;
+            root = putghnode(root, depth, corner, corner, v[i].second, d,
+                           sx, sy) ;
+         }
+      }
+   }
+   rowpend.clear() ;
+}
 /*
  *   Our nonrecurse top-level bit getting routine.
  */
@@ -1007,6 +1519,486 @@ int ghashbase::nextcell(int x, int y, int &v) {
    }
    return nextbit(root, x, y, depth, v) ;
 }
+/*
+ *   Pattern hashes (see patternhash in util.h).  The hash of each
+ *   canonical ghnode, relative to its own top left corner, is kept in
+ *   hashcache until the next gc, so hashing the pattern after a step
+ *   only visits the ghnodes the step created.  Leaves are cheap enough
+ *   to hash directly.
+ */
+unsigned long long ghashbase::ghnodehash(ghnode *n, int depth) {
+   if (depth == 1) {
+      const state *c = ((ghleaf *)n)->c ;
+      unsigned long long h = 0 ;
+      for (int i=0; i<GHLEAFSIZE; i++)
+         if (c[i])
+            h = patternhash::add(h, patternhash::mul(c[i],
+                 patternhash::mul(patternhash::xpow(i & 3),
+                                  patternhash::ypow(i >> 2)))) ;
+      return h ;
+   }
+   if (n == zeroghnode(depth))
+      return 0 ;
+   std::unordered_map<ghnode *, unsigned long long>::iterator it =
+                                                       hashcache.find(n) ;
+   if (it != hashcache.end())
+      return it->second ;
+   unsigned long long h = patternhash::quad(ghnodehash(n->nw, depth-1),
+                                            ghnodehash(n->ne, depth-1),
+                                            ghnodehash(n->sw, depth-1),
+                                            ghnodehash(n->se, depth-1), depth) ;
+   hashcache[n] = h ;
+   return h ;
+}
+/*
+ *   Hash the part of ghnode n (top left corner at x,y) that lies inside
+ *   the rect r (left, top, right, bottom, the last two exclusive),
+ *   relative to the ghnode's corner.
+ */
+unsigned long long ghashbase::recthash(ghnode *n, int depth, long long x,
+                                       long long y, const long long *r) {
+   long long w = 1LL << (depth + 1) ;
+   if (x >= r[2] || y >= r[3] || x + w <= r[0] || y + w <= r[1] ||
+       n == zeroghnode(depth))
+      return 0 ;
+   if (x >= r[0] && y >= r[1] && x + w <= r[2] && y + w <= r[3])
+      return ghnodehash(n, depth) ;
+   if (depth == 1) {
+      const state *c = ((ghleaf *)n)->c ;
+      unsigned long long h = 0 ;
+      for (int i=0; i<GHLEAFSIZE; i++)
+         if (c[i] && x + (i & 3) >= r[0] && x + (i & 3) < r[2] &&
+                     y + (i >> 2) >= r[1] && y + (i >> 2) < r[3])
+            h = patternhash::add(h, patternhash::mul(c[i],
+                 patternhash::mul(patternhash::xpow(i & 3),
+                                  patternhash::ypow(i >> 2)))) ;
+      return h ;
+   }
+   long long half = w >> 1 ;
+   depth-- ;
+   return patternhash::quad(recthash(n->nw, depth, x, y, r),
+                            recthash(n->ne, depth, x + half, y, r),
+                            recthash(n->sw, depth, x, y + half, r),
+                            recthash(n->se, depth, x + half, y + half, r),
+                            depth + 1) ;
+}
+unsigned long long ghashbase::getRectHash(int x, int y, int wd, int ht) {
+   if (!hashed)
+      return lifealgo::getRectHash(x, y, wd, ht) ;
+   if (wd <= 0 || ht <= 0)
+      return 0 ;
+   /* anything an int rect can reach lies in the middle of depth 31 */
+   struct ghnode tghnode ;
+   ghnode *n = root ;
+   int mdepth = depth ;
+   while (mdepth > 31) {
+      tghnode.nw = n->nw->se ;
+      tghnode.ne = n->ne->sw ;
+      tghnode.sw = n->sw->ne ;
+      tghnode.se = n->se->nw ;
+      n = &tghnode ;
+      mdepth-- ;
+   }
+   long long corner = -(1LL << mdepth) ;
+   long long r[4] = { x, y, (long long)x + wd, (long long)y + ht } ;
+   unsigned long long h = recthash(n, mdepth, corner, corner + 1, r) ;
+   return patternhash::mul(h, patternhash::mul(patternhash::xpow(corner - x),
+                                           patternhash::ypow(corner + 1 - y))) ;
+}
+/*
+ *   Batch cell access.  Everything an int can address lies in the
+ *   middle node of depth 31, so the batch setters rebuild that node
+ *   and then splice it back into the root with setmiddle.  The cells
+ *   are sorted into quadrants on the way down, so each node touched
+ *   is rebuilt exactly once, rather than once per cell as setcell
+ *   would.
+ */
+void ghashbase::growroot(int left, int top, int right, int bottom) {
+   int lim = depth <= 31 ? depth : 31 ;
+   int sx0 = left >> lim, sx1 = right >> lim ;
+   int sy0 = (- bottom) >> lim, sy1 = (- top) >> lim ;
+   while (sx0 < -1 || sx1 > 0 || sy0 < -1 || sy1 > 0) {
+      root = save(pushroot(root)) ;
+      depth++ ;
+      sx0 >>= 1 ;
+      sx1 >>= 1 ;
+      sy0 >>= 1 ;
+      sy1 >>= 1 ;
+   }
+}
+ghnode *ghashbase::middleghnode(ghnode &tghnode, int &mdepth) {
+   ghnode *n = root ;
+   mdepth = depth ;
+   while (mdepth > 31) {
+      tghnode.nw = n->nw->se ;
+      tghnode.ne = n->ne->sw ;
+      tghnode.sw = n->sw->ne ;
+      tghnode.se = n->se->nw ;
+      n = &tghnode ;
+      mdepth-- ;
+   }
+   return n ;
+}
+/*
+ *   Replace the middle node of depth 31 in n with m.
+ */
+ghnode *ghashbase::setmiddle(ghnode *n, int depth, ghnode *m) {
+   int sp = gsp ;
+   if (depth > 32) {
+      struct ghnode tghnode ;
+      tghnode.nw = n->nw->se ;
+      tghnode.ne = n->ne->sw ;
+      tghnode.sw = n->sw->ne ;
+      tghnode.se = n->se->nw ;
+      m = save(setmiddle(&tghnode, depth-1, m)) ;
+   }
+   ghnode *nw = save(find_ghnode(n->nw->nw, n->nw->ne, n->nw->sw, m->nw)) ;
+   ghnode *ne = save(find_ghnode(n->ne->nw, n->ne->ne, m->ne, n->ne->se)) ;
+   ghnode *sw = save(find_ghnode(n->sw->nw, m->sw, n->sw->sw, n->sw->se)) ;
+   ghnode *se = save(find_ghnode(m->se, n->se->ne, n->se->sw, n->se->se)) ;
+   ghnode *r = find_ghnode(nw, ne, sw, se) ;
+   pop(sp) ;
+   return r ;
+}
+/*
+ *   The cells are x,y,state triples relative to the same top left
+ *   corner as x,y; scratch has room for count of them.
+ */
+ghnode *ghashbase::setcellsghnode(ghnode *n, int depth, long long x,
+                                  long long y, int *cells, int *scratch,
+                                  int count) {
+   if (count <= 0)
+      return n ;
+   if (depth == 1) {
+      state c[GHLEAFSIZE] ;
+      memcpy(c, ((ghleaf *)n)->c, sizeof(c)) ;
+      for (int i=0; i<count; i++, cells += 3)
+         c[(int)(cells[1] - y) * 4 + (int)(cells[0] - x)] = (state)cells[2] ;
+      return (ghnode *)find_ghleaf(c) ;
+   }
+   long long half = 1LL << depth ;
+   int cnt[4] = { 0, 0, 0, 0 } ;
+   for (int i=0; i<count; i++)
+      cnt[(cells[3*i] >= x + half) + 2 * (cells[3*i+1] >= y + half)]++ ;
+   int at[4] = { 0, cnt[0], cnt[0] + cnt[1], cnt[0] + cnt[1] + cnt[2] } ;
+   /* keep the cells in order within each quadrant, so the last wins */
+   for (int i=0; i<count; i++) {
+      int *c = cells + 3 * i ;
+      int k = (c[0] >= x + half) + 2 * (c[1] >= y + half) ;
+      memcpy(scratch + 3 * at[k]++, c, 3 * sizeof(int)) ;
+   }
+   memcpy(cells, scratch, 3 * (size_t)count * sizeof(int)) ;
+   int sp = gsp ;
+   depth-- ;
+   int *c = cells ;
+   ghnode *nw = save(setcellsghnode(n->nw, depth, x, y, c, scratch,
+                                    cnt[0])) ;
+   c += 3 * cnt[0] ;
+   ghnode *ne = save(setcellsghnode(n->ne, depth, x + half, y, c, scratch,
+                                    cnt[1])) ;
+   c += 3 * cnt[1] ;
+   ghnode *sw = save(setcellsghnode(n->sw, depth, x, y + half, c, scratch,
+                                    cnt[2])) ;
+   c += 3 * cnt[2] ;
+   ghnode *se = save(setcellsghnode(n->se, depth, x + half, y + half, c,
+                                    scratch, cnt[3])) ;
+   ghnode *r = find_ghnode(nw, ne, sw, se) ;
+   pop(sp) ;
+   return r ;
+}
+int ghashbase::setcells(const int *cells, int count, bool withstates) {
+   if (count <= 0)
+      return 0 ;
+   int step = withstates ? 3 : 2 ;
+   int left = cells[0], top = cells[1], right = left, bottom = top ;
+   for (int i=0; i<count; i++) {
+      const int *c = cells + step * i ;
+      if (withstates && (c[2] < 0 || c[2] >= maxCellStates))
+         return -1 ;
+      if (c[0] < left) left = c[0] ;
+      if (c[0] > right) right = c[0] ;
+      if (c[1] < top) top = c[1] ;
+      if (c[1] > bottom) bottom = c[1] ;
+   }
+   ensure_hashed() ;
+   vector<int> work(6 * (size_t)count) ;
+   int *triples = &work[0] ;
+   for (int i=0; i<count; i++) {
+      triples[3*i] = cells[step*i] ;
+      triples[3*i+1] = cells[step*i+1] ;
+      triples[3*i+2] = withstates ? cells[step*i+2] : 1 ;
+   }
+   clearstack() ;
+   save(root) ;
+   okaytogc = 1 ;
+   inGC = 1 ;
+   growroot(left, top, right, bottom) ;
+   struct ghnode tghnode ;
+   int mdepth ;
+   ghnode *n = middleghnode(tghnode, mdepth) ;
+   long long corner = -(1LL << mdepth) ;
+   n = save(setcellsghnode(n, mdepth, corner, corner + 1, triples,
+                         triples + 3 * (size_t)count, count)) ;
+   root = mdepth < depth ? setmiddle(root, depth, n) : n ;
+   okaytogc = 0 ;
+   return 0 ;
+}
+ghnode *ghashbase::putrectghnode(ghnode *n, int depth, long long x,
+                                 long long y, const lifecellrect &r) {
+   long long w = 1LL << (depth + 1) ;
+   if (x >= r.x + (long long)r.wd || y >= r.y + (long long)r.ht ||
+       x + w <= r.x || y + w <= r.y)
+      return n ;
+   if (depth == 1) {
+      state c[GHLEAFSIZE] ;
+      memcpy(c, ((ghleaf *)n)->c, sizeof(c)) ;
+      for (int i=0; i<GHLEAFSIZE; i++) {
+         long long rx = x + (i & 3) - r.x ;
+         long long ry = y + (i >> 2) - r.y ;
+         if (rx >= 0 && rx < r.wd && ry >= 0 && ry < r.ht)
+            c[i] = (state)r.get((int)rx, (int)ry) ;
+      }
+      return (ghnode *)find_ghleaf(c) ;
+   }
+   long long half = w >> 1 ;
+   int sp = gsp ;
+   depth-- ;
+   ghnode *nw = save(putrectghnode(n->nw, depth, x, y, r)) ;
+   ghnode *ne = save(putrectghnode(n->ne, depth, x + half, y, r)) ;
+   ghnode *sw = save(putrectghnode(n->sw, depth, x, y + half, r)) ;
+   ghnode *se = save(putrectghnode(n->se, depth, x + half, y + half, r)) ;
+   ghnode *res = find_ghnode(nw, ne, sw, se) ;
+   pop(sp) ;
+   return res ;
+}
+int ghashbase::putrect(const lifecellrect &r) {
+   if (r.wd <= 0 || r.ht <= 0)
+      return 0 ;
+   if (!r.bits)
+      for (int j=0; j<r.ht; j++)
+         for (int i=0; i<r.wd; i++)
+            if (r.get(i, j) >= maxCellStates)
+               return -1 ;
+   ensure_hashed() ;
+   clearstack() ;
+   save(root) ;
+   okaytogc = 1 ;
+   inGC = 1 ;
+   growroot(r.x, r.y, r.x + r.wd - 1, r.y + r.ht - 1) ;
+   struct ghnode tghnode ;
+   int mdepth ;
+   ghnode *n = middleghnode(tghnode, mdepth) ;
+   long long corner = -(1LL << mdepth) ;
+   n = save(putrectghnode(n, mdepth, corner, corner + 1, r)) ;
+   root = mdepth < depth ? setmiddle(root, depth, n) : n ;
+   okaytogc = 0 ;
+   return 0 ;
+}
+/*
+ *   Visit the live cells of ghnode n (top left corner at x,y) inside the
+ *   rect r (left, top, right, bottom, the last two exclusive).
+ */
+void ghashbase::visitghnode(ghnode *n, int depth, long long x, long long y,
+                            const long long *r, lifecellvisitor &v) {
+   long long w = 1LL << (depth + 1) ;
+   if (x >= r[2] || y >= r[3] || x + w <= r[0] || y + w <= r[1] ||
+       n == zeroghnode(depth))
+      return ;
+   if (depth == 1) {
+      const state *c = ((ghleaf *)n)->c ;
+      for (int i=0; i<GHLEAFSIZE; i++) {
+         long long cx = x + (i & 3) ;
+         long long cy = y + (i >> 2) ;
+         if (c[i] && cx >= r[0] && cx < r[2] && cy >= r[1] && cy < r[3])
+            v.cell((int)cx, (int)cy, c[i]) ;
+      }
+      return ;
+   }
+   long long half = w >> 1 ;
+   depth-- ;
+   visitghnode(n->nw, depth, x, y, r, v) ;
+   visitghnode(n->ne, depth, x + half, y, r, v) ;
+   visitghnode(n->sw, depth, x, y + half, r, v) ;
+   visitghnode(n->se, depth, x + half, y + half, r, v) ;
+}
+void ghashbase::visitcells(lifecellvisitor &v, int x, int y, int wd, int ht) {
+   if (!hashed) {
+      lifealgo::visitcells(v, x, y, wd, ht) ;
+      return ;
+   }
+   if (wd <= 0 || ht <= 0)
+      return ;
+   struct ghnode tghnode ;
+   int mdepth ;
+   ghnode *n = middleghnode(tghnode, mdepth) ;
+   long long corner = -(1LL << mdepth) ;
+   long long r[4] = { x, y, (long long)x + wd, (long long)y + ht } ;
+   visitghnode(n, mdepth, corner, corner + 1, r, v) ;
+}
+/*
+ *   Row-order traversal, for writing patterns.  A strip is a row of
+ *   nonempty ghnodes of one depth, sorted by x; we walk the strip made
+ *   of their top halves and then the one made of their bottom halves,
+ *   so empty space costs nothing, until we get down to rows of ghleafs.
+ *   Positions are relative to the rect's top left corner.
+ */
+bool ghashbase::rowstrip(std::vector<std::pair<long long, ghnode *> > &strip,
+                         int depth, long long y, long long wd, long long ht,
+                         liferowvisitor &v) {
+   long long size = 2LL << depth ;
+   if (strip.empty() || y >= ht || y + size <= 0)
+      return true ;
+   if (depth == 1) {
+      for (int r=0; r<4; r++) {
+         if (y + r < 0 || y + r >= ht)
+            continue ;
+         for (size_t i=0; i<strip.size(); i++) {
+            const state *c = ((ghleaf *)strip[i].second)->c + 4 * r ;
+            for (int col=0; col<4; col++) {
+               long long x = strip[i].first + col ;
+               if (c[col] && x >= 0 && x < wd && !v.cell(x, y + r, c[col]))
+                  return false ;
+            }
+         }
+      }
+      return true ;
+   }
+   long long half = size >> 1 ;
+   ghnode *z = zeroghnode(depth - 1) ;
+   std::vector<std::pair<long long, ghnode *> > sub ;
+   for (int h=0; h<2; h++) {
+      sub.clear() ;
+      for (size_t i=0; i<strip.size(); i++) {
+         long long x = strip[i].first ;
+         ghnode *w = h ? strip[i].second->sw : strip[i].second->nw ;
+         ghnode *e = h ? strip[i].second->se : strip[i].second->ne ;
+         if (w != z && x < wd && x + half > 0)
+            sub.push_back(std::make_pair(x, w)) ;
+         if (e != z && x + half < wd && x + size > 0)
+            sub.push_back(std::make_pair(x + half, e)) ;
+      }
+      if (!rowstrip(sub, depth - 1, y + h * half, wd, ht, v))
+         return false ;
+   }
+   return true ;
+}
+/*
+ *   Does the square at x,y of the given size meet the rect?
+ */
+static bool meetsrect(const bigint &x, const bigint &y, const bigint &size,
+                      const bigint &top, const bigint &left,
+                      const bigint &bottom, const bigint &right) {
+   bigint r = x ;
+   r += size ;
+   bigint b = y ;
+   b += size ;
+   return x <= right && y <= bottom && r > left && b > top ;
+}
+int ghashbase::visitrows(liferowvisitor &v, const bigint &top,
+                         const bigint &left, const bigint &bottom,
+                         const bigint &right) {
+   long long wd, ht ;
+   if (!rowsize(top, left, bottom, right, wd, ht))
+      return -1 ;
+   if (wd <= 0 || ht <= 0 || isEmpty())
+      return 0 ;
+   /*
+    *   Come down from the root in bigints until the nodes are small
+    *   enough that their positions relative to the rect fit in a long
+    *   long; the rect is smaller than such a node, so there are at
+    *   most four of them.
+    */
+   struct bigghnode {
+      bigint x, y ;
+      ghnode *n ;
+   } ;
+   std::vector<bigghnode> nodes, next ;
+   bigint size = 1 ;
+   size.mulpow2(depth + 1) ;
+   bigghnode b ;
+   b.x = 0 ;
+   b.x -= size ;
+   b.x.div2() ;
+   b.y = b.x ;
+   b.y += 1 ;
+   b.n = root ;
+   if (meetsrect(b.x, b.y, size, top, left, bottom, right))
+      nodes.push_back(b) ;
+   int d = depth ;
+   for (; d > 60; d--) {
+      size.div2() ;
+      ghnode *z = zeroghnode(d - 1) ;
+      next.clear() ;
+      for (size_t i=0; i<nodes.size(); i++) {
+         ghnode *n = nodes[i].n ;
+         ghnode *kids[4] = { n->nw, n->ne, n->sw, n->se } ;
+         for (int k=0; k<4; k++) {
+            if (kids[k] == z)
+               continue ;
+            b.x = nodes[i].x ;
+            if (k & 1)
+               b.x += size ;
+            b.y = nodes[i].y ;
+            if (k & 2)
+               b.y += size ;
+            b.n = kids[k] ;
+            if (meetsrect(b.x, b.y, size, top, left, bottom, right))
+               next.push_back(b) ;
+         }
+      }
+      nodes.swap(next) ;
+   }
+   /* put the (few) nodes in row order and walk each row of them */
+   for (size_t i=1; i<nodes.size(); i++)
+      for (size_t j=i; j>0 && (nodes[j].y < nodes[j-1].y ||
+             (nodes[j].y == nodes[j-1].y && nodes[j].x < nodes[j-1].x)); j--)
+         std::swap(nodes[j], nodes[j-1]) ;
+   std::vector<std::pair<long long, ghnode *> > strip ;
+   for (size_t i=0; i<nodes.size(); ) {
+      bigint y = nodes[i].y ;
+      strip.clear() ;
+      for (; i<nodes.size() && nodes[i].y == y; i++) {
+         bigint x = nodes[i].x ;
+         x -= left ;
+         strip.push_back(std::make_pair(x.toint64(), nodes[i].n)) ;
+      }
+      y -= top ;
+      if (!rowstrip(strip, d, y.toint64(), wd, ht, v))
+         return 1 ;
+   }
+   return 0 ;
+}
+unsigned long long ghashbase::getPatternHash() {
+   if (!hashed)
+      return lifealgo::getPatternHash() ;
+   if (isEmpty())
+      return 0 ;
+   bigint top, left, bottom, right ;
+   findedges(&top, &left, &bottom, &right) ;
+   if (top < bigint::min_coord || left < bigint::min_coord ||
+       bottom > bigint::max_coord || right > bigint::max_coord)
+      return 0 ;
+   struct ghnode tghnode ;
+   ghnode *n = root ;
+   int mdepth = depth ;
+   while (mdepth > 31) {
+      tghnode.nw = n->nw->se ;
+      tghnode.ne = n->ne->sw ;
+      tghnode.sw = n->sw->ne ;
+      tghnode.se = n->se->nw ;
+      n = &tghnode ;
+      mdepth-- ;
+   }
+   /* the whole tree is inside the bounding box as far as live cells go */
+   long long corner = -(1LL << mdepth) ;
+   unsigned long long h = patternhash::quad(ghnodehash(n->nw, mdepth-1),
+                                            ghnodehash(n->ne, mdepth-1),
+                                            ghnodehash(n->sw, mdepth-1),
+                                            ghnodehash(n->se, mdepth-1), mdepth) ;
+   return patternhash::mul(h,
+                 patternhash::mul(patternhash::xpow(corner - left.toint()),
+                                  patternhash::ypow(corner + 1 - top.toint()))) ;
+}
 /*
  *   Canonicalize a universe by filling in the null pointers and then
  *   invoking find_ghnode on each ghnode.  Drops the original universe on
@@ -1016,9 +2008,9 @@ ghnode *ghashbase::hashpattern(ghnode *root, int depth) {
    ghnode *r ;
    if (root == 0) {
       r = zeroghnode(depth) ;
-   } else if (depth == 0) {
+   } else if (depth == 1) {
       ghleaf *n = (ghleaf *)root ;
-      r = (ghnode *)find_ghleaf(n->nw, n->ne, n->sw, n->se) ;
+      r = (ghnode *)find_ghleaf(n->c) ;
       n->next = freeghnodes ;
       freeghnodes = root ;
    } else {
@@ -1034,6 +2026,8 @@ ghnode *ghashbase::hashpattern(ghnode *root, int depth) {
 }
 void ghashbase::endofpattern() {
    poller->bailIfCalculating() ;
+   if (rowsmode)
+      endrows() ;
    if (!hashed) {
       root = hashpattern(root, depth) ;
       zeroghnode(depth) ;
@@ -1052,7 +2046,7 @@ void ghashbase::ensure_hashed() {
  */
 ghnode *ghashbase::popzeros(ghnode *n) {
    int depth = ghnode_depth(n) ;
-   while (depth > 1) {
+   while (depth > 2) {
       ghnode *z = zeroghnode(depth-2) ;
       if (n->nw->nw == z && n->nw->ne == z && n->nw->sw == z &&
           n->ne->nw == z && n->ne->ne == z && n->ne->se == z &&
@@ -1082,25 +2076,18 @@ ghnode *ghashbase::popzeros(ghnode *n) {
  */
 #define marked2(n) (3 & (g_uintptr_t)(n)->res)
 #define mark2(n) ((n)->res = (ghnode *)(1 | (g_uintptr_t)(n)->res))
-#define mark2v(n, v) ((n)->res = (ghnode *)(v | (g_uintptr_t)(n)->res))
 #define clearmark2(n) ((n)->res = (ghnode *)(~3 & (g_uintptr_t)(n)->res))
-void ghashbase::unhash_ghnode(ghnode *n) {
-   ghnode *p ;
-   g_uintptr_t h = ghnode_hash(n->nw,n->ne,n->sw,n->se) ;
-   ghnode *pred = 0 ;
-   h = HASHMOD(h) ;
-   for (p=hashtab[h]; (!is_ghnode(p) || !marked2(p)) && p; p = p->next) {
-      if (p == n) {
-         if (pred)
-            pred->next = p->next ;
-         else
-            hashtab[h] = p->next ;
-         return ;
-      }
-      pred = p ;
-   }
-   lifefatal("Didn't find ghnode to unhash") ;
+#ifndef CHAINEDHASH
+/*
+ *   The open-addressed table doesn't use the next field, so there is
+ *   nothing to unhash; we just need to leave next clear afterwards so a
+ *   stale value is never mistaken for a gc mark.
+ */
+void ghashbase::unhash_ghnode2(ghnode *) {}
+void ghashbase::rehash_ghnode(ghnode *n) {
+   n->next = 0 ;
 }
+#else
 void ghashbase::unhash_ghnode2(ghnode *n) {
    ghnode *p ;
    g_uintptr_t h = ghnode_hash(n->nw,n->ne,n->sw,n->se) ;
@@ -1124,56 +2111,79 @@ void ghashbase::rehash_ghnode(ghnode *n) {
    n->next = hashtab[h] ;
    hashtab[h] = n ;
 }
+#endif
 /*
- *   This recursive routine calculates the population by hanging the
- *   population on marked ghnodes.
+ *   Populations are kept for every canonical ghnode we have counted, in
+ *   popmemo, until gc frees the ghnode, so counting the population after
+ *   a step only visits the ghnodes the step created.  A ghnode of depth
+ *   30 or less holds at most 2^62 cells, so its population fits in 64
+ *   bits; only the deeper ghnodes need bigints.  Leaves and depth-2
+ *   ghnodes are cheap enough to count directly.
  */
-const bigint &ghashbase::calcpop(ghnode *root, int depth) {
+const int MAXSMALLPOPDEPTH = 30 ;
+static int ghleafpop(const ghleaf *l) {
+   int n = 0 ;
+   for (int i=0; i<GHLEAFSIZE; i++)
+      n += (l->c[i] != 0) ;
+   return n ;
+}
+unsigned long long ghashbase::calcpop(ghnode *root, int depth) {
+   if (depth == 1)
+      return ghleafpop((ghleaf *)root) ;
+   if (root == zeroghnode(depth))
+      return 0 ;
+   if (depth == 2)
+      return ghleafpop((ghleaf *)root->nw) + ghleafpop((ghleaf *)root->ne) +
+             ghleafpop((ghleaf *)root->sw) + ghleafpop((ghleaf *)root->se) ;
+   std::unordered_map<ghnode *, unsigned long long>::iterator it =
+                                                         popmemo.find(root) ;
+   if (it != popmemo.end())
+      return it->second ;
+   depth-- ;
+   unsigned long long pop = calcpop(root->nw, depth) +
+                            calcpop(root->ne, depth) +
+                            calcpop(root->sw, depth) +
+                            calcpop(root->se, depth) ;
+   popmemo[root] = pop ;
+   return pop ;
+}
+const bigint &ghashbase::calcbigpop(ghnode *root, int depth) {
    if (root == zeroghnode(depth))
       return bigint::zero ;
-   if (depth == 0)
-      return ((ghleaf *)root)->leafpop ;
-   if (marked2(root))
-      return *(bigint*)&(root->next) ;
+   std::unordered_map<ghnode *, bigint>::iterator it = bigpopmemo.find(root) ;
+   if (it != bigpopmemo.end())
+      return it->second ;
    depth-- ;
-   if (root->next == 0)
-      mark2v(root, 3) ;
-   else {
-      unhash_ghnode(root) ;
-      mark2(root) ;
+   bigint pop ;
+   if (depth <= MAXSMALLPOPDEPTH) {
+      pop = bigint((G_INT64)calcpop(root->nw, depth)) ;
+      pop += bigint((G_INT64)calcpop(root->ne, depth)) ;
+      pop += bigint((G_INT64)calcpop(root->sw, depth)) ;
+      pop += bigint((G_INT64)calcpop(root->se, depth)) ;
+   } else {
+      pop = bigint(calcbigpop(root->nw, depth), calcbigpop(root->ne, depth),
+                   calcbigpop(root->sw, depth), calcbigpop(root->se, depth)) ;
    }
-/**
- *   We use the memory in root->next as a value bigint.  But we want to
- *   make sure the copy constructor doesn't "clean up" something that
- *   doesn't exist.  So we clear it to zero here.
- */
-   new(&(root->next))bigint(
-        calcpop(root->nw, depth), calcpop(root->ne, depth),
-        calcpop(root->sw, depth), calcpop(root->se, depth)) ;
-   return *(bigint *)&(root->next) ;
+   return bigpopmemo[root] = pop ;
 }
 /*
- *   Call this after doing something that unhashes ghnodes in order to
- *   use the next field as a temp pointer.
+ *   Called by gc after marking:  forget the populations of the ghnodes
+ *   it is about to free.
  */
-void ghashbase::aftercalcpop2(ghnode *root, int depth) {
-   if (depth == 0 || root == zeroghnode(depth))
-      return ;
-   int v = marked2(root) ;
-   if (v) {
-      clearmark2(root) ;
-      depth-- ;
-      if (depth > 0) {
-         aftercalcpop2(root->nw, depth) ;
-         aftercalcpop2(root->ne, depth) ;
-         aftercalcpop2(root->sw, depth) ;
-         aftercalcpop2(root->se, depth) ;
-      }
-      ((bigint *)&(root->next))->~bigint() ;
-      if (v == 3)
-         root->next = 0 ;
+void ghashbase::prunepops() {
+   for (std::unordered_map<ghnode *, unsigned long long>::iterator it =
+                                popmemo.begin(); it != popmemo.end(); ) {
+      if (marked(it->first))
+         ++it ;
       else
-         rehash_ghnode(root) ;
+         it = popmemo.erase(it) ;
+   }
+   for (std::unordered_map<ghnode *, bigint>::iterator it =
+                             bigpopmemo.begin(); it != bigpopmemo.end(); ) {
+      if (marked(it->first))
+         ++it ;
+      else
+         it = bigpopmemo.erase(it) ;
    }
 }
 /*
@@ -1183,7 +2193,7 @@ void ghashbase::aftercalcpop2(ghnode *root, int depth) {
 void ghashbase::afterwritemc(ghnode *root, int depth) {
    if (root == zeroghnode(depth))
       return ;
-   if (depth == 0) {
+   if (depth == 1) {
       root->nw = 0 ; // all these bigints are guaranteed to be small
       return ;
    }
@@ -1204,8 +2214,10 @@ void ghashbase::calcPopulation() {
    int depth ;
    ensure_hashed() ;
    depth = ghnode_depth(root) ;
-   population = calcpop(root, depth) ;
-   aftercalcpop2(root, depth) ;
+   if (depth <= MAXSMALLPOPDEPTH)
+      population = bigint((G_INT64)calcpop(root, depth)) ;
+   else
+      population = calcbigpop(root, depth) ;
 }
 /*
  *   Is the universe empty?
@@ -1262,6 +2274,8 @@ void ghashbase::gc_mark(ghnode *root, int invalidate) {
             else
               gc_mark(root->res, invalidate) ;
          }
+      } else if (invalidate) {
+         ((ghleaf *)root)->resvalid = 0 ;
       }
    }
 }
@@ -1274,6 +2288,7 @@ void ghashbase::do_gc(int invalidate) {
    g_uintptr_t freed_ghnodes=0 ;
    ghnode *p, *pp ;
    inGC = 1 ;
+   double gcstart = gollySecondCount() ;
    gccount++ ;
    gcstep++ ;
    if (verbose) {
@@ -1296,22 +2311,45 @@ void ghashbase::do_gc(int invalidate) {
    }
    for (i=0; i<timeline.framecount; i++)
       gc_mark((ghnode *)timeline.frames[i], invalidate) ;
+   hashcache.clear() ;
+   prunepops() ;
+   damaged.invalidate() ;
    hashpop = 0 ;
+#ifdef CHAINEDHASH
    memset(hashtab, 0, sizeof(ghnode *) * hashprime) ;
+#else
+   // we rebuild the new table from scratch, so any migration is moot
+   if (oldhashtab) {
+      free(oldhashtab) ;
+      alloced -= sizeof(ghslot) * oldhashprime ;
+      oldhashtab = 0 ;
+      migrating = 0 ;
+   }
+   memset((void *)hashtab, 0, sizeof(ghslot) * hashprime) ;
+#endif
    freeghnodes = 0 ;
    for (p=ghnodeblocks; p; p=p->next) {
       poller->poll() ;
       for (pp=p+1, i=1; i<1001; i++, pp++) {
          if (marked(pp)) {
+#ifdef CHAINEDHASH
             g_uintptr_t h = 0 ;
             if (pp->nw) { /* yes, it's a ghnode */
                h = HASHMOD(ghnode_hash(pp->nw, pp->ne, pp->sw, pp->se)) ;
             } else {
-               ghleaf *lp = (ghleaf *)pp ;
-               h = HASHMOD(ghleaf_hash(lp->nw, lp->ne, lp->sw, lp->se)) ;
+               h = HASHMOD(ghleaf_hash(((ghleaf *)pp)->c)) ;
             }
             pp->next = hashtab[h] ;
             hashtab[h] = pp ;
+#else
+            g_uintptr_t hv = ghslot_hash(pp), h ;
+            for (h=HASHMOD(hv); hashtab[h].load(std::memory_order_relaxed);
+                                                              h=HASHNEXT(h))
+               ;
+            hashtab[h].store((g_uintptr_t)pp | slottag(hv),
+                             std::memory_order_relaxed) ;
+            pp->next = 0 ;
+#endif
             hashpop++ ;
          } else {
             pp->next = freeghnodes ;
@@ -1321,10 +2359,14 @@ void ghashbase::do_gc(int invalidate) {
       }
    }
    inGC = 0 ;
+   double gcsecs = gollySecondCount() - gcstart ;
+   running_hperf.gcCount++ ;
+   running_hperf.gcSeconds += gcsecs ;
    if (verbose) {
      double perc = (double)freed_ghnodes / (double)totalthings * 100.0 ;
-     sprintf(statusline+strlen(statusline), " freed %g percent (%" PRIuPTR ").",
-                                                  perc, freed_ghnodes) ;
+     sprintf(statusline+strlen(statusline),
+             " freed %g percent (%" PRIuPTR ") in %g seconds.",
+                                         perc, freed_ghnodes, gcsecs) ;
      lifestatus(statusline) ;
    }
    if (needPop) {
@@ -1341,7 +2383,7 @@ void ghashbase::do_gc(int invalidate) {
 void ghashbase::clearcache(ghnode *n, int depth, int clearto) {
    if (!marked(n)) {
       mark(n) ;
-      if (depth > 1) {
+      if (depth > 2) {
          depth-- ;
          poller->poll() ;
          clearcache(n->nw, depth, clearto) ;
@@ -1423,14 +2465,23 @@ void ghashbase::new_ngens(int newval) {
    if (newval < clearto)
       clearto = newval ;
    clearto++ ; /* clear this depth and above */
-   if (clearto < 1)
-      clearto = 1 ;
+   if (clearto < 2)
+      clearto = 2 ;
    ngens = newval ;
    inGC = 1 ;
+#ifdef CHAINEDHASH
    for (i=0; i<hashprime; i++)
       for (p=hashtab[i]; p; p=clearmarkbit(p->next))
          if (is_ghnode(p) && !marked(p))
             clearcache(p, ghnode_depth(p), clearto) ;
+#else
+   finishresize() ;
+   for (i=0; i<hashprime; i++) {
+      p = slotnode(hashtab[i].load(std::memory_order_relaxed)) ;
+      if (p && is_ghnode(p) && !marked(p))
+         clearcache(p, ghnode_depth(p), clearto) ;
+   }
+#endif
    for (p=ghnodeblocks; p; p=p->next) {
       poller->poll() ;
       for (pp=p+1, i=1; i<1001; i++, pp++)
@@ -1523,18 +2574,30 @@ ghnode *ghashbase::runpattern() {
    generation += pow2step ;
    return n ;
 }
+/*
+ *   Level-one lines in a macrocell file are 2x2 quadrants of our leaves,
+ *   so while reading we keep them to one side until a level-two line
+ *   puts four of them together.
+ */
+struct ghmcquad {
+   state s[4] ;
+   int valid ;
+} ;
 const char *ghashbase::readmacrocell(char *line) {
    int n=0 ;
    g_uintptr_t i=1, nw=0, ne=0, sw=0, se=0, indlen=0 ;
-   int r, d ;
+   int d ;
    ghnode **ind = 0 ;
+   ghmcquad *quads = 0 ;
    root = 0 ;
    while (getline(line, 10000)) {
       if (i >= indlen) {
          g_uintptr_t nlen = i + indlen + 10 ;
          ind = (ghnode **)realloc(ind, sizeof(ghnode*) * nlen) ;
-         if (ind == 0)
+         quads = (ghmcquad *)realloc(quads, sizeof(ghmcquad) * nlen) ;
+         if (ind == 0 || quads == 0)
            lifefatal("Out of memory (4).") ;
+         memset(quads + indlen, 0, sizeof(ghmcquad) * (nlen - indlen)) ;
          while (indlen < nlen)
             ind[indlen++] = 0 ;
       }
@@ -1630,7 +2693,13 @@ const char *ghashbase::readmacrocell(char *line) {
 	    break ;
          }
       } else {
-         n = sscanf(line, "%d %" PRIuPTR " %" PRIuPTR " %" PRIuPTR " %" PRIuPTR " %d", &d, &nw, &ne, &sw, &se, &r) ;
+         g_uintptr_t vals[6] = { 0 } ;
+         n = getmcnumbers(line, vals, 6) ;
+         d = n > 0 && vals[0] < 0x10000 ? (int)vals[0] : 0 ;
+         nw = vals[1] ;
+         ne = vals[2] ;
+         sw = vals[3] ;
+         se = vals[4] ;
          if (n < 0) // blank line; permit
             continue ;
          if (n == 0) {
@@ -1653,8 +2722,31 @@ const char *ghashbase::readmacrocell(char *line) {
            if (nw >= (g_uintptr_t)maxCellStates || ne >= (g_uintptr_t)maxCellStates ||
                sw >= (g_uintptr_t)maxCellStates || se >= (g_uintptr_t)maxCellStates)
               return "Cell state values too high for this algorithm." ;
-           root = ind[i++] = (ghnode *)find_ghleaf((state)nw, (state)ne,
-                                                   (state)sw, (state)se) ;
+           ghmcquad &q = quads[i++] ;
+           q.s[0] = (state)nw ;
+           q.s[1] = (state)ne ;
+           q.s[2] = (state)sw ;
+           q.s[3] = (state)se ;
+           q.valid = 1 ;
+           root = 0 ;
+           depth = d - 1 ;
+         } else if (d == 2) {
+           g_uintptr_t qi[4] = { nw, ne, sw, se } ;
+           state c[GHLEAFSIZE] ;
+           memset(c, 0, sizeof(c)) ;
+           for (int k=0; k<4; k++) {
+             if (qi[k] == 0)
+               continue ;
+             if (qi[k] >= i || !quads[qi[k]].valid)
+               return "Node out of range in readmacrocell." ;
+             state *p = c + ghquadoff[k] ;
+             p[0] = quads[qi[k]].s[0] ;
+             p[1] = quads[qi[k]].s[1] ;
+             p[4] = quads[qi[k]].s[2] ;
+             p[5] = quads[qi[k]].s[3] ;
+           }
+           clearstack() ;
+           root = ind[i++] = (ghnode *)find_ghleaf(c) ;
            depth = d - 1 ;
          } else {
            ind[0] = zeroghnode(d-2) ; /* allow zeros to work right */
@@ -1668,8 +2760,26 @@ const char *ghashbase::readmacrocell(char *line) {
          }
       }
    }
+   if (root == 0 && depth == 0 && i > 1) {
+      // a lone 2x2 pattern; center it in a leaf
+      state c[GHLEAFSIZE] ;
+      memset(c, 0, sizeof(c)) ;
+      c[5] = quads[i-1].s[0] ;
+      c[6] = quads[i-1].s[1] ;
+      c[9] = quads[i-1].s[2] ;
+      c[10] = quads[i-1].s[3] ;
+      root = (ghnode *)find_ghleaf(c) ;
+      depth = 1 ;
+   }
    if (ind)
       free(ind) ;
+   if (quads)
+      free(quads) ;
+   if (root != 0 && depth == 1) {
+      // the root must be a node, not a leaf
+      root = pushroot(root) ;
+      depth = 2 ;
+   }
    if (root == 0) {
       // allow empty macrocell pattern; note that endofpattern()
       // will be called soon so don't set hashed here
@@ -1688,11 +2798,24 @@ const char *ghashbase::setrule(const char *) {
  *   Write out the native macrocell format.  This is the one we use when
  *   we're not interactive and displaying a progress dialog.
  */
+/*
+ *   Our leaves are written as four level-one (2x2) lines and a level-two
+ *   line; the 2x2 lines are shared between leaves, so we number each
+ *   distinct one just once.
+ */
+static unsigned int ghquadkey(const ghleaf *l, int k) {
+   const state *p = l->c + ghquadoff[k] ;
+   return p[0] | (p[1] << 8) | (p[4] << 16) | ((unsigned int)p[5] << 24) ;
+}
+static void writequad(std::ostream &os, unsigned int key) {
+   os << 1 << ' ' << (key & 255) << ' ' << ((key >> 8) & 255)
+      << ' ' << ((key >> 16) & 255) << ' ' << (key >> 24) << '\n' ;
+}
 g_uintptr_t ghashbase::writecell(std::ostream &os, ghnode *root, int depth) {
    g_uintptr_t thiscell = 0 ;
    if (root == zeroghnode(depth))
       return 0 ;
-   if (depth == 0) {
+   if (depth == 1) {
       if (root->nw != 0)
          return (g_uintptr_t)(root->nw) ;
    } else {
@@ -1701,17 +2824,31 @@ g_uintptr_t ghashbase::writecell(std::ostream &os, ghnode *root, int depth) {
       unhash_ghnode2(root) ;
       mark2(root) ;
    }
-   thiscell = ++cellcounter ;
-   if (depth == 0) {
+   if (depth == 1) {
       ghleaf *n = (ghleaf *)root ;
+      g_uintptr_t q[4] ;
+      for (int k=0; k<4; k++) {
+         unsigned int key = ghquadkey(n, k) ;
+         q[k] = 0 ;
+         if (key == 0)
+            continue ;
+         g_uintptr_t &qc = quadcells[key] ;
+         if (qc == 0) {
+            qc = ++cellcounter ;
+            writequad(os, key) ;
+         }
+         q[k] = qc ;
+      }
+      thiscell = ++cellcounter ;
       root->nw = (ghnode *)thiscell ;
-      os << 1 << ' ' << int(n->nw) << ' ' << int(n->ne)
-              << ' ' << int(n->sw) << ' ' << int(n->se) << '\n' ;
+      os << 2 << ' ' << q[0] << ' ' << q[1]
+              << ' ' << q[2] << ' ' << q[3] << '\n' ;
    } else {
       g_uintptr_t nw = writecell(os, root->nw, depth-1) ;
       g_uintptr_t ne = writecell(os, root->ne, depth-1) ;
       g_uintptr_t sw = writecell(os, root->sw, depth-1) ;
       g_uintptr_t se = writecell(os, root->se, depth-1) ;
+      thiscell = ++cellcounter ;
       root->next = (ghnode *)thiscell ;
       os << depth+1 << ' ' << nw << ' ' << ne
                     << ' ' << sw << ' ' << se << '\n' ;
@@ -1727,7 +2864,7 @@ g_uintptr_t ghashbase::writecell_2p1(ghnode *root, int depth) {
    g_uintptr_t thiscell = 0 ;
    if (root == zeroghnode(depth))
       return 0 ;
-   if (depth == 0) {
+   if (depth == 1) {
       if (root->nw != 0)
          return (g_uintptr_t)(root->nw) ;
    } else {
@@ -1736,7 +2873,15 @@ g_uintptr_t ghashbase::writecell_2p1(ghnode *root, int depth) {
       unhash_ghnode2(root) ;
       mark2(root) ;
    }
-   if (depth == 0) {
+   if (depth == 1) {
+      for (int k=0; k<4; k++) {
+         unsigned int key = ghquadkey((ghleaf *)root, k) ;
+         if (key != 0) {
+            g_uintptr_t &qc = quadcells[key] ;
+            if (qc == 0)
+               qc = ++cellcounter ;
+         }
+      }
       thiscell = ++cellcounter ;
       // note:  we *must* not abort this prescan
       if ((cellcounter & 4095) == 0)
@@ -1760,23 +2905,36 @@ g_uintptr_t ghashbase::writecell_2p1(ghnode *root, int depth) {
  *   numbered, and displaying a progress dialog.
  */
 static char progressmsg[80] ;
+void ghashbase::writeprogress(std::ostream &os, g_uintptr_t thiscell) {
+   if ((thiscell & 4095) == 0) {
+      std::streampos siz = os.tellp() ;
+      sprintf(progressmsg, "File size: %.2f MB", double(siz) / 1048576.0) ;
+      lifeabortprogress(thiscell/(double)writecells, progressmsg) ;
+   }
+}
 g_uintptr_t ghashbase::writecell_2p2(std::ostream &os, ghnode *root, int depth) {
    g_uintptr_t thiscell = 0 ;
    if (root == zeroghnode(depth))
       return 0 ;
-   if (depth == 0) {
-      if (cellcounter + 1 != (g_uintptr_t)(root->nw))
+   if (depth == 1) {
+      if (cellcounter + 1 > (g_uintptr_t)(root->nw) || isaborted())
          return (g_uintptr_t)(root->nw) ;
-      thiscell = ++cellcounter ;
-      if ((cellcounter & 4095) == 0) {
-         std::streampos siz = os.tellp() ;
-         sprintf(progressmsg, "File size: %.2f MB", double(siz) / 1048576.0) ;
-         lifeabortprogress(thiscell/(double)writecells, progressmsg) ;
-      }
       ghleaf *n = (ghleaf *)root ;
-      root->nw = (ghnode *)thiscell ;
-      os << 1 << ' ' << int(n->nw) << ' ' << int(n->ne)
-              << ' ' << int(n->sw) << ' ' << int(n->se) << '\n';
+      g_uintptr_t q[4] ;
+      for (int k=0; k<4; k++) {
+         unsigned int key = ghquadkey(n, k) ;
+         q[k] = (key == 0 ? 0 : quadcells[key]) ;
+         if (q[k] == cellcounter + 1) {
+            writeprogress(os, ++cellcounter) ;
+            writequad(os, key) ;
+         }
+      }
+      if (cellcounter + 1 != (g_uintptr_t)(root->nw)) // this should never happen
+         lifefatal("Internal in writecell_2p2") ;
+      thiscell = ++cellcounter ;
+      writeprogress(os, thiscell) ;
+      os << 2 << ' ' << q[0] << ' ' << q[1]
+              << ' ' << q[2] << ' ' << q[3] << '\n' ;
    } else {
       if (cellcounter + 1 > (g_uintptr_t)(root->next) || isaborted())
          return (g_uintptr_t)(root->next) ;
@@ -1790,11 +2948,7 @@ g_uintptr_t ghashbase::writecell_2p2(std::ostream &os, ghnode *root, int depth)
          return (g_uintptr_t)(root->next) ;
       }
       thiscell = ++cellcounter ;
-      if ((cellcounter & 4095) == 0) {
-         std::streampos siz = os.tellp() ;
-         sprintf(progressmsg, "File size: %.2f MB", double(siz) / 1048576.0) ;
-         lifeabortprogress(thiscell/(double)writecells, progressmsg) ;
-      }
+      writeprogress(os, thiscell) ;
       root->next = (ghnode *)thiscell ;
       os << depth+1 << ' ' << nw << ' ' << ne
                     << ' ' << sw << ' ' << se << '\n' ;
@@ -1844,6 +2998,7 @@ const char *ghashbase::writeNativeFormat(std::ostream &os, char *comments) {
    */
    /* this is the new two-pass way */
    cellcounter = 0 ;
+   quadcells.clear() ;
    vector<int> depths(timeline.framecount) ;
    int framestosave = timeline.framecount ;
    if (timeline.savetimeline == 0)
@@ -1881,6 +3036,7 @@ const char *ghashbase::writeNativeFormat(std::ostream &os, char *comments) {
      }
    }
    afterwritemc(root, depth) ;
+   quadcells.clear() ;
    inGC = 0 ;
    return 0 ;
 }
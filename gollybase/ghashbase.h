@@ -6,6 +6,8 @@
 #include "lifealgo.h"
 #include "liferules.h"
 #include "util.h"
+#include <map>
+#include <unordered_map>
 /*
  *   This class forms the basis of all hashlife-type algorithms except
  *   the highly-optimized hlifealgo (which is most appropriate for
@@ -23,21 +25,46 @@ struct ghnode {
    ghnode *next ;              /* hash link */
    ghnode *nw, *ne, *sw, *se ; /* constant; nw != 0 means nonjleaf */
    ghnode *res ;               /* cache */
+#ifndef GOLLY64BIT
+   ghnode *pad[2] ;            /* so a ghleaf fits in a ghnode */
+#endif
 } ;
 /*
- *   Leaves, like the standard hlifealgo leaves.
+ *   Leaves hold a 4x4 block of cells, like the 8x8 leaves of hlifealgo
+ *   but one byte per cell.  A leaf sits at depth 1 of the tree; there
+ *   is no depth 0.  The cells are stored row by row, north row first
+ *   and west cell first, so a whole leaf can be hashed and compared as
+ *   a couple of machine words.  The res field caches the center 2x2
+ *   one generation on; it is filled in lazily (slowcalc may not be
+ *   usable when the leaf is created) and thrown away with the rest of
+ *   the cache when the rule changes.
  */
+#define GHLEAFSIZE (16)
 struct ghleaf {
    ghnode *next ;              /* hash link */
    ghnode *isghnode ;          /* must always be zero for leaves */
-   state nw, ne, sw, se ;      /* constant */
-   bigint leafpop ;            /* how many set bits */
+   state c[GHLEAFSIZE] ;       /* constant */
+   state res[4] ;              /* cache: nw, ne, sw, se */
+   state resvalid ;            /* nonzero if res is valid */
 } ;
 /*
  *   If it is a struct ghnode, this returns a non-zero value, otherwise it
  *   returns a zero value.
  */
 #define is_ghnode(n) (((ghnode *)(n))->nw)
+/*
+ *   By default the canonical ghnode store is an open-addressed table
+ *   whose slots are claimed with compare-and-swap, so several threads
+ *   can look up and insert nodes at once, and which grows by migrating
+ *   a chunk of the old table on each lookup rather than all at once.
+ *   Each slot holds a node pointer with a few bits of its hash tucked
+ *   into the low (alignment) bits, so most mismatches along a probe
+ *   sequence never touch the node itself.  Define CHAINEDHASH to get
+ *   the older chained table with move-to-front instead.
+ */
+#ifndef CHAINEDHASH
+typedef std::atomic<g_uintptr_t> ghslot ;
+#endif
 /*
  *   For explicit prefetching we retain some state for our lookup
  *   routines.
@@ -46,7 +73,7 @@ struct ghleaf {
 struct ghsetup_t { 
    g_uintptr_t h ;
    struct ghnode *nw, *ne, *sw, *se ;
-   void prefetch(struct ghnode **addr) const { PREFETCH(addr) ; }
+   void prefetch(const void *addr) const { PREFETCH(addr) ; }
 } ;
 #endif
 
@@ -63,7 +90,15 @@ public:
    //  This should be overridden by a deriving class.
    virtual state slowcalc(state nw, state n, state ne, state w, state c,
                           state e, state sw, state s, state se) = 0 ;
+   //  Compute a wd x ht block of cells one generation on.  The input
+   //  is the (wd+2) x (ht+2) block with its northwest corner at c and
+   //  rows stride states apart (north first); the results go to res
+   //  row by row.  The default just calls slowcalc for each cell;
+   //  algorithms with a costly per-call setup can do better.
+   virtual void slowcalcblock(const state *c, int stride, state *res,
+                              int wd, int ht) ;
    virtual int setcell(int x, int y, int newstate) ;
+   virtual int setrowcell(int x, int y, int newstate) ;
    virtual int getcell(int x, int y) ;
    virtual int nextcell(int x, int y, int &v) ;
    virtual void endofpattern() ;
@@ -91,6 +126,14 @@ public:
    virtual void findedges(bigint *t, bigint *l, bigint *b, bigint *r) ;
    virtual const char *readmacrocell(char *line) ;
    virtual const char *writeNativeFormat(std::ostream &os, char *comments) ;
+   virtual unsigned long long getRectHash(int x, int y, int wd, int ht) ;
+   virtual unsigned long long getPatternHash() ;
+   virtual int setcells(const int *cells, int count, bool withstates) ;
+   virtual int putrect(const lifecellrect &r) ;
+   virtual void visitcells(lifecellvisitor &v, int x, int y, int wd, int ht) ;
+   virtual int visitrows(liferowvisitor &v, const bigint &top,
+                         const bigint &left, const bigint &bottom,
+                         const bigint &right) ;
    static void doInitializeAlgoInfo(staticAlgoInfo &) ;
    
 private:
@@ -122,7 +165,21 @@ private:
    g_uintptr_t hashmask ;
 #endif
    static double maxloadfactor ;
+#ifdef CHAINEDHASH
    ghnode **hashtab ;
+#else
+/*
+ *   While the table is growing, oldhashtab holds the previous table;
+ *   lookups consult both until every chunk of it has been migrated.
+ */
+   ghslot *hashtab, *oldhashtab ;
+   g_uintptr_t oldhashprime, migratechunks ;
+#ifndef PRIMEMOD
+   g_uintptr_t oldhashmask ;
+#endif
+   std::atomic<g_uintptr_t> migrateclaimed, migratedone ;
+   std::atomic<int> migrating ;
+#endif
    int halvesdone ;
    int gsp ;
    g_uintptr_t alloced, maxmem ;
@@ -149,26 +206,56 @@ private:
    int cacheinvalid ;
    g_uintptr_t cellcounter ; // used when writing
    g_uintptr_t writecells ; // how many to write
+   std::map<unsigned int, g_uintptr_t> quadcells ; // used when writing
+   std::unordered_map<ghnode *, unsigned long long> hashcache ; // by gc
+   std::unordered_map<ghnode *, unsigned long long> popmemo ; // pruned by gc
+   std::unordered_map<ghnode *, bigint> bigpopmemo ; // the same, deeper ghnodes
+   drawdamage damaged ; // screen tiles of the last draw, keyed by ghnode
    int gccount ; // how many gcs total this pattern
    int gcstep ; // how many gcs this step
+   /*
+    *   Bottom-up loading (see setrowcell).  rowcells holds the cells
+    *   (x, row within the band, state) of the current band of leaf
+    *   rows, and rowpend[d] the last pair of bands of ghnodes of depth
+    *   d not yet joined into a band of depth d+1.
+    */
+   struct rowbandghnodes {
+      rowbandghnodes() : pair(0) {}
+      long long pair ;
+      std::vector<std::pair<long long, ghnode *> > half[2] ;
+   } ;
+   int rowsmode ;
+   long long rowband ;
+   std::vector<int> rowcells ;
+   std::vector<rowbandghnodes> rowpend ;
    hperf running_hperf, step_hperf, inc_hperf ;
    int softinterrupt ;
    static char statusline[] ;
 //
    void resize() ;
+#ifndef CHAINEDHASH
+   ghnode *lookup_ghnode(g_uintptr_t h, ghnode *nw, ghnode *ne, ghnode *sw,
+                         ghnode *se) ;
+   void migratesome() ;
+   void finishresize() ;
+#endif
    ghnode *find_ghnode(ghnode *nw, ghnode *ne, ghnode *sw, ghnode *se) ;
 #ifdef USEPREFETCH
    ghnode *find_ghnode(ghsetup_t &su) ;
    void setupprefetch(ghsetup_t &su, ghnode *nw, ghnode *ne, ghnode *sw, ghnode *se) ;
 #endif
-   void unhash_ghnode(ghnode *n) ;
    void unhash_ghnode2(ghnode *n) ;
    void rehash_ghnode(ghnode *n) ;
-   ghleaf *find_ghleaf(state nw, state ne, state sw, state se) ;
+   ghleaf *find_ghleaf(const state *c, g_uintptr_t h) ;
+   ghleaf *find_ghleaf(const state *c) ;
+   void find_ghleafres(ghleaf **l, state (*c)[GHLEAFSIZE], int n) ;
+   void ghleafres(ghleaf *n) ;
    ghnode *getres(ghnode *n, int depth) ;
    ghnode *dorecurs(ghnode *n, ghnode *ne, ghnode *t, ghnode *e, int depth) ;
    ghnode *dorecurs_half(ghnode *n, ghnode *ne, ghnode *t, ghnode *e, int depth) ;
+   void ghleafstep(state *h, ghleaf *nw, ghleaf *ne, ghleaf *sw, ghleaf *se) ;
    ghleaf *dorecurs_ghleaf(ghleaf *n, ghleaf *ne, ghleaf *t, ghleaf *e) ;
+   ghleaf *dorecurs_ghleaf_half(ghleaf *n, ghleaf *ne, ghleaf *t, ghleaf *e) ;
    ghnode *newghnode() ;
    ghleaf *newghleaf() ;
    ghnode *newclearedghnode() ;
@@ -180,10 +267,33 @@ private:
    ghnode *gsetbit(ghnode *n, int x, int y, int newstate, int depth) ;
    int getbit(ghnode *n, int x, int y, int depth) ;
    int nextbit(ghnode *n, int x, int y, int depth, int &v) ;
+   unsigned long long ghnodehash(ghnode *n, int depth) ;
+   unsigned long long recthash(ghnode *n, int depth, long long x, long long y,
+                               const long long *r) ;
+   void growroot(int left, int top, int right, int bottom) ;
+   ghnode *middleghnode(ghnode &tghnode, int &mdepth) ;
+   ghnode *setmiddle(ghnode *n, int depth, ghnode *m) ;
+   ghnode *setcellsghnode(ghnode *n, int depth, long long x, long long y,
+                          int *cells, int *scratch, int count) ;
+   ghnode *putrectghnode(ghnode *n, int depth, long long x, long long y,
+                         const lifecellrect &r) ;
+   void visitghnode(ghnode *n, int depth, long long x, long long y,
+                    const long long *r, lifecellvisitor &v) ;
+   void flushrowband() ;
+   void pushrowband(int depth, long long band,
+                    std::vector<std::pair<long long, ghnode *> > &nodes) ;
+   void joinrowbands(int depth) ;
+   ghnode *putghnode(ghnode *n, int depth, long long x, long long y,
+                     ghnode *sub, int subdepth, long long sx, long long sy) ;
+   void endrows() ;
+   bool rowstrip(std::vector<std::pair<long long, ghnode *> > &strip,
+                 int depth, long long y, long long wd, long long ht,
+                 liferowvisitor &v) ;
    ghnode *hashpattern(ghnode *root, int depth) ;
    ghnode *popzeros(ghnode *n) ;
-   const bigint &calcpop(ghnode *root, int depth) ;
-   void aftercalcpop2(ghnode *root, int depth) ;
+   unsigned long long calcpop(ghnode *root, int depth) ;
+   const bigint &calcbigpop(ghnode *root, int depth) ;
+   void prunepops() ;
    void afterwritemc(ghnode *root, int depth) ;
    void calcPopulation() ;
    ghnode *save(ghnode *n) ;
@@ -199,12 +309,14 @@ private:
    int log2(unsigned int n) ;
    ghnode *runpattern() ;
    void renderbm(int x, int y) ;
+   int needbm(int x, int y, ghnode *n) ;
    void fill_ll(int d) ;
    void drawghnode(ghnode *n, int llx, int lly, int depth, ghnode *z) ;
    void ensure_hashed() ;
    g_uintptr_t writecell(std::ostream &os, ghnode *root, int depth) ;
    g_uintptr_t writecell_2p1(ghnode *root, int depth) ;
    g_uintptr_t writecell_2p2(std::ostream &os, ghnode *root, int depth) ;
+   void writeprogress(std::ostream &os, g_uintptr_t thiscell) ;
    void drawpixel(int x, int y);
    void draw4x4_1(state sw, state se, state nw, state ne, int llx, int lly) ;
    void draw4x4_1(ghnode *n, ghnode *z, int llx, int lly) ;
@@ -149,6 +149,18 @@ void ghashbase::renderbm(int x, int y) {
    killpixels();
 }
 
+/*
+ *   Tell the damage tracker about the pixmap renderbm is about to draw
+ *   at x,y showing ghnode n (0 if it isn't a single ghnode), and return
+ *   whether it needs drawing at all.  Ghnodes are aligned, so for a
+ *   given view an unchanged screen tile still shows the same ghnode.
+ */
+int ghashbase::needbm(int x, int y, ghnode *n) {
+   int rw = pmsize * pmag ;
+   return damaged.redraw(x * pmag, uviewh - y * pmag - rw, rw, rw,
+                         (G_INT64)(g_uintptr_t)n) ;
+}
+
 /*
  *   Here, llx and lly are coordinates in screen pixels describing
  *   where the lower left pixel of the screen is.  Draw one ghnode.
@@ -161,11 +173,13 @@ void ghashbase::drawghnode(ghnode *n, int llx, int lly, int depth, ghnode *z) {
       return ;
    if (n == z) {
       // don't do anything
-   } else if (depth > 0 && sw > 2) {
+   } else if (depth > 1 && sw > 2) {
       z = z->nw ;
       sw >>= 1 ;
       depth-- ;
       if (sw == (pmsize >> 1)) {
+         if (!needbm(-llx, -lly, n))
+            return ;
          drawghnode(n->sw, 0, 0, depth, z) ;
          drawghnode(n->se, -(pmsize/2), 0, depth, z) ;
          drawghnode(n->nw, 0, -(pmsize/2), depth, z) ;
@@ -177,15 +191,27 @@ void ghashbase::drawghnode(ghnode *n, int llx, int lly, int depth, ghnode *z) {
          drawghnode(n->nw, llx, lly-sw, depth, z) ;
          drawghnode(n->ne, llx-sw, lly-sw, depth, z) ;
       }
-   } else if (depth > 0 && sw == 2) {
+   } else if (depth > 1 && sw == 2) {
       draw4x4_1(n, z->nw, llx, lly) ;
    } else if (sw == 1) {
       drawpixel(-llx, -lly) ;
    } else {
-      struct ghleaf *l = (struct ghleaf *)n ;
-      sw >>= 1 ;
-      if (sw == 1) {
-         draw4x4_1(l->sw, l->se, l->nw, l->ne, llx, lly) ;
+      // a 4x4 leaf; row 0 is the top row
+      const state *c = ((struct ghleaf *)n)->c ;
+      if (sw == 4) {
+         draw4x4_1(c[12], c[13], c[8], c[9], llx, lly) ;
+         draw4x4_1(c[14], c[15], c[10], c[11], llx-2, lly) ;
+         draw4x4_1(c[4], c[5], c[0], c[1], llx, lly-2) ;
+         draw4x4_1(c[6], c[7], c[2], c[3], llx-2, lly-2) ;
+      } else if (sw == 2) {
+         if (c[8] | c[9] | c[12] | c[13])
+            drawpixel(-llx, -lly) ;
+         if (c[10] | c[11] | c[14] | c[15])
+            drawpixel(1-llx, -lly) ;
+         if (c[0] | c[1] | c[4] | c[5])
+            drawpixel(-llx, 1-lly) ;
+         if (c[2] | c[3] | c[6] | c[7])
+            drawpixel(1-llx, 1-lly) ;
       } else {
          lifefatal("Can't happen") ;
       }
@@ -283,6 +309,7 @@ void ghashbase::draw(viewport &viewarg, liferender &rendererarg) {
    // AKT: must call killpixels after setting pmag
    killpixels();
 
+   damaged.begin(*renderer, *view) ;
    int d = depth ;
    fill_ll(d) ;
    int maxd = vieww ;
@@ -301,7 +328,7 @@ void ghashbase::draw(viewport &viewarg, liferender &rendererarg) {
       }
    }
    /*  Find the lowest four we need to examine */
-   while (d > 0 && d - mag >= 0 &&
+   while (d > 1 && d - mag >= 0 &&
           (d - mag > 28 || (1 << (d - mag)) > 2 * maxd)) {
       llx = (llx << 1) + llxb[d] ;
       lly = (lly << 1) + llyb[d] ;
@@ -343,6 +370,10 @@ void ghashbase::draw(viewport &viewarg, liferender &rendererarg) {
       llx = (llx << 1) + llxb[i] ;
       lly = (lly << 1) + llyb[i] ;
    }
+   /*
+    *   Each way of drawing below puts its bitmaps in different places,
+    *   so it sets a different layout for the damage tracker.
+    */
    /* clear the border *around* the universe if necessary */
    if (d + 1 <= mag) {
       ghnode *z = zeroghnode(d) ;
@@ -350,6 +381,8 @@ void ghashbase::draw(viewport &viewarg, liferender &rendererarg) {
           (sw == z && se == z && nw == z && ne == z)) {
          // no live cells
       } else {
+         damaged.layout(1 + 4 * (llx + 16777216 * (G_INT64)lly)) ;
+         needbm(-llx, -lly, 0) ;
          drawpixel(0, 0) ;
          renderbm(-llx, -lly) ;
       }
@@ -357,13 +390,17 @@ void ghashbase::draw(viewport &viewarg, liferender &rendererarg) {
       z = zeroghnode(d) ;
       maxd = 1 << (d - mag + 2) ;
       if (maxd <= pmsize) {
+         damaged.layout(2 + 4 * (llx + 16777216 * (G_INT64)lly)) ;
          maxd >>= 1 ;
          drawghnode(sw, 0, 0, d, z) ;
          drawghnode(se, -maxd, 0, d, z) ;
          drawghnode(nw, 0, -maxd, d, z) ;
          drawghnode(ne, -maxd, -maxd, d, z) ;
+         needbm(-llx, -lly, 0) ;
          renderbm(-llx, -lly) ;
       } else {
+         // tiles are aligned to the root, so they stay put until it grows
+         damaged.layout(4 * (G_INT64)depth) ;
          maxd >>= 1 ;
          drawghnode(sw, llx, lly, d, z) ;
          drawghnode(se, llx-maxd, lly, d, z) ;
@@ -372,35 +409,30 @@ void ghashbase::draw(viewport &viewarg, liferender &rendererarg) {
       }
    }
 bail:
+   damaged.end() ;
    renderer = 0 ;
    view = 0 ;
 }
 static
 int getbitsfromleaves(const vector<ghnode *> &v) {
-  unsigned short nw=0, ne=0, sw=0, se=0 ;
-  int i;
+  state rows[4] = { 0, 0, 0, 0 }, cols[4] = { 0, 0, 0, 0 } ;
+  int i, j ;
   for (i=0; i<(int)v.size(); i++) {
-    ghleaf *p = (ghleaf *)v[i] ;
-    nw |= p->nw ;
-    ne |= p->ne ;
-    sw |= p->sw ;
-    se |= p->se ;
+    const state *c = ((ghleaf *)v[i])->c ;
+    for (j=0; j<16; j++) {
+      rows[j >> 2] |= c[j] ;
+      cols[j & 3] |= c[j] ;
+    }
   }
   int r = 0 ;
-  // horizontal bits are least significant ones
-  unsigned short w = nw | sw ;
-  unsigned short e = ne | se ;
-  // vertical bits are next 8
-  unsigned short n = nw | ne ;
-  unsigned short s = sw | se ;
-  if (w)
-    r |= 512 ;
-  if (e)
-    r |= 256 ;
-  if (n)
-    r |= 2 ;
-  if (s)
-    r |= 1 ;
+  // vertical bits are least significant ones, north row highest;
+  // horizontal bits are next 8, west column highest
+  for (j=0; j<4; j++) {
+    if (rows[j])
+      r |= 8 >> j ;
+    if (cols[j])
+      r |= 2048 >> j ;
+  }
   return r ;
 }
 
@@ -444,13 +476,13 @@ void ghashbase::findedges(bigint *ptop, bigint *pleft, bigint *pbottom, bigint *
    int topbm = 0, bottombm = 0, rightbm = 0, leftbm = 0 ;
    while (currdepth >= -2) {
       currdepth-- ;
-      if (currdepth == -1) { // we have ghleaf ghnodes; turn them into bitmasks
+      if (currdepth == 0) { // we have ghleaf ghnodes; turn them into bitmasks
          topbm = getbitsfromleaves(top) & 0xff ;
          bottombm = getbitsfromleaves(bottom) & 0xff ;
          leftbm = getbitsfromleaves(left) >> 8 ;
          rightbm = getbitsfromleaves(right) >> 8 ;
       }
-      if (currdepth == -1) {
+      if (currdepth == 0 || currdepth == -1) {
           int sz = 1 << (currdepth + 2) ;
           int maskhi = (1 << sz) - (1 << (sz >> 1)) ;
           int masklo = (1 << (sz >> 1)) - 1 ;
@@ -476,7 +508,7 @@ void ghashbase::findedges(bigint *ptop, bigint *pleft, bigint *pbottom, bigint *
           } else {
             leftbm >>= (sz >> 1) ;
           }
-      } else if (currdepth >= 0) {
+      } else if (currdepth >= 1) {
          ghnode *z = 0 ;
          if (hashed)
             z = zeroghnode(currdepth) ;
@@ -627,13 +659,13 @@ void ghashbase::fit(viewport &view, int force) {
    int topbm = 0, bottombm = 0, rightbm = 0, leftbm = 0 ;
    while (currdepth >= 0) {
       currdepth-- ;
-      if (currdepth == -1) { // we have ghleaf ghnodes; turn them into bitmasks
+      if (currdepth == 0) { // we have ghleaf ghnodes; turn them into bitmasks
          topbm = getbitsfromleaves(top) & 0xff ;
          bottombm = getbitsfromleaves(bottom) & 0xff ;
          leftbm = getbitsfromleaves(left) >> 8 ;
          rightbm = getbitsfromleaves(right) >> 8 ;
       }
-      if (currdepth == -1) {
+      if (currdepth == 0 || currdepth == -1) {
          int sz = 1 << (currdepth + 2) ;
          int maskhi = (1 << sz) - (1 << (sz >> 1)) ;
          int masklo = (1 << (sz >> 1)) - 1 ;
@@ -665,7 +697,7 @@ void ghashbase::fit(viewport &view, int force) {
          }
          xsize <<= 1 ;
          ysize <<= 1 ;
-      } else if (currdepth >= 0) {
+      } else if (currdepth >= 1) {
          ghnode *z = 0 ;
          if (hashed)
             z = zeroghnode(currdepth) ;
@@ -18,6 +18,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <iostream>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#ifdef COMPACTNODES
+#include <sys/mman.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+#endif
 using namespace std ;
 /*
  *   Power of two hash sizes work fine.
@@ -43,11 +56,50 @@ static g_uintptr_t nexthashsize(g_uintptr_t i) {
    return i ;
 }
 #endif
+/*
+ *   Shared state for multithreaded stepping.  The hash chains are
+ *   guarded by an array of spinlocks indexed by bucket; the node
+ *   allocator, the gc handshake and the per-worker gc stacks by a
+ *   single mutex.
+ */
+const int HASHLOCKS = 4096 ;
+struct hlifemt {
+   hlifemt(int n) : threads(n) {
+      workers = (hlifeworker *)calloc(n, sizeof(hlifeworker)) ;
+      if (workers == 0)
+         lifefatal("Out of memory (5).") ;
+      for (int i=0; i<n; i++)
+         workers[i].index = i ;
+      for (int i=0; i<HASHLOCKS; i++)
+         hashlocks[i].clear() ;
+      active = parked = running = 0 ;
+      gcwanted = stopping = 0 ;
+      inserted = 0 ;
+   }
+   ~hlifemt() {
+      for (int i=0; i<threads.size(); i++)
+         free(workers[i].stack) ;
+      free(workers) ;
+   }
+   lifethreads threads ;
+   hlifeworker *workers ;
+   std::mutex lock ;
+   std::condition_variable cv ;
+   int active, parked, running ;
+   std::atomic<int> gcwanted, stopping ;
+   std::atomic<g_uintptr_t> inserted ;
+   std::atomic_flag hashlocks[HASHLOCKS] ;
+} ;
 /*
  *   Note that all the places we represent 4-squares by short, we use
  *   unsigned shorts; this is so we can directly index into these arrays.
  */
 static unsigned char shortpop[65536] ;
+/*
+ *   The population of a leaf is at most 64, so we keep those bigints in
+ *   a table rather than in the leaves.
+ */
+static bigint leafpops[65] ;
 /*
  *   The cached result of an 8-square is a new 4-square representing
  *   two generations into the future.  This subroutine calculates that
@@ -99,18 +151,56 @@ void hlifealgo::leafres(leaf *n) {
    (ruletable[(t01 << 10) | (t02 << 8) | (t11 << 2) | t12] << 8) |
    (ruletable[(t10 << 10) | (t11 << 8) | (t20 << 2) | t21] << 2) |
     ruletable[(t11 << 10) | (t12 << 8) | (t21 << 2) | t22] ;
-   n->leafpop = bigint((short)(shortpop[n->nw] + shortpop[n->ne] +
-                               shortpop[n->sw] + shortpop[n->se])) ;
+   n->leafpop = (unsigned short)(shortpop[n->nw] + shortpop[n->ne] +
+                                 shortpop[n->sw] + shortpop[n->se]) ;
 }
 /*
  *   We do now support garbage collection, but there are some routines we
  *   call frequently to help us.
  */
+/*
+ *   The raw value of a link; we hash on these.  While a node is
+ *   unhashed we can also keep a number in its next field (or, for
+ *   leaves, in the field that is always zero).
+ */
+#ifdef COMPACTNODES
+#define linkval(f) ((g_uintptr_t)(f).i)
+#define setlinkval(f,v) ((f).i = (unsigned int)(v))
+#else
+#define linkval(f) ((g_uintptr_t)(f))
+#define setlinkval(f,v) ((f) = (node *)(v))
+#endif
+/*
+ *   The res field also carries a `recently used' bit for the gc's
+ *   second-chance treatment of the cache:  it is set when a result is
+ *   stored or looked up, each gc clears it, and an entry that hasn't
+ *   been used again by the next gc is dropped (see gc_mark).  So
+ *   anything that wants the node res points to goes through resof().
+ *
+ *   The recursion keeps results it got from getres in locals and
+ *   relies on the res field to keep them alive, so only the first gc
+ *   of a runpattern may drop entries:  anything a local holds then was
+ *   looked up or stored since the previous gc, so its bit is set.
+ *   Later gcs in the same runpattern just clear bits.
+ */
+#ifdef COMPACTNODES
+#define RESUSED (0x40000000)
+#define resof(n) (noderef::at(~RESUSED & (n)->res.i))
+#define resused(n) (RESUSED & (n)->res.i)
+#define useres(n) ((n)->res.i |= RESUSED)
+#define unuseres(n) ((n)->res.i &= ~RESUSED)
+#else
+#define RESUSED (2)
+#define resof(n) ((node *)(~(g_uintptr_t)RESUSED & (g_uintptr_t)(n)->res))
+#define resused(n) (RESUSED & (g_uintptr_t)(n)->res)
+#define useres(n) ((n)->res = (node *)(RESUSED | (g_uintptr_t)(n)->res))
+#define unuseres(n) ((n)->res = (node *)(~(g_uintptr_t)RESUSED & (g_uintptr_t)(n)->res))
+#endif
 #ifdef PRIMEMOD
-#define node_hash(a,b,c,d) (65537*(g_uintptr_t)(d)+257*(g_uintptr_t)(c)+17*(g_uintptr_t)(b)+5*(g_uintptr_t)(a))
+#define node_hash(a,b,c,d) (65537*linkval(d)+257*linkval(c)+17*linkval(b)+5*linkval(a))
 #else
-g_uintptr_t node_hash(void *a, void *b, void *c, void *d) {
-   g_uintptr_t r = (65537*(g_uintptr_t)(d)+257*(g_uintptr_t)(c)+17*(g_uintptr_t)(b)+5*(g_uintptr_t)(a)) ;
+g_uintptr_t node_hash(noderef a, noderef b, noderef c, noderef d) {
+   g_uintptr_t r = (65537*linkval(d)+257*linkval(c)+17*linkval(b)+5*linkval(a)) ;
    r += (r >> 11) ;
    return r ;
 }
@@ -195,7 +285,7 @@ void hlifealgo::resize() {
  *   find it in the hash table, we return it; otherwise, we build a
  *   new node and store it in the hash table, and return that.
  */
-node *hlifealgo::find_node(node *nw, node *ne, node *sw, node *se) {
+node *hlifealgo::find_node(noderef nw, noderef ne, noderef sw, noderef se) {
    node *p ;
    g_uintptr_t h = node_hash(nw,ne,sw,se) ;
    node *pred = 0 ;
@@ -267,8 +357,11 @@ leaf *hlifealgo::find_leaf(unsigned short nw, unsigned short ne,
  *   stack pointer and garbage collection stuff.
  */
 node *hlifealgo::getres(node *n, int depth) {
-   if (n->res)
-     return n->res ;
+   if (n->res) {
+     if (!resused(n))
+       useres(n) ;
+     return resof(n) ;
+   }
    node *res = 0 ;
    /**
     *   This routine be the only place we assign to res.  We use
@@ -313,11 +406,13 @@ node *hlifealgo::getres(node *n, int depth) {
      if (ngens < depth && halvesdone < 1000)
        halvesdone++ ;
      n->res = res ;
+     useres(n) ;
    }
    return res ;
 }
 #ifdef USEPREFETCH
-void hlifealgo::setupprefetch(setup_t &su, node *nw, node *ne, node *sw, node *se) {
+void hlifealgo::setupprefetch(setup_t &su, noderef nw, noderef ne,
+                              noderef sw, noderef se) {
    su.h = node_hash(nw,ne,sw,se) ;
    su.nw = nw ;
    su.ne = ne ;
@@ -524,26 +619,80 @@ leaf *hlifealgo::dorecurs_leaf_quarter(leaf *n, leaf *ne,
                     combine4(t10, t11, t20, t21),
                     combine4(t11, t12, t21, t22)) ;
 }
+#ifdef COMPACTNODES
+/*
+ *   The shared node arena.  We reserve address space for the largest
+ *   arena a noderef can index the first time anyone asks for a block
+ *   (backing off if the system won't give us that much), and commit it
+ *   a block at a time as it gets touched.  Blocks handed back by a
+ *   universe that goes away are kept on a free list for the next one.
+ */
+static_assert(sizeof(node) == NODESLOT && sizeof(leaf) <= NODESLOT,
+              "nodes and leaves must fit an arena slot") ;
+char *hlifearena ;
+static g_uintptr_t arenasize, arenaused ;
+static node *arenafree ;
+static std::mutex arenalock ;
+static node *arenablock() {
+   const g_uintptr_t blockbytes = 1001 * sizeof(node) ;
+   std::lock_guard<std::mutex> lk(arenalock) ;
+   if (hlifearena == 0) {
+      for (arenasize = MAXARENASLOTS * sizeof(node) ;
+           arenasize >= ((g_uintptr_t)64 << 20) ; arenasize >>= 1) {
+         void *p = mmap(0, arenasize, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0) ;
+         if (p != MAP_FAILED) {
+            hlifearena = (char *)p ;
+            break ;
+         }
+      }
+      if (hlifearena == 0)
+         return 0 ;
+      arenaused = sizeof(node) ; // slot zero is the null link
+   }
+   node *r = arenafree ;
+   if (r) {
+      arenafree = r->next ;
+      return (node *)memset(r, 0, blockbytes) ;
+   }
+   if (arenaused + blockbytes > arenasize)
+      return 0 ;
+   r = (node *)(hlifearena + arenaused) ;
+   arenaused += blockbytes ;
+   return r ;
+}
+static void arenarelease(node *r) {
+   std::lock_guard<std::mutex> lk(arenalock) ;
+   r->next = arenafree ;
+   arenafree = r ;
+}
+#endif
 /*
  *   We keep free nodes in a linked list for allocation, and we allocate
  *   them 1000 at a time.
  */
+void hlifealgo::newblock() {
+   int i ;
+#ifdef COMPACTNODES
+   freenodes = arenablock() ;
+#else
+   freenodes = (node *)calloc(1001, sizeof(node)) ;
+#endif
+   if (freenodes == 0)
+      lifefatal("Out of memory; try reducing the hash memory limit.") ;
+   alloced += 1001 * sizeof(node) ;
+   freenodes->next = nodeblocks ;
+   nodeblocks = freenodes++ ;
+   for (i=0; i<999; i++) {
+      freenodes[1].next = freenodes ;
+      freenodes++ ;
+   }
+   totalthings += 1000 ;
+}
 node *hlifealgo::newnode() {
    node *r ;
-   if (freenodes == 0) {
-      int i ;
-      freenodes = (node *)calloc(1001, sizeof(node)) ;
-      if (freenodes == 0)
-         lifefatal("Out of memory; try reducing the hash memory limit.") ;
-      alloced += 1001 * sizeof(node) ;
-      freenodes->next = nodeblocks ;
-      nodeblocks = freenodes++ ;
-      for (i=0; i<999; i++) {
-         freenodes[1].next = freenodes ;
-         freenodes++ ;
-      }
-      totalthings += 1000 ;
-   }
+   if (freenodes == 0)
+      newblock() ;
    if (freenodes->next == 0 && alloced + 1000 * sizeof(node) > maxmem &&
        okaytogc) {
       do_gc(0) ;
@@ -556,9 +705,7 @@ node *hlifealgo::newnode() {
  *   Leaves are the same.
  */
 leaf *hlifealgo::newleaf() {
-   leaf *r = (leaf *)newnode() ;
-   new(&(r->leafpop))bigint ;
-   return r ;
+   return (leaf *)newnode() ;
 }
 /*
  *   Sometimes we want the new node or leaf to be automatically cleared
@@ -568,9 +715,7 @@ node *hlifealgo::newclearednode() {
    return (node *)memset(newnode(), 0, sizeof(node)) ;
 }
 leaf *hlifealgo::newclearedleaf() {
-   leaf *r = (leaf *)newclearednode() ;
-   new(&(r->leafpop))bigint ;
-   return r ;
+   return (leaf *)newclearednode() ;
 }
 hlifealgo::hlifealgo() {
    int i ;
@@ -580,9 +725,12 @@ hlifealgo::hlifealgo() {
  *   and we can turn off a bit by anding an integer with the next
  *   lower integer.
  */
-   if (shortpop[1] == 0)
+   if (shortpop[1] == 0) {
       for (i=1; i<65536; i++)
          shortpop[i] = shortpop[i & (i - 1)] + 1 ;
+      for (i=1; i<65; i++)
+         leafpops[i] = i ;
+   }
    hashprime = nexthashsize(1000) ;
 #ifndef PRIMEMOD
    hashmask = hashprime - 1 ;
@@ -624,22 +772,31 @@ hlifealgo::hlifealgo() {
    needPop = 0 ;
    inGC = 0 ;
    cacheinvalid = 0 ;
+   agecache = 1 ;
    gccount = 0 ;
    gcstep = 0 ;
    running_hperf.clear() ;
    inc_hperf = running_hperf ;
    step_hperf = running_hperf ;
    softinterrupt = 0 ;
+   mt = 0 ;
+   rowsmode = 0 ;
+   rowband = 0 ;
 }
 /**
  *   Destructor frees memory.
  */
 hlifealgo::~hlifealgo() {
+   deletethreads() ;
    free(hashtab) ;
    while (nodeblocks) {
       node *r = nodeblocks ;
       nodeblocks = nodeblocks->next ;
+#ifdef COMPACTNODES
+      arenarelease(r) ;
+#else
       free(r) ;
+#endif
    }
    if (zeronodea)
       free(zeronodea) ;
@@ -695,6 +852,7 @@ void hlifealgo::step() {
             pow2step += pow2step ;
       }
       gcstep = 0 ;
+      double gcstepstart = running_hperf.gcSeconds ;
       running_hperf.genval = generation.todouble() ;
       for (int i=0; i<nonpow2; i++) {
          node *newroot = runpattern() ;
@@ -704,6 +862,11 @@ void hlifealgo::step() {
          root = newroot ;
          depth = node_depth(root) ;
       }
+      if (verbose && gcstep > 0) {
+         sprintf(statusline, "GC: %d collections, %g seconds this step",
+                 gcstep, running_hperf.gcSeconds - gcstepstart) ;
+         lifestatus(statusline) ;
+      }
       running_hperf.reportStep(step_hperf, inc_hperf, generation.todouble(), verbose) ;
       if (poller->isInterrupted() || !softinterrupt)
          break ;
@@ -725,6 +888,10 @@ void hlifealgo::setMaxMemory(int newmemlimit) {
 #ifndef GOLLY64BIT
    else if (newmemlimit > 4000)
      newmemlimit = 4000 ;
+#endif
+#ifdef COMPACTNODES
+   else if ((g_uintptr_t)newmemlimit > ((MAXARENASLOTS * sizeof(node)) >> 20))
+     newmemlimit = (int)((MAXARENASLOTS * sizeof(node)) >> 20) ;
 #endif
    g_uintptr_t newlimit = ((g_uintptr_t)newmemlimit) << 20 ;
    if (alloced > newlimit) {
@@ -889,7 +1056,7 @@ node *hlifealgo::gsetbit(node *n, int x, int y, int newstate, int depth) {
          wh = 1 << (depth - 1) ;
       }
       depth-- ;
-      node **nptr ;
+      noderef *nptr ;
       if (depth+1 == this->depth || depth < 31) {
          if (x < 0) {
             if (y < 0)
@@ -924,10 +1091,10 @@ node *hlifealgo::gsetbit(node *n, int x, int y, int newstate, int depth) {
       node *s = gsetbit(*nptr, (x & (w - 1)) - wh,
                                (y & (w - 1)) - wh, newstate, depth) ;
       if (hashed) {
-         node *nw = (nptr == &(n->nw) ? s : n->nw) ;
-         node *sw = (nptr == &(n->sw) ? s : n->sw) ;
-         node *ne = (nptr == &(n->ne) ? s : n->ne) ;
-         node *se = (nptr == &(n->se) ? s : n->se) ;
+         node *nw = (nptr == &(n->nw) ? s : (node *)n->nw) ;
+         node *sw = (nptr == &(n->sw) ? s : (node *)n->sw) ;
+         node *ne = (nptr == &(n->ne) ? s : (node *)n->ne) ;
+         node *se = (nptr == &(n->se) ? s : (node *)n->se) ;
          n = save(find_node(nw, ne, sw, se)) ;
       } else {
          *nptr = s ;
@@ -1060,6 +1227,8 @@ int hlifealgo::nextbit(node *n, int x, int y, int depth) {
 int hlifealgo::setcell(int x, int y, int newstate) {
    if (newstate & ~1)
       return -1 ;
+   if (rowsmode)
+      endrows() ;
    if (hashed) {
       clearstack() ;
       save(root) ;
@@ -1092,6 +1261,168 @@ int hlifealgo::setcell(int x, int y, int newstate) {
    }
    return 0 ;
 }
+/*
+ *   Loading a pattern a row at a time.  Rather than walking down from
+ *   the root for every cell, we collect the cells of each band of 8
+ *   rows, turn them into canonical leaves, and join each pair of
+ *   vertically adjacent bands of nodes into a band of nodes one level
+ *   up, so every node is built once, from the bottom.  Rows are
+ *   counted from y = 1 so that the bands line up with the tree, whose
+ *   top edge is at 1 - 2^depth.  Nothing here is reachable from the
+ *   root until endrows, so gc stays off until then.
+ */
+int hlifealgo::setrowcell(int x, int y, int newstate) {
+   if (newstate & ~1)
+      return -1 ;
+   long long band = ((long long)y - 1) >> 3 ;
+   if (!rowsmode) {
+      if (!isEmpty())
+         return setcell(x, y, newstate) ;
+      rowsmode = 1 ;
+      rowband = band ;
+   } else if (band != rowband) {
+      if (band < rowband) {
+         /* out of order; finish up and go on a cell at a time */
+         endrows() ;
+         return setcell(x, y, newstate) ;
+      }
+      flushrowband() ;
+      rowband = band ;
+   }
+   rowcells.push_back(x) ;
+   rowcells.push_back((int)(((long long)y - 1) & 7)) ;
+   rowcells.push_back(newstate) ;
+   return 0 ;
+}
+/*
+ *   Sort key for the cells of a band: the column of leaves they lie in.
+ */
+struct rowcellorder {
+   rowcellorder(const int *c) : cells(c) {}
+   bool operator()(int a, int b) const {
+      return (cells[3*a] >> 3) < (cells[3*b] >> 3) ;
+   }
+   const int *cells ;
+} ;
+void hlifealgo::flushrowband() {
+   int n = (int)(rowcells.size() / 3) ;
+   if (n == 0)
+      return ;
+   const int *cells = &rowcells[0] ;
+   std::vector<int> order(n) ;
+   for (int i=0; i<n; i++)
+      order[i] = i ;
+   std::stable_sort(order.begin(), order.end(), rowcellorder(cells)) ;
+   std::vector<std::pair<long long, node *> > leaves ;
+   node *z = zeronode(2) ;
+   for (int i=0; i<n; ) {
+      int col = cells[3*order[i]] >> 3 ;
+      unsigned short q[4] = { 0, 0, 0, 0 } ;
+      for (; i<n && (cells[3*order[i]] >> 3) == col; i++) {
+         const int *c = cells + 3 * order[i] ;
+         int cx = c[0] & 7 ;
+         int k = (cx >> 2) + 2 * (c[1] >> 2) ;
+         unsigned short b = (unsigned short)(1 << (3 - (cx & 3) +
+                                                   4 * (3 - (c[1] & 3)))) ;
+         if (c[2])
+            q[k] |= b ;
+         else
+            q[k] &= ~b ;
+      }
+      node *l = (node *)find_leaf(q[0], q[1], q[2], q[3]) ;
+      if (l != z)
+         leaves.push_back(std::make_pair((long long)col, l)) ;
+   }
+   rowcells.clear() ;
+   pushrowband(2, rowband, leaves) ;
+}
+/*
+ *   Add a band of nodes (sorted by column) at the given depth, joining
+ *   the pending pair at that depth first if this band isn't part of it.
+ */
+void hlifealgo::pushrowband(int depth, long long band,
+                            std::vector<std::pair<long long, node *> > &nodes) {
+   if ((int)rowpend.size() <= depth)
+      rowpend.resize(depth + 1) ;
+   if (rowpend[depth].pair != (band >> 1))
+      joinrowbands(depth) ;
+   rowpend[depth].pair = band >> 1 ;
+   rowpend[depth].half[band & 1].swap(nodes) ;
+}
+void hlifealgo::joinrowbands(int depth) {
+   std::vector<std::pair<long long, node *> > t, b, up ;
+   t.swap(rowpend[depth].half[0]) ;
+   b.swap(rowpend[depth].half[1]) ;
+   if (t.empty() && b.empty())
+      return ;
+   node *z = zeronode(depth) ;
+   size_t i = 0, j = 0 ;
+   while (i < t.size() || j < b.size()) {
+      long long col ;
+      if (j == b.size() || (i < t.size() && t[i].first < b[j].first))
+         col = t[i].first >> 1 ;
+      else
+         col = b[j].first >> 1 ;
+      node *q[4] = { z, z, z, z } ;
+      for (; i < t.size() && (t[i].first >> 1) == col; i++)
+         q[t[i].first & 1] = t[i].second ;
+      for (; j < b.size() && (b[j].first >> 1) == col; j++)
+         q[2 + (b[j].first & 1)] = b[j].second ;
+      up.push_back(std::make_pair(col, find_node(q[0], q[1], q[2], q[3]))) ;
+   }
+   pushrowband(depth + 1, rowpend[depth].pair, up) ;
+}
+/*
+ *   Put sub (of depth subdepth, corner at sx,sy) into node n (corner
+ *   at x,y), in row-band coordinates.
+ */
+node *hlifealgo::putnode(node *n, int depth, long long x, long long y,
+                         node *sub, int subdepth, long long sx, long long sy) {
+   if (depth == subdepth)
+      return sub ;
+   long long half = 1LL << depth ;
+   depth-- ;
+   node *nw = n->nw, *ne = n->ne, *sw = n->sw, *se = n->se ;
+   if (sy < y + half) {
+      if (sx < x + half)
+         nw = putnode(nw, depth, x, y, sub, subdepth, sx, sy) ;
+      else
+         ne = putnode(ne, depth, x + half, y, sub, subdepth, sx, sy) ;
+   } else {
+      if (sx < x + half)
+         sw = putnode(sw, depth, x, y + half, sub, subdepth, sx, sy) ;
+      else
+         se = putnode(se, depth, x + half, y + half, sub, subdepth, sx, sy) ;
+   }
+   return find_node(nw, ne, sw, se) ;
+}
+/*
+ *   What is left at the end is at most a pair of bands at each depth;
+ *   these go into the (empty) root from the top.
+ */
+void hlifealgo::endrows() {
+   flushrowband() ;
+   rowsmode = 0 ;
+   for (int d=2; d<(int)rowpend.size(); d++) {
+      for (int h=0; h<2; h++) {
+         std::vector<std::pair<long long, node *> > &v = rowpend[d].half[h] ;
+         long long sy = (2 * rowpend[d].pair + h) << (d + 1) ;
+         for (size_t i=0; i<v.size(); i++) {
+            long long sx = v[i].first << (d + 1) ;
+            long long w = 2LL << d ;
+            while (sx < -(1LL << depth) || sx + w > (1LL << depth) ||
+                   sy < -(1LL << depth) || sy + w > (1LL << depth)) {
+               root = pushroot(root) ;
+               depth++ ;
+            }
+            long long corner = -(1LL << depth) ;
+            root = putnode(root, depth, corner, corner, v[i].second, d,
+                           sx, sy) ;
+         }
+      }
+   }
+   rowpend.clear() ;
+}
 /*
  *   Our nonrecurse top-level bit getting routine.
  */
@@ -1152,6 +1483,518 @@ int hlifealgo::nextcell(int x, int y, int &v) {
    }
    return nextbit(root, x, y, depth) ;
 }
+/*
+ *   Pattern hashes (see patternhash in util.h).  The hash of each
+ *   canonical node, relative to its own top left corner, is kept in
+ *   hashcache until the next gc, so hashing the pattern after a step
+ *   only visits the nodes the step created.  Leaves are cheap enough
+ *   to hash directly.
+ */
+unsigned long long hlifealgo::nodehash(node *n, int depth) {
+   if (depth == 2) {
+      leaf *l = (leaf *)n ;
+      return patternhash::quad(patternhash::block4x4(l->nw),
+                               patternhash::block4x4(l->ne),
+                               patternhash::block4x4(l->sw),
+                               patternhash::block4x4(l->se), 2) ;
+   }
+   if (n == zeronode(depth))
+      return 0 ;
+   std::unordered_map<node *, unsigned long long>::iterator it =
+                                                       hashcache.find(n) ;
+   if (it != hashcache.end())
+      return it->second ;
+   unsigned long long h = patternhash::quad(nodehash(n->nw, depth-1),
+                                            nodehash(n->ne, depth-1),
+                                            nodehash(n->sw, depth-1),
+                                            nodehash(n->se, depth-1), depth) ;
+   hashcache[n] = h ;
+   return h ;
+}
+/*
+ *   Hash the part of node n (top left corner at x,y) that lies inside
+ *   the rect r (left, top, right, bottom, the last two exclusive),
+ *   relative to the node's corner.
+ */
+unsigned long long hlifealgo::recthash(node *n, int depth, long long x,
+                                       long long y, const long long *r) {
+   long long w = 1LL << (depth + 1) ;
+   if (x >= r[2] || y >= r[3] || x + w <= r[0] || y + w <= r[1] ||
+       n == zeronode(depth))
+      return 0 ;
+   if (x >= r[0] && y >= r[1] && x + w <= r[2] && y + w <= r[3])
+      return nodehash(n, depth) ;
+   if (depth == 2) {
+      leaf *l = (leaf *)n ;
+      unsigned short q[4] = { l->nw, l->ne, l->sw, l->se } ;
+      unsigned long long h[4] ;
+      for (int i=0; i<4; i++) {
+         long long qx = x + 4 * (i & 1) ;
+         long long qy = y + 4 * (i >> 1) ;
+         int cols = 0, mask = 0 ;
+         for (int c=0; c<4; c++)
+            if (qx + c >= r[0] && qx + c < r[2])
+               cols |= 8 >> c ;
+         for (int rw=0; rw<4; rw++)
+            if (qy + rw >= r[1] && qy + rw < r[3])
+               mask |= cols << (4 * (3 - rw)) ;
+         h[i] = patternhash::block4x4(q[i] & mask) ;
+      }
+      return patternhash::quad(h[0], h[1], h[2], h[3], 2) ;
+   }
+   long long half = w >> 1 ;
+   depth-- ;
+   return patternhash::quad(recthash(n->nw, depth, x, y, r),
+                            recthash(n->ne, depth, x + half, y, r),
+                            recthash(n->sw, depth, x, y + half, r),
+                            recthash(n->se, depth, x + half, y + half, r),
+                            depth + 1) ;
+}
+unsigned long long hlifealgo::getRectHash(int x, int y, int wd, int ht) {
+   if (!hashed)
+      return lifealgo::getRectHash(x, y, wd, ht) ;
+   if (wd <= 0 || ht <= 0)
+      return 0 ;
+   /* anything an int rect can reach lies in the middle of depth 31 */
+   struct node tnode ;
+   node *n = root ;
+   int mdepth = depth ;
+   while (mdepth > 31) {
+      tnode.nw = n->nw->se ;
+      tnode.ne = n->ne->sw ;
+      tnode.sw = n->sw->ne ;
+      tnode.se = n->se->nw ;
+      n = &tnode ;
+      mdepth-- ;
+   }
+   long long corner = -(1LL << mdepth) ;
+   long long r[4] = { x, y, (long long)x + wd, (long long)y + ht } ;
+   unsigned long long h = recthash(n, mdepth, corner, corner + 1, r) ;
+   return patternhash::mul(h, patternhash::mul(patternhash::xpow(corner - x),
+                                           patternhash::ypow(corner + 1 - y))) ;
+}
+/*
+ *   Batch cell access.  Everything an int can address lies in the
+ *   middle node of depth 31, so the batch setters rebuild that node
+ *   and then splice it back into the root with setmiddle.  The cells
+ *   are sorted into quadrants on the way down, so each node touched
+ *   is rebuilt exactly once, rather than once per cell as setcell
+ *   would.
+ */
+void hlifealgo::growroot(int left, int top, int right, int bottom) {
+   int lim = depth <= 31 ? depth : 31 ;
+   int sx0 = left >> lim, sx1 = right >> lim ;
+   int sy0 = (- bottom) >> lim, sy1 = (- top) >> lim ;
+   while (sx0 < -1 || sx1 > 0 || sy0 < -1 || sy1 > 0) {
+      root = save(pushroot(root)) ;
+      depth++ ;
+      sx0 >>= 1 ;
+      sx1 >>= 1 ;
+      sy0 >>= 1 ;
+      sy1 >>= 1 ;
+   }
+}
+node *hlifealgo::middlenode(node &tnode, int &mdepth) {
+   node *n = root ;
+   mdepth = depth ;
+   while (mdepth > 31) {
+      tnode.nw = n->nw->se ;
+      tnode.ne = n->ne->sw ;
+      tnode.sw = n->sw->ne ;
+      tnode.se = n->se->nw ;
+      n = &tnode ;
+      mdepth-- ;
+   }
+   return n ;
+}
+/*
+ *   Replace the middle node of depth 31 in n with m.
+ */
+node *hlifealgo::setmiddle(node *n, int depth, node *m) {
+   int sp = gsp ;
+   if (depth > 32) {
+      struct node tnode ;
+      tnode.nw = n->nw->se ;
+      tnode.ne = n->ne->sw ;
+      tnode.sw = n->sw->ne ;
+      tnode.se = n->se->nw ;
+      m = save(setmiddle(&tnode, depth-1, m)) ;
+   }
+   node *nw = save(find_node(n->nw->nw, n->nw->ne, n->nw->sw, m->nw)) ;
+   node *ne = save(find_node(n->ne->nw, n->ne->ne, m->ne, n->ne->se)) ;
+   node *sw = save(find_node(n->sw->nw, m->sw, n->sw->sw, n->sw->se)) ;
+   node *se = save(find_node(m->se, n->se->ne, n->se->sw, n->se->se)) ;
+   node *r = find_node(nw, ne, sw, se) ;
+   pop(sp) ;
+   return r ;
+}
+/*
+ *   The cells are x,y,state triples relative to the same top left
+ *   corner as x,y; scratch has room for count of them.
+ */
+node *hlifealgo::setcellsnode(node *n, int depth, long long x, long long y,
+                              int *cells, int *scratch, int count) {
+   if (count <= 0)
+      return n ;
+   if (depth == 2) {
+      leaf *l = (leaf *)n ;
+      unsigned short q[4] = { l->nw, l->ne, l->sw, l->se } ;
+      for (int i=0; i<count; i++, cells += 3) {
+         int cx = (int)(cells[0] - x) ;
+         int cy = (int)(cells[1] - y) ;
+         int k = (cx >> 2) + 2 * (cy >> 2) ;
+         unsigned short b = (unsigned short)(1 << (3 - (cx & 3) +
+                                                   4 * (3 - (cy & 3)))) ;
+         if (cells[2])
+            q[k] |= b ;
+         else
+            q[k] &= ~b ;
+      }
+      return (node *)find_leaf(q[0], q[1], q[2], q[3]) ;
+   }
+   long long half = 1LL << depth ;
+   int cnt[4] = { 0, 0, 0, 0 } ;
+   for (int i=0; i<count; i++)
+      cnt[(cells[3*i] >= x + half) + 2 * (cells[3*i+1] >= y + half)]++ ;
+   int at[4] = { 0, cnt[0], cnt[0] + cnt[1], cnt[0] + cnt[1] + cnt[2] } ;
+   /* keep the cells in order within each quadrant, so the last wins */
+   for (int i=0; i<count; i++) {
+      int *c = cells + 3 * i ;
+      int k = (c[0] >= x + half) + 2 * (c[1] >= y + half) ;
+      memcpy(scratch + 3 * at[k]++, c, 3 * sizeof(int)) ;
+   }
+   memcpy(cells, scratch, 3 * (size_t)count * sizeof(int)) ;
+   int sp = gsp ;
+   depth-- ;
+   int *c = cells ;
+   node *nw = save(setcellsnode(n->nw, depth, x, y, c, scratch, cnt[0])) ;
+   c += 3 * cnt[0] ;
+   node *ne = save(setcellsnode(n->ne, depth, x + half, y, c, scratch,
+                                cnt[1])) ;
+   c += 3 * cnt[1] ;
+   node *sw = save(setcellsnode(n->sw, depth, x, y + half, c, scratch,
+                                cnt[2])) ;
+   c += 3 * cnt[2] ;
+   node *se = save(setcellsnode(n->se, depth, x + half, y + half, c, scratch,
+                                cnt[3])) ;
+   node *r = find_node(nw, ne, sw, se) ;
+   pop(sp) ;
+   return r ;
+}
+int hlifealgo::setcells(const int *cells, int count, bool withstates) {
+   if (count <= 0)
+      return 0 ;
+   int step = withstates ? 3 : 2 ;
+   int left = cells[0], top = cells[1], right = left, bottom = top ;
+   for (int i=0; i<count; i++) {
+      const int *c = cells + step * i ;
+      if (withstates && (c[2] & ~1))
+         return -1 ;
+      if (c[0] < left) left = c[0] ;
+      if (c[0] > right) right = c[0] ;
+      if (c[1] < top) top = c[1] ;
+      if (c[1] > bottom) bottom = c[1] ;
+   }
+   ensure_hashed() ;
+   vector<int> work(6 * (size_t)count) ;
+   int *triples = &work[0] ;
+   for (int i=0; i<count; i++) {
+      triples[3*i] = cells[step*i] ;
+      triples[3*i+1] = cells[step*i+1] ;
+      triples[3*i+2] = withstates ? cells[step*i+2] : 1 ;
+   }
+   clearstack() ;
+   save(root) ;
+   okaytogc = 1 ;
+   inGC = 1 ;
+   growroot(left, top, right, bottom) ;
+   struct node tnode ;
+   int mdepth ;
+   node *n = middlenode(tnode, mdepth) ;
+   long long corner = -(1LL << mdepth) ;
+   n = save(setcellsnode(n, mdepth, corner, corner + 1, triples,
+                         triples + 3 * (size_t)count, count)) ;
+   root = mdepth < depth ? setmiddle(root, depth, n) : n ;
+   okaytogc = 0 ;
+   return 0 ;
+}
+node *hlifealgo::putrectnode(node *n, int depth, long long x, long long y,
+                             const lifecellrect &r) {
+   long long w = 1LL << (depth + 1) ;
+   if (x >= r.x + (long long)r.wd || y >= r.y + (long long)r.ht ||
+       x + w <= r.x || y + w <= r.y)
+      return n ;
+   if (depth == 2) {
+      leaf *l = (leaf *)n ;
+      unsigned short q[4] = { l->nw, l->ne, l->sw, l->se } ;
+      for (int j=0; j<8; j++) {
+         long long ry = y + j - r.y ;
+         if (ry < 0 || ry >= r.ht)
+            continue ;
+         for (int i=0; i<8; i++) {
+            long long rx = x + i - r.x ;
+            if (rx < 0 || rx >= r.wd)
+               continue ;
+            int k = (i >> 2) + 2 * (j >> 2) ;
+            unsigned short b = (unsigned short)(1 << (3 - (i & 3) +
+                                                      4 * (3 - (j & 3)))) ;
+            if (r.get((int)rx, (int)ry))
+               q[k] |= b ;
+            else
+               q[k] &= ~b ;
+         }
+      }
+      return (node *)find_leaf(q[0], q[1], q[2], q[3]) ;
+   }
+   long long half = w >> 1 ;
+   int sp = gsp ;
+   depth-- ;
+   node *nw = save(putrectnode(n->nw, depth, x, y, r)) ;
+   node *ne = save(putrectnode(n->ne, depth, x + half, y, r)) ;
+   node *sw = save(putrectnode(n->sw, depth, x, y + half, r)) ;
+   node *se = save(putrectnode(n->se, depth, x + half, y + half, r)) ;
+   node *res = find_node(nw, ne, sw, se) ;
+   pop(sp) ;
+   return res ;
+}
+int hlifealgo::putrect(const lifecellrect &r) {
+   if (r.wd <= 0 || r.ht <= 0)
+      return 0 ;
+   if (!r.bits)
+      for (int j=0; j<r.ht; j++)
+         for (int i=0; i<r.wd; i++)
+            if (r.get(i, j) & ~1)
+               return -1 ;
+   ensure_hashed() ;
+   clearstack() ;
+   save(root) ;
+   okaytogc = 1 ;
+   inGC = 1 ;
+   growroot(r.x, r.y, r.x + r.wd - 1, r.y + r.ht - 1) ;
+   struct node tnode ;
+   int mdepth ;
+   node *n = middlenode(tnode, mdepth) ;
+   long long corner = -(1LL << mdepth) ;
+   n = save(putrectnode(n, mdepth, corner, corner + 1, r)) ;
+   root = mdepth < depth ? setmiddle(root, depth, n) : n ;
+   okaytogc = 0 ;
+   return 0 ;
+}
+/*
+ *   Visit the live cells of node n (top left corner at x,y) inside the
+ *   rect r (left, top, right, bottom, the last two exclusive).
+ */
+void hlifealgo::visitnode(node *n, int depth, long long x, long long y,
+                          const long long *r, lifecellvisitor &v) {
+   long long w = 1LL << (depth + 1) ;
+   if (x >= r[2] || y >= r[3] || x + w <= r[0] || y + w <= r[1] ||
+       n == zeronode(depth))
+      return ;
+   if (depth == 2) {
+      leaf *l = (leaf *)n ;
+      unsigned short q[4] = { l->nw, l->ne, l->sw, l->se } ;
+      for (int i=0; i<4; i++) {
+         for (int bits=q[i]; bits; bits &= bits - 1) {
+            int b = 0 ;
+            while (!((bits >> b) & 1))
+               b++ ;
+            long long cx = x + 4 * (i & 1) + 3 - (b & 3) ;
+            long long cy = y + 4 * (i >> 1) + 3 - (b >> 2) ;
+            if (cx >= r[0] && cx < r[2] && cy >= r[1] && cy < r[3])
+               v.cell((int)cx, (int)cy, 1) ;
+         }
+      }
+      return ;
+   }
+   long long half = w >> 1 ;
+   depth-- ;
+   visitnode(n->nw, depth, x, y, r, v) ;
+   visitnode(n->ne, depth, x + half, y, r, v) ;
+   visitnode(n->sw, depth, x, y + half, r, v) ;
+   visitnode(n->se, depth, x + half, y + half, r, v) ;
+}
+void hlifealgo::visitcells(lifecellvisitor &v, int x, int y, int wd, int ht) {
+   if (!hashed) {
+      lifealgo::visitcells(v, x, y, wd, ht) ;
+      return ;
+   }
+   if (wd <= 0 || ht <= 0)
+      return ;
+   struct node tnode ;
+   int mdepth ;
+   node *n = middlenode(tnode, mdepth) ;
+   long long corner = -(1LL << mdepth) ;
+   long long r[4] = { x, y, (long long)x + wd, (long long)y + ht } ;
+   visitnode(n, mdepth, corner, corner + 1, r, v) ;
+}
+/*
+ *   Row-order traversal, for writing patterns.  A strip is a row of
+ *   nonempty nodes of one depth, sorted by x; we walk the strip made
+ *   of their top halves and then the one made of their bottom halves,
+ *   so empty space costs nothing, until we get down to rows of leaves.
+ *   Positions are relative to the rect's top left corner.
+ */
+bool hlifealgo::rowstrip(std::vector<std::pair<long long, node *> > &strip,
+                         int depth, long long y, long long wd, long long ht,
+                         liferowvisitor &v) {
+   long long size = 2LL << depth ;
+   if (strip.empty() || y >= ht || y + size <= 0)
+      return true ;
+   if (depth == 2) {
+      for (int r=0; r<8; r++) {
+         if (y + r < 0 || y + r >= ht)
+            continue ;
+         int shift = 4 * (3 - (r & 3)) ;
+         for (size_t i=0; i<strip.size(); i++) {
+            leaf *l = (leaf *)strip[i].second ;
+            int bits = r < 4 ?
+                       ((l->nw >> shift) & 15) << 4 | ((l->ne >> shift) & 15) :
+                       ((l->sw >> shift) & 15) << 4 | ((l->se >> shift) & 15) ;
+            for (int c=0; bits; c++, bits = (bits << 1) & 255) {
+               long long x = strip[i].first + c ;
+               if ((bits & 128) && x >= 0 && x < wd && !v.cell(x, y + r, 1))
+                  return false ;
+            }
+         }
+      }
+      return true ;
+   }
+   long long half = size >> 1 ;
+   node *z = zeronode(depth - 1) ;
+   std::vector<std::pair<long long, node *> > sub ;
+   for (int h=0; h<2; h++) {
+      sub.clear() ;
+      for (size_t i=0; i<strip.size(); i++) {
+         long long x = strip[i].first ;
+         node *w = h ? strip[i].second->sw : strip[i].second->nw ;
+         node *e = h ? strip[i].second->se : strip[i].second->ne ;
+         if (w != z && x < wd && x + half > 0)
+            sub.push_back(std::make_pair(x, w)) ;
+         if (e != z && x + half < wd && x + size > 0)
+            sub.push_back(std::make_pair(x + half, e)) ;
+      }
+      if (!rowstrip(sub, depth - 1, y + h * half, wd, ht, v))
+         return false ;
+   }
+   return true ;
+}
+/*
+ *   Does the square at x,y of the given size meet the rect?
+ */
+static bool meetsrect(const bigint &x, const bigint &y, const bigint &size,
+                      const bigint &top, const bigint &left,
+                      const bigint &bottom, const bigint &right) {
+   bigint r = x ;
+   r += size ;
+   bigint b = y ;
+   b += size ;
+   return x <= right && y <= bottom && r > left && b > top ;
+}
+int hlifealgo::visitrows(liferowvisitor &v, const bigint &top,
+                         const bigint &left, const bigint &bottom,
+                         const bigint &right) {
+   long long wd, ht ;
+   if (!rowsize(top, left, bottom, right, wd, ht))
+      return -1 ;
+   if (wd <= 0 || ht <= 0 || isEmpty())
+      return 0 ;
+   /*
+    *   Come down from the root in bigints until the nodes are small
+    *   enough that their positions relative to the rect fit in a long
+    *   long; the rect is smaller than such a node, so there are at
+    *   most four of them.
+    */
+   struct bignode {
+      bigint x, y ;
+      node *n ;
+   } ;
+   std::vector<bignode> nodes, next ;
+   bigint size = 1 ;
+   size.mulpow2(depth + 1) ;
+   bignode b ;
+   b.x = 0 ;
+   b.x -= size ;
+   b.x.div2() ;
+   b.y = b.x ;
+   b.y += 1 ;
+   b.n = root ;
+   if (meetsrect(b.x, b.y, size, top, left, bottom, right))
+      nodes.push_back(b) ;
+   int d = depth ;
+   for (; d > 60; d--) {
+      size.div2() ;
+      node *z = zeronode(d - 1) ;
+      next.clear() ;
+      for (size_t i=0; i<nodes.size(); i++) {
+         node *n = nodes[i].n ;
+         node *kids[4] = { n->nw, n->ne, n->sw, n->se } ;
+         for (int k=0; k<4; k++) {
+            if (kids[k] == z)
+               continue ;
+            b.x = nodes[i].x ;
+            if (k & 1)
+               b.x += size ;
+            b.y = nodes[i].y ;
+            if (k & 2)
+               b.y += size ;
+            b.n = kids[k] ;
+            if (meetsrect(b.x, b.y, size, top, left, bottom, right))
+               next.push_back(b) ;
+         }
+      }
+      nodes.swap(next) ;
+   }
+   /* put the (few) nodes in row order and walk each row of them */
+   for (size_t i=1; i<nodes.size(); i++)
+      for (size_t j=i; j>0 && (nodes[j].y < nodes[j-1].y ||
+             (nodes[j].y == nodes[j-1].y && nodes[j].x < nodes[j-1].x)); j--)
+         std::swap(nodes[j], nodes[j-1]) ;
+   std::vector<std::pair<long long, node *> > strip ;
+   for (size_t i=0; i<nodes.size(); ) {
+      bigint y = nodes[i].y ;
+      strip.clear() ;
+      for (; i<nodes.size() && nodes[i].y == y; i++) {
+         bigint x = nodes[i].x ;
+         x -= left ;
+         strip.push_back(std::make_pair(x.toint64(), nodes[i].n)) ;
+      }
+      y -= top ;
+      if (!rowstrip(strip, d, y.toint64(), wd, ht, v))
+         return 1 ;
+   }
+   return 0 ;
+}
+unsigned long long hlifealgo::getPatternHash() {
+   if (!hashed)
+      return lifealgo::getPatternHash() ;
+   if (isEmpty())
+      return 0 ;
+   bigint top, left, bottom, right ;
+   findedges(&top, &left, &bottom, &right) ;
+   if (top < bigint::min_coord || left < bigint::min_coord ||
+       bottom > bigint::max_coord || right > bigint::max_coord)
+      return 0 ;
+   struct node tnode ;
+   node *n = root ;
+   int mdepth = depth ;
+   while (mdepth > 31) {
+      tnode.nw = n->nw->se ;
+      tnode.ne = n->ne->sw ;
+      tnode.sw = n->sw->ne ;
+      tnode.se = n->se->nw ;
+      n = &tnode ;
+      mdepth-- ;
+   }
+   /* the whole tree is inside the bounding box as far as live cells go */
+   long long corner = -(1LL << mdepth) ;
+   unsigned long long h = patternhash::quad(nodehash(n->nw, mdepth-1),
+                                            nodehash(n->ne, mdepth-1),
+                                            nodehash(n->sw, mdepth-1),
+                                            nodehash(n->se, mdepth-1), mdepth) ;
+   return patternhash::mul(h,
+                 patternhash::mul(patternhash::xpow(corner - left.toint()),
+                                  patternhash::ypow(corner + 1 - top.toint()))) ;
+}
 /*
  *   Canonicalize a universe by filling in the null pointers and then
  *   invoking find_node on each node.  Drops the original universe on
@@ -1179,6 +2022,8 @@ node *hlifealgo::hashpattern(node *root, int depth) {
 }
 void hlifealgo::endofpattern() {
    poller->bailIfCalculating() ;
+   if (rowsmode)
+      endrows() ;
    if (!hashed) {
       root = hashpattern(root, depth) ;
       zeronode(depth) ;
@@ -1217,35 +2062,30 @@ node *hlifealgo::popzeros(node *n) {
  *   (or abusing) the cache (res) field, and the least significant bit of
  *   the hash next field (as a visited bit).
  */
+#ifdef COMPACTNODES
+#define marked(n) (0x80000000 & (n)->next.i)
+#define mark(n) ((n)->next.i |= 0x80000000)
+#define clearmark(n) ((n)->next.i &= ~0x80000000)
+#define clearmarkbit(p) (noderef::at(~0x80000000 & (p).i))
+#else
 #define marked(n) (1 & (g_uintptr_t)(n)->next)
 #define mark(n) ((n)->next = (node *)(1 | (g_uintptr_t)(n)->next))
 #define clearmark(n) ((n)->next = (node *)(~1 & (g_uintptr_t)(n)->next))
 #define clearmarkbit(p) ((node *)(~1 & (g_uintptr_t)(p)))
+#endif
 /*
  *   Sometimes we want to use *res* instead of next to mark.  You cannot
  *   do this to leaves, though.
  */
-#define marked2(n) (3 & (g_uintptr_t)(n)->res)
+#ifdef COMPACTNODES
+#define marked2(n) (0x80000000 & (n)->res.i)
+#define mark2(n) ((n)->res.i |= 0x80000000)
+#define clearmark2(n) ((n)->res.i &= ~0x80000000)
+#else
+#define marked2(n) (1 & (g_uintptr_t)(n)->res)
 #define mark2(n) ((n)->res = (node *)(1 | (g_uintptr_t)(n)->res))
-#define mark2v(n,v) ((n)->res = (node *)(v | (g_uintptr_t)(n)->res))
-#define clearmark2(n) ((n)->res = (node *)(~3 & (g_uintptr_t)(n)->res))
-void hlifealgo::unhash_node(node *n) {
-   node *p ;
-   g_uintptr_t h = node_hash(n->nw,n->ne,n->sw,n->se) ;
-   node *pred = 0 ;
-   h = HASHMOD(h) ;
-   for (p=hashtab[h]; (!is_node(p) || !marked2(p)) && p; p = p->next) {
-      if (p == n) {
-         if (pred)
-            pred->next = p->next ;
-         else
-            hashtab[h] = p->next ;
-         return ;
-      }
-      pred = p ;
-   }
-   lifefatal("Didn't find node to unhash") ;
-}
+#define clearmark2(n) ((n)->res = (node *)(~1 & (g_uintptr_t)(n)->res))
+#endif
 void hlifealgo::unhash_node2(node *n) {
    node *p ;
    g_uintptr_t h = node_hash(n->nw,n->ne,n->sw,n->se) ;
@@ -1270,54 +2110,85 @@ void hlifealgo::rehash_node(node *n) {
    hashtab[h] = n ;
 }
 /*
- *   This recursive routine calculates the population by hanging the
- *   population on marked nodes.
+ *   Populations are kept for every canonical node we have counted, in
+ *   popmemo, until gc frees the node, so counting the population after
+ *   a step only visits the nodes the step created.  A node of depth 30
+ *   or less holds at most 2^62 cells, so its population fits in 64
+ *   bits; only the deeper nodes need bigints.  Leaves and depth-3 nodes
+ *   are cheap enough to count directly.
  */
-const bigint &hlifealgo::calcpop(node *root, int depth) {
-   if (root == zeronode(depth))
-      return bigint::zero ;
+const int MAXSMALLPOPDEPTH = 30 ;
+unsigned long long hlifealgo::calcpop(node *root, int depth) {
    if (depth == 2)
       return ((leaf *)root)->leafpop ;
-   if (marked2(root))
-      return *(bigint*)&(root->next) ;
+   if (root == zeronode(depth))
+      return 0 ;
+   if (depth == 3)
+      return (unsigned long long)((leaf *)root->nw)->leafpop +
+             ((leaf *)root->ne)->leafpop + ((leaf *)root->sw)->leafpop +
+             ((leaf *)root->se)->leafpop ;
+   std::unordered_map<node *, unsigned long long>::iterator it =
+                                                         popmemo.find(root) ;
+   if (it != popmemo.end())
+      return it->second ;
    depth-- ;
-   if (root->next == 0)
-      mark2v(root, 3) ;
-   else {
-      unhash_node(root) ;
-      mark2(root) ;
+   unsigned long long pop = calcpop(root->nw, depth) +
+                            calcpop(root->ne, depth) +
+                            calcpop(root->sw, depth) +
+                            calcpop(root->se, depth) ;
+   popmemo[root] = pop ;
+   return pop ;
+}
+const bigint &hlifealgo::calcbigpop(node *root, int depth) {
+   if (root == zeronode(depth))
+      return bigint::zero ;
+   std::unordered_map<node *, bigint>::iterator it = bigpopmemo.find(root) ;
+   if (it != bigpopmemo.end())
+      return it->second ;
+   depth-- ;
+   bigint pop ;
+   if (depth <= MAXSMALLPOPDEPTH) {
+      pop = bigint((G_INT64)calcpop(root->nw, depth)) ;
+      pop += bigint((G_INT64)calcpop(root->ne, depth)) ;
+      pop += bigint((G_INT64)calcpop(root->sw, depth)) ;
+      pop += bigint((G_INT64)calcpop(root->se, depth)) ;
+   } else {
+      pop = bigint(calcbigpop(root->nw, depth), calcbigpop(root->ne, depth),
+                   calcbigpop(root->sw, depth), calcbigpop(root->se, depth)) ;
    }
-/**
- *   We use allocate-in-place bigint constructor here to initialize the
- *   node.  This should compile to a single instruction.
+   return bigpopmemo[root] = pop ;
+}
+/*
+ *   Called by gc after marking:  forget the populations of the nodes
+ *   it is about to free.
  */
-   new(&(root->next))bigint(
-        calcpop(root->nw, depth), calcpop(root->ne, depth),
-        calcpop(root->sw, depth), calcpop(root->se, depth)) ;
-   return *(bigint *)&(root->next) ;
+void hlifealgo::prunepops() {
+   for (std::unordered_map<node *, unsigned long long>::iterator it =
+                                popmemo.begin(); it != popmemo.end(); ) {
+      if (marked(it->first))
+         ++it ;
+      else
+         it = popmemo.erase(it) ;
+   }
+   for (std::unordered_map<node *, bigint>::iterator it =
+                             bigpopmemo.begin(); it != bigpopmemo.end(); ) {
+      if (marked(it->first))
+         ++it ;
+      else
+         it = bigpopmemo.erase(it) ;
+   }
 }
 /*
- *   Call this after doing something that unhashes nodes in order to
- *   use the next field as a temp pointer.
+ *   Likewise forget the rendered tiles of the nodes gc will free.
  */
-void hlifealgo::aftercalcpop2(node *root, int depth) {
-   if (depth == 2 || root == zeronode(depth))
-      return ;
-   int v = marked2(root) ;
-   if (v) {
-      clearmark2(root) ;
-      depth-- ;
-      if (depth > 2) {
-         aftercalcpop2(root->nw, depth) ;
-         aftercalcpop2(root->ne, depth) ;
-         aftercalcpop2(root->sw, depth) ;
-         aftercalcpop2(root->se, depth) ;
+void hlifealgo::prunetiles() {
+   for (tilelist::iterator it = tiles.begin(); it != tiles.end(); ) {
+      if (marked(it->first.first)) {
+         ++it ;
+      } else {
+         tilemap.erase(it->first) ;
+         it = tiles.erase(it) ;
       }
-      ((bigint *)&(root->next))->~bigint() ;
-      if (v == 3)
-         root->next = 0 ;
-      else
-         rehash_node(root) ;
    }
 }
 /*
@@ -1347,8 +2218,10 @@ void hlifealgo::calcPopulation() {
    int depth ;
    ensure_hashed() ;
    depth = node_depth(root) ;
-   population = calcpop(root, depth) ;
-   aftercalcpop2(root, depth) ;
+   if (depth <= MAXSMALLPOPDEPTH)
+      population = bigint((G_INT64)calcpop(root, depth)) ;
+   else
+      population = calcbigpop(root, depth) ;
 }
 /*
  *   Is the universe empty?
@@ -1400,10 +2273,12 @@ void hlifealgo::gc_mark(node *root, int invalidate) {
          gc_mark(root->sw, invalidate) ;
          gc_mark(root->se, invalidate) ;
          if (root->res) {
-            if (invalidate)
+            if (invalidate || (agecache && !resused(root)))
               root->res = 0 ;
-            else
-              gc_mark(root->res, invalidate) ;
+            else {
+              unuseres(root) ;
+              gc_mark(resof(root), invalidate) ;
+            }
          }
       }
    }
@@ -1417,6 +2292,7 @@ void hlifealgo::do_gc(int invalidate) {
    g_uintptr_t freed_nodes=0 ;
    node *p, *pp ;
    inGC = 1 ;
+   double gcstart = gollySecondCount() ;
    gccount++ ;
    gcstep++ ;
    if (verbose) {
@@ -1439,6 +2315,15 @@ void hlifealgo::do_gc(int invalidate) {
    }
    for (i=0; i<timeline.framecount; i++)
       gc_mark((node *)timeline.frames[i], invalidate) ;
+   if (mt && mt->running)
+      for (int w=0; w<mt->threads.size(); w++)
+         for (i=0; i<mt->workers[w].gsp; i++)
+            gc_mark(mt->workers[w].stack[i], invalidate) ;
+   agecache = 0 ;
+   hashcache.clear() ;
+   prunepops() ;
+   prunetiles() ;
+   damaged.invalidate() ;
    hashpop = 0 ;
    memset(hashtab, 0, sizeof(node *) * hashprime) ;
    freenodes = 0 ;
@@ -1465,11 +2350,19 @@ void hlifealgo::do_gc(int invalidate) {
          }
       }
    }
+   // the workers' private free lists were just swept up with the rest
+   if (mt && mt->running)
+      for (int w=0; w<mt->threads.size(); w++)
+         mt->workers[w].freenodes = 0 ;
    inGC = 0 ;
+   double gcsecs = gollySecondCount() - gcstart ;
+   running_hperf.gcCount++ ;
+   running_hperf.gcSeconds += gcsecs ;
    if (verbose) {
      double perc = (double)freed_nodes / (double)totalthings * 100.0 ;
-     sprintf(statusline+strlen(statusline), " freed %g percent (%" PRIuPTR ").",
-                                                   perc, freed_nodes) ;
+     sprintf(statusline+strlen(statusline),
+             " freed %g percent (%" PRIuPTR ") in %g seconds.",
+                                         perc, freed_nodes, gcsecs) ;
      lifestatus(statusline) ;
    }
    if (needPop) {
@@ -1494,7 +2387,7 @@ void hlifealgo::clearcache(node *n, int depth, int clearto) {
          clearcache(n->sw, depth, clearto) ;
          clearcache(n->se, depth, clearto) ;
          if (n->res)
-            clearcache(n->res, depth, clearto) ;
+            clearcache(resof(n), depth, clearto) ;
       }
       if (depth >= clearto)
          n->res = 0 ;
@@ -1601,6 +2494,7 @@ node *hlifealgo::runpattern() {
    save(root) ; // do this in case we interrupt generation
    ensure_hashed() ;
    okaytogc = 1 ;
+   agecache = 1 ;
    if (cacheinvalid) {
       do_gc(1) ; // invalidate the entire cache and recalc leaves
       cacheinvalid = 0 ;
@@ -1617,7 +2511,10 @@ node *hlifealgo::runpattern() {
    }
    save(zeronode(nzeros-1)) ;
    save(n) ;
-   n2 = getres(n, depth) ;
+   if (numthreads > 1)
+      n2 = runparallel(n, depth) ;
+   else
+      n2 = getres(n, depth) ;
    okaytogc = 0 ;
    clearstack() ;
    if (halvesdone == 1 && n->res != 0) {
@@ -1630,6 +2527,496 @@ node *hlifealgo::runpattern() {
    generation += pow2step ;
    return n ;
 }
+/*
+ *   Multithreaded stepping.
+ *
+ *   With more than one thread we run the same recursion, but at depths
+ *   of MTFORKDEPTH and up the nine (and then four) sub-results of a
+ *   dorecurs that aren't already cached are handed to the worker pool
+ *   and computed concurrently.  Since nodes are canonical, it does not
+ *   matter which thread builds a node or fills in a res field; two
+ *   threads racing on the same node just compute the same answer.
+ *
+ *   Each thread has its own gc stack and a small private cache of free
+ *   nodes; hash chains are protected by striped spinlocks.  We never
+ *   gc or resize in the middle of a find_node.  Instead, a thread that
+ *   notices memory or the hash load getting tight sets gcwanted, and
+ *   the main thread (worker 0), at its next getres, stops the world:
+ *   it waits until every other active thread is parked at a safe point
+ *   (the top of getres, or waiting for tasks), runs the ordinary
+ *   resize/do_gc, and lets everyone go.  So the memory limit can be
+ *   overshot slightly while we wait, and all gc, polling and status
+ *   reporting stays on the main thread.
+ */
+const int MTFORKDEPTH = 8 ;
+const int MTREFILL = 64 ;
+struct hlifetask : public lifetask {
+   hlifealgo *h ;
+   node *n, *res ;
+   int depth ;
+   virtual void run(int worker) { h->runtask(*this, worker) ; }
+} ;
+static inline void locknodes(std::atomic_flag &l) {
+   while (l.test_and_set(std::memory_order_acquire))
+      std::this_thread::yield() ;
+}
+static inline void unlocknodes(std::atomic_flag &l) {
+   l.clear(std::memory_order_release) ;
+}
+void hlifealgo::setNumThreads(int n) {
+   poller->bailIfCalculating() ;
+   lifealgo::setNumThreads(n) ;
+   if (mt && mt->threads.size() != numthreads)
+      deletethreads() ;
+}
+void hlifealgo::deletethreads() {
+   if (mt == 0)
+      return ;
+   for (int i=0; i<mt->threads.size(); i++)
+      alloced -= sizeof(node *) * mt->workers[i].stacksize ;
+   delete mt ;
+   mt = 0 ;
+}
+/*
+ *   Run getres on the top node with all our threads.  When this returns
+ *   every task has been joined, so the other threads are idle again and
+ *   we can fold their bookkeeping back into ours.
+ */
+node *hlifealgo::runparallel(node *n, int depth) {
+   if (mt == 0)
+      mt = new hlifemt(numthreads) ;
+   hlifeworker &w = mt->workers[0] ;
+   mt->active = 1 ;
+   mt->parked = 0 ;
+   mt->running = 1 ;
+   w.nest = 1 ;
+   node *r = getres(w, n, depth) ;
+   w.nest = 0 ;
+   mt->running = 0 ;
+   mt->active = 0 ;
+   hashpop += mt->inserted ;
+   mt->inserted = 0 ;
+   for (int i=0; i<mt->threads.size(); i++) {
+      hlifeworker &wi = mt->workers[i] ;
+      hashpop += wi.inserted ;
+      wi.inserted = 0 ;
+      halvesdone += wi.halvesdone ;
+      wi.halvesdone = 0 ;
+      while (wi.freenodes) {
+         node *p = wi.freenodes ;
+         wi.freenodes = p->next ;
+         p->next = freenodes ;
+         freenodes = p ;
+      }
+   }
+   if (halvesdone > 1000)
+      halvesdone = 1000 ;
+   mt->gcwanted = 0 ;
+   if (hashpop > hashlimit)
+      resize() ;
+   return r ;
+}
+/*
+ *   A task runs one getres on whatever thread picks it up.  The first
+ *   task a pool thread runs makes it an active participant in the gc
+ *   handshake; tasks it runs while waiting on its own tasks don't.
+ */
+void hlifealgo::runtask(hlifetask &t, int worker) {
+   hlifeworker &w = mt->workers[worker] ;
+   if (w.nest++ == 0)
+      enterworker(w) ;
+   t.res = getres(w, t.n, t.depth) ;
+   if (--w.nest == 0)
+      leaveworker(w) ;
+}
+void hlifealgo::enterworker(hlifeworker &) {
+   std::unique_lock<std::mutex> lk(mt->lock) ;
+   mt->active++ ;
+   while (mt->stopping) {
+      mt->parked++ ;
+      mt->cv.notify_all() ;
+      while (mt->stopping)
+         mt->cv.wait(lk) ;
+      mt->parked-- ;
+   }
+}
+void hlifealgo::leaveworker(hlifeworker &) {
+   std::lock_guard<std::mutex> lk(mt->lock) ;
+   mt->active-- ;
+   mt->cv.notify_all() ;
+}
+/*
+ *   Called by every thread at the top of getres and while waiting for
+ *   tasks; at these points everything the thread needs is on its gc
+ *   stack and it holds no locks.
+ */
+void hlifealgo::safepoint(hlifeworker &w) {
+   if (w.index != 0) {
+      if (!mt->stopping)
+         return ;
+      std::unique_lock<std::mutex> lk(mt->lock) ;
+      if (!mt->stopping)
+         return ;
+      mt->parked++ ;
+      mt->cv.notify_all() ;
+      while (mt->stopping)
+         mt->cv.wait(lk) ;
+      mt->parked-- ;
+      return ;
+   }
+   if (!mt->gcwanted)
+      return ;
+   std::unique_lock<std::mutex> lk(mt->lock) ;
+   mt->stopping = 1 ;
+   while (mt->parked + 1 < mt->active)
+      mt->cv.wait(lk) ;
+   hashpop += mt->inserted ;
+   mt->inserted = 0 ;
+   for (int i=0; i<mt->threads.size(); i++) {
+      hashpop += mt->workers[i].inserted ;
+      mt->workers[i].inserted = 0 ;
+   }
+   if (hashpop > hashlimit)
+      resize() ;
+   else
+      do_gc(0) ;
+   mt->gcwanted = 0 ;
+   mt->stopping = 0 ;
+   mt->cv.notify_all() ;
+}
+/*
+ *   Grab a handful of free nodes for this worker, making a new block
+ *   if we have to.  If that pushes us up against the memory limit, ask
+ *   for a gc.
+ */
+void hlifealgo::refill(hlifeworker &w) {
+   std::lock_guard<std::mutex> lk(mt->lock) ;
+   if (freenodes == 0)
+      newblock() ;
+   node *p = freenodes ;
+   for (int i=1; i<MTREFILL && p->next; i++)
+      p = p->next ;
+   w.freenodes = freenodes ;
+   freenodes = p->next ;
+   p->next = 0 ;
+   if (freenodes == 0 && alloced + 1000 * sizeof(node) > maxmem)
+      mt->gcwanted = 1 ;
+}
+void hlifealgo::countinserted(hlifeworker &w) {
+   if (++w.inserted < 1024)
+      return ;
+   g_uintptr_t pending = (mt->inserted += w.inserted) ;
+   w.inserted = 0 ;
+   if (hashpop + pending > hashlimit)
+      mt->gcwanted = 1 ;
+}
+node *hlifealgo::save(hlifeworker &w, node *n) {
+   if (w.gsp >= w.stacksize) {
+      std::lock_guard<std::mutex> lk(mt->lock) ;
+      int nstacksize = w.stacksize * 2 + 100 ;
+      alloced += sizeof(node *)*(nstacksize-w.stacksize) ;
+      w.stack = (node **)realloc(w.stack, nstacksize * sizeof(node *)) ;
+      if (w.stack == 0)
+        lifefatal("Out of memory (3).") ;
+      w.stacksize = nstacksize ;
+   }
+   w.stack[w.gsp++] = n ;
+   return n ;
+}
+node *hlifealgo::find_node(hlifeworker &w, noderef nw, noderef ne,
+                           noderef sw, noderef se) {
+   if (w.freenodes == 0)
+      refill(w) ;
+   node *p ;
+   node *pred = 0 ;
+   g_uintptr_t h = HASHMOD(node_hash(nw,ne,sw,se)) ;
+   std::atomic_flag &l = mt->hashlocks[h & (HASHLOCKS - 1)] ;
+   locknodes(l) ;
+   for (p=hashtab[h]; p; p = p->next) { /* make sure to compare nw *first* */
+      if (nw == p->nw && ne == p->ne && sw == p->sw && se == p->se) {
+         if (pred) { /* move this one to the front */
+            pred->next = p->next ;
+            p->next = hashtab[h] ;
+            hashtab[h] = p ;
+         }
+         unlocknodes(l) ;
+         return save(w, p) ;
+      }
+      pred = p ;
+   }
+   p = w.freenodes ;
+   w.freenodes = p->next ;
+   p->nw = nw ;
+   p->ne = ne ;
+   p->sw = sw ;
+   p->se = se ;
+   p->res = 0 ;
+   p->next = hashtab[h] ;
+   hashtab[h] = p ;
+   unlocknodes(l) ;
+   countinserted(w) ;
+   return save(w, p) ;
+}
+leaf *hlifealgo::find_leaf(hlifeworker &w, unsigned short nw,
+                           unsigned short ne, unsigned short sw,
+                           unsigned short se) {
+   if (w.freenodes == 0)
+      refill(w) ;
+   leaf *p ;
+   leaf *pred = 0 ;
+   g_uintptr_t h = HASHMOD(leaf_hash(nw, ne, sw, se)) ;
+   std::atomic_flag &l = mt->hashlocks[h & (HASHLOCKS - 1)] ;
+   locknodes(l) ;
+   for (p=(leaf *)hashtab[h]; p; p = (leaf *)p->next) {
+      if (nw == p->nw && ne == p->ne && sw == p->sw && se == p->se &&
+          !is_node(p)) {
+         if (pred) {
+            pred->next = p->next ;
+            p->next = hashtab[h] ;
+            hashtab[h] = (node *)p ;
+         }
+         unlocknodes(l) ;
+         return (leaf *)save(w, (node *)p) ;
+      }
+      pred = p ;
+   }
+   p = (leaf *)w.freenodes ;
+   w.freenodes = p->next ;
+   p->nw = nw ;
+   p->ne = ne ;
+   p->sw = sw ;
+   p->se = se ;
+   leafres(p) ;
+   p->isnode = 0 ;
+   p->next = hashtab[h] ;
+   hashtab[h] = (node *)p ;
+   unlocknodes(l) ;
+   countinserted(w) ;
+   return (leaf *)save(w, (node *)p) ;
+}
+/*
+ *   Only the main thread polls and keeps performance statistics; the
+ *   others just watch for the interrupt flag.
+ */
+node *hlifealgo::getres(hlifeworker &w, node *n, int depth) {
+   if (n->res) {
+     if (!resused(n))
+       useres(n) ;
+     return resof(n) ;
+   }
+   safepoint(w) ;
+   if (w.index == 0) {
+      if (poller->poll() || softinterrupt)
+         return zeronode(depth-1) ;
+      if (running_hperf.fastinc(depth, ngens < depth))
+         running_hperf.report(inc_hperf, verbose) ;
+   } else if (poller->isInterrupted() || softinterrupt) {
+      return zeronode(depth-1) ;
+   }
+   node *res = 0 ;
+   int sp = w.gsp ;
+   depth-- ;
+   if (ngens >= depth) {
+     if (is_node(n->nw)) {
+       res = dorecurs(w, n->nw, n->ne, n->sw, n->se, depth) ;
+     } else {
+       res = (node *)dorecurs_leaf(w, (leaf *)n->nw, (leaf *)n->ne,
+                                   (leaf *)n->sw, (leaf *)n->se) ;
+     }
+   } else {
+     if (is_node(n->nw)) {
+       res = dorecurs_half(w, n->nw, n->ne, n->sw, n->se, depth) ;
+     } else if (ngens == 0) {
+       res = (node *)dorecurs_leaf_quarter(w, (leaf *)n->nw, (leaf *)n->ne,
+                                           (leaf *)n->sw, (leaf *)n->se) ;
+     } else {
+       res = (node *)dorecurs_leaf_half(w, (leaf *)n->nw, (leaf *)n->ne,
+                                        (leaf *)n->sw, (leaf *)n->se) ;
+     }
+   }
+   w.gsp = sp ;
+   if (softinterrupt ||
+       poller->isInterrupted()) // don't assign this to the cache field!
+     res = zeronode(depth) ;
+   else {
+     if (ngens < depth)
+       w.halvesdone++ ;
+     n->res = res ;
+     useres(n) ;
+   }
+   return res ;
+}
+/*
+ *   Compute getres of each of the cnt inputs.  Deep enough in the tree
+ *   we fork all the ones that aren't cached yet except the last, which
+ *   we do ourselves, and then help out until the rest are done.  The
+ *   inputs are on our gc stack, and each result hangs off its input's
+ *   res field, so everything survives a gc while we wait.
+ */
+void hlifealgo::getresn(hlifeworker &w, node **in, node **out, int cnt,
+                        int depth) {
+   int i ;
+   if (depth < MTFORKDEPTH) {
+      for (i=0; i<cnt; i++)
+         out[i] = getres(w, in[i], depth) ;
+      return ;
+   }
+   hlifetask tasks[9] ;
+   lifetaskgroup g ;
+   int last = -1 ;
+   for (i=0; i<cnt; i++) {
+      tasks[i].n = 0 ;
+      out[i] = resof(in[i]) ;
+      if (out[i] != 0) {
+         useres(in[i]) ;
+         continue ;
+      }
+      if (last >= 0) {
+         hlifetask &t = tasks[last] ;
+         t.h = this ;
+         t.n = in[last] ;
+         t.depth = depth ;
+         t.res = 0 ;
+         mt->threads.spawn(w.index, &t, g) ;
+      }
+      last = i ;
+   }
+   if (last < 0)
+      return ;
+   out[last] = getres(w, in[last], depth) ;
+   while (g.pending > 0) {
+      safepoint(w) ;
+      if (w.index == 0)
+         poller->poll() ;
+      if (!mt->threads.runone(w.index))
+         std::this_thread::yield() ;
+   }
+   for (i=0; i<cnt; i++)
+      if (tasks[i].n)
+         out[i] = tasks[i].res ;
+}
+node *hlifealgo::dorecurs(hlifeworker &w, node *n, node *ne, node *t,
+                          node *e, int depth) {
+   int sp = w.gsp ;
+   node *in[9], *out[9] ;
+   in[0] = n ;
+   in[1] = find_node(w, n->ne, ne->nw, n->se, ne->sw) ;
+   in[2] = ne ;
+   in[3] = find_node(w, n->sw, n->se, t->nw, t->ne) ;
+   in[4] = find_node(w, n->se, ne->sw, t->ne, e->nw) ;
+   in[5] = find_node(w, ne->sw, ne->se, e->nw, e->ne) ;
+   in[6] = t ;
+   in[7] = find_node(w, t->ne, e->nw, t->se, e->sw) ;
+   in[8] = e ;
+   getresn(w, in, out, 9, depth) ;
+   node
+   *t00 = out[0], *t01 = out[1], *t02 = out[2],
+   *t10 = out[3], *t11 = out[4], *t12 = out[5],
+   *t20 = out[6], *t21 = out[7], *t22 = out[8] ;
+   in[0] = find_node(w, t00, t01, t10, t11) ;
+   in[1] = find_node(w, t01, t02, t11, t12) ;
+   in[2] = find_node(w, t10, t11, t20, t21) ;
+   in[3] = find_node(w, t11, t12, t21, t22) ;
+   getresn(w, in, out, 4, depth) ;
+   n = find_node(w, out[0], out[1], out[2], out[3]) ;
+   w.gsp = sp ;
+   return save(w, n) ;
+}
+node *hlifealgo::dorecurs_half(hlifeworker &w, node *n, node *ne, node *t,
+                               node *e, int depth) {
+   int sp = w.gsp ;
+   node *in[9], *out[9] ;
+   in[0] = n ;
+   in[1] = find_node(w, n->ne, ne->nw, n->se, ne->sw) ;
+   in[2] = ne ;
+   in[3] = find_node(w, n->sw, n->se, t->nw, t->ne) ;
+   in[4] = find_node(w, n->se, ne->sw, t->ne, e->nw) ;
+   in[5] = find_node(w, ne->sw, ne->se, e->nw, e->ne) ;
+   in[6] = t ;
+   in[7] = find_node(w, t->ne, e->nw, t->se, e->sw) ;
+   in[8] = e ;
+   getresn(w, in, out, 9, depth) ;
+   node
+   *t00 = out[0], *t01 = out[1], *t02 = out[2],
+   *t10 = out[3], *t11 = out[4], *t12 = out[5],
+   *t20 = out[6], *t21 = out[7], *t22 = out[8] ;
+   if (depth > 3) {
+      n = find_node(w, find_node(w, t00->se, t01->sw, t10->ne, t11->nw),
+                       find_node(w, t01->se, t02->sw, t11->ne, t12->nw),
+                       find_node(w, t10->se, t11->sw, t20->ne, t21->nw),
+                       find_node(w, t11->se, t12->sw, t21->ne, t22->nw)) ;
+   } else {
+      n = find_node(w, (node *)find_leaf(w, ((leaf *)t00)->se,
+                                            ((leaf *)t01)->sw,
+                                            ((leaf *)t10)->ne,
+                                            ((leaf *)t11)->nw),
+                       (node *)find_leaf(w, ((leaf *)t01)->se,
+                                            ((leaf *)t02)->sw,
+                                            ((leaf *)t11)->ne,
+                                            ((leaf *)t12)->nw),
+                       (node *)find_leaf(w, ((leaf *)t10)->se,
+                                            ((leaf *)t11)->sw,
+                                            ((leaf *)t20)->ne,
+                                            ((leaf *)t21)->nw),
+                       (node *)find_leaf(w, ((leaf *)t11)->se,
+                                            ((leaf *)t12)->sw,
+                                            ((leaf *)t21)->ne,
+                                            ((leaf *)t22)->nw)) ;
+   }
+   w.gsp = sp ;
+   return save(w, n) ;
+}
+leaf *hlifealgo::dorecurs_leaf(hlifeworker &w, leaf *n, leaf *ne, leaf *t,
+                               leaf *e) {
+   unsigned short
+   t00 = n->res2,
+   t01 = find_leaf(w, n->ne, ne->nw, n->se, ne->sw)->res2,
+   t02 = ne->res2,
+   t10 = find_leaf(w, n->sw, n->se, t->nw, t->ne)->res2,
+   t11 = find_leaf(w, n->se, ne->sw, t->ne, e->nw)->res2,
+   t12 = find_leaf(w, ne->sw, ne->se, e->nw, e->ne)->res2,
+   t20 = t->res2,
+   t21 = find_leaf(w, t->ne, e->nw, t->se, e->sw)->res2,
+   t22 = e->res2 ;
+   return find_leaf(w, find_leaf(w, t00, t01, t10, t11)->res2,
+                       find_leaf(w, t01, t02, t11, t12)->res2,
+                       find_leaf(w, t10, t11, t20, t21)->res2,
+                       find_leaf(w, t11, t12, t21, t22)->res2) ;
+}
+leaf *hlifealgo::dorecurs_leaf_half(hlifeworker &w, leaf *n, leaf *ne,
+                                    leaf *t, leaf *e) {
+   unsigned short
+   t00 = n->res2,
+   t01 = find_leaf(w, n->ne, ne->nw, n->se, ne->sw)->res2,
+   t02 = ne->res2,
+   t10 = find_leaf(w, n->sw, n->se, t->nw, t->ne)->res2,
+   t11 = find_leaf(w, n->se, ne->sw, t->ne, e->nw)->res2,
+   t12 = find_leaf(w, ne->sw, ne->se, e->nw, e->ne)->res2,
+   t20 = t->res2,
+   t21 = find_leaf(w, t->ne, e->nw, t->se, e->sw)->res2,
+   t22 = e->res2 ;
+   return find_leaf(w, combine4(t00, t01, t10, t11),
+                       combine4(t01, t02, t11, t12),
+                       combine4(t10, t11, t20, t21),
+                       combine4(t11, t12, t21, t22)) ;
+}
+leaf *hlifealgo::dorecurs_leaf_quarter(hlifeworker &w, leaf *n, leaf *ne,
+                                       leaf *t, leaf *e) {
+   unsigned short
+   t00 = n->res1,
+   t01 = find_leaf(w, n->ne, ne->nw, n->se, ne->sw)->res1,
+   t02 = ne->res1,
+   t10 = find_leaf(w, n->sw, n->se, t->nw, t->ne)->res1,
+   t11 = find_leaf(w, n->se, ne->sw, t->ne, e->nw)->res1,
+   t12 = find_leaf(w, ne->sw, ne->se, e->nw, e->ne)->res1,
+   t20 = t->res1,
+   t21 = find_leaf(w, t->ne, e->nw, t->se, e->sw)->res1,
+   t22 = e->res1 ;
+   return find_leaf(w, combine4(t00, t01, t10, t11),
+                       combine4(t01, t02, t11, t12),
+                       combine4(t10, t11, t20, t21),
+                       combine4(t11, t12, t21, t22)) ;
+}
 /* Returns the center 4-square of an 8x8 leaf node. */
 static unsigned short unpack4x4center(leaf *leaf) {
    return combine4(leaf->nw, leaf->ne, leaf->sw, leaf->se);
@@ -1637,7 +3024,7 @@ static unsigned short unpack4x4center(leaf *leaf) {
 const char *hlifealgo::readmacrocell(char *line) {
    int n=0 ;
    g_uintptr_t i=1, nw=0, ne=0, sw=0, se=0, indlen=0 ;
-   int r, d ;
+   int d ;
    node **ind = 0 ;
    root = 0 ;
    while (getline(line, 10000)) {
@@ -1776,7 +3163,13 @@ default:       return "Illegal character in readmacrocell." ;
 	    break ;
          }
       } else {
-         n = sscanf(line, "%d %" PRIuPTR " %" PRIuPTR " %" PRIuPTR " %" PRIuPTR " %d", &d, &nw, &ne, &sw, &se, &r) ;
+         g_uintptr_t vals[6] = { 0 } ;
+         n = getmcnumbers(line, vals, 6) ;
+         d = n > 0 && vals[0] < 0x10000 ? (int)vals[0] : 0 ;
+         nw = vals[1] ;
+         ne = vals[2] ;
+         sw = vals[3] ;
+         se = vals[4] ;
          if (n < 0) // blank line; permit
             continue ;
          if (n == 0) {
@@ -1915,10 +3308,10 @@ g_uintptr_t hlifealgo::writecell(std::ostream &os, node *root, int depth) {
       return 0 ;
    if (depth == 2) {
       if (root->nw != 0)
-         return (g_uintptr_t)(root->nw) ;
+         return linkval(root->nw) ;
    } else {
       if (marked2(root))
-         return (g_uintptr_t)(root->next) ;
+         return linkval(root->next) ;
       unhash_node2(root) ;
       mark2(root) ;
    }
@@ -1927,7 +3320,7 @@ g_uintptr_t hlifealgo::writecell(std::ostream &os, node *root, int depth) {
       unsigned int top, bot ;
       leaf *n = (leaf *)root ;
       thiscell = ++cellcounter ;
-      root->nw = (node *)thiscell ;
+      setlinkval(root->nw, thiscell) ;
       unpack8x8(n->nw, n->ne, n->sw, n->se, &top, &bot) ;
       for (j=7; (top | bot) && j>=0; j--) {
          int bits = (top >> 24) ;
@@ -1947,7 +3340,7 @@ g_uintptr_t hlifealgo::writecell(std::ostream &os, node *root, int depth) {
       g_uintptr_t sw = writecell(os, root->sw, depth-1) ;
       g_uintptr_t se = writecell(os, root->se, depth-1) ;
       thiscell = ++cellcounter ;
-      root->next = (node *)thiscell ;
+      setlinkval(root->next, thiscell) ;
       os << depth+1 << ' ' << nw << ' ' << ne << ' ' << sw << ' ' << se << '\n';
    }
    return thiscell ;
@@ -1963,10 +3356,10 @@ g_uintptr_t hlifealgo::writecell_2p1(node *root, int depth) {
       return 0 ;
    if (depth == 2) {
       if (root->nw != 0)
-         return (g_uintptr_t)(root->nw) ;
+         return linkval(root->nw) ;
    } else {
       if (marked2(root))
-         return (g_uintptr_t)(root->next) ;
+         return linkval(root->next) ;
       unhash_node2(root) ;
       mark2(root) ;
    }
@@ -1975,7 +3368,7 @@ g_uintptr_t hlifealgo::writecell_2p1(node *root, int depth) {
       // note:  we *must* not abort this prescan
       if ((cellcounter & 4095) == 0)
          lifeabortprogress(0, "Scanning tree") ;
-      root->nw = (node *)thiscell ;
+      setlinkval(root->nw, thiscell) ;
    } else {
       writecell_2p1(root->nw, depth-1) ;
       writecell_2p1(root->ne, depth-1) ;
@@ -1985,7 +3378,7 @@ g_uintptr_t hlifealgo::writecell_2p1(node *root, int depth) {
       // note:  we *must* not abort this prescan
       if ((cellcounter & 4095) == 0)
          lifeabortprogress(0, "Scanning tree") ;
-      root->next = (node *)thiscell ;
+      setlinkval(root->next, thiscell) ;
    }
    return thiscell ;
 }
@@ -1999,8 +3392,8 @@ g_uintptr_t hlifealgo::writecell_2p2(std::ostream &os, node *root, int depth) {
    if (root == zeronode(depth))
       return 0 ;
    if (depth == 2) {
-      if (cellcounter + 1 != (g_uintptr_t)(root->nw))
-         return (g_uintptr_t)(root->nw) ;
+      if (cellcounter + 1 != linkval(root->nw))
+         return linkval(root->nw) ;
       thiscell = ++cellcounter ;
       if ((cellcounter & 4095) == 0) {
          std::streampos siz = os.tellp();
@@ -2010,7 +3403,7 @@ g_uintptr_t hlifealgo::writecell_2p2(std::ostream &os, node *root, int depth) {
       int i, j ;
       unsigned int top, bot ;
       leaf *n = (leaf *)root ;
-      root->nw = (node *)thiscell ;
+      setlinkval(root->nw, thiscell) ;
       unpack8x8(n->nw, n->ne, n->sw, n->se, &top, &bot) ;
       for (j=7; (top | bot) && j>=0; j--) {
          int bits = (top >> 24) ;
@@ -2025,16 +3418,16 @@ g_uintptr_t hlifealgo::writecell_2p2(std::ostream &os, node *root, int depth) {
       }
       os << '\n' ;
    } else {
-      if (cellcounter + 1 > (g_uintptr_t)(root->next) || isaborted())
-         return (g_uintptr_t)(root->next) ;
+      if (cellcounter + 1 > linkval(root->next) || isaborted())
+         return linkval(root->next) ;
       g_uintptr_t nw = writecell_2p2(os, root->nw, depth-1) ;
       g_uintptr_t ne = writecell_2p2(os, root->ne, depth-1) ;
       g_uintptr_t sw = writecell_2p2(os, root->sw, depth-1) ;
       g_uintptr_t se = writecell_2p2(os, root->se, depth-1) ;
       if (!isaborted() &&
-          cellcounter + 1 != (g_uintptr_t)(root->next)) { // this should never happen
+          cellcounter + 1 != linkval(root->next)) { // this should never happen
          lifefatal("Internal in writecell_2p2") ;
-         return (g_uintptr_t)(root->next) ;
+         return linkval(root->next) ;
       }
       thiscell = ++cellcounter ;
       if ((cellcounter & 4095) == 0) {
@@ -2042,7 +3435,7 @@ g_uintptr_t hlifealgo::writecell_2p2(std::ostream &os, node *root, int depth) {
          sprintf(progressmsg, "File size: %.2f MB", double(siz) / 1048576.0) ;
          lifeabortprogress(thiscell/(double)writecells, progressmsg) ;
       }
-      root->next = (node *)thiscell ;
+      setlinkval(root->next, thiscell) ;
       os << depth+1 << ' ' << nw << ' ' << ne << ' ' << sw << ' ' << se << '\n';
    }
    return thiscell ;
@@ -2115,7 +3508,7 @@ const char *hlifealgo::writeNativeFormat(std::ostream &os, char *comments) {
      for (int i=0; i<timeline.framecount; i++) {
        node *frame = (node*)timeline.frames[i] ;
        writecell_2p2(os, frame, depths[i]) ;
-       os << "#FRAME " << i << ' ' << (g_uintptr_t)frame->next << '\n' ;
+       os << "#FRAME " << i << ' ' << linkval(frame->next) << '\n' ;
      }
    }
    writecell_2p2(os, root, depth) ;
@@ -6,6 +6,8 @@
 #include "lifealgo.h"
 #include "liferules.h"
 #include "util.h"
+#include <unordered_map>
+#include <list>
 /*
  *   Into instances of this node structure is where almost all of the
  *   memory allocated by this program goes.  Thus, it is imperative we
@@ -92,10 +94,47 @@
  *   this together, and you get the following structure for the 16-squares
  *   and larger:
  */
+struct node ;
+/*
+ *   On 64-bit platforms those six pointers cost 48 bytes a node, so when
+ *   COMPACTNODES is defined (see platform.h) all the nodes and leaves
+ *   of every universe live in one big reserved arena instead, and the
+ *   links are 32-bit slot numbers into that arena.  Slot zero is never
+ *   handed out, so a zero link is still a null pointer.  The top two
+ *   bits are left free for the mark bits the gc and the traversal
+ *   routines hang on the next and res fields, which limits the arena
+ *   to 2**30 slots (24GB of nodes).  A noderef behaves like a node *
+ *   almost everywhere, so the rest of the code doesn't care which
+ *   representation it's getting.
+ */
+#ifdef COMPACTNODES
+#define NODESLOT (24)
+#define MAXARENASLOTS ((g_uintptr_t)1 << 30)
+extern char *hlifearena ;
+struct leaf ;
+struct noderef {
+   unsigned int i ;
+   noderef() = default ;
+   noderef(node *p) : i(p ? (unsigned int)(((char *)p - hlifearena) / NODESLOT) : 0) {}
+   static node *at(unsigned int i) {
+      return i ? (node *)(hlifearena + (g_uintptr_t)i * NODESLOT) : 0 ;
+   }
+   operator node *() const { return at(i) ; }
+   node *operator->() const { return (node *)(hlifearena + (g_uintptr_t)i * NODESLOT) ; }
+   explicit operator leaf *() const { return (leaf *)at(i) ; }
+   // comparing two refs doesn't need to look them up
+   bool operator==(const noderef &r) const { return i == r.i ; }
+   bool operator!=(const noderef &r) const { return i != r.i ; }
+   bool operator==(node *p) const { return at(i) == p ; }
+   bool operator!=(node *p) const { return at(i) != p ; }
+} ;
+#else
+typedef node *noderef ;
+#endif
 struct node {
-   node *next ;              /* hash link */
-   node *nw, *ne, *sw, *se ; /* constant; nw != 0 means nonleaf */
-   node *res ;               /* cache */
+   noderef next ;            /* hash link */
+   noderef nw, ne, sw, se ;  /* constant; nw != 0 means nonleaf */
+   noderef res ;             /* cache */
 } ;
 /*
  *   For the 8-squares, we do not have `children', we have actual data
@@ -121,11 +160,11 @@ struct node {
  *   so on.
  */
 struct leaf {
-   node *next ;              /* hash link */
-   node *isnode ;            /* must always be zero for leaves */
+   noderef next ;            /* hash link */
+   noderef isnode ;          /* must always be zero for leaves */
    unsigned short nw, ne, sw, se ;  /* constant */
-   bigint leafpop ;         /* how many set bits */
    unsigned short res1, res2 ;      /* constant */
+   unsigned short leafpop ;         /* how many set bits */
 } ;
 /*
  *   If it is a struct node, this returns a non-zero value, otherwise it
@@ -139,10 +178,27 @@ struct leaf {
 #ifdef USEPREFETCH
 struct setup_t { 
    g_uintptr_t h ;
-   struct node *nw, *ne, *sw, *se ;
+   noderef nw, ne, sw, se ;
    void prefetch(node **addr) const { PREFETCH(addr) ; }
 } ;
 #endif
+/*
+ *   When we step with more than one thread, each thread gets one of
+ *   these:  its own gc stack and a small private list of free nodes.
+ *   Everything else (the hash table and the node blocks) is shared;
+ *   see the multithreading section of hlifealgo.cpp.
+ */
+struct hlifeworker {
+   int index ;
+   node **stack ;
+   int gsp, stacksize ;
+   node *freenodes ;
+   int nest ;                 // nesting depth of tasks we are running
+   int halvesdone ;
+   g_uintptr_t inserted ;     // nodes hashed since our last report
+} ;
+struct hlifemt ;
+struct hlifetask ;
 /**
  *   Our hlifealgo class.
  */
@@ -151,6 +207,7 @@ public:
    hlifealgo() ;
    virtual ~hlifealgo() ;
    virtual int setcell(int x, int y, int newstate) ;
+   virtual int setrowcell(int x, int y, int newstate) ;
    virtual int getcell(int x, int y) ;
    virtual int nextcell(int x, int y, int &state) ;
    virtual void endofpattern() ;
@@ -162,6 +219,7 @@ public:
    virtual int hyperCapable() { return 1 ; }
    virtual void setMaxMemory(int m) ;
    virtual int getMaxMemory() { return (int)(maxmem >> 20) ; }
+   virtual void setNumThreads(int n) ;
    virtual const char *setrule(const char *s) ;
    virtual const char *getrule() { return hliferules.getrule() ; }
    virtual void step() ;
@@ -178,6 +236,14 @@ public:
    virtual void findedges(bigint *t, bigint *l, bigint *b, bigint *r) ;
    virtual const char *readmacrocell(char *line) ;
    virtual const char *writeNativeFormat(std::ostream &os, char *comments) ;
+   virtual unsigned long long getRectHash(int x, int y, int wd, int ht) ;
+   virtual unsigned long long getPatternHash() ;
+   virtual int setcells(const int *cells, int count, bool withstates) ;
+   virtual int putrect(const lifecellrect &r) ;
+   virtual void visitcells(lifecellvisitor &v, int x, int y, int wd, int ht) ;
+   virtual int visitrows(liferowvisitor &v, const bigint &top,
+                         const bigint &left, const bigint &bottom,
+                         const bigint &right) ;
    static void doInitializeAlgoInfo(staticAlgoInfo &) ;
 private:
 /*
@@ -214,6 +280,7 @@ private:
    g_uintptr_t alloced, maxmem ;
    node *freenodes ;
    int okaytogc ;
+   int agecache ; // may the next gc drop cold cache entries?
    g_uintptr_t totalthings ;
    node *nodeblocks ;
    char *ruletable ;
@@ -234,22 +301,55 @@ private:
    char *llxb, *llyb ;
    int hashed ;
    int cacheinvalid ;
+   std::unordered_map<node *, unsigned long long> popmemo ; // pruned by gc
+   std::unordered_map<node *, bigint> bigpopmemo ; // the same, deeper nodes
+   std::unordered_map<node *, unsigned long long> hashcache ; // by gc
+   /*
+    *   Rendered tiles, most recently drawn first, for the nodes that
+    *   drawnode renders as whole bitmaps; keyed by node and mag and
+    *   pruned by gc (see hlifedraw.cpp).
+    */
+   typedef std::pair<node *, int> tilekey ;
+   struct tilekeyhash {
+      size_t operator()(const tilekey &k) const {
+         return std::hash<node *>()(k.first) ^ (size_t)k.second ;
+      }
+   } ;
+   typedef std::list<std::pair<tilekey, std::vector<unsigned int> > > tilelist ;
+   tilelist tiles ;
+   std::unordered_map<tilekey, tilelist::iterator, tilekeyhash> tilemap ;
+   drawdamage damaged ; // screen tiles of the last draw, keyed by node
    g_uintptr_t cellcounter ; // used when writing
    g_uintptr_t writecells ; // how many to write
    int gccount ; // how many gcs total this pattern
    int gcstep ; // how many gcs this step
+   /*
+    *   Bottom-up loading (see setrowcell).  rowcells holds the cells
+    *   (x, row within the band, state) of the current band of leaf
+    *   rows, and rowpend[d] the last pair of bands of nodes of depth d
+    *   not yet joined into a band of depth d+1.
+    */
+   struct rowbandnodes {
+      rowbandnodes() : pair(0) {}
+      long long pair ;
+      std::vector<std::pair<long long, node *> > half[2] ;
+   } ;
+   int rowsmode ;
+   long long rowband ;
+   std::vector<int> rowcells ;
+   std::vector<rowbandnodes> rowpend ;
    hperf running_hperf, step_hperf, inc_hperf ;
    int softinterrupt ;
    static char statusline[] ;
 //
    void leafres(leaf *n) ;
    void resize() ;
-   node *find_node(node *nw, node *ne, node *sw, node *se) ;
+   node *find_node(noderef nw, noderef ne, noderef sw, noderef se) ;
 #ifdef USEPREFETCH
    node *find_node(setup_t &su) ;
-   void setupprefetch(setup_t &su, node *nw, node *ne, node *sw, node *se) ;
+   void setupprefetch(setup_t &su, noderef nw, noderef ne, noderef sw,
+                      noderef se) ;
 #endif
-   void unhash_node(node *n) ;
    void unhash_node2(node *n) ;
    void rehash_node(node *n) ;
    leaf *find_leaf(unsigned short nw, unsigned short ne,
@@ -272,10 +372,34 @@ private:
    node *gsetbit(node *n, int x, int y, int newstate, int depth) ;
    int getbit(node *n, int x, int y, int depth) ;
    int nextbit(node *n, int x, int y, int depth) ;
+   unsigned long long nodehash(node *n, int depth) ;
+   unsigned long long recthash(node *n, int depth, long long x, long long y,
+                               const long long *r) ;
+   void growroot(int left, int top, int right, int bottom) ;
+   node *middlenode(node &tnode, int &mdepth) ;
+   node *setmiddle(node *n, int depth, node *m) ;
+   node *setcellsnode(node *n, int depth, long long x, long long y,
+                      int *cells, int *scratch, int count) ;
+   node *putrectnode(node *n, int depth, long long x, long long y,
+                     const lifecellrect &r) ;
+   void visitnode(node *n, int depth, long long x, long long y,
+                  const long long *r, lifecellvisitor &v) ;
+   void flushrowband() ;
+   void pushrowband(int depth, long long band,
+                    std::vector<std::pair<long long, node *> > &nodes) ;
+   void joinrowbands(int depth) ;
+   node *putnode(node *n, int depth, long long x, long long y, node *sub,
+                 int subdepth, long long sx, long long sy) ;
+   void endrows() ;
+   bool rowstrip(std::vector<std::pair<long long, node *> > &strip,
+                 int depth, long long y, long long wd, long long ht,
+                 liferowvisitor &v) ;
    node *hashpattern(node *root, int depth) ;
    node *popzeros(node *n) ;
-   const bigint &calcpop(node *root, int depth) ;
-   void aftercalcpop2(node *root, int depth) ;
+   unsigned long long calcpop(node *root, int depth) ;
+   const bigint &calcbigpop(node *root, int depth) ;
+   void prunepops() ;
+   void prunetiles() ;
    void afterwritemc(node *root, int depth) ;
    void calcPopulation() ;
    node *save(node *n) ;
@@ -291,6 +415,9 @@ private:
    int log2(unsigned int n) ;
    node *runpattern() ;
    void renderbm(int x, int y) ;
+   int needbm(int x, int y, node *n) ;
+   bool gettile(node *n) ;
+   void puttile(node *n) ;
    void fill_ll(int d) ;
    void drawnode(node *n, int llx, int lly, int depth, node *z) ;
    void ensure_hashed() ;
@@ -301,5 +428,36 @@ private:
                   unsigned short sw, unsigned short se,
                   unsigned int *top, unsigned int *bot) ;
    liferules hliferules ;
+   /*
+    *   Multithreaded stepping.  These mirror the routines above but
+    *   take the calling thread's worker state.
+    */
+   friend struct hlifetask ;
+   hlifemt *mt ;
+   void newblock() ;
+   void deletethreads() ;
+   node *runparallel(node *n, int depth) ;
+   void runtask(hlifetask &t, int worker) ;
+   void enterworker(hlifeworker &w) ;
+   void leaveworker(hlifeworker &w) ;
+   void safepoint(hlifeworker &w) ;
+   void refill(hlifeworker &w) ;
+   void countinserted(hlifeworker &w) ;
+   node *save(hlifeworker &w, node *n) ;
+   node *find_node(hlifeworker &w, noderef nw, noderef ne, noderef sw,
+                   noderef se) ;
+   leaf *find_leaf(hlifeworker &w, unsigned short nw, unsigned short ne,
+                   unsigned short sw, unsigned short se) ;
+   node *getres(hlifeworker &w, node *n, int depth) ;
+   void getresn(hlifeworker &w, node **in, node **out, int cnt, int depth) ;
+   node *dorecurs(hlifeworker &w, node *n, node *ne, node *t, node *e,
+                  int depth) ;
+   node *dorecurs_half(hlifeworker &w, node *n, node *ne, node *t, node *e,
+                       int depth) ;
+   leaf *dorecurs_leaf(hlifeworker &w, leaf *n, leaf *ne, leaf *t, leaf *e) ;
+   leaf *dorecurs_leaf_half(hlifeworker &w, leaf *n, leaf *ne, leaf *t,
+                            leaf *e) ;
+   leaf *dorecurs_leaf_quarter(hlifeworker &w, leaf *n, leaf *ne, leaf *t,
+                               leaf *e) ;
 } ;
 #endif
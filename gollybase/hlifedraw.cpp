@@ -29,6 +29,11 @@ static unsigned char liver, liveg, liveb, livea;
 // rowett: RGBA view of cell states
 static unsigned int liveRGBA, deadRGBA;
 
+// the 8 state bytes and the 8 RGBA words each bigbuf byte expands to
+static unsigned char statebits[256][8] ;
+static unsigned int rgbabits[256][8] ;
+static unsigned int rgbalive, rgbadead ;
+
 static void drawpixel(int x, int y) {
   bigbuf[(((bmsize-1)-y) << (logbmsize-3)) + (x >> 3)] |= (128 >> (x & 7)) ;
 }
@@ -97,15 +102,8 @@ void hlifealgo::renderbm(int x, int y) {
       unsigned char *pixptr = pixbuf;
 
       for (int i = 0; i < ibufsize * 4; i++) {
-         unsigned char byte = *bigptr++;
-         *pixptr++ = (byte & 128) ? 1 : 0;
-         *pixptr++ = (byte & 64) ? 1 : 0;
-         *pixptr++ = (byte & 32) ? 1 : 0;
-         *pixptr++ = (byte & 16) ? 1 : 0;
-         *pixptr++ = (byte & 8) ? 1 : 0;
-         *pixptr++ = (byte & 4) ? 1 : 0;
-         *pixptr++ = (byte & 2) ? 1 : 0;
-         *pixptr++ = (byte & 1);   // no condition needed
+         memcpy(pixptr, statebits[*bigptr++], 8) ;
+         pixptr += 8 ;
       }
    } else {
       // convert each bigbuf byte into 32 bytes of pixel data (8 * RGBA)
@@ -113,15 +111,8 @@ void hlifealgo::renderbm(int x, int y) {
       unsigned int *pixptr = (unsigned int *)pixbuf;
 
       for (int i = 0; i < ibufsize * 4; i++) {
-         unsigned char byte = *bigptr++;
-         *pixptr++ = (byte & 128) ? liveRGBA : deadRGBA;
-         *pixptr++ = (byte & 64) ? liveRGBA : deadRGBA;
-         *pixptr++ = (byte & 32) ? liveRGBA : deadRGBA;
-         *pixptr++ = (byte & 16) ? liveRGBA : deadRGBA;
-         *pixptr++ = (byte & 8) ? liveRGBA : deadRGBA;
-         *pixptr++ = (byte & 4) ? liveRGBA : deadRGBA;
-         *pixptr++ = (byte & 2) ? liveRGBA : deadRGBA;
-         *pixptr++ = (byte & 1) ? liveRGBA : deadRGBA;
+         memcpy(pixptr, rgbabits[*bigptr++], 32) ;
+         pixptr += 8 ;
       }
    }
    if (renderer->justState())
@@ -132,6 +123,55 @@ void hlifealgo::renderbm(int x, int y) {
    memset(bigbuf, 0, sizeof(ibigbuf)) ;
 }
 
+/*
+ *   Tell the damage tracker about the bitmap renderbm is about to draw
+ *   at x,y showing node n (0 if it isn't a single node), and return
+ *   whether it needs drawing at all.  A node that is exactly bmsize
+ *   pixels across always lands on the same screen tile for a given
+ *   view, since nodes are aligned, so an unchanged tile still shows
+ *   the same node and the previous frame already has its pixels.
+ */
+int hlifealgo::needbm(int x, int y, node *n) {
+   int rw = bmsize * pmag ;
+   return damaged.redraw(x * pmag, uviewh - y * pmag - rw, rw, rw,
+                         (G_INT64)(g_uintptr_t)n) ;
+}
+
+/*
+ *   A node that is exactly bmsize pixels across always draws the
+ *   same bitmap, wherever it lands on the screen, and since nodes
+ *   are canonical the node and mag identify that bitmap.  So we keep
+ *   the bitmaps of the most recently drawn such nodes and copy them
+ *   back into bigbuf when the node shows up again; panning around a
+ *   pattern built from repeated subpatterns then costs a copy per
+ *   screen tile rather than a descent.  Gc drops the tiles of the
+ *   nodes it frees (see prunetiles).
+ */
+const size_t MAXTILES = 1024 ;            // 8MB of 256x256 bitmaps
+
+bool hlifealgo::gettile(node *n) {
+   std::unordered_map<tilekey, tilelist::iterator, tilekeyhash>::iterator it =
+                                              tilemap.find(tilekey(n, mag)) ;
+   if (it == tilemap.end())
+      return false ;
+   tiles.splice(tiles.begin(), tiles, it->second) ;
+   memcpy(ibigbuf, &tiles.front().second[0], sizeof(ibigbuf)) ;
+   return true ;
+}
+
+void hlifealgo::puttile(node *n) {
+   if (tiles.size() >= MAXTILES) {
+      // reuse the least recently drawn
+      tilemap.erase(tiles.back().first) ;
+      tiles.splice(tiles.begin(), tiles, --tiles.end()) ;
+   } else {
+      tiles.push_front(make_pair(tilekey(), vector<unsigned int>(ibufsize))) ;
+   }
+   tiles.front().first = tilekey(n, mag) ;
+   memcpy(&tiles.front().second[0], ibigbuf, sizeof(ibigbuf)) ;
+   tilemap[tiles.front().first] = tiles.begin() ;
+}
+
 /*
  *   Here, llx and lly are coordinates in screen pixels describing
  *   where the lower left pixel of the screen is.  Draw one node.
@@ -149,10 +189,15 @@ void hlifealgo::drawnode(node *n, int llx, int lly, int depth, node *z) {
       sw >>= 1 ;
       depth-- ;
       if (sw == (bmsize >> 1)) {
-         drawnode(n->sw, 0, 0, depth, z) ;
-         drawnode(n->se, -(bmsize/2), 0, depth, z) ;
-         drawnode(n->nw, 0, -(bmsize/2), depth, z) ;
-         drawnode(n->ne, -(bmsize/2), -(bmsize/2), depth, z) ;
+         if (!needbm(-llx, -lly, n))
+            return ;
+         if (!gettile(n)) {
+            drawnode(n->sw, 0, 0, depth, z) ;
+            drawnode(n->se, -(bmsize/2), 0, depth, z) ;
+            drawnode(n->nw, 0, -(bmsize/2), depth, z) ;
+            drawnode(n->ne, -(bmsize/2), -(bmsize/2), depth, z) ;
+            puttile(n) ;
+         }
          renderbm(-llx, -lly) ;
       } else {
          drawnode(n->sw, llx, lly, depth, z) ;
@@ -217,6 +262,19 @@ static void init_compress4x4() {
    for (i=0; i<256; i++)
       if (i & (i-1))
          compress4x4[i] = compress4x4[i & (i-1)] | compress4x4[i & -i] ;
+   for (i=0; i<256; i++)
+      for (int j=0; j<8; j++)
+         statebits[i][j] = (unsigned char)((i >> (7 - j)) & 1) ;
+}
+
+static void init_rgbabits() {
+   if (rgbalive == liveRGBA && rgbadead == deadRGBA)
+      return ;
+   for (int i=0; i<256; i++)
+      for (int j=0; j<8; j++)
+         rgbabits[i][j] = (i & (128 >> j)) ? liveRGBA : deadRGBA ;
+   rgbalive = liveRGBA ;
+   rgbadead = deadRGBA ;
 }
 
 /*
@@ -261,6 +319,7 @@ void hlifealgo::draw(viewport &viewarg, liferender &rendererarg) {
       *colptr++ = deadg;
       *colptr++ = deadb;
       *colptr++ = deada;
+      init_rgbabits() ;
    }
 
    view = &viewarg ;
@@ -282,6 +341,7 @@ void hlifealgo::draw(viewport &viewarg, liferender &rendererarg) {
       viewh = uviewh ;
       vieww = uvieww ;
    }
+   damaged.begin(*renderer, *view) ;
    int d = depth ;
    fill_ll(d) ;
    int maxd = vieww ;
@@ -342,6 +402,10 @@ void hlifealgo::draw(viewport &viewarg, liferender &rendererarg) {
       llx = (llx << 1) + llxb[i] ;
       lly = (lly << 1) + llyb[i] ;
    }
+   /*
+    *   Each way of drawing below puts its bitmaps in different places,
+    *   so it sets a different layout for the damage tracker.
+    */
    /* clear the border *around* the universe if necessary */
    if (d + 1 <= mag) {
       node *z = zeronode(d) ;
@@ -349,6 +413,8 @@ void hlifealgo::draw(viewport &viewarg, liferender &rendererarg) {
           (sw == z && se == z && nw == z && ne == z)) {
          // no live cells
       } else {
+         damaged.layout(1 + 4 * (llx + 16777216 * (G_INT64)lly)) ;
+         needbm(-llx, -lly, 0) ;
          drawpixel(0, 0) ;
          renderbm(-llx, -lly) ;
       }
@@ -356,13 +422,17 @@ void hlifealgo::draw(viewport &viewarg, liferender &rendererarg) {
       z = zeronode(d) ;
       maxd = 1 << (d - mag + 2) ;
       if (maxd <= bmsize) {
+         damaged.layout(2 + 4 * (llx + 16777216 * (G_INT64)lly)) ;
          maxd >>= 1 ;
          drawnode(sw, 0, 0, d, z) ;
          drawnode(se, -maxd, 0, d, z) ;
          drawnode(nw, 0, -maxd, d, z) ;
          drawnode(ne, -maxd, -maxd, d, z) ;
+         needbm(-llx, -lly, 0) ;
          renderbm(-llx, -lly) ;
       } else {
+         // tiles are aligned to the root, so they stay put until it grows
+         damaged.layout(4 * (G_INT64)depth) ;
          maxd >>= 1 ;
          drawnode(sw, llx, lly, d, z) ;
          drawnode(se, llx-maxd, lly, d, z) ;
@@ -371,6 +441,7 @@ void hlifealgo::draw(viewport &viewarg, liferender &rendererarg) {
       }
    }
 bail:
+   damaged.end() ;
    renderer = 0 ;
    view = 0 ;
 }
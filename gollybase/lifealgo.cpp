@@ -4,6 +4,7 @@
 #include "lifealgo.h"
 #include "util.h"       // for lifestatus
 #include "string.h"
+#include <string>
 using namespace std ;
 lifealgo::~lifealgo() {
    poller = 0 ;
@@ -884,6 +885,240 @@ void lifealgo::getcells(unsigned char *buf, int x, int y, int w, int h) {
    draw(vp, hsr) ;
 }
 
+int lifealgo::setcells(const int *cells, int count, bool withstates) {
+   int r = 0 ;
+   int step = withstates ? 3 : 2 ;
+   for (int i=0; i<count; i++, cells += step)
+      if (setcell(cells[0], cells[1], withstates ? cells[2] : 1) < 0)
+         r = -1 ;
+   return r ;
+}
+
+class cellcollector : public lifecellvisitor {
+public:
+   virtual void cell(int x, int y, int) {
+      xy.push_back(x) ;
+      xy.push_back(y) ;
+   }
+   vector<int> xy ;
+} ;
+
+int lifealgo::putrect(const lifecellrect &r) {
+   // clear the live cells first, so the empty parts of the rect cost
+   // nothing even in algorithms that allocate when a cell is set
+   cellcollector live ;
+   visitcells(live, r.x, r.y, r.wd, r.ht) ;
+   for (size_t i=0; i<live.xy.size(); i+=2)
+      setcell(live.xy[i], live.xy[i+1], 0) ;
+   int err = 0 ;
+   for (int j=0; j<r.ht; j++)
+      for (int i=0; i<r.wd; i++) {
+         int state = r.get(i, j) ;
+         if (state && setcell(r.x + i, r.y + j, state) < 0)
+            err = -1 ;
+      }
+   return err ;
+}
+
+class bitmapwriter : public lifecellvisitor {
+public:
+   bitmapwriter(unsigned char *b, int xarg, int yarg, int w) :
+      bits(b), x(xarg), y(yarg), rowbytes(((size_t)w + 7) >> 3) {}
+   virtual void cell(int cx, int cy, int) {
+      cx -= x ;
+      bits[(cy - y) * rowbytes + (cx >> 3)] |= (unsigned char)(0x80 >> (cx & 7)) ;
+   }
+   unsigned char *bits ;
+   int x, y ;
+   size_t rowbytes ;
+} ;
+
+void lifealgo::getbitmap(unsigned char *bits, int x, int y, int wd, int ht) {
+   if (wd <= 0 || ht <= 0)
+      return ;
+   bitmapwriter w(bits, x, y, wd) ;
+   memset(bits, 0, w.rowbytes * ht) ;
+   visitcells(w, x, y, wd, ht) ;
+}
+
+void lifealgo::visitcells(lifecellvisitor &v, int x, int y, int wd, int ht) {
+   int right = x + wd - 1 ;
+   int bottom = y + ht - 1 ;
+   int state = 0 ;
+   for (int cy=y; cy<=bottom; cy++) {
+      for (int cx=x; cx<=right; cx++) {
+         int skip = nextcell(cx, cy, state) ;
+         if (skip < 0 || skip > right - cx)
+            break ;
+         cx += skip ;
+         v.cell(cx, cy, state) ;
+      }
+   }
+}
+
+int lifealgo::visitallcells(lifecellvisitor &v) {
+   if (isEmpty())
+      return 0 ;
+   bigint top, left, bottom, right ;
+   findedges(&top, &left, &bottom, &right) ;
+   if (top < bigint::min_coord || left < bigint::min_coord ||
+       bottom > bigint::max_coord || right > bigint::max_coord)
+      return -1 ;
+   // a pattern wider or taller than an int can count is done in pieces
+   const long long piece = 1 << 30 ;
+   long long r = right.toint(), b = bottom.toint() ;
+   for (long long y=top.toint(); y<=b; y+=piece)
+      for (long long x=left.toint(); x<=r; x+=piece)
+         visitcells(v, (int)x, (int)y,
+                    (int)(r - x + 1 < piece ? r - x + 1 : piece),
+                    (int)(b - y + 1 < piece ? b - y + 1 : piece)) ;
+   return 0 ;
+}
+
+/*
+ *   Is a rect (edges inclusive) small enough for visitrows?  If so,
+ *   return its size.
+ */
+bool lifealgo::rowsize(const bigint &top, const bigint &left,
+                       const bigint &bottom, const bigint &right,
+                       long long &wd, long long &ht) {
+   static const bigint limit(G_MAKEINT64(1) << 60) ;
+   bigint w = right ;
+   w -= left ;
+   bigint h = bottom ;
+   h -= top ;
+   if (w >= limit || h >= limit)
+      return false ;
+   wd = w.toint64() + 1 ;
+   ht = h.toint64() + 1 ;
+   return true ;
+}
+
+int lifealgo::visitrows(liferowvisitor &v, const bigint &top,
+                        const bigint &left, const bigint &bottom,
+                        const bigint &right) {
+   long long wd, ht ;
+   if (!rowsize(top, left, bottom, right, wd, ht))
+      return -1 ;
+   if (wd <= 0 || ht <= 0)
+      return 0 ;
+   // nextcell can't get at cells beyond the editing limits
+   if (top < bigint::min_coord || left < bigint::min_coord ||
+       bottom > bigint::max_coord || right > bigint::max_coord)
+      return -1 ;
+   int x0 = left.toint(), x1 = right.toint() ;
+   int y0 = top.toint(), y1 = bottom.toint() ;
+   int state = 0 ;
+   for (int y=y0; y<=y1; y++) {
+      for (int x=x0; x<=x1; x++) {
+         int skip = nextcell(x, y, state) ;
+         if (skip < 0 || skip > x1 - x)
+            break ;
+         x += skip ;
+         if (!v.cell((long long)x - x0, (long long)y - y0, state))
+            return 1 ;
+      }
+   }
+   return 0 ;
+}
+
+unsigned long long lifealgo::getRectHash(int x, int y, int wd, int ht) {
+   unsigned long long h = 0 ;
+   int right = x + wd - 1 ;
+   int bottom = y + ht - 1 ;
+   int v = 0 ;
+   for (int cy=y; cy<=bottom; cy++) {
+      unsigned long long rowh = 0, px = 1 ;
+      int px_at = x ; // px is X^(px_at - x)
+      for (int cx=x; cx<=right; cx++) {
+         int skip = nextcell(cx, cy, v) ;
+         if (skip < 0 || skip > right - cx)
+            break ;
+         cx += skip ;
+         px = patternhash::mul(px, patternhash::xpow(cx - px_at)) ;
+         px_at = cx ;
+         rowh = patternhash::add(rowh, patternhash::mul(v, px)) ;
+      }
+      if (rowh)
+         h = patternhash::add(h, patternhash::mul(rowh,
+                                            patternhash::ypow(cy - y))) ;
+   }
+   return h ;
+}
+
+unsigned long long lifealgo::getPatternHash() {
+   if (isEmpty())
+      return 0 ;
+   bigint top, left, bottom, right ;
+   findedges(&top, &left, &bottom, &right) ;
+   if (top < bigint::min_coord || left < bigint::min_coord ||
+       bottom > bigint::max_coord || right > bigint::max_coord)
+      return 0 ;
+   int x = left.toint() ;
+   int y = top.toint() ;
+   return getRectHash(x, y, right.toint() - x + 1, bottom.toint() - y + 1) ;
+}
+
+bool perioddetector::observe(lifealgo &algo) {
+   if (b0nots8 < 0) {
+      // B0-and-not-S8 rules are emulated by using different rules for
+      // odd and even gens, so a still pattern can seem to repeat after
+      // an odd number of gens
+      string r = algo.getrule() ;
+      r = r.substr(0, r.find(':')) ;
+      b0nots8 = r.compare(0, 2, "B0") == 0 && r.find('/') != string::npos &&
+                r[r.size()-1] != '8' ;
+   }
+   if (algo.isEmpty()) {
+      period = 1 ;
+      dx = dy = 0 ;
+      firstgen = algo.getGeneration() ;
+      return true ;
+   }
+   bigint top, left, bottom, right ;
+   algo.findedges(&top, &left, &bottom, &right) ;
+   if (top < bigint::min_coord || left < bigint::min_coord ||
+       bottom > bigint::max_coord || right > bigint::max_coord)
+      return false ;
+   seen now ;
+   now.gen = algo.getGeneration() ;
+   now.pop = algo.getPopulation() ;
+   now.x = left.toint() ;
+   now.y = top.toint() ;
+   now.wd = right.toint() - now.x + 1 ;
+   now.ht = bottom.toint() - now.y + 1 ;
+   unsigned long long h = algo.getPatternHash() ;
+   unordered_map<unsigned long long, seen>::iterator it = table.find(h) ;
+   if (it != table.end()) {
+      seen &then = it->second ;
+      if (then.pop == now.pop && then.wd == now.wd && then.ht == now.ht) {
+         bigint p = now.gen ;
+         p -= then.gen ;
+         int moved = (then.x != now.x || then.y != now.y) ;
+         if (!(b0nots8 && !moved && (p.low31() & 1))) {
+            period = p.toint() ;
+            dx = now.x - then.x ;
+            dy = now.y - then.y ;
+            firstgen = then.gen ;
+            return true ;
+         }
+      }
+   }
+   table[h] = now ;
+   window.push_back(h) ;
+   if ((int)window.size() > maxp) {
+      // forget the generation that has slid out of the window, unless
+      // a later generation with the same hash has replaced it
+      it = table.find(window.front()) ;
+      bigint age = now.gen ;
+      age -= it->second.gen ;
+      if (age > bigint(maxp - 1))
+         table.erase(it) ;
+      window.pop_front() ;
+   }
+   return false ;
+}
+
 // -----------------------------------------------------------------------------
 
 int staticAlgoInfo::nextAlgoId = 0 ;
@@ -25,6 +25,8 @@
 #endif
 using std::vector;
 #include <iostream>
+#include <deque>
+#include <unordered_map>
 
 // this must not be increased beyond 32767, because we use a bigint
 // multiply that only supports multiplicands up to that size.
@@ -42,19 +44,99 @@ public:
    vector<void *> frames ;
 } ;
 
+/**
+ *   The batch cell calls below hand live cells to one of these, and
+ *   take rectangles of cell states in one of those: one byte per cell,
+ *   or one bit per cell (most significant bit first, each row padded to
+ *   a whole byte), row by row from the top.
+ */
+class lifecellvisitor {
+public:
+   virtual ~lifecellvisitor() {}
+   virtual void cell(int x, int y, int state) = 0 ;
+} ;
+/**
+ *   Writers get the live cells of a rect from visitrows in row order,
+ *   left to right, relative to the rect's top left corner; returning
+ *   false from cell stops the walk.
+ */
+class liferowvisitor {
+public:
+   virtual ~liferowvisitor() {}
+   virtual bool cell(long long x, long long y, int state) = 0 ;
+} ;
+struct lifecellrect {
+   lifecellrect(const unsigned char *d, int xarg, int yarg, int w, int h,
+                bool b) : data(d), x(xarg), y(yarg), wd(w), ht(h), bits(b),
+                          rowbytes(b ? ((size_t)w + 7) >> 3 : (size_t)w) {}
+   int get(int i, int j) const {
+      const unsigned char *row = data + j * rowbytes ;
+      return bits ? (row[i >> 3] >> (7 - (i & 7))) & 1 : row[i] ;
+   }
+   const unsigned char *data ;
+   int x, y, wd, ht ;
+   bool bits ;
+   size_t rowbytes ;
+} ;
+
 class lifealgo {
 public:
    lifealgo() : generation(0), increment(0), timeline(), grid_type(SQUARE_GRID)
       {  poller = &default_poller ;
          gridwd = gridht = 0 ;      // default is an unbounded universe
          unbounded = true ;         // most algorithms use an unbounded universe
+         numthreads = 1 ;
       }
    virtual ~lifealgo() ;
    // returns <0 if error
    virtual int setcell(int x, int y, int newstate) = 0 ;
+   // loaders whose cells come a row at a time, top to bottom and left
+   // to right, use this instead of setcell; the hashing algorithms
+   // build their trees bottom-up from it when the universe starts out
+   // empty.  Call endofpattern afterwards, as with setcell.
+   virtual int setrowcell(int x, int y, int newstate) {
+      return setcell(x, y, newstate) ;
+   }
    virtual int getcell(int x, int y) = 0 ;
    virtual int nextcell(int x, int y, int &v) = 0 ;
    void getcells(unsigned char *buf, int x, int y, int w, int h) ;
+   // batch cell access; the versions here loop over setcell and
+   // nextcell, and algorithms override them with walks over their own
+   // structures.  Call endofpattern afterwards, as with setcell.
+   // cells holds count x,y pairs (or x,y,state triples if withstates),
+   // best sorted by y and then x; returns <0 if error
+   virtual int setcells(const int *cells, int count, bool withstates) ;
+   // set every cell of a rect from a byte or a bit per cell
+   int setrect(const unsigned char *states, int x, int y, int wd, int ht) {
+      return putrect(lifecellrect(states, x, y, wd, ht, false)) ;
+   }
+   int setbitmap(const unsigned char *bits, int x, int y, int wd, int ht) {
+      return putrect(lifecellrect(bits, x, y, wd, ht, true)) ;
+   }
+   virtual int putrect(const lifecellrect &r) ;
+   void getbitmap(unsigned char *bits, int x, int y, int wd, int ht) ;
+   // pass every live cell in a rect to the visitor, in no particular order
+   virtual void visitcells(lifecellvisitor &v, int x, int y, int wd, int ht) ;
+   // the same for the whole pattern; returns <0 if it lies beyond the
+   // editing limits
+   int visitallcells(lifecellvisitor &v) ;
+   // pass the live cells in a rect (edges inclusive) to the visitor in
+   // row order; returns <0 if the rect is more than 2^60 cells across or
+   // down (or, for algos without their own, beyond the editing limits),
+   // >0 if the visitor stopped the walk, else 0
+   virtual int visitrows(liferowvisitor &v, const bigint &top,
+                         const bigint &left, const bigint &bottom,
+                         const bigint &right) ;
+   static bool rowsize(const bigint &top, const bigint &left,
+                       const bigint &bottom, const bigint &right,
+                       long long &wd, long long &ht) ;
+   // hash the cells in a rect relative to its top left corner, so a
+   // translated copy hashes the same (see patternhash in util.h);
+   // the hashlife algorithms remember the hash of each node
+   virtual unsigned long long getRectHash(int x, int y, int wd, int ht) ;
+   // the same for the whole pattern relative to its bounding box;
+   // 0 if the pattern is empty or beyond the editing limits
+   virtual unsigned long long getPatternHash() ;
    // call after setcell calls
    virtual void endofpattern() = 0 ;
    virtual void setIncrement(bigint inc) = 0 ;
@@ -68,9 +150,16 @@ public:
    virtual int hyperCapable() = 0 ;
    virtual void setMaxMemory(int m) = 0 ;          // never alloc more than this
    virtual int getMaxMemory() = 0 ;
+   // use up to this many threads when stepping; algorithms that cannot
+   // split a generation across cores simply ignore it
+   virtual void setNumThreads(int n) { numthreads = (n < 1 ? 1 : n) ; }
+   int getNumThreads() { return numthreads ; }
    virtual const char *setrule(const char *) = 0 ; // new rules; returns err msg
    virtual const char *getrule() = 0 ;             // get current rule set
    virtual void step() = 0 ;                       // do inc gens
+   // draw the part of the universe in view; if the renderer keeps its
+   // frame, only the areas that changed since the last draw into it
+   // are repainted (see liferender::keepsframe), else every pixel is
    virtual void draw(viewport &view, liferender &renderer) = 0 ;
    virtual void fit(viewport &view, int force) = 0 ;
    virtual void findedges(bigint *t, bigint *l, bigint *b, bigint *r) = 0 ;
@@ -157,6 +246,7 @@ protected:
    lifepoll *poller ;
    static int verbose ;
    int maxCellStates ; // keep up to date; setcell depends on it
+   int numthreads ;
    bigint generation ;
    bigint increment ;
    timeline_t timeline ;
@@ -173,6 +263,34 @@ private:
    void ClearRect(int top, int left, int bottom, int right) ;
 } ;
 
+/**
+ *   Watches a pattern generation by generation for it to repeat, up to
+ *   translation, with a period of at most maxp.  Call observe() once
+ *   per generation (stepping by one in between); when it returns true,
+ *   period and the displacement per period say what was found, and
+ *   firstgen is the first generation of the cycle.  An empty pattern
+ *   counts as period 1.  A matching hash is confirmed against the
+ *   population and bounding box size before it is believed.
+ */
+class perioddetector {
+public:
+   perioddetector(int maxparg) : period(0), dx(0), dy(0), maxp(maxparg),
+                                 b0nots8(-1) {}
+   bool observe(lifealgo &algo) ;
+   int period ;
+   int dx, dy ;
+   bigint firstgen ;
+private:
+   struct seen {
+      bigint gen, pop ;
+      int x, y, wd, ht ;
+   } ;
+   int maxp ;
+   int b0nots8 ;
+   std::unordered_map<unsigned long long, seen> table ;
+   std::deque<unsigned long long> window ;
+} ;
+
 /**
  *   If you need any static information from a lifealgo, this class can be
  *   called (or overridden) to set up all that data.  Right now the
@@ -3,6 +3,7 @@
 
 #include "liferender.h"
 #include "util.h"
+#include <algorithm>
 liferender::~liferender() {}
 void liferender::pixblit(int x, int y, int w, int h, unsigned char* pm, int pmscale) {
    lifefatal("pixblit not implemented") ;
@@ -29,3 +30,95 @@ void staterender::stateblit(int x, int y, int w, int h, unsigned char* pm) {
          *wp++ = *rp++ ;
    }
 }
+int liferender::keepsframe() {
+   return 0 ;
+}
+void liferender::damage(int x, int y, int w, int h) {
+   lifefatal("damage not implemented") ;
+}
+/*
+ *   Frame ids are unique across renderers, so an algorithm remembering
+ *   one can't mistake another renderer's frame for its own.
+ */
+static int framecount = 0 ;
+int liferender::newframe() {
+   frame = ++framecount ;
+   return frame ;
+}
+void drawdamage::begin(liferender &r, viewport &view) {
+   renderer = &r ;
+   cur.clear() ;
+   tracking = !r.justState() && r.keepsframe() ;
+   incremental = 0 ;
+   if (!tracking) {
+      // someone else's pixels; nothing we remember is any good
+      frame = 0 ;
+      prev.clear() ;
+      return ;
+   }
+   unsigned char *red, *green, *blue, deada, livea ;
+   r.getcolors(&red, &green, &blue, &deada, &livea) ;
+   unsigned G_INT64 uh = deada * 257 + livea ;
+   for (int i=0; i<256; i++)
+      uh = uh * 1000003 + (red[i] << 16) + (green[i] << 8) + blue[i] ;
+   G_INT64 h = (G_INT64)uh ;
+   if (frame != 0 && r.frameid() == frame && view.x == x && view.y == y &&
+       view.getmag() == mag && view.getwidth() == wd &&
+       view.getheight() == ht && h == colors) {
+      incremental = 1 ;
+   } else {
+      prev.clear() ;
+      x = view.x ;
+      y = view.y ;
+      mag = view.getmag() ;
+      wd = view.getwidth() ;
+      ht = view.getheight() ;
+      colors = h ;
+      r.damage(0, 0, wd, ht) ;
+   }
+}
+void drawdamage::layout(G_INT64 l) {
+   if (l == tiling)
+      return ;
+   tiling = l ;
+   if (incremental) {
+      incremental = 0 ;
+      prev.clear() ;
+      renderer->damage(0, 0, wd, ht) ;
+   }
+}
+int drawdamage::redraw(int x, int y, int w, int h, G_INT64 key, int dirty) {
+   if (!tracking)
+      return 1 ;
+   tile t = { x, y, w, h, key } ;
+   cur.push_back(t) ;
+   if (!incremental)
+      return 1 ;
+   if (key != 0 && !dirty) {
+      std::vector<tile>::iterator it =
+                               std::lower_bound(prev.begin(), prev.end(), t) ;
+      if (it != prev.end() && !(t < *it) && it->key == key)
+         return 0 ;
+   }
+   renderer->damage(x, y, w, h) ;
+   return 1 ;
+}
+void drawdamage::end() {
+   if (!tracking)
+      return ;
+   std::sort(cur.begin(), cur.end()) ;
+   if (incremental) {
+      // tiles that went empty since the last frame
+      for (size_t i=0; i<prev.size(); i++)
+         if (!std::binary_search(cur.begin(), cur.end(), prev[i]))
+            renderer->damage(prev[i].x, prev[i].y, prev[i].w, prev[i].h) ;
+   }
+   prev.swap(cur) ;
+   cur.clear() ;
+   frame = renderer->newframe() ;
+   renderer = 0 ;
+}
+void drawdamage::invalidate() {
+   for (size_t i=0; i<prev.size(); i++)
+      prev[i].key = 0 ;
+}
@@ -22,10 +22,12 @@
  */
 #ifndef LIFERENDER_H
 #define LIFERENDER_H
+#include "viewport.h"
+#include <vector>
 class liferender {
 public:
-   liferender() : juststate(0) {}
-   liferender(int state) : juststate(state) {}
+   liferender() : juststate(0), frame(0) {}
+   liferender(int state) : juststate(state), frame(0) {}
    int justState() { return juststate ; }
    virtual ~liferender() ;
 
@@ -47,8 +49,21 @@ public:
    // for state renderers, this just copies the cell state; no scaling is
    // supported.  Only called for juststate renderers.
    virtual void stateblit(int x, int y, int w, int h, unsigned char* pm) ;
+
+   // A renderer may keep the pixels of the previous frame, in which
+   // case (keepsframe returns nonzero) the algorithm is free to redraw
+   // only what changed since it last drew into this renderer.  It calls
+   // damage for every area it is about to redraw; the renderer must set
+   // that area to the dead color, since empty areas are not blitted.
+   // Anything else that draws into a kept frame must call newframe so
+   // the next draw repaints everything.  See drawdamage below.
+   virtual int keepsframe() ;
+   virtual void damage(int x, int y, int w, int h) ;
+   int frameid() { return frame ; }
+   int newframe() ;
 private:
    int juststate ;
+   int frame ;
 } ;
 class staterender : public liferender {
 public:
@@ -59,4 +74,46 @@ private:
    unsigned char *buf ;
    int vw, vh ;
 } ;
+/**
+ *   Bookkeeping for algorithms that redraw only what changed.  The
+ *   algorithm draws in fixed tiles; it calls begin at the start of
+ *   draw and then redraw for each tile, with the tile's rectangle in
+ *   renderer coordinates and a key naming what the tile shows (a
+ *   canonical node, say), and skips the tile when redraw returns 0.
+ *   A key of 0 always redraws, as does dirty.  end clears the tiles
+ *   that were drawn last time but not this time.
+ *
+ *   Everything is redrawn if the renderer doesn't keep its frame or if
+ *   anything but the cells changed since the last draw:  the frame,
+ *   the view, the colors, or the layout, which the algorithm sets
+ *   before its first tile to whatever else decides where tiles fall.
+ */
+class drawdamage {
+public:
+   drawdamage() : renderer(0), frame(0), tracking(0), incremental(0),
+                  mag(0), wd(0), ht(0), tiling(0), colors(0) {}
+   void begin(liferender &r, viewport &view) ;
+   void layout(G_INT64 l) ;
+   int redraw(int x, int y, int w, int h, G_INT64 key, int dirty=0) ;
+   void end() ;
+   // forget the keys; call this when what they name may be freed
+   void invalidate() ;
+   // whether keys are worth computing (the renderer keeps its frame)
+   int active() { return tracking ; }
+private:
+   struct tile {
+      int x, y, w, h ;
+      G_INT64 key ;
+      bool operator<(const tile &t) const {
+         return y != t.y ? y < t.y : x != t.x ? x < t.x :
+                w != t.w ? w < t.w : h < t.h ;
+      }
+   } ;
+   std::vector<tile> prev, cur ;
+   liferender *renderer ;
+   int frame, tracking, incremental ;
+   bigint x, y ;
+   int mag, wd, ht ;
+   G_INT64 tiling, colors ;
+} ;
 #endif
@@ -37,6 +37,99 @@ static const char *VALIDNEIGHBORHOODS = "MNC+X*2HBD#@3ALGW";
 // hex digits (upper case)
 static const char *HEXCHARACTERS = "0123456789ABCDEF";
 
+// the worker threads used when numthreads > 1
+
+struct ltlmt {
+    ltlmt(int n) : threads(n) {}
+    lifethreads threads;
+};
+
+// do_rows splits the rows of each of these passes into bands of at least
+// MINBANDROWS rows and runs the bands on different threads
+
+enum { GEN_PASS, MOORE_SUMS_PASS, MOORE_UPDATE_PASS, NEUMANN_UPDATE_PASS,
+       PACK_PASS, PACKED_UPDATE_PASS };
+
+#define MINBANDROWS 16
+
+struct ltltask : public lifetask {
+    ltlalgo* algo;
+    ltlalgo::ltlband band;              // results for this band
+    int pass;
+    int first, last;                    // rows in this band
+    int mincol, maxcol, orow, ocol;     // as passed to do_rows
+    virtual void run(int) { algo->run_pass(*this); }
+};
+
+static int band_height(int first, int last, int nthreads, int minht)
+{
+    // return the number of rows in each band when splitting first..last into
+    // bands of at least minht rows (the final band might be shorter); a result
+    // > last-first means there is just one band
+    int nrows = last - first + 1;
+    int nbands = nthreads > 1 ? nrows / minht : 1;
+    // a few bands per thread helps even out the work
+    if (nbands > 4 * nthreads) nbands = 4 * nthreads;
+    if (nbands < 2) return nrows;
+    return (nrows + nbands - 1) / nbands;
+}
+
+// Moore_packed is used for 2-state Moore rules with a range up to MAXPACKEDRANGE
+// (the neighborhood counts must fit in 8 bits)
+
+#define MAXPACKEDRANGE 7
+
+// multiplying 8 cells (each 0 or 1) by PACKMULT moves them into the top 8 bits
+
+#ifdef GOLLYBIGENDIAN
+static const unsigned long long PACKMULT = 0x8040201008040201ULL;
+#else
+static const unsigned long long PACKMULT = 0x0102040810204080ULL;
+#endif
+
+// unpackbits[b] holds the 8 cells (each 0 or 1) given by the bits in b
+
+static unsigned long long unpackbits[256];
+
+static inline int bitcount64(unsigned long long x)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    while (x) {
+        x &= x - 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static inline int lowestbit(unsigned long long x)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int r = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        r++;
+    }
+    return r;
+#endif
+}
+
+static inline int highestbit(unsigned long long x)
+{
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(x);
+#else
+    int r = 0;
+    while (x >>= 1) r++;
+    return r;
+#endif
+}
+
 // -----------------------------------------------------------------------------
 
 // Create a new empty universe.
@@ -44,11 +137,23 @@ static const char *HEXCHARACTERS = "0123456789ABCDEF";
 ltlalgo::ltlalgo()
 {
     shape = NULL ;
+    mt = NULL;
     // create a bounded universe with the default grid size, range and neighborhood
     unbounded = false;
     range = 1;
     ntype = 'M';
     colcounts = NULL;
+    packed = false;
+    packedcells = NULL;
+    packedsize = 0;
+    packedwd = 0;
+    if (unpackbits[255] == 0) {
+        for (int i = 0; i < 256; i++) {
+            unsigned char cells[8];
+            for (int j = 0; j < 8; j++) cells[j] = (i >> j) & 1;
+            memcpy(&unpackbits[i], cells, 8);
+        }
+    }
     create_grids(DEFAULTSIZE, DEFAULTSIZE);
     generation = 0;
     increment = 1;
@@ -70,9 +175,11 @@ ltlalgo::ltlalgo()
 
 ltlalgo::~ltlalgo()
 {
+    delete mt;
     free(outergrid1);
     if (outergrid2) free(outergrid2);
     if (colcounts) free(colcounts);
+    if (packedcells) free(packedcells);
     if (shape) free(shape);
     if (births) free(births);
     if (survivals) free(survivals);
@@ -89,7 +196,10 @@ void ltlalgo::allocate_colcounts()
 {
     // allocate the array used for cumulative column counts of state-1 cells
     if (colcounts) free(colcounts);
-    if (ntype == 'M') {
+    if (packed) {
+        // Moore_packed doesn't need colcounts
+        colcounts = NULL;
+    } else if (ntype == 'M') {
         colcounts = (int*) malloc(outerbytes * sizeof(int));
         // if NULL then use fast_Moore, otherwise faster_Moore_*
     } else if (ntype == 'N') {
@@ -131,7 +241,7 @@ void ltlalgo::create_grids(int wd, int ht)
     currgrid = outergrid1 + offset;
 
     // if using fast_Moore or fast_Neumann we need to allocate outergrid2
-    if (colcounts == NULL) {
+    if (colcounts == NULL && !packed) {
         outergrid2 = (unsigned char*) calloc(outerbytes, sizeof(unsigned char));
         if (outergrid2 == NULL) lifefatal("Not enough memory for LtL grids!");
         // point nextgrid to top left non-border cells within outergrid2
@@ -269,8 +379,8 @@ const char* ltlalgo::resize_grids(int up, int down, int left, int right)
 
     allocate_colcounts();
 
-    if (colcounts) {
-        // faster_* calls don't use outergrid2
+    if (colcounts || packed) {
+        // faster_* and Moore_packed calls don't use outergrid2
         free(outergrid2);
         outergrid2 = NULL;
         nextgrid = NULL;
@@ -281,6 +391,60 @@ const char* ltlalgo::resize_grids(int up, int down, int left, int right)
 
 // -----------------------------------------------------------------------------
 
+// Make sure the given rectangle lies inside an unbounded universe.
+
+bool ltlalgo::expand_grid(int left, int top, int right, int bottom)
+{
+    if (left >= gleft && right <= gright && top >= gtop && bottom <= gbottom) return true;
+    
+    if (population == 0) {
+        // no need to resize empty grids;
+        // just adjust grid edges so that the rectangle is in middle of grid
+        gtop = top + int(((long long)bottom - top) / 2) - int(ght / 2);
+        gleft = left + int(((long long)right - left) / 2) - int(gwd / 2);
+
+        // for triangular type rules ensure pattern placement is on a 2x2 grid
+        if (grid_type == TRI_GRID) {
+            gtop &= ~1;
+            gleft &= ~1;
+        }
+
+        gbottom = gtop + ghtm1;
+        gright = gleft + gwdm1;
+        // set bigint versions of grid edges (used by GUI code)
+        gridtop = gtop;
+        gridleft = gleft;
+        gridbottom = gbottom;
+        gridright = gright;
+        
+        if (left >= gleft && right <= gright && top >= gtop && bottom <= gbottom) return true;
+    }
+    
+    int up = top < gtop ? gtop - top : 0;
+    int down = bottom > gbottom ? bottom - gbottom : 0;
+    int lt = left < gleft ? gleft - left : 0;
+    int rt = right > gright ? right - gright : 0;
+    
+    // if the down or right amount is 1 then it's likely a pattern file
+    // is being loaded, so increase the amount to reduce the number of
+    // resize_grids calls and speed up the loading time
+    if (down == 1) down = 10;
+    if (rt == 1) rt = 10;
+    
+    const char* errmsg = resize_grids(up, down, lt, rt);
+    if (errmsg) {
+        if (show_warning) lifewarning(errmsg);
+        // prevent further warning messages until endofpattern is called
+        // (this avoids user having to close thousands of dialog boxes
+        // if they attempted to paste a large pattern)
+        show_warning = false;
+        return false;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
 // Set the cell at the given location to the given state.
 
 int ltlalgo::setcell(int x, int y, int newstate)
@@ -289,49 +453,7 @@ int ltlalgo::setcell(int x, int y, int newstate)
     
     if (unbounded) {
         // check if universe needs to be expanded
-        if (x < gleft || x > gright || y < gtop || y > gbottom) {
-            if (population == 0) {
-                // no need to resize empty grids;
-                // just adjust grid edges so that x,y is in middle of grid
-                gtop = y - int(ght / 2);
-                gleft = x - int(gwd / 2);
-
-                // for triangular type rules ensure pattern placement is on a 2x2 grid
-                if (grid_type == TRI_GRID) {
-                    gtop &= ~1;
-                    gleft &= ~1;
-                }
-
-                gbottom = gtop + ghtm1;
-                gright = gleft + gwdm1;
-                // set bigint versions of grid edges (used by GUI code)
-                gridtop = gtop;
-                gridleft = gleft;
-                gridbottom = gbottom;
-                gridright = gright;
-            } else {
-                int up = y < gtop ? gtop - y : 0;
-                int down = y > gbottom ? y - gbottom : 0;
-                int left = x < gleft ? gleft - x : 0;
-                int right = x > gright ? x - gright : 0;
-                
-                // if the down or right amount is 1 then it's likely a pattern file
-                // is being loaded, so increase the amount to reduce the number of
-                // resize_grids calls and speed up the loading time
-                if (down == 1) down = 10;
-                if (right == 1) right = 10;
-                
-                const char* errmsg = resize_grids(up, down, left, right);
-                if (errmsg) {
-                    if (show_warning) lifewarning(errmsg);
-                    // prevent further warning messages until endofpattern is called
-                    // (this avoids user having to close thousands of dialog boxes
-                    // if they attempted to paste a large pattern)
-                    show_warning = false;
-                    return -1;
-                }
-            }
-        }
+        if (!expand_grid(x, y, x, y)) return -1;
     } else {
         // check if x,y is outside bounded universe
         if (x < gleft || x > gright) return -1;
@@ -424,6 +546,77 @@ int ltlalgo::nextcell(int x, int y, int& v)
 
 // -----------------------------------------------------------------------------
 
+// Set a batch of cells, expanding an unbounded universe once to fit them
+// all rather than a little at a time.
+
+int ltlalgo::setcells(const int* cells, int count, bool withstates)
+{
+    if (count <= 0) return 0;
+    if (unbounded) {
+        int step = withstates ? 3 : 2;
+        int left = cells[0], top = cells[1], right = left, bottom = top;
+        for (int i = 1; i < count; i++) {
+            const int* c = cells + step * i;
+            if (c[0] < left) left = c[0];
+            if (c[0] > right) right = c[0];
+            if (c[1] < top) top = c[1];
+            if (c[1] > bottom) bottom = c[1];
+        }
+        if (!expand_grid(left, top, right, bottom)) return -1;
+    }
+    return lifealgo::setcells(cells, count, withstates);
+}
+
+// -----------------------------------------------------------------------------
+
+int ltlalgo::putrect(const lifecellrect& r)
+{
+    if (r.wd <= 0 || r.ht <= 0) return 0;
+    if (unbounded) {
+        // only the live part of the rectangle needs to fit
+        int left = r.wd, top = r.ht, right = -1, bottom = -1;
+        for (int j = 0; j < r.ht; j++) {
+            for (int i = 0; i < r.wd; i++) {
+                if (r.get(i, j)) {
+                    if (i < left) left = i;
+                    if (i > right) right = i;
+                    if (j < top) top = j;
+                    bottom = j;
+                }
+            }
+        }
+        if (right >= 0 &&
+            !expand_grid(r.x + left, r.y + top, r.x + right, r.y + bottom)) return -1;
+    }
+    return lifealgo::putrect(r);
+}
+
+// -----------------------------------------------------------------------------
+
+// Visit the live cells in the given rectangle, scanning only the part
+// of currgrid inside the pattern's bounding box.
+
+void ltlalgo::visitcells(lifecellvisitor& v, int x, int y, int wd, int ht)
+{
+    if (population == 0 || wd <= 0 || ht <= 0) return;
+    long long left = (long long)x - gleft;
+    long long top = (long long)y - gtop;
+    long long right = left + wd - 1;
+    long long bottom = top + ht - 1;
+    if (left < minx) left = minx;
+    if (top < miny) top = miny;
+    if (right > maxx) right = maxx;
+    if (bottom > maxy) bottom = maxy;
+    for (long long gy = top; gy <= bottom; gy++) {
+        unsigned char* cellptr = currgrid + gy * outerwd;
+        for (long long gx = left; gx <= right; gx++) {
+            if (cellptr[gx]) v.cell(int(gx + gleft), int(gy + gtop), cellptr[gx]);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
 static bigint bigpop;
 
 const bigint& ltlalgo::getPopulation()
@@ -441,7 +634,7 @@ int ltlalgo::isEmpty()
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::update_current_grid(unsigned char &state, int ncount)
+void ltlalgo::update_current_grid(ltlband& band, unsigned char &state, int ncount)
 {
     // return the state of the cell based on the neighbor count
     if (state == 0) {
@@ -449,7 +642,7 @@ void ltlalgo::update_current_grid(unsigned char &state, int ncount)
         if (births[ncount]) {
             // new cell is born
             state = 1;
-            population++;
+            band.population++;
         }
     } else if (state == 1) {
         // this cell is alive
@@ -461,8 +654,7 @@ void ltlalgo::update_current_grid(unsigned char &state, int ncount)
             } else {
                 // cell dies
                 state = 0;
-                population--;
-                if (population == 0) empty_boundaries();
+                band.population--;
             }
         }
     } else {
@@ -472,15 +664,14 @@ void ltlalgo::update_current_grid(unsigned char &state, int ncount)
         } else {
             // cell dies
             state = 0;
-            population--;
-            if (population == 0) empty_boundaries();
+            band.population--;
         }
     }
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::update_next_grid(int x, int y, int xyoffset, int ncount)
+void ltlalgo::update_next_grid(ltlband& band, int x, int y, int xyoffset, int ncount)
 {
     // x,y cell in nextgrid might change based on the given neighborhood count
     unsigned char state = *(currgrid + xyoffset);
@@ -490,11 +681,11 @@ void ltlalgo::update_next_grid(int x, int y, int xyoffset, int ncount)
             // new cell is born in nextgrid
             unsigned char* nextcell = nextgrid + xyoffset;
             *nextcell = 1;
-            population++;
-            if (x < minx) minx = x;
-            if (x > maxx) maxx = x;
-            if (y < miny) miny = y;
-            if (y > maxy) maxy = y;
+            band.population++;
+            if (x < band.minx) band.minx = x;
+            if (x > band.maxx) band.maxx = x;
+            if (y < band.miny) band.miny = y;
+            if (y > band.maxy) band.maxy = y;
         }
     } else if (state == 1) {
         // this cell is alive
@@ -503,23 +694,22 @@ void ltlalgo::update_next_grid(int x, int y, int xyoffset, int ncount)
             unsigned char* nextcell = nextgrid + xyoffset;
             *nextcell = 1;
             // population doesn't change but pattern limits in nextgrid might
-            if (x < minx) minx = x;
-            if (x > maxx) maxx = x;
-            if (y < miny) miny = y;
-            if (y > maxy) maxy = y;
+            if (x < band.minx) band.minx = x;
+            if (x > band.maxx) band.maxx = x;
+            if (y < band.miny) band.miny = y;
+            if (y > band.maxy) band.maxy = y;
         } else if (maxCellStates > 2) {
             // cell decays to state 2
             unsigned char* nextcell = nextgrid + xyoffset;
             *nextcell = 2;
             // population doesn't change but pattern limits in nextgrid might
-            if (x < minx) minx = x;
-            if (x > maxx) maxx = x;
-            if (y < miny) miny = y;
-            if (y > maxy) maxy = y;
+            if (x < band.minx) band.minx = x;
+            if (x > band.maxx) band.maxx = x;
+            if (y < band.miny) band.miny = y;
+            if (y > band.maxy) band.maxy = y;
         } else {
             // cell dies
-            population--;
-            if (population == 0) empty_boundaries();
+            band.population--;
         }
     } else {
         // state is > 1 so this cell will eventually die
@@ -527,21 +717,20 @@ void ltlalgo::update_next_grid(int x, int y, int xyoffset, int ncount)
             unsigned char* nextcell = nextgrid + xyoffset;
             *nextcell = state + 1;
             // population doesn't change but pattern limits in nextgrid might
-            if (x < minx) minx = x;
-            if (x > maxx) maxx = x;
-            if (y < miny) miny = y;
-            if (y > maxy) maxy = y;
+            if (x < band.minx) band.minx = x;
+            if (x > band.maxx) band.maxx = x;
+            if (y < band.miny) band.miny = y;
+            if (y > band.maxy) band.maxy = y;
         } else {
             // cell dies
-            population--;
-            if (population == 0) empty_boundaries();
+            band.population--;
         }
     }
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::faster_Moore_bounded(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::faster_Moore_bounded(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     // use Adam P. Goucher's algorithm to calculate Moore neighborhood counts
     // in a bounded universe; note that currgrid is surrounded by a border that
@@ -602,13 +791,13 @@ void ltlalgo::faster_Moore_bounded(int mincol, int minrow, int maxcol, int maxro
     ccptr = colptr + mincol + bpr;
     unsigned char* stateptr = currgrid + minrow*outerwd+mincol;
     unsigned char state = *stateptr;
-    update_current_grid(state, *ccptr);
+    update_current_grid(band, state, *ccptr);
     *stateptr = state;
     if (state) {
-        if (mincol < minx) minx = mincol;
-        if (mincol > maxx) maxx = mincol;
-        if (minrow < miny) miny = minrow;
-        if (minrow > maxy) maxy = minrow;
+        if (mincol < band.minx) band.minx = mincol;
+        if (mincol > band.maxx) band.maxx = mincol;
+        if (minrow < band.miny) band.miny = minrow;
+        if (minrow > band.maxy) band.maxy = minrow;
     }
 
     bool rowchanged = false;
@@ -619,17 +808,17 @@ void ltlalgo::faster_Moore_bounded(int mincol, int minrow, int maxcol, int maxro
         int* ccptr1 = colptr + (j + bpr);
         int* ccptr2 = colptr + (j + bmrm1);
         state = *stateptr;
-        update_current_grid(state, *ccptr1 - *ccptr2);
+        update_current_grid(band, state, *ccptr1 - *ccptr2);
         *stateptr++ = state;
         if (state) {
-            if (j < minx) minx = j;
-            if (j > maxx) maxx = j;
+            if (j < band.minx) band.minx = j;
+            if (j > band.maxx) band.maxx = j;
             rowchanged = true;
         }
     }
     if (rowchanged) {
-        if (minrow < miny) miny = minrow;
-        if (minrow > maxy) maxy = minrow;
+        if (minrow < band.miny) band.miny = minrow;
+        if (minrow > band.maxy) band.maxy = minrow;
     }
     
     bool colchanged = false;
@@ -640,18 +829,18 @@ void ltlalgo::faster_Moore_bounded(int mincol, int minrow, int maxcol, int maxro
         int* ccptr1 = colptr + (i + bpr) * outerwd;
         int* ccptr2 = colptr + (i + bmrm1) * outerwd;
         state = *stateptr;
-        update_current_grid(state, *ccptr1 - *ccptr2);
+        update_current_grid(band, state, *ccptr1 - *ccptr2);
         *stateptr = state;
         stateptr += outerwd;
         if (state) {
-            if (i < miny) miny = i;
-            if (i > maxy) maxy = i;
+            if (i < band.miny) band.miny = i;
+            if (i > band.maxy) band.maxy = i;
             colchanged = true;
         }
     }
     if (colchanged) {
-        if (mincol < minx) minx = mincol;
-        if (mincol > maxx) maxx = mincol;
+        if (mincol < band.minx) band.minx = mincol;
+        if (mincol > band.maxx) band.maxx = mincol;
     }
     
     rowchanged = false;
@@ -667,17 +856,17 @@ void ltlalgo::faster_Moore_bounded(int mincol, int minrow, int maxcol, int maxro
             int* ccptr3 = ipr + jmrm1;
             int* ccptr4 = imrm1 + jpr;
             state = *stateptr;
-            update_current_grid(state, *ccptr1 + *ccptr2 - *ccptr3 - *ccptr4);
+            update_current_grid(band, state, *ccptr1 + *ccptr2 - *ccptr3 - *ccptr4);
             *stateptr++ = state;
             if (state) {
-                if (j < minx) minx = j;
-                if (j > maxx) maxx = j;
+                if (j < band.minx) band.minx = j;
+                if (j > band.maxx) band.maxx = j;
                 rowchanged = true;
             }
         }
         if (rowchanged) {
-            if (i < miny) miny = i;
-            if (i > maxy) maxy = i;
+            if (i < band.miny) band.miny = i;
+            if (i > band.maxy) band.maxy = i;
             rowchanged = false;
         }
     }
@@ -685,7 +874,7 @@ void ltlalgo::faster_Moore_bounded(int mincol, int minrow, int maxcol, int maxro
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::faster_Moore_bounded2(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::faster_Moore_bounded2(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     // use Adam P. Goucher's algorithm to calculate Moore neighborhood counts
     // in a bounded universe; note that currgrid is surrounded by a border that
@@ -825,22 +1014,22 @@ void ltlalgo::faster_Moore_bounded2(int mincol, int minrow, int maxcol, int maxr
     if (*stateptr == 0) {
         if (births[ncount]) {
             *stateptr = 1;
-            population++;
-            minx = mincol;
-            maxx = mincol;
-            miny = minrow;
-            maxy = minrow;
+            band.population++;
+            band.minx = mincol;
+            band.maxx = mincol;
+            band.miny = minrow;
+            band.maxy = minrow;
         }
     } else {
         if (!survivals[ncount]) {
             *stateptr = 0;
-            population--;
+            band.population--;
         }
         else {
-            minx = mincol;
-            maxx = maxcol;
-            miny = minrow;
-            maxy = maxrow;
+            band.minx = mincol;
+            band.maxx = maxcol;
+            band.miny = minrow;
+            band.maxy = maxrow;
         }
     }
 
@@ -855,27 +1044,27 @@ void ltlalgo::faster_Moore_bounded2(int mincol, int minrow, int maxcol, int maxr
         if (*stateptr == 0) {
             if (births[ncount]) {
                 *stateptr = 1;
-                population++;
-                if (j < minx) minx = j;
-                if (j > maxx) maxx = j;
+                band.population++;
+                if (j < band.minx) band.minx = j;
+                if (j > band.maxx) band.maxx = j;
                 rowchanged = true;
             }
         } else {
             if (!survivals[ncount]) {
                 *stateptr = 0;
-                population--;
+                band.population--;
             }
             else {
-                if (j < minx) minx = j;
-                if (j > maxx) maxx = j;
+                if (j < band.minx) band.minx = j;
+                if (j > band.maxx) band.maxx = j;
                 rowchanged = true;
             }
         }
         stateptr++;
     }
     if (rowchanged) {
-        if (minrow < miny) miny = minrow;
-        if (minrow > maxy) maxy = minrow;
+        if (minrow < band.miny) band.miny = minrow;
+        if (minrow > band.maxy) band.maxy = minrow;
     }
     
     bool colchanged = false;
@@ -889,19 +1078,19 @@ void ltlalgo::faster_Moore_bounded2(int mincol, int minrow, int maxcol, int maxr
         if (*stateptr == 0) {
             if (births[ncount]) {
                 *stateptr = 1;
-                population++;
-                if (i < miny) miny = i;
-                if (i > maxy) maxy = i;
+                band.population++;
+                if (i < band.miny) band.miny = i;
+                if (i > band.maxy) band.maxy = i;
                 colchanged = true;
             }
         } else {
             if (!survivals[ncount]) {
                 *stateptr = 0;
-                population--;
+                band.population--;
             }
             else {
-                if (i < miny) miny = i;
-                if (i > maxy) maxy = i;
+                if (i < band.miny) band.miny = i;
+                if (i > band.maxy) band.maxy = i;
                 colchanged = true;
             }
         }
@@ -910,8 +1099,8 @@ void ltlalgo::faster_Moore_bounded2(int mincol, int minrow, int maxcol, int maxr
         ccptr2 += outerwd;
     }
     if (colchanged) {
-        if (mincol < minx) minx = mincol;
-        if (mincol > maxx) maxx = mincol;
+        if (mincol < band.minx) band.minx = mincol;
+        if (mincol > band.maxx) band.maxx = mincol;
     }
     
     rowchanged = false;
@@ -930,36 +1119,35 @@ void ltlalgo::faster_Moore_bounded2(int mincol, int minrow, int maxcol, int maxr
             if (*stateptr == 0) {
                 if (births[ncount]) {
                     *stateptr = 1;
-                    population++;
-                    if (j < minx) minx = j;
-                    if (j > maxx) maxx = j;
+                    band.population++;
+                    if (j < band.minx) band.minx = j;
+                    if (j > band.maxx) band.maxx = j;
                     rowchanged = true;
                 }
             } else {
                 if (!survivals[ncount]) {
                     *stateptr = 0;
-                    population--;
+                    band.population--;
                 }
                 else {
-                    if (j < minx) minx = j;
-                    if (j > maxx) maxx = j;
+                    if (j < band.minx) band.minx = j;
+                    if (j > band.maxx) band.maxx = j;
                     rowchanged = true;
                 }
             }
             stateptr++;
         }
         if (rowchanged) {
-            if (i < miny) miny = i;
-            if (i > maxy) maxy = i;
+            if (i < band.miny) band.miny = i;
+            if (i > band.maxy) band.maxy = i;
             rowchanged = false;
         }
     }
-    if (population == 0) empty_boundaries();
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::faster_Moore_unbounded(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::faster_Moore_unbounded(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     // use Adam P. Goucher's algorithm to calculate Moore neighborhood counts
     // in an unbounded universe; note that we can safely assume there is at least
@@ -1027,13 +1215,13 @@ void ltlalgo::faster_Moore_unbounded(int mincol, int minrow, int maxcol, int max
     ccptr = colptr + mincol + range;
     unsigned char* stateptr = currgrid + minrow*outerwd+mincol;
     unsigned char state = *stateptr;
-    update_current_grid(state, *ccptr);
+    update_current_grid(band, state, *ccptr);
     *stateptr = state;
     if (state) {
-        if (mincol < minx) minx = mincol;
-        if (mincol > maxx) maxx = mincol;
-        if (minrow < miny) miny = minrow;
-        if (minrow > maxy) maxy = minrow;
+        if (mincol < band.minx) band.minx = mincol;
+        if (mincol > band.maxx) band.maxx = mincol;
+        if (minrow < band.miny) band.miny = minrow;
+        if (minrow > band.maxy) band.maxy = minrow;
     }
 
     bool rowchanged = false;
@@ -1044,17 +1232,17 @@ void ltlalgo::faster_Moore_unbounded(int mincol, int minrow, int maxcol, int max
         int* ccptr1 = colptr + (j+range);
         int* ccptr2 = colptr + (j-rangep1);
         state = *stateptr;
-        update_current_grid(state, *ccptr1 - *ccptr2);
+        update_current_grid(band, state, *ccptr1 - *ccptr2);
         *stateptr++ = state;
         if (state) {
-            if (j < minx) minx = j;
-            if (j > maxx) maxx = j;
+            if (j < band.minx) band.minx = j;
+            if (j > band.maxx) band.maxx = j;
             rowchanged = true;
         }
     }
     if (rowchanged) {
-        if (minrow < miny) miny = minrow;
-        if (minrow > maxy) maxy = minrow;
+        if (minrow < band.miny) band.miny = minrow;
+        if (minrow > band.maxy) band.maxy = minrow;
     }
 
     bool colchanged = false;
@@ -1065,18 +1253,18 @@ void ltlalgo::faster_Moore_unbounded(int mincol, int minrow, int maxcol, int max
         int* ccptr1 = colptr + (i+range) * outerwd;
         int* ccptr2 = colptr + (i-rangep1) * outerwd;
         state = *stateptr;
-        update_current_grid(state, *ccptr1 - *ccptr2);
+        update_current_grid(band, state, *ccptr1 - *ccptr2);
         *stateptr = state;
         stateptr += outerwd;
         if (state) {
-            if (i < miny) miny = i;
-            if (i > maxy) maxy = i;
+            if (i < band.miny) band.miny = i;
+            if (i > band.maxy) band.maxy = i;
             colchanged = true;
         }
     }
     if (colchanged) {
-        if (mincol < minx) minx = mincol;
-        if (mincol > maxx) maxx = mincol;
+        if (mincol < band.minx) band.minx = mincol;
+        if (mincol > band.maxx) band.maxx = mincol;
     }
     
     rowchanged = false;
@@ -1092,17 +1280,17 @@ void ltlalgo::faster_Moore_unbounded(int mincol, int minrow, int maxcol, int max
             int* ccptr3 = ipr + jmrm1;
             int* ccptr4 = imrm1 + jpr;
             state = *stateptr;
-            update_current_grid(state, *ccptr1 + *ccptr2 - *ccptr3 - *ccptr4);
+            update_current_grid(band, state, *ccptr1 + *ccptr2 - *ccptr3 - *ccptr4);
             *stateptr++ = state;
             if (state) {
-                if (j < minx) minx = j;
-                if (j > maxx) maxx = j;
+                if (j < band.minx) band.minx = j;
+                if (j > band.maxx) band.maxx = j;
                 rowchanged = true;
             }
         }
         if (rowchanged) {
-            if (i < miny) miny = i;
-            if (i > maxy) maxy = i;
+            if (i < band.miny) band.miny = i;
+            if (i > band.maxy) band.maxy = i;
             rowchanged = false;
         }
     }
@@ -1110,7 +1298,7 @@ void ltlalgo::faster_Moore_unbounded(int mincol, int minrow, int maxcol, int max
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::faster_Moore_unbounded2(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::faster_Moore_unbounded2(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     // use Adam P. Goucher's algorithm to calculate Moore neighborhood counts
     // in an unbounded universe; note that we can safely assume there is at least
@@ -1267,22 +1455,22 @@ void ltlalgo::faster_Moore_unbounded2(int mincol, int minrow, int maxcol, int ma
     if (*stateptr == 0) {
         if (births[ncount]) {
             *stateptr = 1;
-            population++;
-            minx = mincol;
-            maxx = mincol;
-            miny = minrow;
-            maxy = minrow;
+            band.population++;
+            band.minx = mincol;
+            band.maxx = mincol;
+            band.miny = minrow;
+            band.maxy = minrow;
         }
     } else {
         if (!survivals[ncount]) {
             *stateptr = 0;
-            population--;
+            band.population--;
         }
         else {
-            minx = mincol;
-            maxx = maxcol;
-            miny = minrow;
-            maxy = maxrow;
+            band.minx = mincol;
+            band.maxx = maxcol;
+            band.miny = minrow;
+            band.maxy = maxrow;
         }
     }
 
@@ -1297,27 +1485,27 @@ void ltlalgo::faster_Moore_unbounded2(int mincol, int minrow, int maxcol, int ma
         if (*stateptr == 0) {
             if (births[ncount]) {
                 *stateptr = 1;
-                population++;
-                if (j < minx) minx = j;
-                if (j > maxx) maxx = j;
+                band.population++;
+                if (j < band.minx) band.minx = j;
+                if (j > band.maxx) band.maxx = j;
                 rowchanged = true;
             }
         } else {
             if (!survivals[ncount]) {
                 *stateptr = 0;
-                population--;
+                band.population--;
             }
             else {
-                if (j < minx) minx = j;
-                if (j > maxx) maxx = j;
+                if (j < band.minx) band.minx = j;
+                if (j > band.maxx) band.maxx = j;
                 rowchanged = true;
             }
         }
         stateptr++;
     }
     if (rowchanged) {
-        if (minrow < miny) miny = minrow;
-        if (minrow > maxy) maxy = minrow;
+        if (minrow < band.miny) band.miny = minrow;
+        if (minrow > band.maxy) band.maxy = minrow;
     }
 
     bool colchanged = false;
@@ -1331,19 +1519,19 @@ void ltlalgo::faster_Moore_unbounded2(int mincol, int minrow, int maxcol, int ma
         if (*stateptr == 0) {
             if (births[ncount]) {
                 *stateptr = 1;
-                population++;
-                if (i < miny) miny = i;
-                if (i > maxy) maxy = i;
+                band.population++;
+                if (i < band.miny) band.miny = i;
+                if (i > band.maxy) band.maxy = i;
                 colchanged = true;
             }
         } else {
             if (!survivals[ncount]) {
                 *stateptr = 0;
-                population--;
+                band.population--;
             }
             else {
-                if (i < miny) miny = i;
-                if (i > maxy) maxy = i;
+                if (i < band.miny) band.miny = i;
+                if (i > band.maxy) band.maxy = i;
                 colchanged = true;
             }
         }
@@ -1352,8 +1540,8 @@ void ltlalgo::faster_Moore_unbounded2(int mincol, int minrow, int maxcol, int ma
         ccptr2 += outerwd;
     }
     if (colchanged) {
-        if (mincol < minx) minx = mincol;
-        if (mincol > maxx) maxx = mincol;
+        if (mincol < band.minx) band.minx = mincol;
+        if (mincol > band.maxx) band.maxx = mincol;
     }
     
     rowchanged = false;
@@ -1372,36 +1560,404 @@ void ltlalgo::faster_Moore_unbounded2(int mincol, int minrow, int maxcol, int ma
             if (*stateptr == 0) {
                 if (births[ncount]) {
                     *stateptr = 1;
-                    population++;
-                    if (j < minx) minx = j;
-                    if (j > maxx) maxx = j;
+                    band.population++;
+                    if (j < band.minx) band.minx = j;
+                    if (j > band.maxx) band.maxx = j;
                     rowchanged = true;
                 }
             } else {
                 if (!survivals[ncount]) {
                     *stateptr = 0;
-                    population--;
+                    band.population--;
                 }
                 else {
-                    if (j < minx) minx = j;
-                    if (j > maxx) maxx = j;
+                    if (j < band.minx) band.minx = j;
+                    if (j > band.maxx) band.maxx = j;
                     rowchanged = true;
                 }
             }
             stateptr++;
         }
         if (rowchanged) {
-            if (i < miny) miny = i;
-            if (i > maxy) maxy = i;
+            if (i < band.miny) band.miny = i;
+            if (i > band.maxy) band.maxy = i;
             rowchanged = false;
         }
     }
-    if (population == 0) empty_boundaries();
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Moore(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::Moore_parallel(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
+{
+    // this does the same as faster_Moore_* but in two passes that can each be
+    // split across threads; colcounts is indexed by grid position (like currgrid)
+    // and only needs to start at the row and column just above and left of the
+    // top left cell's neighborhood, except that in an unbounded universe those
+    // might be -1 (in which case row or column 0 is dead and does as well)
+    int orow = minrow - range - 1;
+    int ocol = mincol - range - 1;
+    if (orow < 0 && unbounded) orow = 0;
+    if (ocol < 0 && unbounded) ocol = 0;
+    int lastrow = maxrow + range;
+    int lastcol = maxcol + range;
+
+    // each band of rows in colcounts has cumulative counts starting from its own
+    // top row; the bands are at least 2*range+2 rows high so a neighborhood never
+    // covers more than two of them, and Moore_update then only needs to add in
+    // the last row of the upper band
+    int minht = 2 * range + 2;
+    if (minht < MINBANDROWS) minht = MINBANDROWS;
+    sumsht = band_height(orow, lastrow, numthreads, minht);
+    do_rows(band, MOORE_SUMS_PASS, orow, lastrow, ocol, lastcol, 0, 0, minht);
+    do_rows(band, MOORE_UPDATE_PASS, minrow, maxrow, mincol, maxcol, orow, ocol, MINBANDROWS);
+}
+
+// -----------------------------------------------------------------------------
+
+void ltlalgo::Moore_sums(int first, int last, int mincol, int maxcol)
+{
+    // calculate cumulative counts of state-1 cells in rows first..last and
+    // columns mincol..maxcol (relative to first and mincol) and store in colcounts
+    int* ccbase = colcounts + (unbounded ? 0 : border * outerwd + border);
+    int width = maxcol - mincol + 1;
+    vector<int> zeros(width, 0);
+    for (int i = first; i <= last; i++) {
+        unsigned char* cellptr = currgrid + i * outerwd + mincol;
+        int* ccptr = ccbase + i * outerwd + mincol;
+        int* prevptr = i > first ? ccptr - outerwd : &zeros[0];
+        int rowcount = 0;
+        int j = 0;
+
+        // process in 8 cell chunks so runs of dead cells are quick
+        while (j + 8 <= width) {
+            unsigned long long chunk;
+            memcpy(&chunk, cellptr + j, 8);
+            if (chunk) {
+                for (int k = j; k < j + 8; k++) {
+                    rowcount += cellptr[k] == 1;
+                    ccptr[k] = prevptr[k] + rowcount;
+                }
+            } else {
+                for (int k = j; k < j + 8; k++) {
+                    ccptr[k] = prevptr[k] + rowcount;
+                }
+            }
+            j += 8;
+        }
+        for (; j < width; j++) {
+            rowcount += cellptr[j] == 1;
+            ccptr[j] = prevptr[j] + rowcount;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void ltlalgo::Moore_update(ltlband& band, int first, int last, int mincol, int maxcol, int orow, int ocol)
+{
+    // calculate final neighborhood counts for rows first..last using the values
+    // in colcounts (which start at orow,ocol) and update the cells in current grid
+    int* ccbase = colcounts + (unbounded ? 0 : border * outerwd + border);
+    int width = maxcol - mincol + 1;
+    vector<int> counts(width);
+    int* ncount = &counts[0];
+    int rangep1 = range + 1;
+    for (int i = first; i <= last; i++) {
+        int top = i - rangep1;
+        if (top < orow) top = orow;
+        int* ipr = ccbase + (i + range) * outerwd;
+        int* imrm1 = ccbase + top * outerwd;
+        int j = mincol;
+        if ((i + range - orow) / sumsht == (top - orow) / sumsht) {
+            // both rows are in the same band of colcounts
+            if (j - rangep1 < ocol) {
+                ncount[0] = ipr[j+range] - imrm1[j+range] - ipr[ocol] + imrm1[ocol];
+                j++;
+            }
+            for (; j <= maxcol; j++) {
+                ncount[j-mincol] = ipr[j+range] - imrm1[j+range] - ipr[j-rangep1] + imrm1[j-rangep1];
+            }
+        } else {
+            // add in the last row of the band containing the top row
+            int* endptr = ccbase + (orow + ((top - orow) / sumsht + 1) * sumsht - 1) * outerwd;
+            if (j - rangep1 < ocol) {
+                ncount[0] = ipr[j+range] + endptr[j+range] - imrm1[j+range]
+                          - ipr[ocol] - endptr[ocol] + imrm1[ocol];
+                j++;
+            }
+            for (; j <= maxcol; j++) {
+                ncount[j-mincol] = ipr[j+range] + endptr[j+range] - imrm1[j+range]
+                                 - ipr[j-rangep1] - endptr[j-rangep1] + imrm1[j-rangep1];
+            }
+        }
+
+        unsigned char* stateptr = currgrid + i * outerwd + mincol;
+        if (maxCellStates == 2) {
+            int popchange = 0;
+            for (j = 0; j < width; j++) {
+                int state = stateptr[j];
+                const unsigned char* flags = state ? survivals : births;
+                int newstate = flags[ncount[j]];
+                popchange += newstate - state;
+                stateptr[j] = newstate;
+            }
+            band.population += popchange;
+        } else {
+            for (j = 0; j < width; j++) {
+                unsigned char state = stateptr[j];
+                update_current_grid(band, state, ncount[j]);
+                stateptr[j] = state;
+            }
+        }
+
+        // find the first and last live cells in the row
+        int firstlive = 0;
+        int lastlive = width - 1;
+        while (lastlive >= 0 && stateptr[lastlive] == 0) lastlive--;
+        while (firstlive < lastlive && stateptr[firstlive] == 0) firstlive++;
+        if (lastlive >= 0) {
+            if (firstlive + mincol < band.minx) band.minx = firstlive + mincol;
+            if (lastlive + mincol > band.maxx) band.maxx = lastlive + mincol;
+            if (i < band.miny) band.miny = i;
+            if (i > band.maxy) band.maxy = i;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void ltlalgo::Moore_packed(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
+{
+    // this does the same as faster_Moore_*2 but with the cells packed into bits
+    // so the neighborhood counts of 64 cells can be found at once; the first pass
+    // packs all the rows needed into packedcells and the second pass then updates
+    // the cells in currgrid
+
+    // find the counts where births and survivals switch on or off; a cell's count
+    // includes itself so can only be 0..maxn for births and 1..maxn+1 for survivals
+    int maxn = (2 * range + 1) * (2 * range + 1) - 1;
+    bedges.clear();
+    sedges.clear();
+    bool bprev = false;
+    bool sprev = false;
+    for (int i = 0; i <= maxn + 2; i++) {
+        bool b = i <= maxn && births[i];
+        bool s = i > 0 && i <= maxn + 1 && survivals[i];
+        if (b != bprev) bedges.push_back(i);
+        if (s != sprev) sedges.push_back(i);
+        bprev = b;
+        sprev = s;
+    }
+
+    // packedcells has a row for each row within range of minrow..maxrow; in each
+    // row mincol is bit 0 of word 1 and words 0 and packedwd-1 hold the cells
+    // within range of the left and right edges
+    int orow = minrow - range;
+    int lastrow = maxrow + range;
+    packedwd = (maxcol - mincol + 64) / 64 + 2;
+    size_t needed = (size_t)(lastrow - orow + 1) * packedwd;
+    if (needed > packedsize) {
+        if (packedcells) free(packedcells);
+        packedcells = (unsigned long long*) malloc(needed * sizeof(unsigned long long));
+        if (packedcells == NULL) lifefatal("Not enough memory for packed LtL grid!");
+        packedsize = needed;
+    }
+    do_rows(band, PACK_PASS, orow, lastrow, mincol, maxcol, orow, 0, MINBANDROWS);
+
+    // each band has to sum the rows above and below it before it can start
+    // so use taller bands than usual
+    int minht = 4 * range + 4;
+    if (minht < MINBANDROWS) minht = MINBANDROWS;
+    do_rows(band, PACKED_UPDATE_PASS, minrow, maxrow, mincol, maxcol, orow, 0, minht);
+}
+
+// -----------------------------------------------------------------------------
+
+void ltlalgo::pack_rows(int first, int last, int mincol, int maxcol, int orow)
+{
+    // pack the cells in rows first..last from mincol-range to maxcol+range
+    // into the matching rows of packedcells
+    int width = maxcol - mincol + 1;
+    for (int i = first; i <= last; i++) {
+        unsigned long long* rowptr = packedcells + (size_t)(i - orow) * packedwd;
+        memset(rowptr, 0, packedwd * sizeof(unsigned long long));
+        unsigned char* cellptr = currgrid + i * outerwd + mincol;
+        for (int j = -range; j < 0; j++) {
+            if (cellptr[j]) rowptr[0] |= 1ULL << (64 + j);
+        }
+        unsigned long long* wordptr = rowptr + 1;
+        int j = 0;
+        while (j + 8 <= width) {
+            unsigned long long chunk;
+            memcpy(&chunk, cellptr + j, 8);
+            if (chunk) wordptr[j >> 6] |= ((chunk * PACKMULT) >> 56) << (j & 63);
+            j += 8;
+        }
+        for (; j < width + range; j++) {
+            if (cellptr[j]) wordptr[j >> 6] |= 1ULL << (j & 63);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+static inline unsigned long long count_ge(const unsigned long long* count, int nbits, int n)
+{
+    // return the cells whose bit-sliced count is >= n
+    unsigned long long result = ~0ULL;
+    for (int b = 0; b < nbits; b++) {
+        if ((n >> b) & 1) {
+            result &= count[b];
+        } else {
+            result |= count[b];
+        }
+    }
+    return n >> nbits ? 0 : result;
+}
+
+static inline unsigned long long count_in(const unsigned long long* count, int nbits,
+                                          const vector<int>& edges)
+{
+    // return the cells whose count switches on a flag given by edges
+    unsigned long long result = 0;
+    for (size_t e = 0; e < edges.size(); e++) {
+        result ^= count_ge(count, nbits, edges[e]);
+    }
+    return result;
+}
+
+// -----------------------------------------------------------------------------
+
+template <int R>
+void ltlalgo::packed_update(ltlband& band, int first, int last, int mincol, int maxcol, int orow)
+{
+    // update rows first..last of currgrid using the cells in packedcells (which
+    // start at orow); the counts are kept bit-sliced, so bit j of rowsums[b]
+    // is bit b of the number of live cells in the 2R+1 cells centered on cell j,
+    // and likewise colsums for the sum of 2R+1 of these row counts
+    const int NCELLS = 2 * R + 1;
+    const int RBITS = NCELLS < 4 ? 2 : NCELLS < 8 ? 3 : 4;
+    const int NSUM = NCELLS * NCELLS;
+    const int CBITS = NSUM < 16 ? 4 : NSUM < 32 ? 5 : NSUM < 64 ? 6 : NSUM < 128 ? 7 : 8;
+    int width = maxcol - mincol + 1;
+    int nwords = (width + 63) >> 6;
+    unsigned long long lastmask = (width & 63) ? (1ULL << (width & 63)) - 1 : ~0ULL;
+    
+    // colsums has CBITS planes of nwords words; rowsums keeps the row counts of
+    // the last NCELLS+1 rows
+    vector<unsigned long long> sums((CBITS + (NCELLS + 1) * RBITS) * nwords, 0);
+    unsigned long long* colsums = &sums[0];
+    unsigned long long* rowsums = colsums + CBITS * nwords;
+
+    for (int y = first - R; y <= last + R; y++) {
+        const unsigned long long* rowptr = packedcells + (size_t)(y - orow) * packedwd + 1;
+        int slot = (y - first + R) % (NCELLS + 1);
+        unsigned long long* newsums = rowsums + slot * RBITS * nwords;
+        unsigned long long* oldsums = NULL;
+        if (y - NCELLS >= first - R) {
+            slot = (y - NCELLS - first + R) % (NCELLS + 1);
+            oldsums = rowsums + slot * RBITS * nwords;
+        }
+        int i = y - R;              // row to update (if >= first)
+        const unsigned long long* cellrow = packedcells + (size_t)(i - orow) * packedwd + 1;
+        unsigned char* stateptr = currgrid + i * outerwd + mincol;
+        int popchange = 0;
+        int firstword = -1, lastword = -1;
+        unsigned long long firstbits = 0, lastbits = 0;
+
+        for (int k = 0; k < nwords; k++) {
+            // add up the cells in row y within R of each cell in word k
+            unsigned long long mid = rowptr[k];
+            unsigned long long left = rowptr[k-1];
+            unsigned long long right = rowptr[k+1];
+            unsigned long long rs[RBITS];
+            rs[0] = mid;
+            for (int b = 1; b < RBITS; b++) rs[b] = 0;
+            for (int s = 1; s <= R; s++) {
+                unsigned long long a = (mid >> s) | (right << (64 - s));
+                unsigned long long c = (mid << s) | (left >> (64 - s));
+                // full adder then carry into the higher bits
+                unsigned long long carry = (rs[0] & a) | (rs[0] & c) | (a & c);
+                rs[0] ^= a ^ c;
+                for (int b = 1; b < RBITS; b++) {
+                    unsigned long long t = rs[b] & carry;
+                    rs[b] ^= carry;
+                    carry = t;
+                }
+            }
+
+            for (int b = 0; b < RBITS; b++) newsums[b * nwords + k] = rs[b];
+
+            // add the new row counts to colsums and subtract the counts of the
+            // row that is no longer in range
+            unsigned long long cs[CBITS];
+            unsigned long long carry = 0;
+            for (int b = 0; b < CBITS; b++) {
+                unsigned long long v = colsums[b * nwords + k];
+                unsigned long long r = b < RBITS ? rs[b] : 0;
+                cs[b] = v ^ r ^ carry;
+                carry = (v & r) | (carry & (v ^ r));
+            }
+            if (oldsums) {
+                unsigned long long borrow = 0;
+                for (int b = 0; b < CBITS; b++) {
+                    unsigned long long v = cs[b];
+                    unsigned long long r = b < RBITS ? oldsums[b * nwords + k] : 0;
+                    cs[b] = v ^ r ^ borrow;
+                    borrow = (~v & r) | (~(v ^ r) & borrow);
+                }
+            }
+            for (int b = 0; b < CBITS; b++) colsums[b * nwords + k] = cs[b];
+            if (i < first) continue;
+
+            // cs now has the neighborhood counts so apply the rule
+            unsigned long long mask = k == nwords - 1 ? lastmask : ~0ULL;
+            unsigned long long oldcells = cellrow[k] & mask;
+            unsigned long long newcells = ((oldcells & count_in(cs, CBITS, sedges)) |
+                                           (~oldcells & count_in(cs, CBITS, bedges))) & mask;
+            if (newcells) {
+                if (firstword < 0) {
+                    firstword = k;
+                    firstbits = newcells;
+                }
+                lastword = k;
+                lastbits = newcells;
+            }
+            if (newcells == oldcells) continue;
+            popchange += bitcount64(newcells) - bitcount64(oldcells);
+
+            // store the changed cells in currgrid
+            unsigned char* cellptr = stateptr + k * 64;
+            unsigned long long changed = newcells ^ oldcells;
+            int ncells = k == nwords - 1 ? width - k * 64 : 64;
+            for (int j = 0; j < ncells; j += 8) {
+                if (((changed >> j) & 0xff) == 0) continue;
+                if (j + 8 <= ncells) {
+                    memcpy(cellptr + j, &unpackbits[(newcells >> j) & 0xff], 8);
+                } else {
+                    for (int x = j; x < ncells; x++) cellptr[x] = (newcells >> x) & 1;
+                }
+            }
+        }
+        if (i < first) continue;
+        band.population += popchange;
+
+        // update the boundary of live cells
+        if (firstword >= 0) {
+            int x = mincol + firstword * 64 + lowestbit(firstbits);
+            if (x < band.minx) band.minx = x;
+            x = mincol + lastword * 64 + highestbit(lastbits);
+            if (x > band.maxx) band.maxx = x;
+            if (i < band.miny) band.miny = i;
+            if (i > band.maxy) band.maxy = i;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void ltlalgo::fast_Moore(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     if (range == 1) {
         for (int y = minrow; y <= maxrow; y++) {
@@ -1423,7 +1979,7 @@ void ltlalgo::fast_Moore(int mincol, int minrow, int maxcol, int maxrow)
                 if (*cellptr++ == 1) ncount++;
                 if (*cellptr++ == 1) ncount++;
                 if (*cellptr   == 1) ncount++;
-                update_next_grid(x, y, yoffset+x, ncount);
+                update_next_grid(band, x, y, yoffset+x, ncount);
             }
         }
     } else {
@@ -1462,7 +2018,7 @@ void ltlalgo::fast_Moore(int mincol, int minrow, int maxcol, int maxrow)
             //   | | | | | | | |
             //   ---------------
             
-            update_next_grid(mincol, y, yoffset+mincol, ncount);
+            update_next_grid(band, mincol, y, yoffset+mincol, ncount);
             
             // for the remaining cells in this row we only need to update
             // the count in the right column of the new neighborhood
@@ -1484,7 +2040,7 @@ void ltlalgo::fast_Moore(int mincol, int minrow, int maxcol, int maxrow)
                 }
                 colcount[rightcol] = rcount;
                 
-                update_next_grid(x, y, yoffset+x, ncount);
+                update_next_grid(band, x, y, yoffset+x, ncount);
             }
         }
     
@@ -1493,7 +2049,7 @@ void ltlalgo::fast_Moore(int mincol, int minrow, int maxcol, int maxrow)
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Shaped(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Shaped(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     for (int y = minrow; y <= maxrow; y++) {
         int yoffset = y * outerwd;
@@ -1511,7 +2067,7 @@ void ltlalgo::fast_Shaped(int mincol, int minrow, int maxcol, int maxrow)
                 if (cellptr[i] == 1) ncount++ ;
         }
            
-        update_next_grid(mincol, y, yoffset+mincol, ncount);
+        update_next_grid(band, mincol, y, yoffset+mincol, ncount);
         
         // for the remaining cells in this row we only need subtract
         // points in relevant rows and add points in other relevant
@@ -1527,7 +2083,7 @@ void ltlalgo::fast_Shaped(int mincol, int minrow, int maxcol, int maxrow)
                if (cp[xprange] == 1)
                   ncount++ ;
             }
-            update_next_grid(x, y, yoffset+x, ncount);
+            update_next_grid(band, x, y, yoffset+x, ncount);
         }
     }
 }
@@ -1578,77 +2134,78 @@ int ltlalgo::getcount(int i, int j)
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::faster_Neumann_bounded(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::Neumann_colcounts(int mincol, int minrow)
 {
-    // use Dean Hickerson's algorithm (based on Adam P. Goucher's algorithm for the
-    // Moore neighborhood) to calculate extended von Neumann neighborhood counts
-    // in a bounded universe; note that currgrid is surrounded by a border that
-    // might contain live cells (the border is range+1 cells thick and the
-    // outermost cells are always dead)
-    
-    // the given limits are relative to currgrid so we need to add border
-    // so they are relative to outergrid1, and then expand them by range
-    int bmr = border - range;
-    int bpr = border + range;
-    minrow += bmr;
-    mincol += bmr;
-    maxrow += bpr;
-    maxcol += bpr;
-    
-    // set variables used below and in getcount
-    nrows = maxrow - minrow + 1;
-    ncols = maxcol - mincol + 1;
-    ccht = nrows + (ncols-1)/2;
-    halfccwd = ncols/2;
-
-    // calculate cumulative counts in top left corner of colcounts
+    // calculate cumulative counts in top left corner of colcounts for the
+    // nrows by ncols rectangle whose top left cell is at mincol,minrow in outergrid1
     for (int i = 0; i < ccht; i++) {
         int* Coffset = colcounts + i * outerwd;
-        unsigned char* Goffset = outergrid1 + (i + minrow) * outerwd;
+        unsigned char* Goffset = outergrid1 + (i + minrow) * outerwd + mincol;
         int im1 = i - 1;
         int im2 = im1 - 1;
-        for (int j = 0; j < ncols; j++) {
-            int* Cij = Coffset + j;
-            *Cij = getcount(im1,j-1) + getcount(im1,j+1) - getcount(im2,j);
-            if (i < nrows) {
-                unsigned char* Gij = Goffset + j + mincol;
-                if (*Gij == 1) *Cij += *Gij;
+        if (i < 2 || ncols < 3) {
+            for (int j = 0; j < ncols; j++) {
+                int* Cij = Coffset + j;
+                *Cij = getcount(im1,j-1) + getcount(im1,j+1) - getcount(im2,j);
+                if (i < nrows) {
+                    unsigned char* Gij = Goffset + j;
+                    if (*Gij == 1) *Cij += *Gij;
+                }
+            }
+            continue;
+        }
+        // every getcount call for 0 < j < ncols-1 just reads the previous two rows
+        // so only the end columns need checking and the rest of the row vectorizes
+        int last = ncols - 1;
+        Coffset[0] = getcount(im1,-1) + getcount(im1,1) - getcount(im2,0);
+        Coffset[last] = getcount(im1,last-1) + getcount(im1,last+1) - getcount(im2,last);
+        int* C1 = Coffset - outerwd;
+        int* C2 = C1 - outerwd;
+        for (int j = 1; j < last; j++) {
+            Coffset[j] = C1[j-1] + C1[j+1] - C2[j];
+        }
+        if (i < nrows) {
+            for (int j = 0; j <= last; j++) {
+                Coffset[j] += Goffset[j] == 1;
             }
         }
     }
-    
-    // set minrow and mincol for update_current_grid calls
-    minrow -= border;
-    mincol -= border;
+}
 
-    // calculate final neighborhood counts and update the corresponding cells in the grid
+// -----------------------------------------------------------------------------
+
+void ltlalgo::Neumann_update(ltlband& band, int first, int last, int jfirst, int jlast, int orow, int ocol)
+{
+    // calculate final neighborhood counts for rows first..last and columns jfirst..jlast
+    // of the colcounts rectangle and update the corresponding cells in the grid
+    // (orow,ocol is the grid position of the rectangle's top left cell)
     bool rowchanged = false;
-    for (int i = range; i < nrows-range; i++) {
+    for (int i = first; i <= last; i++) {
         int im1 = i - 1;
         int ipr = i + range;
         int iprm1 = ipr - 1;
         int imrm1 = i - range - 1;
         int imrm2 = imrm1 - 1;
-        int ipminrow = i + minrow;
-        unsigned char* stateptr = currgrid + ipminrow*outerwd + range + mincol;
-        for (int j = range; j < ncols-range; j++) {
+        int iporow = i + orow;
+        unsigned char* stateptr = currgrid + iporow*outerwd + jfirst + ocol;
+        for (int j = jfirst; j <= jlast; j++) {
             int jpr = j + range;
             int jmr = j - range;
             int n = getcount(ipr,j)   - getcount(im1,jpr+1) - getcount(im1,jmr-1) + getcount(imrm2,j) +
                     getcount(iprm1,j) - getcount(im1,jpr)   - getcount(im1,jmr)   + getcount(imrm1,j);
             unsigned char state = *stateptr;
-            update_current_grid(state, n);
+            update_current_grid(band, state, n);
             *stateptr++ = state;
             if (state) {
-                int jpmincol = j + mincol;
-                if (jpmincol < minx) minx = jpmincol;
-                if (jpmincol > maxx) maxx = jpmincol;
+                int jpocol = j + ocol;
+                if (jpocol < band.minx) band.minx = jpocol;
+                if (jpocol > band.maxx) band.maxx = jpocol;
                 rowchanged = true;
             }
         }
         if (rowchanged) {
-            if (ipminrow < miny) miny = ipminrow;
-            if (ipminrow > maxy) maxy = ipminrow;
+            if (iporow < band.miny) band.miny = iporow;
+            if (iporow > band.maxy) band.maxy = iporow;
             rowchanged = false;
         }
     }
@@ -1656,7 +2213,42 @@ void ltlalgo::faster_Neumann_bounded(int mincol, int minrow, int maxcol, int max
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::faster_Neumann_unbounded(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::faster_Neumann_bounded(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
+{
+    // use Dean Hickerson's algorithm (based on Adam P. Goucher's algorithm for the
+    // Moore neighborhood) to calculate extended von Neumann neighborhood counts
+    // in a bounded universe; note that currgrid is surrounded by a border that
+    // might contain live cells (the border is range+1 cells thick and the
+    // outermost cells are always dead)
+    
+    // the given limits are relative to currgrid so we need to add border
+    // so they are relative to outergrid1, and then expand them by range
+    int bmr = border - range;
+    int bpr = border + range;
+    minrow += bmr;
+    mincol += bmr;
+    maxrow += bpr;
+    maxcol += bpr;
+    
+    // set variables used below and in getcount
+    nrows = maxrow - minrow + 1;
+    ncols = maxcol - mincol + 1;
+    ccht = nrows + (ncols-1)/2;
+    halfccwd = ncols/2;
+
+    Neumann_colcounts(mincol, minrow);
+    
+    // set minrow and mincol for update_current_grid calls
+    minrow -= border;
+    mincol -= border;
+
+    // calculate final neighborhood counts and update the corresponding cells in the grid
+    do_rows(band, NEUMANN_UPDATE_PASS, range, nrows-range-1, range, ncols-range-1, minrow, mincol, MINBANDROWS);
+}
+
+// -----------------------------------------------------------------------------
+
+void ltlalgo::faster_Neumann_unbounded(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     // use Dean Hickerson's algorithm (based on Adam P. Goucher's algorithm for the
     // Moore neighborhood) to calculate extended von Neumann neighborhood counts
@@ -1669,58 +2261,15 @@ void ltlalgo::faster_Neumann_unbounded(int mincol, int minrow, int maxcol, int m
     ccht = nrows + (ncols-1)/2;
     halfccwd = ncols/2;
 
-    // calculate cumulative counts in top left corner of colcounts
-    for (int i = 0; i < ccht; i++) {
-        int* Coffset = colcounts + i * outerwd;
-        unsigned char* Goffset = outergrid1 + (i + minrow) * outerwd;
-        int im1 = i - 1;
-        int im2 = im1 - 1;
-        for (int j = 0; j < ncols; j++) {
-            int* Cij = Coffset + j;
-            *Cij = getcount(im1,j-1) + getcount(im1,j+1) - getcount(im2,j);
-            if (i < nrows) {
-                unsigned char* Gij = Goffset + j + mincol;
-                if (*Gij == 1) *Cij += *Gij;
-            }
-        }
-    }
+    Neumann_colcounts(mincol, minrow);
 
     // calculate final neighborhood counts and update the corresponding cells in the grid
-    bool rowchanged = false;
-    for (int i = 0; i < nrows; i++) {
-        int im1 = i - 1;
-        int ipr = i + range;
-        int iprm1 = ipr - 1;
-        int imrm1 = i - range - 1;
-        int imrm2 = imrm1 - 1;
-        int ipminrow = i + minrow;
-        unsigned char* stateptr = currgrid + ipminrow*outerwd + mincol;
-        for (int j = 0; j < ncols; j++) {
-            int jpr = j + range;
-            int jmr = j - range;
-            int n = getcount(ipr,j)   - getcount(im1,jpr+1) - getcount(im1,jmr-1) + getcount(imrm2,j) +
-                    getcount(iprm1,j) - getcount(im1,jpr)   - getcount(im1,jmr)   + getcount(imrm1,j);
-            unsigned char state = *stateptr;
-            update_current_grid(state, n);
-            *stateptr++ = state;
-            if (state) {
-                int jpmincol = j + mincol;
-                if (jpmincol < minx) minx = jpmincol;
-                if (jpmincol > maxx) maxx = jpmincol;
-                rowchanged = true;
-            }
-        }
-        if (rowchanged) {
-            if (ipminrow < miny) miny = ipminrow;
-            if (ipminrow > maxy) maxy = ipminrow;
-            rowchanged = false;
-        }
-    }
+    do_rows(band, NEUMANN_UPDATE_PASS, 0, nrows-1, 0, ncols-1, minrow, mincol, MINBANDROWS);
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Asterisk(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Asterisk(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     for (int y = minrow; y <= maxrow; y++) {
         int yoffset = y * outerwd;
@@ -1742,14 +2291,14 @@ void ltlalgo::fast_Asterisk(int mincol, int minrow, int maxcol, int maxrow)
                 if (cp1[x + j] == 1) ncount++;
             }
 
-            update_next_grid(x, y, yoffset+x, ncount);
+            update_next_grid(band, x, y, yoffset+x, ncount);
         }
     }
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Tripod(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Tripod(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     for (int y = minrow; y <= maxrow; y++) {
         int yoffset = y * outerwd;
@@ -1769,14 +2318,14 @@ void ltlalgo::fast_Tripod(int mincol, int minrow, int maxcol, int maxrow)
                 if (cp1[x + j] == 1) ncount++;
             }
 
-            update_next_grid(x, y, yoffset+x, ncount);
+            update_next_grid(band, x, y, yoffset+x, ncount);
         }
     }
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Weighted(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Weighted(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     const int nsize = (range + range + 1);
     const int brow = (nsize - 1) * nsize;
@@ -1808,7 +2357,7 @@ void ltlalgo::fast_Weighted(int mincol, int minrow, int maxcol, int maxrow)
                     k += l;
                 }
     
-                update_next_grid(x, y, yoffset+x, ncount);
+                update_next_grid(band, x, y, yoffset+x, ncount);
             }
         }
     } else {
@@ -1847,7 +2396,7 @@ void ltlalgo::fast_Weighted(int mincol, int minrow, int maxcol, int maxrow)
                     k += l;
                 }
     
-                update_next_grid(x, y, yoffset+x, ncount);
+                update_next_grid(band, x, y, yoffset+x, ncount);
             }
         }
     }
@@ -1855,7 +2404,7 @@ void ltlalgo::fast_Weighted(int mincol, int minrow, int maxcol, int maxrow)
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Custom(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Custom(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     for (int y = minrow; y <= maxrow; y++) {
         int yoffset = y * outerwd;
@@ -1880,14 +2429,14 @@ void ltlalgo::fast_Custom(int mincol, int minrow, int maxcol, int maxrow)
                 j += k;
             }
 
-            update_next_grid(x, y, yoffset+x, ncount);
+            update_next_grid(band, x, y, yoffset+x, ncount);
         }
     }
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Hash(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Hash(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     for (int y = minrow; y <= maxrow; y++) {
         int yoffset = y * outerwd;
@@ -1921,7 +2470,7 @@ void ltlalgo::fast_Hash(int mincol, int minrow, int maxcol, int maxrow)
             if (cp2[x + 1] == 1) ncount++;
         }
         ncount += rowcount1 + rowcount2;
-        update_next_grid(x, y, yoffset+x, ncount);
+        update_next_grid(band, x, y, yoffset+x, ncount);
 
         // for remaining columns subtract the left and add the right cells
         for (int x = mincol + 1; x <= maxcol; x++) {
@@ -1950,14 +2499,14 @@ void ltlalgo::fast_Hash(int mincol, int minrow, int maxcol, int maxrow)
             }
             ncount += rowcount1 + rowcount2;
 
-            update_next_grid(x, y, yoffset+x, ncount);
+            update_next_grid(band, x, y, yoffset+x, ncount);
         }
     }
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_CheckerBoth(int mincol, int minrow, int maxcol, int maxrow, int start)
+void ltlalgo::fast_CheckerBoth(ltlband& band, int mincol, int minrow, int maxcol, int maxrow, int start)
 {
     int topoffset = range * outerwd;
     for (int y = minrow; y <= maxrow; y++) {
@@ -1982,7 +2531,7 @@ void ltlalgo::fast_CheckerBoth(int mincol, int minrow, int maxcol, int maxrow, i
             if (cellptr[x] == 1) ncount++;
 	  }
 
-        update_next_grid(x, y, yoffset+x, ncount);
+        update_next_grid(band, x, y, yoffset+x, ncount);
         x++;
 
         // check if there are two cells in the row
@@ -2002,7 +2551,7 @@ void ltlalgo::fast_CheckerBoth(int mincol, int minrow, int maxcol, int maxrow, i
                 if (cellptr[x] == 1) ncount2++;
 		}
 
-            update_next_grid(x, y, yoffset+x, ncount2);
+            update_next_grid(band, x, y, yoffset+x, ncount2);
             x++;
 
             // for the remaining cell pairs on the row subtract the left and add the right cells
@@ -2020,7 +2569,7 @@ void ltlalgo::fast_CheckerBoth(int mincol, int minrow, int maxcol, int maxrow, i
                     if (cellptr[x - 2] == 1) ncount--;
                     if (cellptr[x] == 1) ncount++;
 		    }
-                update_next_grid(x, y, yoffset+x, ncount);
+                update_next_grid(band, x, y, yoffset+x, ncount);
                 x += 1;
 
                 if (x <= maxcol) {
@@ -2037,7 +2586,7 @@ void ltlalgo::fast_CheckerBoth(int mincol, int minrow, int maxcol, int maxrow, i
                         if (cellptr[x - 2] == 1) ncount2--;
                         if (cellptr[x] == 1) ncount2++;
 			  }
-                    update_next_grid(x, y, yoffset+x, ncount2);
+                    update_next_grid(band, x, y, yoffset+x, ncount2);
                     x += 1;
                 }
             }
@@ -2047,21 +2596,21 @@ void ltlalgo::fast_CheckerBoth(int mincol, int minrow, int maxcol, int maxrow, i
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Aligned(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Aligned(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
-	fast_CheckerBoth(mincol, minrow, maxcol, maxrow, 0);
+	fast_CheckerBoth(band, mincol, minrow, maxcol, maxrow, 0);
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Checker(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Checker(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
-	fast_CheckerBoth(mincol, minrow, maxcol, maxrow, 1);
+	fast_CheckerBoth(band, mincol, minrow, maxcol, maxrow, 1);
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Hex(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Hex(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     for (int y = minrow; y <= maxrow; y++) {
         int yoffset = y * outerwd;
@@ -2081,7 +2630,7 @@ void ltlalgo::fast_Hex(int mincol, int minrow, int maxcol, int maxrow)
                 if (cp1[x + i] == 1) ncount++;
             }
         }
-        update_next_grid(x, y, yoffset+x, ncount);
+        update_next_grid(band, x, y, yoffset+x, ncount);
 
         // for remaining columns subtract the left and add the right cells
         for (int x = mincol + 1; x <= maxcol; x++) {
@@ -2094,14 +2643,14 @@ void ltlalgo::fast_Hex(int mincol, int minrow, int maxcol, int maxrow)
                 if (cp1[x - range + j - 1] == 1) ncount--;
                 if (cp1[x + range] == 1)         ncount++;
             }
-            update_next_grid(x, y, yoffset+x, ncount);
+            update_next_grid(band, x, y, yoffset+x, ncount);
         }
     }
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Saltire(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Saltire(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     for (int y = minrow; y <= maxrow; y++) {
         int yoffset = y * outerwd;
@@ -2118,14 +2667,14 @@ void ltlalgo::fast_Saltire(int mincol, int minrow, int maxcol, int maxrow)
                 if (cp2[x - j] == 1) ncount++;
                 if (cp2[x + j] == 1) ncount++;
             }
-            update_next_grid(x, y, yoffset+x, ncount);
+            update_next_grid(band, x, y, yoffset+x, ncount);
         }
     }
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Star(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Star(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     for (int y = minrow; y <= maxrow; y++) {
         int yoffset = y * outerwd;
@@ -2149,7 +2698,7 @@ void ltlalgo::fast_Star(int mincol, int minrow, int maxcol, int maxrow)
             if (cellptr[x + j] == 1) rowcount++;
         }
         ncount += rowcount;
-        update_next_grid(x, y, yoffset+x, ncount);
+        update_next_grid(band, x, y, yoffset+x, ncount);
 
         // for remaining columns subtract the left and add the right cells
         for (int x = mincol + 1; x <= maxcol; x++) {
@@ -2168,14 +2717,14 @@ void ltlalgo::fast_Star(int mincol, int minrow, int maxcol, int maxrow)
             if (cellptr[x + range] == 1)     rowcount++;
             ncount += rowcount;
 
-            update_next_grid(x, y, yoffset+x, ncount);
+            update_next_grid(band, x, y, yoffset+x, ncount);
         }
     }
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Cross(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Cross(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     for (int y = minrow; y <= maxrow; y++) {
         int yoffset = y * outerwd;
@@ -2195,7 +2744,7 @@ void ltlalgo::fast_Cross(int mincol, int minrow, int maxcol, int maxrow)
             if (cellptr[x + j] == 1) rowcount++;
         }
         ncount += rowcount;
-        update_next_grid(x, y, yoffset+x, ncount);
+        update_next_grid(band, x, y, yoffset+x, ncount);
 
         // for remaining columns subtract the left and add the right cells
         for (int x = mincol + 1; x <= maxcol; x++) {
@@ -2210,14 +2759,14 @@ void ltlalgo::fast_Cross(int mincol, int minrow, int maxcol, int maxrow)
             if (cellptr[x + range] == 1)     rowcount++;
             ncount += rowcount;
 
-            update_next_grid(x, y, yoffset+x, ncount);
+            update_next_grid(band, x, y, yoffset+x, ncount);
         }
     }
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Triangular(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Triangular(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     // vertical range is half range
     int halfr = range >> 1;
@@ -2261,7 +2810,7 @@ void ltlalgo::fast_Triangular(int mincol, int minrow, int maxcol, int maxrow)
                 }
             }
         }
-        update_next_grid(x, y, yoffset+x, ncount);
+        update_next_grid(band, x, y, yoffset+x, ncount);
         x++;
 
         // for the remaining cells compute the edge differences
@@ -2308,7 +2857,7 @@ void ltlalgo::fast_Triangular(int mincol, int minrow, int maxcol, int maxrow)
                     if (cp1[x + l + 1] == 1) ncount++;
                 }
             }
-            update_next_grid(x, y, yoffset+x, ncount);
+            update_next_grid(band, x, y, yoffset+x, ncount);
             x++;
         }
     }
@@ -2316,7 +2865,7 @@ void ltlalgo::fast_Triangular(int mincol, int minrow, int maxcol, int maxrow)
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Gaussian(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Gaussian(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     int topoffset = range * outerwd;
     for (int y = minrow; y <= maxrow; y++) {
@@ -2366,14 +2915,14 @@ void ltlalgo::fast_Gaussian(int mincol, int minrow, int maxcol, int maxrow)
             }
             if (cellptr[x]) ncount++;
 
-            update_next_grid(x, y, yoffset+x, ncount);
+            update_next_grid(band, x, y, yoffset+x, ncount);
         }
     }
 }
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::fast_Neumann(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::fast_Neumann(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
 {
     if (range == 1) {
         int outerwd2 = outerwd * 2;
@@ -2393,7 +2942,7 @@ void ltlalgo::fast_Neumann(int mincol, int minrow, int maxcol, int maxrow)
                 if (*--cellptr == 1) ncount++;
                 cellptr += outerwd2;
                 if (*cellptr   == 1) ncount++;
-                update_next_grid(x, y, yoffset+x, ncount);
+                update_next_grid(band, x, y, yoffset+x, ncount);
             }
         }
     } else {
@@ -2428,7 +2977,7 @@ void ltlalgo::fast_Neumann(int mincol, int minrow, int maxcol, int maxrow)
                     xoffset--;          // range-1, ..., 2, 1, 0
                     rowptr += outerwd;
                 }
-                update_next_grid(x, y, yoffset+x, ncount);
+                update_next_grid(band, x, y, yoffset+x, ncount);
             }
         }
     }
@@ -2436,38 +2985,130 @@ void ltlalgo::fast_Neumann(int mincol, int minrow, int maxcol, int maxrow)
 
 // -----------------------------------------------------------------------------
 
-void ltlalgo::do_gen(int mincol, int minrow, int maxcol, int maxrow)
+void ltlalgo::setNumThreads(int n)
 {
-    // check for B0 emulation
-    unsigned char* saveb = births;
-    unsigned char* saves = survivals;
+    poller->bailIfCalculating();
+    lifealgo::setNumThreads(n);
+    if (mt && mt->threads.size() != numthreads) {
+        delete mt;
+        mt = NULL;
+    }
+}
 
-    if (b0 && getGeneration().odd()) {
-        births = altbirths;
-        survivals = altsurvivals;
+// -----------------------------------------------------------------------------
+
+void ltlalgo::do_rows(ltlband& band, int pass, int first, int last, int mincol, int maxcol, int orow, int ocol, int minht)
+{
+    if (first > last) return;
+    int ht = band_height(first, last, numthreads, minht);
+    int nbands = (last - first + ht) / ht;
+    vector<ltltask> tasks(nbands);
+    for (int i = 0; i < nbands; i++) {
+        ltltask& t = tasks[i];
+        t.algo = this;
+        t.band = band;
+        t.band.population = 0;
+        t.pass = pass;
+        t.first = first + i * ht;
+        t.last = t.first + ht - 1;
+        if (t.last > last) t.last = last;
+        t.mincol = mincol;
+        t.maxcol = maxcol;
+        t.orow = orow;
+        t.ocol = ocol;
+    }
+    if (nbands == 1) {
+        run_pass(tasks[0]);
+    } else {
+        if (mt == NULL) mt = new ltlmt(numthreads);
+        lifetaskgroup g;
+        for (int i = 1; i < nbands; i++) mt->threads.spawn(0, &tasks[i], g);
+        run_pass(tasks[0]);
+        mt->threads.wait(0, g);
+    }
+    
+    // combine the results from each band
+    for (int i = 0; i < nbands; i++) {
+        ltlband& b = tasks[i].band;
+        band.population += b.population;
+        if (b.minx < band.minx) band.minx = b.minx;
+        if (b.maxx > band.maxx) band.maxx = b.maxx;
+        if (b.miny < band.miny) band.miny = b.miny;
+        if (b.maxy > band.maxy) band.maxy = b.maxy;
     }
+}
 
+// -----------------------------------------------------------------------------
+
+void ltlalgo::run_pass(ltltask& t)
+{
+    switch (t.pass) {
+        case GEN_PASS:
+            do_band(t.band, t.mincol, t.first, t.maxcol, t.last);
+            break;
+
+        case MOORE_SUMS_PASS:
+            Moore_sums(t.first, t.last, t.mincol, t.maxcol);
+            break;
+
+        case MOORE_UPDATE_PASS:
+            Moore_update(t.band, t.first, t.last, t.mincol, t.maxcol, t.orow, t.ocol);
+            break;
+
+        case NEUMANN_UPDATE_PASS:
+            Neumann_update(t.band, t.first, t.last, t.mincol, t.maxcol, t.orow, t.ocol);
+            break;
+
+        case PACK_PASS:
+            pack_rows(t.first, t.last, t.mincol, t.maxcol, t.orow);
+            break;
+
+        case PACKED_UPDATE_PASS:
+            switch (range) {
+                case 1: packed_update<1>(t.band, t.first, t.last, t.mincol, t.maxcol, t.orow); break;
+                case 2: packed_update<2>(t.band, t.first, t.last, t.mincol, t.maxcol, t.orow); break;
+                case 3: packed_update<3>(t.band, t.first, t.last, t.mincol, t.maxcol, t.orow); break;
+                case 4: packed_update<4>(t.band, t.first, t.last, t.mincol, t.maxcol, t.orow); break;
+                case 5: packed_update<5>(t.band, t.first, t.last, t.mincol, t.maxcol, t.orow); break;
+                case 6: packed_update<6>(t.band, t.first, t.last, t.mincol, t.maxcol, t.orow); break;
+                case 7: packed_update<7>(t.band, t.first, t.last, t.mincol, t.maxcol, t.orow); break;
+                default: lifefatal("Unexpected range in Moore_packed!");
+            }
+            break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void ltlalgo::do_band(ltlband& band, int mincol, int minrow, int maxcol, int maxrow)
+{
     switch (ntype) {
         case 'M':
-            if (unbounded) {
-                if (colcounts) {
+            if (packed) {
+                Moore_packed(band, mincol, minrow, maxcol, maxrow);
+            } else if (unbounded) {
+                if (colcounts && numthreads > 1) {
+                    Moore_parallel(band, mincol, minrow, maxcol, maxrow);
+                } else if (colcounts) {
                     if (maxCellStates == 2) {
-                        faster_Moore_unbounded2(mincol, minrow, maxcol, maxrow);
+                        faster_Moore_unbounded2(band, mincol, minrow, maxcol, maxrow);
                     } else {
-                        faster_Moore_unbounded(mincol, minrow, maxcol, maxrow);
+                        faster_Moore_unbounded(band, mincol, minrow, maxcol, maxrow);
                     }
                 } else {
-                    fast_Moore(mincol, minrow, maxcol, maxrow);
+                    fast_Moore(band, mincol, minrow, maxcol, maxrow);
                 }
             } else {
-                if (colcounts) {
+                if (colcounts && numthreads > 1) {
+                    Moore_parallel(band, mincol, minrow, maxcol, maxrow);
+                } else if (colcounts) {
                     if (maxCellStates == 2) {
-                        faster_Moore_bounded2(mincol, minrow, maxcol, maxrow);
+                        faster_Moore_bounded2(band, mincol, minrow, maxcol, maxrow);
                     } else {
-                        faster_Moore_bounded(mincol, minrow, maxcol, maxrow);
+                        faster_Moore_bounded(band, mincol, minrow, maxcol, maxrow);
                     }
                 } else {
-                    fast_Moore(mincol, minrow, maxcol, maxrow);
+                    fast_Moore(band, mincol, minrow, maxcol, maxrow);
                 }
             }
             break;
@@ -2475,81 +3116,116 @@ void ltlalgo::do_gen(int mincol, int minrow, int maxcol, int maxrow)
         case 'N':
             if (unbounded) {
                 if (colcounts) {
-                    faster_Neumann_unbounded(mincol, minrow, maxcol, maxrow);
+                    faster_Neumann_unbounded(band, mincol, minrow, maxcol, maxrow);
                 } else {
-                    fast_Neumann(mincol, minrow, maxcol, maxrow);
+                    fast_Neumann(band, mincol, minrow, maxcol, maxrow);
                 }
             } else {
                 if (colcounts) {
-                    faster_Neumann_bounded(mincol, minrow, maxcol, maxrow);
+                    faster_Neumann_bounded(band, mincol, minrow, maxcol, maxrow);
                 } else {
-                    fast_Neumann(mincol, minrow, maxcol, maxrow);
+                    fast_Neumann(band, mincol, minrow, maxcol, maxrow);
                 }
             }
             break;
 
         case 'C':
         case '2':
-            fast_Shaped(mincol, minrow, maxcol, maxrow);
+            fast_Shaped(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case 'A':
-            fast_Asterisk(mincol, minrow, maxcol, maxrow);
+            fast_Asterisk(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case '3':
-            fast_Tripod(mincol, minrow, maxcol, maxrow);
+            fast_Tripod(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case 'W':
-            fast_Weighted(mincol, minrow, maxcol, maxrow);
+            fast_Weighted(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case '@':
-            fast_Custom(mincol, minrow, maxcol, maxrow);
+            fast_Custom(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case '#':
-            fast_Hash(mincol, minrow, maxcol, maxrow);
+            fast_Hash(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case 'B':
-            fast_Checker(mincol, minrow, maxcol, maxrow);
+            fast_Checker(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case 'D':
-            fast_Aligned(mincol, minrow, maxcol, maxrow);
+            fast_Aligned(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case 'H':
-            fast_Hex(mincol, minrow, maxcol, maxrow);
+            fast_Hex(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case 'X':
-            fast_Saltire(mincol, minrow, maxcol, maxrow);
+            fast_Saltire(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case '*':
-            fast_Star(mincol, minrow, maxcol, maxrow);
+            fast_Star(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case '+':
-            fast_Cross(mincol, minrow, maxcol, maxrow);
+            fast_Cross(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case 'L':
-            fast_Triangular(mincol, minrow, maxcol, maxrow);
+            fast_Triangular(band, mincol, minrow, maxcol, maxrow);
             break;
 
         case 'G':
-            fast_Gaussian(mincol, minrow, maxcol, maxrow);
+            fast_Gaussian(band, mincol, minrow, maxcol, maxrow);
             break;
 
         default:
-            lifefatal("unknown neighborhood in do_gen");
+            lifefatal("unknown neighborhood in do_band");
             break;
     }
 
+}
+
+// -----------------------------------------------------------------------------
+
+void ltlalgo::do_gen(int mincol, int minrow, int maxcol, int maxrow)
+{
+    // check for B0 emulation
+    unsigned char* saveb = births;
+    unsigned char* saves = survivals;
+
+    if (b0 && getGeneration().odd()) {
+        births = altbirths;
+        survivals = altsurvivals;
+    }
+
+    ltlband band;
+    band.population = 0;
+    band.minx = minx;
+    band.miny = miny;
+    band.maxx = maxx;
+    band.maxy = maxy;
+
+    if (colcounts || packed) {
+        // the faster_* and Moore_packed routines split their own passes into bands
+        do_band(band, mincol, minrow, maxcol, maxrow);
+    } else {
+        do_rows(band, GEN_PASS, minrow, maxrow, mincol, maxcol, 0, 0, MINBANDROWS);
+    }
+
+    population += band.population;
+    minx = band.minx;
+    miny = band.miny;
+    maxx = band.maxx;
+    maxy = band.maxy;
+
     // reset births and survivals
     births = saveb;
     survivals = saves;
@@ -2714,7 +3390,7 @@ void ltlalgo::do_bounded_gen()
     do_gen(mincol, minrow, maxcol, maxrow);
 
     // if using one grid with a torus then clear border cells copied above
-    if (colcounts && torus) {
+    if ((colcounts || packed) && torus) {
         if (sminy < range) {
             // clear cells in bottom border
             int numrows = range - sminy;
@@ -3848,9 +4524,11 @@ const char *ltlalgo::setrule(const char *s)
     // the given rule is valid
     int oldrange = range;
     char oldtype = ntype;
+    bool oldpacked = packed;
     int scount = c;
     range = r;
     ntype = n;
+    packed = n == 'M' && c <= 2 && r <= MAXPACKEDRANGE;
     topology = t;
     if (births) free(births);
     births = bs;
@@ -3909,7 +4587,8 @@ const char *ltlalgo::setrule(const char *s)
         
         // if the new size is different or range has changed or ntype has changed
         // or the old universe is unbounded then we need to create new grids
-        if (gwd != newwd || ght != newht || range != oldrange || ntype != oldtype || unbounded) {
+        if (gwd != newwd || ght != newht || range != oldrange || ntype != oldtype ||
+            packed != oldpacked || unbounded) {
             if (population > 0) {
                 save_cells();       // store the current pattern in cell_list
             }
@@ -3973,12 +4652,13 @@ const char *ltlalgo::setrule(const char *s)
             gridright = gright;
         }
 
-        // reallocate colcounts if ntype has changed
-        if (ntype != oldtype) {
+        // reallocate colcounts if ntype has changed or Moore_packed is no longer
+        // (or now) used
+        if (ntype != oldtype || packed != oldpacked) {
             allocate_colcounts();
         }
         
-        if (colcounts == NULL && outergrid2 == NULL) {
+        if (colcounts == NULL && outergrid2 == NULL && !packed) {
             // this can happen if previous rule used NM and was unbounded,
             // and new rule uses NN and is unbounded and range <= SMALL_NN_RANGE
             outergrid2 = (unsigned char*) calloc(outerbytes, sizeof(unsigned char));
@@ -3986,8 +4666,8 @@ const char *ltlalgo::setrule(const char *s)
             nextgrid = outergrid2;
         }
 
-        if (colcounts && outergrid2) {
-            // faster_* calls don't use outergrid2, so we deallocate it and
+        if ((colcounts || packed) && outergrid2) {
+            // faster_* and Moore_packed calls don't use outergrid2, so we deallocate it and
             // reset it to NULL (also necessary for test in step() loop)
             free(outergrid2);
             outergrid2 = NULL;
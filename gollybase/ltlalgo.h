@@ -10,6 +10,9 @@
 #include "liferules.h"  // for MAXRULESIZE
 #include <vector>
 
+struct ltlmt;
+struct ltltask;
+
 class ltlalgo : public lifealgo {
 public:
     ltlalgo();
@@ -17,6 +20,9 @@ public:
     virtual int setcell(int x, int y, int newstate);
     virtual int getcell(int x, int y);
     virtual int nextcell(int x, int y, int& v);
+    virtual int setcells(const int* cells, int count, bool withstates);
+    virtual int putrect(const lifecellrect& r);
+    virtual void visitcells(lifecellvisitor& v, int x, int y, int wd, int ht);
     virtual void endofpattern();
     virtual void setIncrement(bigint inc) { increment = inc; }
     virtual void setIncrement(int inc) { increment = inc; }
@@ -32,6 +38,7 @@ public:
     virtual int NumCellStates();
     virtual int NumRandomizedCellStates() { return 2 ; }
     virtual void step();
+    virtual void setNumThreads(int n);
     virtual void* getcurrentstate() { return 0; }
     virtual void setcurrentstate(void*) {}
     virtual void draw(viewport& view, liferender& renderer);
@@ -55,6 +62,12 @@ private:
     vector<int> cell_list;              // used by save_cells and restore_cells
     bool show_warning;                  // flag used to avoid multiple warning dialogs
     int* colcounts;                     // cumulative column counts of state-1 cells
+    bool packed;                        // use Moore_packed instead of colcounts and outergrid2
+    unsigned long long* packedcells;    // current generation packed 64 cells per word
+    size_t packedsize;                  // number of words allocated for packedcells
+    int packedwd;                       // number of words in each row of packedcells
+    vector<int> bedges, sedges;         // counts where births and survivals switch on or off
+    drawdamage damaged;                 // screen blocks of the last draw
     
     // bounded grids are surrounded by a border of cells (with thickness = range+1)
     // so we can calculate neighborhood counts without checking for edge conditions;
@@ -72,6 +85,16 @@ private:
     int ccht;                           // height of colcounts array when ntype = N
     int halfccwd;                       // half width of colcounts array when ntype = N
     int nrows, ncols;                   // size of rectangle being processed
+
+    // the change in population and the boundary of live cells found by
+    // the fast* and faster* routines over the rows they were given
+    struct ltlband {
+        int population;
+        int minx, miny, maxx, maxy;
+    };
+    ltlmt* mt;                          // worker threads (only created if numthreads > 1)
+    int sumsht;                         // height of each band of colcounts in Moore_parallel
+    friend struct ltltask;
     
     // rule parameters (set by setrule)
     int range;                          // neighborhood radius
@@ -102,38 +125,61 @@ private:
     void do_bounded_gen();              // calculate the next generation in a bounded universe
     bool do_unbounded_gen();            // calculate the next generation in an unbounded universe
     int getcount(int i, int j);         // used in faster_Neumann_*
+    void do_band(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    // calculate the next generation for the given rows using the fast* routines
+    void do_rows(ltlband& band, int pass, int first, int last, int mincol, int maxcol, int orow, int ocol, int minht);
+    // run the given pass over rows first..last, split into bands of at least minht rows
+    // across threads if possible
+    void run_pass(ltltask& t);          // run one band of a pass
 
     const char* resize_grids(int up, int down, int left, int right);
     // try to resize an unbounded universe by the given amounts (possibly -ve);
     // if it fails then return a suitable error message
+    bool expand_grid(int left, int top, int right, int bottom);
+    // make sure the given rectangle lies inside an unbounded universe;
+    // if that fails then warn (once per pattern) and return false
     
-    void fast_Moore(int mincol, int minrow, int maxcol, int maxrow);
-    void faster_Moore_bounded(int mincol, int minrow, int maxcol, int maxrow);
-    void faster_Moore_bounded2(int mincol, int minrow, int maxcol, int maxrow);
-    void faster_Moore_unbounded(int mincol, int minrow, int maxcol, int maxrow);
-    void faster_Moore_unbounded2(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Neumann(int mincol, int minrow, int maxcol, int maxrow);
-    void faster_Neumann_bounded(int mincol, int minrow, int maxcol, int maxrow);
-    void faster_Neumann_unbounded(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Shaped(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Asterisk(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Tripod(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Weighted(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Custom(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Hash(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_CheckerBoth(int mincol, int minrow, int maxcol, int maxrow, int start);
-    void fast_Aligned(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Checker(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Hex(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Saltire(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Star(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Cross(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Triangular(int mincol, int minrow, int maxcol, int maxrow);
-    void fast_Gaussian(int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Moore(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void faster_Moore_bounded(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void faster_Moore_bounded2(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void faster_Moore_unbounded(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void faster_Moore_unbounded2(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Neumann(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void faster_Neumann_bounded(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void faster_Neumann_unbounded(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Shaped(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Asterisk(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Tripod(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Weighted(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Custom(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Hash(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_CheckerBoth(ltlband& band, int mincol, int minrow, int maxcol, int maxrow, int start);
+    void fast_Aligned(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Checker(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Hex(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Saltire(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Star(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Cross(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Triangular(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void fast_Gaussian(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
     // these routines are called from do_gen to process a rectangular region of cells
+
+    void Moore_parallel(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void Moore_sums(int first, int last, int mincol, int maxcol);
+    void Moore_update(ltlband& band, int first, int last, int mincol, int maxcol, int orow, int ocol);
+    // used instead of faster_Moore_* when running on several threads
+
+    void Moore_packed(ltlband& band, int mincol, int minrow, int maxcol, int maxrow);
+    void pack_rows(int first, int last, int mincol, int maxcol, int orow);
+    template <int R> void packed_update(ltlband& band, int first, int last, int mincol, int maxcol, int orow);
+    // used instead of colcounts for 2-state Moore rules with a small range
+
+    void Neumann_colcounts(int mincol, int minrow);
+    void Neumann_update(ltlband& band, int first, int last, int jfirst, int jlast, int orow, int ocol);
+    // the two halves of faster_Neumann_*
     
-    void update_current_grid(unsigned char &state, int ncount);
-    void update_next_grid(int x, int y, int xyoffset, int ncount);
+    void update_current_grid(ltlband& band, unsigned char &state, int ncount);
+    void update_next_grid(ltlband& band, int x, int y, int xyoffset, int ncount);
     // called from each of the fast* routines to set the state of the x,y cell
     // in nextgrid based on the given neighborhood count
 };
@@ -63,11 +63,57 @@ static void killpixels()
 
 // -----------------------------------------------------------------------------
 
+// return keys for the damage tracker naming what a block shows;
+// LTL has no change flags to go by, but hashing a block is still
+// much cheaper than drawing and uploading it again
+
+static G_INT64 cellkey(unsigned char* cellptr, int rowbytes, int imax, int jmax)
+{
+    unsigned G_INT64 h = 14695981039346656037ULL ^ (imax * 1000003 + jmax);
+    for (int j = 0; j < jmax; j++) {
+        int i = 0;
+        for ( ; i + 8 <= imax; i += 8) {
+            unsigned G_INT64 w;
+            memcpy(&w, cellptr + i, 8);
+            h = (h ^ w) * 1099511628211ULL;
+        }
+        for ( ; i < imax; i++) {
+            h = (h ^ cellptr[i]) * 1099511628211ULL;
+        }
+        cellptr += rowbytes;
+    }
+    return (G_INT64)h;
+}
+
+static G_INT64 pixelkey()
+{
+    unsigned G_INT64 h = 14695981039346656037ULL;
+    for (int i = 0; i < pmsize*pmsize; i++) {
+        h = (h ^ pixRGBAbuf[i]) * 1099511628211ULL;
+    }
+    return (G_INT64)h;
+}
+
+// -----------------------------------------------------------------------------
+
 // this is the top-level drawing routine
 
 void ltlalgo::draw(viewport &view, liferender &renderer)
 {
-    if (population == 0) return;
+    // get pixel position in view of grid's top left cell
+    pair<int,int> ltpxl = view.screenPosOf(gridleft, gridtop, this);
+    
+    // blocks are laid out from the grid's top left cell, so the last frame
+    // can only be reused if the grid is in the same place and the same size
+    unsigned G_INT64 gridpos = (unsigned int)ltpxl.first;
+    gridpos = ((gridpos * 1000003 + (unsigned int)ltpxl.second) * 1000003 + gwd) * 1000003 + ght;
+    damaged.begin(renderer, view);
+    damaged.layout((G_INT64)(gridpos * 2 + unbounded));
+    
+    if (population == 0) {
+        damaged.end();
+        return;
+    }
 
     if (!renderer.justState()) {
        // get cell colors and alpha values for dead and live pixels
@@ -103,9 +149,6 @@ void ltlalgo::draw(viewport &view, liferender &renderer)
         mag = -view.getmag();
     }
     
-    // get pixel position in view of grid's top left cell
-    pair<int,int> ltpxl = view.screenPosOf(gridleft, gridtop, this);
-    
     if (renderer.justState() || pmag > 1) {
         if (unbounded) {
             // simply display the entire grid -- ie. no need to use pixbuf
@@ -113,6 +156,7 @@ void ltlalgo::draw(viewport &view, liferender &renderer)
             int y = ltpxl.second;       // ditto
             int wd = gwd * pmag;
             int ht = ght * pmag;
+            damaged.redraw(x, y, wd, ht, 0);
             if (renderer.justState())
                renderer.stateblit(x, y, wd, ht, currgrid) ;
             else
@@ -128,6 +172,7 @@ void ltlalgo::draw(viewport &view, liferender &renderer)
             int y = ltpxl.second;
             int wd = outerwd * pmag;
             int ht = outerht * pmag;
+            damaged.redraw(x, y, wd, ht, 0);
             if (renderer.justState())
                renderer.stateblit(x, y, wd, ht, outergrid1) ;
             else
@@ -154,6 +199,10 @@ void ltlalgo::draw(viewport &view, liferender &renderer)
                         // get cell at top left corner of this block
                         unsigned char* cellptr = currgrid + row * outerwd + col;
                         
+                        // skip this block if the last frame already shows it
+                        G_INT64 key = damaged.active() ? cellkey(cellptr, outerwd, imax, jmax) : 0;
+                        if (!damaged.redraw(x, y, pmsize, pmsize, key)) continue;
+                        
                         // find live cells in this block and store their RGBA data in pixbuf
                         for (int j = 0; j < jmax; j++) {
                             unsigned char* p = cellptr;
@@ -182,8 +231,10 @@ void ltlalgo::draw(viewport &view, liferender &renderer)
                 pixRGBAbuf[0] = state1RGBA;     // there is at least 1 live cell in grid
                 int x = ltpxl.first;
                 int y = ltpxl.second;
+                damaged.redraw(x, y, pmsize, pmsize, 0);
                 renderer.pixblit(x, y, pmsize, pmsize, pixbuf, 1);
                 pixRGBAbuf[0] = cellRGBA[0];
+                damaged.end();
                 return;
             }
             
@@ -236,14 +287,16 @@ void ltlalgo::draw(viewport &view, liferender &renderer)
                             cellptr += outerwd * pmag;
                         }
                         
-                        // draw the shrunken block
-                        renderer.pixblit(x, y, pmsize, pmsize, pixbuf, 1);
+                        // draw the shrunken block unless the last frame already shows it
+                        if (damaged.redraw(x, y, pmsize, pmsize, damaged.active() ? pixelkey() : 0))
+                            renderer.pixblit(x, y, pmsize, pmsize, pixbuf, 1);
                         killpixels();
                     }
                 }
             }
         }
     }
+    damaged.end();
 }
 
 // -----------------------------------------------------------------------------
@@ -41,6 +41,11 @@
    #undef GOLLY64BIT
 #endif
 #define USEPREFETCH (1)
+// pack hlife nodes into 24 bytes (see hlifealgo.h); this wants a large
+// address space to reserve the node arena in
+#if defined(GOLLY64BIT) && !defined(_WIN32) && !defined(NOCOMPACTNODES)
+#define COMPACTNODES (1)
+#endif
 // note that _WIN32 is also defined when compiling for 64-bit Windows
 #ifdef _WIN32
 #include <mmintrin.h>
@@ -12,6 +12,7 @@
 #include <string.h>
 #include <limits.h>
 #include <iostream>
+#include <mutex>
 using namespace std ;
 /*
  *   The ai array is used to figure out the index number of the bit set in
@@ -68,16 +69,37 @@ static int bricks, tiles, supertiles, rcc, dq, ds, rccs, dqs, dss ;
 #else
 #define STAT(a)
 #endif
+/*
+ *   The state we need to run a generation on several threads; see
+ *   doquadmt below.  Workers may need new bricks, tiles or supertiles, so
+ *   during a parallel wave the free lists are guarded by alloclock.
+ */
+static const int MTLEVEL = 4 ;
+struct qlifemt {
+   qlifemt(int n) : threads(n) {}
+   lifethreads threads ;
+   std::mutex alloclock ;
+} ;
+void qlifealgo::lockalloc() {
+   mt->alloclock.lock() ;
+}
+void qlifealgo::unlockalloc() {
+   mt->alloclock.unlock() ;
+}
 /*
  *   If we need a new empty brick, we call this.  This structure is guaranteed
  *   to be all zeros.
  */
 brick *qlifealgo::newbrick() {
    brick *r ;
+   if (inwave)
+      lockalloc() ;
    if (bricklist == 0)
       bricklist = filllist(sizeof(brick)) ;
    r = (brick *)(bricklist) ;
    bricklist = bricklist->next ;
+   if (inwave)
+      unlockalloc() ;
    memset(r, 0, sizeof(brick)) ;
    STAT(bricks++) ;
    return r ;
@@ -88,10 +110,14 @@ brick *qlifealgo::newbrick() {
  */
 tile *qlifealgo::newtile() {
    tile *r ;
+   if (inwave)
+      lockalloc() ;
    if (tilelist == 0)
       tilelist = filllist(sizeof(tile)) ;
    r = (tile *)(tilelist) ;
    tilelist = tilelist->next ;
+   if (inwave)
+      unlockalloc() ;
    r->b[0] = r->b[1] = r->b[2] = r->b[3] = emptybrick ;
    r->flags = -1 ;
    r->localdeltaforward = 0 ;
@@ -104,10 +130,14 @@ tile *qlifealgo::newtile() {
  */
 supertile *qlifealgo::newsupertile(int lev) {
    supertile *r ;
+   if (inwave)
+      lockalloc() ;
    if (supertilelist == 0)
       supertilelist = filllist(sizeof(supertile)) ;
    r = (supertile *)supertilelist ;
    supertilelist = supertilelist->next ;
+   if (inwave)
+      unlockalloc() ;
    r->d[0] = r->d[1] = r->d[2] = r->d[3] = r->d[4] = r->d[5] =
                                  r->d[6] = r->d[7] = nullroots[lev-1] ;
    STAT(supertiles++) ;
@@ -200,6 +230,8 @@ qlifealgo::qlifealgo() {
       lifefatal("bad platform for this program") ;
    memused = 0 ;
    maxmemory = 0 ;
+   mt = 0 ;
+   inwave = 0 ;
    poller->bailIfCalculating() ;
    generation = 0 ;
    increment = 1 ;
@@ -210,6 +242,9 @@ qlifealgo::qlifealgo() {
    cleandowncounter = 63 ;
    usedmemory = 0 ;
    deltaforward = 0 ;
+   ruletable = 0 ;
+   currslicerule = 0 ;
+   slicerules[0].valid = slicerules[1].valid = 0 ;
    ai[0] = 4 ; ai[1] = 0 ; ai[2] = 1 ; ai[4] = 2 ; ai[8] = 3 ;
    ai[16] = 4 ; ai[32] = 5 ; ai[64] = 6 ; ai[128] = 7 ;
    minlow32 = min = 0 ;
@@ -232,6 +267,7 @@ qlifealgo::qlifealgo() {
  *   This subroutine frees a universe.
  */
 qlifealgo::~qlifealgo() {
+   delete mt ;
    while (memused) {
       linkedmem *nu = memused->next ;
       free(memused) ;
@@ -282,6 +318,8 @@ void qlifealgo::setMaxMemory(int newmemlimit) {
  */
 int qlifealgo::doquad01(supertile *zis, supertile *edge,
                         supertile *par, supertile *cor, int lev) {
+   if (lev == MTLEVEL && !inwave && numthreads > 1)
+      return doquadmt(zis, edge, par, cor, lev, 1) ;
 /*
  *   First we figure out which subtiles we need to recalculate.  There will
  *   always be at least one if we got into this subroutine (except for the
@@ -293,7 +331,8 @@ int qlifealgo::doquad01(supertile *zis, supertile *edge,
  *   Note that the parallel and corner have already been recomputed so
  *   their changing bits are shifted up 10 positions in c.
  */
-   poller->poll() ;
+   if (!inwave)
+      poller->poll() ;
    int changing = (zis->flags | (par->flags >> 19) |
                    (((edge->flags >> 18) | (cor->flags >> 27)) & 1)) & 0xff ;
    int x, b, nchanging = (zis->flags & 0x3ff00) << 10 ;
@@ -360,7 +399,10 @@ int qlifealgo::doquad01(supertile *zis, supertile *edge,
  */
 int qlifealgo::doquad10(supertile *zis, supertile *edge,
                         supertile *par, supertile *cor, int lev) {
-   poller->poll() ;
+   if (lev == MTLEVEL && !inwave && numthreads > 1)
+      return doquadmt(zis, edge, par, cor, lev, 0) ;
+   if (!inwave)
+      poller->poll() ;
    int changing = (zis->flags | (par->flags >> 19) |
                    (((edge->flags >> 18) | (cor->flags >> 27)) & 1)) & 0xff ;
    int x, b, nchanging = (zis->flags & 0x3ff00) << 10 ;
@@ -401,6 +443,411 @@ int qlifealgo::doquad10(supertile *zis, supertile *edge,
    zis->flags = nchanging | 0xf0000000 ;
    return upchanging(nchanging) ;
 }
+/*
+ *   Multithreaded generations.  Within a phase a tile only ever looks at
+ *   the tiles that precede it in the walk (for 0->1 the ones to its right,
+ *   below, and below right; for 1->0 to its left, above, and above left),
+ *   and supertiles likewise.  So any order that finishes those neighbors
+ *   first gives exactly the same result as the serial walk.
+ *
+ *   At level MTLEVEL (2048x2048 cells) we therefore lay the 64 grandchildren of a supertile
+ *   out as an 8x8 grid, indexed by the order in which the serial walk
+ *   would visit them at each of the two levels, and run the anti-diagonals
+ *   of that grid as successive waves; every supertile in a wave only
+ *   depends on earlier waves, so they can all go at once.
+ *
+ *   The one thing the serial walk learns from a child before starting its
+ *   next sibling is the sibling's changing bits, and those come from the
+ *   bits the previous phase left behind (which a recompute merely shifts
+ *   up ten places).  So we can work out up front which children and
+ *   grandchildren will be visited, allocate them in serial order, and only
+ *   then fan the grandchildren out.  Polling is left to the main thread
+ *   between waves.
+ */
+struct qlifetask : public lifetask {
+   qlifealgo *q ;
+   supertile *zis, *edge, *par, *cor ;
+   int lev, forward, result ;
+   virtual void run(int) { q->runtask(*this) ; }
+} ;
+void qlifealgo::runtask(qlifetask &t) {
+   if (t.forward)
+      t.result = doquad01(t.zis, t.edge, t.par, t.cor, t.lev) ;
+   else
+      t.result = doquad10(t.zis, t.edge, t.par, t.cor, t.lev) ;
+}
+void qlifealgo::setNumThreads(int n) {
+   poller->bailIfCalculating() ;
+   lifealgo::setNumThreads(n) ;
+   if (mt && mt->threads.size() != numthreads) {
+      delete mt ;
+      mt = 0 ;
+   }
+}
+int qlifealgo::doquadmt(supertile *zis, supertile *edge,
+                        supertile *par, supertile *cor, int lev, int forward) {
+   poller->poll() ;
+   if (mt == 0)
+      mt = new qlifemt(numthreads) ;
+/*
+ *   Children and grandchildren are indexed by k, their position in the
+ *   serial walk; sub[k] maps that to a position in the supertile, nb[k]
+ *   to the previous one in the walk, and at the start of the walk the
+ *   neighbor is subtile edgesub of the edge supertile.
+ */
+   static const int sub01[8] = { 7, 6, 5, 4, 3, 2, 1, 0 } ;
+   static const int sub10[8] = { 0, 1, 2, 3, 4, 5, 6, 7 } ;
+   const int *sub = forward ? sub01 : sub10 ;
+   int edgesub = forward ? 0 : 7 ;
+   int changing = (zis->flags | (par->flags >> 19) |
+                   (((edge->flags >> 18) | (cor->flags >> 27)) & 1)) & 0xff ;
+   int nchanging = (zis->flags & 0x3ff00) << 10 ;
+   supertile *row[8], *rowedge[8], *rowpar[8], *rowcor[8] ;
+   int rowchanging[8], rownchanging[8] ;
+   int k, kk ;
+/*
+ *   Which children would the serial walk visit, and with what changing
+ *   bits?  A visited sibling's high bits are its current low bits moved
+ *   up, since that is what its recompute will do.
+ */
+   for (k=0; k<8; k++) {
+      int x = sub[k] ;
+      row[k] = 0 ;
+      if (!((changing >> k) & 1))
+         continue ;
+      if (zis->d[x] == nullroots[lev-1])
+         zis->d[x] = newsupertile(lev-1) ;
+      supertile *p = zis->d[x] ;
+      supertile *pf = k ? zis->d[sub[k-1]] : edge->d[edgesub] ;
+      supertile *pfu = k ? par->d[sub[k-1]] : cor->d[edgesub] ;
+      supertile *pu = par->d[x] ;
+      int pfflags = (k && row[k-1]) ? (pf->flags & 0x3ff00) << 10 : pf->flags ;
+      row[k] = p ;
+      rowedge[k] = pu ;
+      rowpar[k] = pf ;
+      rowcor[k] = pfu ;
+      rowchanging[k] = (p->flags | (pfflags >> 19) |
+                        (((pu->flags >> 18) | (pfu->flags >> 27)) & 1)) & 0xff ;
+      rownchanging[k] = (p->flags & 0x3ff00) << 10 ;
+   }
+/*
+ *   Allocate the grandchildren we will visit, then set up a task for each.
+ */
+   for (k=0; k<8; k++)
+      if (row[k])
+         for (kk=0; kk<8; kk++)
+            if ((rowchanging[k] >> kk) & 1 &&
+                row[k]->d[sub[kk]] == nullroots[lev-2])
+               row[k]->d[sub[kk]] = newsupertile(lev-2) ;
+   qlifetask tasks[64] ;
+   for (k=0; k<8; k++) {
+      if (row[k] == 0)
+         continue ;
+      for (kk=0; kk<8; kk++) {
+         qlifetask &t = tasks[k*8+kk] ;
+         t.zis = 0 ;
+         if (!((rowchanging[k] >> kk) & 1))
+            continue ;
+         int y = sub[kk] ;
+         t.q = this ;
+         t.zis = row[k]->d[y] ;
+         t.edge = rowpar[k]->d[y] ;
+         t.par = kk ? row[k]->d[sub[kk-1]] : rowedge[k]->d[edgesub] ;
+         t.cor = kk ? rowpar[k]->d[sub[kk-1]] : rowcor[k]->d[edgesub] ;
+         t.lev = lev - 2 ;
+         t.forward = forward ;
+         t.result = 0 ;
+      }
+   }
+/*
+ *   Run the waves.
+ */
+   inwave = 1 ;
+   for (int w=0; w<15; w++) {
+      lifetaskgroup g ;
+      qlifetask *last = 0 ;
+      for (k=0; k<8; k++) {
+         kk = w - k ;
+         if (kk < 0 || kk > 7 || row[k] == 0 || tasks[k*8+kk].zis == 0)
+            continue ;
+         if (last)
+            mt->threads.spawn(0, last, g) ;
+         last = &tasks[k*8+kk] ;
+      }
+      if (last)
+         runtask(*last) ;
+      mt->threads.wait(0, g) ;
+   }
+   inwave = 0 ;
+/*
+ *   Fold the results back up just as the serial walk would have.
+ */
+   for (k=0; k<8; k++) {
+      if (row[k] == 0)
+         continue ;
+      for (kk=0; kk<8; kk++)
+         if (tasks[k*8+kk].zis)
+            rownchanging[k] |= tasks[k*8+kk].result << (forward ? sub[kk] : 7 - sub[kk]) ;
+      row[k]->flags = rownchanging[k] | 0xf0000000 ;
+      nchanging |= upchanging(rownchanging[k]) << (forward ? sub[k] : 7 - sub[k]) ;
+   }
+   zis->flags = nchanging | 0xf0000000 ;
+   return upchanging(nchanging) ;
+}
+/*
+ *   The bit-sliced slice kernel.  For each of the nine positions in the
+ *   3x3 neighborhood we build a word holding, for every cell of the
+ *   output slice, the input cell at that offset; we add up the counted
+ *   neighbors with a tree of full adders into four bit planes, and then
+ *   match the planes against the counts in the rule.  Every step is a
+ *   plain logical operation on a 32-bit word, so we do a whole brick of
+ *   eight slices at a time in one AVX2 register (or two SSE2 registers).
+ *
+ *   Since the vector kernel always does all eight slices, it only pays
+ *   off when several of them need recomputing; SLICEMIN is how many.
+ */
+#if !defined(NOBITSLICE) && (defined(__SSE2__) || defined(_M_X64))
+#define BITSLICE
+#ifdef __AVX2__
+#include <immintrin.h>
+typedef __m256i slicevec ;
+#define SLICELANES (8)
+#define SLICEMIN (4)
+#define VLOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define VSTORE(p, a) _mm256_storeu_si256((__m256i *)(p), a)
+#define VSET(v) _mm256_set1_epi32((int)(v))
+#define VAND(a, b) _mm256_and_si256(a, b)
+#define VANDNOT(a, b) _mm256_andnot_si256(a, b)
+#define VOR(a, b) _mm256_or_si256(a, b)
+#define VXOR(a, b) _mm256_xor_si256(a, b)
+#define VSHL(a, n) _mm256_slli_epi32(a, n)
+#define VSHR(a, n) _mm256_srli_epi32(a, n)
+#else
+#include <emmintrin.h>
+typedef __m128i slicevec ;
+#define SLICELANES (4)
+#define SLICEMIN (6)
+#define VLOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define VSTORE(p, a) _mm_storeu_si128((__m128i *)(p), a)
+#define VSET(v) _mm_set1_epi32((int)(v))
+#define VAND(a, b) _mm_and_si128(a, b)
+#define VANDNOT(a, b) _mm_andnot_si128(a, b)
+#define VOR(a, b) _mm_or_si128(a, b)
+#define VXOR(a, b) _mm_xor_si128(a, b)
+#define VSHL(a, n) _mm_slli_epi32(a, n)
+#define VSHR(a, n) _mm_srli_epi32(a, n)
+#endif
+/*
+ *   Full adder:  s gets the low bit and c the carry of a+b+d.
+ */
+#define FULLADD(s, c, a, b, d) { slicevec _t = VXOR(a, b) ; \
+   s = VXOR(_t, d) ; c = VOR(VAND(a, b), VAND(_t, d)) ; }
+/*
+ *   Compute eight slices.  For slice j, zis[j] is the slice itself,
+ *   trail[j] the slice beside it, next[j] the slice above or below it, and
+ *   trailnext[j] the one diagonally across.  When FORWARD is set we are
+ *   going from even to odd generations, and the neighbors are to the
+ *   right and below; otherwise they are to the left and above.  When
+ *   MOORE is set all eight neighbors count, so we need not mask any out.
+ */
+template <int FORWARD, int MOORE>
+static void slicekernel(const unsigned int *zis, const unsigned int *trail,
+                        const unsigned int *next,
+                        const unsigned int *trailnext, unsigned int *res,
+                        const slicerule &r) {
+   const slicevec m1 = VSET(FORWARD ? 0xeeeeeeee : 0x77777777) ;
+   const slicevec t1 = VSET(FORWARD ? 0x11111111 : 0x88888888) ;
+   const slicevec m2 = VSET(FORWARD ? 0xcccccccc : 0x33333333) ;
+   const slicevec t2 = VSET(FORWARD ? 0x33333333 : 0xcccccccc) ;
+   const slicevec ones = VSET(~0) ;
+   for (int l=0; l<8; l+=SLICELANES) {
+      slicevec z = VLOAD(zis+l), t = VLOAD(trail+l) ;
+      slicevec zn = VLOAD(next+l), tn = VLOAD(trailnext+l) ;
+      slicevec row[3], trow[3], nb[9] ;
+/*
+ *   First line up the three rows each output cell needs . . .
+ */
+      if (FORWARD) {
+         row[0] = z ;
+         row[1] = VOR(VSHL(z, 4), VSHR(zn, 28)) ;
+         row[2] = VOR(VSHL(z, 8), VSHR(zn, 24)) ;
+         trow[0] = t ;
+         trow[1] = VOR(VSHL(t, 4), VSHR(tn, 28)) ;
+         trow[2] = VOR(VSHL(t, 8), VSHR(tn, 24)) ;
+      } else {
+         row[0] = VOR(VSHR(z, 8), VSHL(zn, 24)) ;
+         row[1] = VOR(VSHR(z, 4), VSHL(zn, 28)) ;
+         row[2] = z ;
+         trow[0] = VOR(VSHR(t, 8), VSHL(tn, 24)) ;
+         trow[1] = VOR(VSHR(t, 4), VSHL(tn, 28)) ;
+         trow[2] = t ;
+      }
+/*
+ *   . . . and then the three columns.
+ */
+      for (int i=0; i<3; i++) {
+         if (FORWARD) {
+            nb[3*i] = row[i] ;
+            nb[3*i+1] = VOR(VAND(VSHL(row[i], 1), m1),
+                            VAND(VSHR(trow[i], 3), t1)) ;
+            nb[3*i+2] = VOR(VAND(VSHL(row[i], 2), m2),
+                            VAND(VSHR(trow[i], 2), t2)) ;
+         } else {
+            nb[3*i] = VOR(VAND(VSHR(row[i], 2), m2),
+                          VAND(VSHL(trow[i], 2), t2)) ;
+            nb[3*i+1] = VOR(VAND(VSHR(row[i], 1), m1),
+                            VAND(VSHL(trow[i], 3), t1)) ;
+            nb[3*i+2] = row[i] ;
+         }
+      }
+      slicevec center = nb[4] ;
+      if (!MOORE)
+         for (int i=0; i<9; i++)
+            if (!((r.nbmask >> i) & 1))
+               nb[i] = VXOR(ones, ones) ;
+/*
+ *   Add the eight neighbors into four bit planes.
+ */
+      slicevec s0, s1, s2, c0, c1, c2, b0, b1, b2, b3, ca, cb, cc ;
+      FULLADD(s0, c0, nb[0], nb[1], nb[2]) ;
+      FULLADD(s1, c1, nb[3], nb[5], nb[6]) ;
+      s2 = VXOR(nb[7], nb[8]) ;
+      c2 = VAND(nb[7], nb[8]) ;
+      FULLADD(b0, ca, s0, s1, s2) ;
+      FULLADD(s0, cb, c0, c1, c2) ;
+      b1 = VXOR(s0, ca) ;
+      cc = VAND(s0, ca) ;
+      b2 = VXOR(cb, cc) ;
+      b3 = VAND(cb, cc) ;
+/*
+ *   Pick out the counts that turn cells on.
+ */
+      slicevec out = VXOR(ones, ones) ;
+      for (int i=0; i<r.nterms; i++) {
+         int n = r.term[i] ;
+         slicevec eq = (n & 1) ? b0 : VXOR(b0, ones) ;
+         eq = (n & 2) ? VAND(eq, b1) : VANDNOT(b1, eq) ;
+         eq = (n & 4) ? VAND(eq, b2) : VANDNOT(b2, eq) ;
+         eq = (n & 8) ? VAND(eq, b3) : VANDNOT(b3, eq) ;
+         if (!(n & SLICEBORN))
+            eq = VAND(eq, center) ;
+         else if (!(n & SLICESURVIVE))
+            eq = VANDNOT(center, eq) ;
+         out = VOR(out, eq) ;
+      }
+      VSTORE(res+l, out) ;
+   }
+}
+template <int FORWARD>
+static void slicekernel(const unsigned int *zis, const unsigned int *trail,
+                        const unsigned int *next,
+                        const unsigned int *trailnext, unsigned int *res,
+                        const slicerule &r) {
+   if (r.nbmask == 0x1ef)
+      slicekernel<FORWARD, 1>(zis, trail, next, trailnext, res, r) ;
+   else
+      slicekernel<FORWARD, 0>(zis, trail, next, trailnext, res, r) ;
+}
+/*
+ *   Gather the neighboring slices for a brick and run the kernel on it;
+ *   these are kept out of line so p01 and p10 themselves stay lean.
+ *   For 0->1, b is the brick, rb the one to the right, db below, and rdb
+ *   below right; for 1->0, lb is to the left, ub above, lub above left.
+ */
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+static void slicebrick01(brick *b, brick *rb, brick *db, brick *rdb,
+                         unsigned int *res, const slicerule &r) {
+   unsigned int tr[8], trn[8] ;
+   for (int j=0; j<7; j++) {
+      tr[j] = b->d[j+1] ;
+      trn[j] = db->d[j+1] ;
+   }
+   tr[7] = rb->d[0] ;
+   trn[7] = rdb->d[0] ;
+   slicekernel<1>(b->d, tr, db->d, trn, res, r) ;
+}
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+static void slicebrick10(brick *lub, brick *ub, brick *lb, brick *b,
+                         unsigned int *res, const slicerule &r) {
+   unsigned int tr[8], tro[8] ;
+   tr[0] = lb->d[15] ;
+   tro[0] = lub->d[15] ;
+   for (int j=1; j<8; j++) {
+      tr[j] = b->d[j+7] ;
+      tro[j] = ub->d[j+7] ;
+   }
+   slicekernel<0>(b->d+8, tr, ub->d+8, tro, res, r) ;
+}
+#endif
+/*
+ *   See if a 4x4 rule table can be computed by the slice kernel; if so,
+ *   fill in r.  We work out the 3x3 rule from the table, find which
+ *   neighbors it looks at, check it only cares how many of those are on,
+ *   and finally make sure every entry of the table agrees with that.
+ */
+static void makeslicerule(const char *rptr, slicerule &r) {
+   r.valid = 0 ;
+   r.nbmask = r.born = r.survive = 0 ;
+#ifdef BITSLICE
+   char f[512] ;
+   int c, i, m, n ;
+   for (m=0; m<512; m++) {
+      // bit r*3+c of m is cell (r,c), which is bit 15-(r*4+c) of the index
+      i = 0 ;
+      for (n=0; n<9; n++)
+         if ((m >> n) & 1)
+            i |= 1 << (15 - (n / 3 * 4 + n % 3)) ;
+      f[m] = (rptr[i] >> 5) & 1 ;
+   }
+   for (n=0; n<9; n++)
+      if (n != 4)
+         for (m=0; m<512; m++)
+            if (f[m] != f[m ^ (1 << n)]) {
+               r.nbmask |= 1 << n ;
+               break ;
+            }
+   int seen[2] = { 0, 0 } ;
+   for (m=0; m<512; m++) {
+      c = (m >> 4) & 1 ;
+      n = bc[m & r.nbmask & 0xff] + ((m & r.nbmask) >> 8) ;
+      int *v = c ? &r.survive : &r.born ;
+      if ((seen[c] >> n) & 1) {
+         if (((*v >> n) & 1) != f[m])
+            return ;
+      } else {
+         seen[c] |= 1 << n ;
+         *v |= f[m] << n ;
+      }
+   }
+   for (i=0; i<65536; i++) {
+      int want = 0 ;
+      for (int q=0; q<4; q++) {
+         // q selects the output cell:  0 and 1 top, 2 and 3 bottom
+         int w = i << ((q >> 1) * 4 + (q & 1)) ;
+         m = 0 ;
+         for (n=0; n<9; n++)
+            if ((w >> (15 - (n / 3 * 4 + n % 3))) & 1)
+               m |= 1 << n ;
+         c = (m >> 4) & 1 ;
+         n = bc[m & r.nbmask & 0xff] + ((m & r.nbmask) >> 8) ;
+         if ((((c ? r.survive : r.born) >> n) & 1))
+            want |= 1 << ((q >> 1) ? 1 - (q & 1) : 5 - (q & 1)) ;
+      }
+      if (rptr[i] != want)
+         return ;
+   }
+   r.nterms = 0 ;
+   for (n=0; n<9; n++)
+      if (((r.born | r.survive) >> n) & 1)
+         r.term[r.nterms++] = n | (((r.born >> n) & 1) ? SLICEBORN : 0) |
+                              (((r.survive >> n) & 1) ? SLICESURVIVE : 0) ;
+   r.valid = 1 ;
+#endif
+}
 /*
  *   This is our monster subroutine that, with its mirror below, accounts for
  *   about 90% of the runtime.  It handles recomputation for a 32x32 tile.
@@ -436,6 +883,18 @@ int qlifealgo::p01(tile *p, tile *pr, tile *pd, tile *prd) {
          p->flags |= 1 << i ;
          if (b == emptybrick)
             p->b[i] = b = newbrick() ;
+/*
+ *   If enough slices need recomputing and the rule allows it, do the
+ *   whole brick up front with the slice kernel.
+ */
+         unsigned int *nv = 0 ;
+#ifdef BITSLICE
+         unsigned int nvbuf[8] ;
+         if (currslicerule && bc[recomp & 0xff] >= SLICEMIN) {
+            slicebrick01(b, rb, db, rdb, nvbuf, *currslicerule) ;
+            nv = nvbuf ;
+         }
+#endif
 /*
  *   If we need to recompute the end slice, now is a good time to get the
  *   right neighbor's data.
@@ -470,18 +929,23 @@ int qlifealgo::p01(tile *p, tile *pr, tile *pd, tile *prd) {
  */
                unsigned int zisdata = b->d[j] ;
                unsigned int underdata = (zisdata << 8) + (db->d[j] >> 24) ;
-               unsigned int otherdata = ((zisdata << 2) & 0xcccccccc) +
-                                        ((traildata >> 2) & 0x33333333) ;
-               unsigned int otherunderdata = ((underdata << 2) & 0xcccccccc) +
-                                    ((trailunderdata >> 2) & 0x33333333) ;
-               int newv = (ruletable[zisdata >> 16] << 26) +
-                          (ruletable[underdata >> 16] << 18) +
-                          (ruletable[zisdata & 0xffff] << 10) +
-                          (ruletable[underdata & 0xffff] << 2) +
-                          (ruletable[otherdata >> 16] << 24) +
-                          (ruletable[otherunderdata >> 16] << 16) +
-                          (ruletable[otherdata & 0xffff] << 8) +
-                           ruletable[otherunderdata & 0xffff] ;
+               int newv ;
+               if (nv) {
+                  newv = nv[j] ;
+               } else {
+                  unsigned int otherdata = ((zisdata << 2) & 0xcccccccc) +
+                                           ((traildata >> 2) & 0x33333333) ;
+                  unsigned int otherunderdata = ((underdata << 2) & 0xcccccccc) +
+                                       ((trailunderdata >> 2) & 0x33333333) ;
+                  newv = (ruletable[zisdata >> 16] << 26) +
+                         (ruletable[underdata >> 16] << 18) +
+                         (ruletable[zisdata & 0xffff] << 10) +
+                         (ruletable[underdata & 0xffff] << 2) +
+                         (ruletable[otherdata >> 16] << 24) +
+                         (ruletable[otherunderdata >> 16] << 16) +
+                         (ruletable[otherdata & 0xffff] << 8) +
+                          ruletable[otherunderdata & 0xffff] ;
+               }
 /*
  *   Has anything changed?
  *   Keep track of what has changed in the entire cell, the rightmost
@@ -562,6 +1026,14 @@ int qlifealgo::p10(tile *plu, tile *pu, tile *pl, tile *p) {
          p->flags |= 1 << i ;
          if (b == emptybrick)
             p->b[i] = b = newbrick() ;
+         unsigned int *nv = 0 ;
+#ifdef BITSLICE
+         unsigned int nvbuf[8] ;
+         if (currslicerule && bc[recomp & 0xff] >= SLICEMIN) {
+            slicebrick10(lub, ub, lb, b, nvbuf, *currslicerule) ;
+            nv = nvbuf ;
+         }
+#endif
          if (recomp & 1) {
             j = 0 ;
             traildata = lb->d[15] ;
@@ -577,18 +1049,23 @@ int qlifealgo::p10(tile *plu, tile *pu, tile *pl, tile *p) {
             if (recomp & 1) {
                unsigned int zisdata = b->d[j + 8] ;
                unsigned int overdata = (zisdata >> 8) + (ub->d[j + 8] << 24) ;
-               unsigned int otherdata = ((zisdata >> 2) & 0x33333333) +
-                                        ((traildata << 2) & 0xcccccccc) ;
-               unsigned int otheroverdata = ((overdata >> 2) & 0x33333333) +
-                                    ((trailoverdata << 2) & 0xcccccccc) ;
-               int newv = (ruletable[otheroverdata >> 16] << 26) +
-                          (ruletable[otherdata >> 16] << 18) +
-                          (ruletable[otheroverdata & 0xffff] << 10) +
-                          (ruletable[otherdata & 0xffff] << 2) +
-                          (ruletable[overdata >> 16] << 24) +
-                          (ruletable[zisdata >> 16] << 16) +
-                          (ruletable[overdata & 0xffff] << 8) +
-                           ruletable[zisdata & 0xffff] ;
+               int newv ;
+               if (nv) {
+                  newv = nv[j] ;
+               } else {
+                  unsigned int otherdata = ((zisdata >> 2) & 0x33333333) +
+                                           ((traildata << 2) & 0xcccccccc) ;
+                  unsigned int otheroverdata = ((overdata >> 2) & 0x33333333) +
+                                       ((trailoverdata << 2) & 0xcccccccc) ;
+                  newv = (ruletable[otheroverdata >> 16] << 26) +
+                         (ruletable[otherdata >> 16] << 18) +
+                         (ruletable[otheroverdata & 0xffff] << 10) +
+                         (ruletable[otherdata & 0xffff] << 2) +
+                         (ruletable[overdata >> 16] << 24) +
+                         (ruletable[zisdata >> 16] << 16) +
+                         (ruletable[overdata & 0xffff] << 8) +
+                          ruletable[zisdata & 0xffff] ;
+               }
                int delta = (b->d[j] ^ newv) | deltaforward | p->localdeltaforward ;
                STAT(rcc++) ;
                maska = cdelta | (delta & 0xcccccccc) ;
@@ -866,6 +1343,63 @@ int qlifealgo::nextcell(int x, int y, int &v) {
       return -1 ;
    return nextcell(x, y, root, rootlev) ;
 }
+/*
+ *   Visit the set cells of supertile n, whose corner is at tile tx,ty,
+ *   that lie inside the rect r (internal coordinates: left, top, right,
+ *   bottom, the last two exclusive).  Only the nonempty supertiles,
+ *   bricks and words are looked at.
+ */
+void qlifealgo::visitcells(supertile *n, int lev, long long tx, long long ty,
+                           const long long *r, lifecellvisitor &v, int odd) {
+   if (lev > 0) {
+      if (lev & 1) {
+         long long cw = 1LL << ((lev >> 1) + lev - 1) ;
+         for (int i=0; i<8; i++, tx += cw)
+            if (n->d[i] != nullroots[lev-1] && (tx + cw) * 32 > r[0] &&
+                tx * 32 < r[2])
+               visitcells(n->d[i], lev-1, tx, ty, r, v, odd) ;
+      } else {
+         long long ch = 1LL << ((lev >> 1) + lev - 3) ;
+         for (int i=0; i<8; i++, ty += ch)
+            if (n->d[i] != nullroots[lev-1] && (ty + ch) * 32 > r[1] &&
+                ty * 32 < r[3])
+               visitcells(n->d[i], lev-1, tx, ty, r, v, odd) ;
+      }
+      return ;
+   }
+   tile *p = (tile *)n ;
+   for (int bi=0; bi<4; bi++) {
+      if (p->b[bi] == emptybrick)
+         continue ;
+      long long by = ty * 32 + bi * 8 ;
+      if (by + 8 <= r[1] || by >= r[3])
+         continue ;
+      for (int w=0; w<8; w++) {
+         long long wx = tx * 32 + w * 4 ;
+         if (wx + 4 <= r[0] || wx >= r[2])
+            continue ;
+         for (unsigned int bits=p->b[bi]->d[w + 8 * odd]; bits;
+              bits &= bits - 1) {
+            int b = 31 ;
+            while (!((bits >> (31 - b)) & 1))
+               b-- ;
+            /* bit 31-b holds row b/4, column b%4 of the word */
+            long long cx = wx + (b & 3) ;
+            long long cy = by + (b >> 2) ;
+            if (cx >= r[0] && cx < r[2] && cy >= r[1] && cy < r[3])
+               v.cell((int)(cx + odd), (int)(- cy - odd), 1) ;
+         }
+      }
+   }
+}
+void qlifealgo::visitcells(lifecellvisitor &v, int x, int y, int wd, int ht) {
+   if (wd <= 0 || ht <= 0 || root == nullroot)
+      return ;
+   int odd = generation.odd() ;
+   long long r[4] = { (long long)x - odd, - ((long long)y + ht) + 1 - odd,
+                      (long long)x + wd - odd, - (long long)y + 1 - odd } ;
+   visitcells(root, rootlev, minlow32, minlow32, r, v, odd) ;
+}
 int qlifealgo::nextcell(int x, int y, supertile *n, int lev) {
    if (lev > 0) {
       if (n == nullroots[lev])
@@ -1146,13 +1680,19 @@ void qlifealgo::step() {
    while (t != 0) {
       if (qliferules.alternate_rules) {
          // emulate B0-not-Smax rule by changing rule table depending on gen parity
-         if (generation.odd())
+         if (generation.odd()) {
             ruletable = qliferules.rule1 ;
-         else
+            currslicerule = slicerules + 1 ;
+         } else {
             ruletable = qliferules.rule0 ;
+            currslicerule = slicerules ;
+         }
       } else {
          ruletable = qliferules.rule0 ;
+         currslicerule = slicerules ;
       }
+      if (!currslicerule->valid)
+         currslicerule = 0 ;
       dogen() ;
       if (poller->isInterrupted())
          break ;
@@ -1202,8 +1742,12 @@ const char *qlifealgo::setrule(const char *s) {
       fliprule(qliferules.rule0);
    }
    
+   makeslicerule(qliferules.rule0, slicerules[0]) ;
+   makeslicerule(qliferules.rule1, slicerules[1]) ;
+
    // ruletable is set in step(), but play safe
    ruletable = qliferules.rule0 ;
+   currslicerule = 0 ;
    
    if (qliferules.isHexagonal())
       grid_type = HEX_GRID;
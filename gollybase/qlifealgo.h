@@ -117,8 +117,9 @@ struct tile { /* 32 bytes */
  *   of the eighth (first) subtile has changed.
  *
  *   Bit 18 through 27 correspond to the previous generation's bits 8 through
- *   17.  Bits 28 through 31 are the dirty bits; we currently use three of
- *   them.
+ *   17.  Bits 28 through 31 are the dirty bits:  bit 28 for mdelete, bits
+ *   29 and 30 for the two population counts, and bit 31 for draw, which
+ *   clears it on the supertiles it renders as one bitmap.
  *
  *   The above description corresponds to odd levels.  For even levels,
  *   since tiles are stacked vertically instead of horizontally, change
@@ -153,6 +154,24 @@ struct supertile { /* 44 bytes */
 struct linkedmem {
    struct linkedmem *next ;
 } ;
+/*
+ *   When the rule table in use is outer-totalistic (the result depends
+ *   only on the cell itself and how many of a fixed set of neighbors are
+ *   on), we can skip the table and compute all eight slices of a brick at
+ *   once with bit-sliced adders in SIMD registers.  This holds the rule in
+ *   that form:  nbmask has bit r*3+c set for each counted position of the
+ *   3x3 neighborhood (r and c counting from the upper left), and bit n of
+ *   born (survive) is set if an off (on) cell with n counted neighbors on
+ *   is on in the next generation; term lists the counts that appear in
+ *   either, for the kernel's benefit.  The valid flag is clear if the table
+ *   can't be expressed this way.
+ */
+struct slicerule {
+   int valid, nbmask, born, survive ;
+   int nterms, term[9] ; // counts or-ed with the flags below
+} ;
+#define SLICEBORN (16)
+#define SLICESURVIVE (32)
 /*
  *   This structure contains all of our variables that pertain to a
  *   particular universe.  (Thus, we support multiple universes.)
@@ -186,6 +205,8 @@ struct linkedmem {
  *   supertiles at each level.  Setting this to 40 limits the number of
  *   levels to 40, which is sufficient for a 2^65x2^62 universe.
  */
+struct qlifemt ;
+struct qlifetask ;
 class qlifealgo : public lifealgo {
 public:
    qlifealgo() ;
@@ -193,6 +214,7 @@ public:
    virtual int setcell(int x, int y, int newstate) ;
    virtual int getcell(int x, int y) ;
    virtual int nextcell(int x, int y, int &v) ;
+   virtual void visitcells(lifecellvisitor &v, int x, int y, int wd, int ht) ;
    // call after setcell calls
    virtual void endofpattern() {
      poller->bailIfCalculating() ;
@@ -207,6 +229,7 @@ public:
    virtual int hyperCapable() { return 0 ; }
    virtual void setMaxMemory(int m) ;
    virtual int getMaxMemory() { return (int)(maxmemory >> 20) ; }
+   virtual void setNumThreads(int n) ;
    virtual const char *setrule(const char *s) ;
    virtual const char *getrule() { return qliferules.getrule() ; }
    virtual void step() ;
@@ -230,6 +253,11 @@ private:
                 supertile *par, supertile *cor, int lev) ;
    int doquad10(supertile *zis, supertile *edge,
                 supertile *par, supertile *cor, int lev) ;
+   int doquadmt(supertile *zis, supertile *edge,
+                supertile *par, supertile *cor, int lev, int forward) ;
+   void runtask(qlifetask &t) ;
+   void lockalloc() ;
+   void unlockalloc() ;
    int p01(tile *p, tile *pr, tile *pd, tile *prd) ;
    int p10(tile *plu, tile *pu, tile *pl, tile *p) ;
    G_INT64 find_set_bits(supertile *p, int lev, int gm1) ;
@@ -240,9 +268,12 @@ private:
    void dogen() ;
    void renderbm(int x, int y) ;
    void renderbm(int x, int y, int xsize, int ysize) ;
+   int needbm(int x, int y, int size, supertile *p) ;
    void BlitCells(supertile *p, int xoff, int yoff, int wd, int ht, int lev) ;
    void ShrinkCells(supertile *p, int xoff, int yoff, int wd, int ht, int lev) ;
    int nextcell(int x, int y, supertile *n, int lev) ;
+   void visitcells(supertile *n, int lev, long long tx, long long ty,
+                   const long long *r, lifecellvisitor &v, int odd) ;
    void fill_ll(int d) ;
    int lowsub(vector<supertile*> &src, vector<supertile*> &dst, int lev) ;
    int highsub(vector<supertile*> &src, vector<supertile*> &dst, int lev) ;
@@ -265,6 +296,8 @@ private:
    int cleandowncounter ;
    g_uintptr_t maxmemory, usedmemory ;
    char *ruletable ;
+   slicerule slicerules[2] ; // for rule0 and rule1
+   slicerule *currslicerule ; // for ruletable, or 0 if we need the table
    // when drawing, these are used
    liferender *renderer ;
    viewport *view ;
@@ -274,6 +307,11 @@ private:
    int quickb, deltaforward ;
    int llbits, llsize ;
    char *llxb, *llyb ;
+   drawdamage damaged ; // screen tiles of the last draw
    liferules qliferules ;
+   // for multithreaded generations
+   friend struct qlifetask ;
+   qlifemt *mt ;
+   int inwave ;
 } ;
 #endif
@@ -81,6 +81,24 @@ void qlifealgo::renderbm(int x, int y, int xsize, int ysize) {
    memset(bigbuf, 0, sizeof(ibigbuf)) ;
 }
 
+/*
+ *   Tell the damage tracker about the bitmap renderbm is about to draw
+ *   at x,y showing supertile p (0 if it isn't a single supertile), and
+ *   return whether it needs drawing at all.  The supertile can be
+ *   skipped if it hasn't been recomputed since we last drew it, which
+ *   is what dirty bit 31 tracks; the bit is cleared here.
+ */
+int qlifealgo::needbm(int x, int y, int size, supertile *p) {
+   int dirty = 0 ;
+   if (p) {
+      dirty = p->flags & 0x80000000 ;
+      p->flags &= 0x7fffffff ;
+   }
+   int rw = size * pmag ;
+   return damaged.redraw(x * pmag, uviewh - y * pmag - rw, rw, rw,
+                         (G_INT64)(g_uintptr_t)p, dirty) ;
+}
+
 static int minlevel;
 /*
  *   We cheat for now; we assume we can use 32-bit ints.  We can below
@@ -116,6 +134,9 @@ void qlifealgo::BlitCells(supertile *p,
       return;
    }
 
+   if (!needbm(xoff, yoff, bmsize, lev == 2 ? p : 0))
+      return ;
+
    // walk a (probably) non-empty 256x256 supertile, finding all the 1 bits and
    // setting corresponding bits in the bitmap (bigbuf)
    liveseen = 0 ;
@@ -201,6 +222,8 @@ void qlifealgo::ShrinkCells(supertile *p,
          return ;
       }
       if (lev == bmlev) {
+         if (!needbm(xoff, yoff, shbmsize, p))
+            return ;
          bmleft = xoff ;
          bmtop = yoff ;
       }
@@ -496,7 +519,12 @@ void qlifealgo::draw(viewport &viewarg, liferender &renderarg) {
       viewh = uviewh ;
       vieww = uvieww ;
    }
+   // the grid shifts by a cell between even and odd generations, and
+   // with the root level, so both must match to reuse the last frame
+   damaged.begin(*renderer, *view) ;
+   damaged.layout(oddgen + 2 * rootlev) ;
    if (root == nullroots[rootlev]) {
+      damaged.end() ;
       renderer = 0 ;
       view = 0 ;
       return ;
@@ -515,6 +543,7 @@ void qlifealgo::draw(viewport &viewarg, liferender &renderarg) {
       llx = (llx << 1) + llxb[i] ;
       lly = (lly << 1) + llyb[i] ;
       if (llx > 2*maxd || lly > 2*maxd || llx < -2*maxd || lly < -2*maxd) {
+         damaged.end() ;
          renderer = 0 ;
          view = 0 ;
          return ;
@@ -565,6 +594,7 @@ void qlifealgo::draw(viewport &viewarg, liferender &renderarg) {
       llx -= xp ;
       lly -= yp ;
       if (llx > 2*maxd || lly > 2*maxd || llx < -2*maxd || lly < -2*maxd) {
+         damaged.end() ;
          renderer = 0 ;
          view = 0 ;
          return ;
@@ -594,6 +624,7 @@ void qlifealgo::draw(viewport &viewarg, liferender &renderarg) {
    int yoffuht = yoff + wd ;
    int xoffuwd = xoff + wd ;
    if (yoff >= viewh || xoff >= vieww || yoffuht < 0 || xoffuwd < 0) {
+      damaged.end() ;
       renderer = 0 ;
       view = 0 ;
       return ;
@@ -620,8 +651,10 @@ void qlifealgo::draw(viewport &viewarg, liferender &renderarg) {
       ShrinkCells(se, xoff+levsize, yoff, levsize, levsize, curlev);
       ShrinkCells(nw, xoff, yoff+levsize, levsize, levsize, curlev);
       ShrinkCells(ne, xoff+levsize, yoff+levsize, levsize, levsize, curlev);
-      if (bmlev > curlev)
+      if (bmlev > curlev) {
+         needbm(bmleft, bmtop, shbmsize, 0) ;
          renderbm(bmleft, bmtop, shbmsize, shbmsize) ;
+      }
    } else {
       // recurse down to 256x256 supertiles and use bitmap blitting
       BlitCells(sw, xoff, yoff, levsize, levsize, curlev);
@@ -629,6 +662,7 @@ void qlifealgo::draw(viewport &viewarg, liferender &renderarg) {
       BlitCells(nw, xoff, yoff+levsize, levsize, levsize, curlev);
       BlitCells(ne, xoff+levsize, yoff+levsize, levsize, levsize, curlev);
    }
+   damaged.end() ;
    renderer = 0 ;
    view = 0 ;
 }
@@ -15,6 +15,17 @@
 #endif
 #include <cstdlib>
 #include <cstring>
+#ifdef ZLIB
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #define LINESIZE 20000
 #define CR 13
@@ -36,62 +47,271 @@ FILE *pattfile ;
 #endif
 
 char filebuff[BUFFSIZE];
-int buffpos, bytesread, prevchar;
+const char *inbuff;         // the chars being read (filebuff or one of the chunks below)
+size_t buffpos, bytesread;  // position in inbuff and number of chars in it
+int prevchar;
 
 long filesize;              // length of file in bytes
 
-// use buffered getchar instead of slow fgetc
-// don't override the "getchar" name which is likely to be a macro
-int mgetchar() {
-   if (buffpos == BUFFSIZE) {
-      double filepos;
-      #ifdef ZLIB
-         bytesread = gzread(zinstream, filebuff, BUFFSIZE);
-         filepos = gzoffset(zinstream);
-      #else
-         bytesread = fread(filebuff, 1, BUFFSIZE, pattfile);
-         filepos = ftell(pattfile);
-      #endif
-      buffpos = 0;
-      lifeabortprogress(filepos / filesize, "");
+long getfilesize(const char *filename) {
+   long flen = 0;
+   FILE *f = fopen(filename, "r");
+   if (f != 0) {
+      fseek(f, 0L, SEEK_END);
+      flen = ftell(f);
+      fclose(f);
    }
-   if (buffpos >= bytesread) return EOF;
-   return filebuff[buffpos++];
+   return flen;
 }
 
-// use getline instead of fgets so we can handle DOS/Mac/Unix line endings
+#ifndef _WIN32
+// Uncompressed files are mapped into memory and read in place, in chunks
+// of MAPCHUNK chars so the progress dialog is still updated.
+#define MAPFILES
+#define MAPCHUNK (1 << 20)
+const char *mapbase = 0;
+size_t mapsize, mapoffset;
+#endif
+
+#ifdef ZLIB
+// Compressed files are inflated by another thread into a ring of GZCHUNKS
+// chunks so that inflating the rest of the file overlaps with parsing.
+#define GZCHUNK (1 << 20)
+#define GZCHUNKS 4
+
+struct gzreader {
+   std::thread thread ;
+   std::mutex mut ;
+   std::condition_variable cond ;
+   char *chunk[GZCHUNKS] ;
+   size_t len[GZCHUNKS] ;        // chars in each chunk (0 at end of file)
+   double offset[GZCHUNKS] ;     // file position after each chunk
+   int next ;                    // chunk to be filled next
+   int take ;                    // chunk to be parsed next
+   int count ;                   // chunks filled and not yet released by the parser
+   bool holding ;                // parser is using chunk[take]
+   bool done, stop ;
+   void run() ;
+} ;
+
+gzreader *gzthread = 0;
+
+void gzreader::run() {
+   std::unique_lock<std::mutex> lock(mut) ;
+   while (true) {
+      cond.wait(lock, [this] { return stop || count < GZCHUNKS ; }) ;
+      if (stop)
+         break ;
+      int slot = next ;
+      lock.unlock() ;
+      int n = gzread(zinstream, chunk[slot], GZCHUNK) ;
+      double pos = gzoffset(zinstream) ;
+      lock.lock() ;
+      len[slot] = n > 0 ? n : 0 ;
+      offset[slot] = pos ;
+      next = (next + 1) % GZCHUNKS ;
+      count++ ;
+      cond.notify_all() ;
+      if (n <= 0)
+         break ;
+   }
+   done = true ;
+   cond.notify_all() ;
+}
+#endif
+
+// get the next chars from the current pattern file into inbuff;
+// return false at the end of the file
+static bool fillbuff() {
+   double filepos;
+   buffpos = 0;
+   bytesread = 0;
+#ifdef MAPFILES
+   if (mapbase) {
+      if (mapoffset >= mapsize) return false;
+      inbuff = mapbase + mapoffset;
+      bytesread = mapsize - mapoffset;
+      if (bytesread > MAPCHUNK) bytesread = MAPCHUNK;
+      mapoffset += bytesread;
+      lifeabortprogress((double)mapoffset / mapsize, "");
+      return true;
+   }
+#endif
+#ifdef ZLIB
+   if (gzthread) {
+      gzreader &g = *gzthread;
+      std::unique_lock<std::mutex> lock(g.mut);
+      if (g.holding) {
+         // let the reader thread refill the chunk we've finished with
+         g.holding = false;
+         g.take = (g.take + 1) % GZCHUNKS;
+         g.count--;
+         g.cond.notify_all();
+      }
+      g.cond.wait(lock, [&g] { return g.count > 0 || g.done; });
+      if (g.count == 0) return false;
+      g.holding = true;
+      inbuff = g.chunk[g.take];
+      bytesread = g.len[g.take];
+      filepos = g.offset[g.take];
+   } else {
+      inbuff = filebuff;
+      int n = gzread(zinstream, filebuff, BUFFSIZE);
+      bytesread = n > 0 ? n : 0;
+      filepos = gzoffset(zinstream);
+   }
+#else
+   inbuff = filebuff;
+   bytesread = fread(filebuff, 1, BUFFSIZE, pattfile);
+   filepos = ftell(pattfile);
+#endif
+   lifeabortprogress(filepos / filesize, "");
+   return bytesread > 0;
+}
+
+// open the given pattern file for getline; return false if that fails
+static bool openpattfile(const char *filename) {
+   filesize = getfilesize(filename);
+   inbuff = filebuff;
+   buffpos = 0;
+   bytesread = 0;                            // for 1st getline call
+   prevchar = 0;
+#ifdef MAPFILES
+   // map the file if it isn't compressed
+   int fd = open(filename, O_RDONLY);
+   if (fd >= 0) {
+      struct stat st;
+      if (fstat(fd, &st) == 0 && st.st_size > 0 && (unsigned long long)st.st_size < ((size_t)-1) / 2) {
+         void *p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (p != MAP_FAILED) {
+            const unsigned char *bytes = (const unsigned char *)p;
+            if (st.st_size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b) {
+               munmap(p, st.st_size);
+            } else {
+               madvise(p, st.st_size, MADV_SEQUENTIAL);
+               mapbase = (const char *)p;
+               mapsize = st.st_size;
+               mapoffset = 0;
+               close(fd);
+               return true;
+            }
+         }
+      }
+      close(fd);
+   }
+#endif
+#ifdef ZLIB
+   zinstream = gzopen(filename, "rb") ;      // rb needed on Windows
+   if (zinstream == 0)
+      return false ;
+   // small files aren't worth another thread
+   if (filesize > GZCHUNK / 4) {
+      gzthread = new gzreader ;
+      gzreader &g = *gzthread ;
+      for (int i = 0; i < GZCHUNKS; i++) {
+         g.chunk[i] = (char *)malloc(GZCHUNK) ;
+         if (g.chunk[i] == 0)
+            lifefatal("Not enough memory to read pattern file!") ;
+      }
+      g.next = g.take = g.count = 0 ;
+      g.holding = g.done = g.stop = false ;
+      g.thread = std::thread(&gzreader::run, gzthread) ;
+   }
+#else
+   pattfile = fopen(filename, "r") ;
+   if (pattfile == 0)
+      return false ;
+#endif
+   return true;
+}
+
+static void closepattfile() {
+#ifdef MAPFILES
+   if (mapbase) {
+      munmap((void *)mapbase, mapsize);
+      mapbase = 0;
+      return;
+   }
+#endif
+#ifdef ZLIB
+   if (gzthread) {
+      {
+         std::lock_guard<std::mutex> lock(gzthread->mut);
+         gzthread->stop = true;
+         gzthread->cond.notify_all();
+      }
+      gzthread->thread.join();
+      for (int i = 0; i < GZCHUNKS; i++)
+         free(gzthread->chunk[i]);
+      delete gzthread;
+      gzthread = 0;
+   }
+   gzclose(zinstream) ;
+#else
+   fclose(pattfile) ;
+#endif
+}
+
+// use getline instead of fgets so we can handle DOS/Mac/Unix line endings;
+// the chars between line endings are copied from inbuff in one go
 char *getline(char *line, int maxlinelen) {
    int i = 0;
    while (i < maxlinelen) {
-      int ch = mgetchar();
-      if (isaborted()) return NULL;
-      switch (ch) {
-         case CR:
-            prevchar = CR;
-            line[i] = 0;
-            return line;
-         case LF:
-            if (prevchar != CR) {
-               prevchar = LF;
-               line[i] = 0;
-               return line;
-            }
-            // if CR+LF (DOS) then ignore the LF
-            break;
-         case EOF:
+      if (buffpos >= bytesread) {
+         bool more = fillbuff();
+         if (isaborted()) return NULL;
+         if (!more) {
             if (i == 0) return NULL;
             line[i] = 0;
             return line;
-         default:
-            prevchar = ch;
-            line[i++] = (char) ch;
-            break;
+         }
+      }
+      const char *p = inbuff + buffpos;
+      const char *end = inbuff + bytesread;
+      if (end - p > maxlinelen - i) end = p + (maxlinelen - i);
+      const char *q = p;
+      while (q < end && *q != CR && *q != LF) q++;
+      if (q > p) {
+         memcpy(line + i, p, q - p);
+         i += q - p;
+         buffpos += q - p;
+         prevchar = (unsigned char) q[-1];
+      }
+      if (q == end) continue;
+      buffpos++;
+      if (*q == CR) {
+         prevchar = CR;
+         line[i] = 0;
+         return line;
       }
+      if (prevchar != CR) {
+         prevchar = LF;
+         line[i] = 0;
+         return line;
+      }
+      // if CR+LF (DOS) then ignore the LF
    }
    line[i] = 0;      // silently truncate long line
    return line;
 }
 
+// the macrocell readers call this for every node so it needs to be much
+// faster than sscanf
+int getmcnumbers(const char *line, g_uintptr_t *vals, int maxvals) {
+   const char *p = line;
+   int n = 0;
+   while (n < maxvals) {
+      while (*p && *p <= ' ') p++;
+      if (*p < '0' || *p > '9')
+         return (n == 0 && *p == 0) ? -1 : n;
+      g_uintptr_t v = 0;
+      while (*p >= '0' && *p <= '9')
+         v = v * 10 + (*p++ - '0');
+      vals[n++] = v;
+   }
+   return n;
+}
+
 const char *SETCELLERROR = "Impossible; set cell error for state 1" ;
 
 // Read a text pattern like "...ooo$$$ooo" where '.', ',' and chars <= ' '
@@ -108,7 +328,7 @@ const char *readtextpattern(lifealgo &imp, char *line) {
          } else if (*p == '$') {
             x += 10;
          } else {
-            if (imp.setcell(x, y, 1) < 0) {
+            if (imp.setrowcell(x, y, 1) < 0) {
                return SETCELLERROR ;
             }
             x++;
@@ -315,7 +535,7 @@ const char *readrle(lifealgo &imp, char *line, size_t nwsindex) {
                      if (ght == 0 || y < ght) {
                         while (n-- > 0) {
                            if (gwd == 0 || x < gwd) {
-                              if (imp.setcell(xoff + x, yoff + y, state) < 0)
+                              if (imp.setrowcell(xoff + x, yoff + y, state) < 0)
                                  return "Cell state out of range for this algorithm";
                            }
                            x++;
@@ -418,7 +638,7 @@ const char *readdblife(lifealgo &imp, char *line) {
                   x += n;
                } else if (*p == 'O') {
                   while (n-- > 0)
-                     if (imp.setcell(x++, y, 1) < 0)
+                     if (imp.setrowcell(x++, y, 1) < 0)
                         return SETCELLERROR ;
                } else {
                   // ignore dblife commands like "5k10h@"
@@ -623,17 +843,6 @@ const char *readmcell(lifealgo &imp, char *line) {
    return 0;
 }
 
-long getfilesize(const char *filename) {
-   long flen = 0;
-   FILE *f = fopen(filename, "r");
-   if (f != 0) {
-      fseek(f, 0L, SEEK_END);
-      flen = ftell(f);
-      fclose(f);
-   }
-   return flen;
-}
-
 // This function guesses whether `line' is the start of a headerless Life RLE
 // pattern.  It is used to distinguish headerless RLE from plain text patterns.
 static bool isplainrle(const char *line) {
@@ -842,41 +1051,17 @@ const char *build_err_str(const char *filename) {
 }
 
 const char *readpattern(const char *filename, lifealgo &imp) {
-   filesize = getfilesize(filename);
-#ifdef ZLIB
-   zinstream = gzopen(filename, "rb") ;      // rb needed on Windows
-   if (zinstream == 0)
+   if (!openpattfile(filename))
       return build_err_str(filename) ;
-#else
-   pattfile = fopen(filename, "r") ;
-   if (pattfile == 0)
-      return build_err_str(filename) ;
-#endif
-   buffpos = BUFFSIZE;                       // for 1st getchar call
-   prevchar = 0;                             // for 1st getline call
    const char *errmsg = loadpattern(filename, imp) ;
-#ifdef ZLIB
-   gzclose(zinstream) ;
-#else
-   fclose(pattfile) ;
-#endif
+   closepattfile() ;
    return errmsg ;
 }
 
 const char *readclipboard(const char *filename, lifealgo &imp,
                           bigint *t, bigint *l, bigint *b, bigint *r) {
-   filesize = getfilesize(filename);
-#ifdef ZLIB
-   zinstream = gzopen(filename, "rb") ;      // rb needed on Windows
-   if (zinstream == 0)
+   if (!openpattfile(filename))
       return "Can't open clipboard file!" ;
-#else
-   pattfile = fopen(filename, "r") ;
-   if (pattfile == 0)
-      return "Can't open clipboard file!" ;
-#endif
-   buffpos = BUFFSIZE;                       // for 1st getchar call
-   prevchar = 0;                             // for 1st getline call
 
    top = 0;
    left = 0;
@@ -893,11 +1078,7 @@ const char *readclipboard(const char *filename, lifealgo &imp,
    if (bottom < top) *b = top;
    if (right < left) *r = left;
 
-#ifdef ZLIB
-   gzclose(zinstream) ;
-#else
-   fclose(pattfile) ;
-#endif
+   closepattfile() ;
    return errmsg ;
 }
 
@@ -910,19 +1091,9 @@ const char *readcomments(const char *filename, char **commptr)
    char *cptr = *commptr;
    cptr[0] = 0;                              // safer to init to empty string
 
-   filesize = getfilesize(filename);
-#ifdef ZLIB
-   zinstream = gzopen(filename, "rb") ;      // rb needed on Windows
-   if (zinstream == 0)
+   if (!openpattfile(filename))
       return build_err_str(filename) ;
-#else
-   pattfile = fopen(filename, "r") ;
-   if (pattfile == 0)
-      return build_err_str(filename) ;
-#endif
    char line[LINESIZE + 1] ;
-   buffpos = BUFFSIZE;                       // for 1st getchar call
-   prevchar = 0;                             // for 1st getline call
    int commlen = 0;
    size_t nwsindex = 0;                      // index of first non-whitespace character in line
 
@@ -1038,10 +1209,6 @@ const char *readcomments(const char *filename, char **commptr)
    if (commlen == maxcommlen) commlen--;
    cptr[commlen] = 0;
 
-#ifdef ZLIB
-   gzclose(zinstream) ;
-#else
-   fclose(pattfile) ;
-#endif
+   closepattfile() ;
    return 0 ;
 }
@@ -4,6 +4,7 @@
 #ifndef READPATTERN_H
 #define READPATTERN_H
 #include "bigint.h"
+#include "platform.h"
 class lifealgo ;
 
 // allocate a 1MB buffer for storing comment data (big enough
@@ -20,6 +21,13 @@ const char *readpattern(const char *filename, lifealgo &imp) ;
  */
 char *getline(char *line, int maxlinelen) ;
 
+/*
+ *   Read up to maxvals unsigned decimal numbers separated by whitespace
+ *   from the start of a macrocell line into vals.  Like sscanf, this
+ *   returns the number read, or -1 if the line is blank.
+ */
+int getmcnumbers(const char *line, g_uintptr_t *vals, int maxvals) ;
+
 /*
  *   Similar to readpattern but we return the pattern edges
  *   (not necessarily the minimal bounding box; eg. if an
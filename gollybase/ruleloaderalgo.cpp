@@ -256,6 +256,16 @@ state ruleloaderalgo::slowcalc(state nw, state n, state ne, state w, state c,
         return LocalRuleTree->slowcalc(nw, n, ne, w, c, e, sw, s, se);
 }
 
+void ruleloaderalgo::slowcalcblock(const state *c, int stride, state *res,
+                                   int wd, int ht)
+{
+    // hand the whole block over so the local algo can use its own kernel
+    if (rule_type == TABLE)
+        LocalRuleTable->slowcalcblock(c, stride, res, wd, ht);
+    else // rule_type == TREE
+        LocalRuleTree->slowcalcblock(c, stride, res, wd, ht);
+}
+
 static lifealgo* creator()
 {
     return new ruleloaderalgo();
@@ -15,6 +15,20 @@
 #include <sstream>
 using namespace std;
 
+// the lut rows are scanned this many words at a time
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LUT_VECWORDS (4)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LUT_VECWORDS (2)
+#else
+#define LUT_VECWORDS (1)
+#endif
+#if defined(_MSC_VER) && defined(_WIN64)
+#include <intrin.h>
+#endif
+
 const string ruletable_algo::neighborhood_value_keywords[N_SUPPORTED_NEIGHBORHOODS] = 
                     {"vonNeumann","Moore","hexagonal","oneDimensional"};
 // (keep in sync with TNeighborhood)
@@ -621,6 +635,19 @@ void ruletable_algo::PackTransitions(const string& symmetries, int n_inputs,
          }
       }
    }
+   FlattenLut();
+}
+
+// copy the lut into the padded flat layout used by the update kernels
+void ruletable_algo::FlattenLut()
+{
+   unsigned int n_inputs = (unsigned int)this->lut.size();
+   this->n_flat_words = (this->n_compressed_rules + LUT_VECWORDS - 1) / LUT_VECWORDS * LUT_VECWORDS;
+   this->flat_lut.assign((size_t)n_inputs * this->n_states * this->n_flat_words, 0);
+   for(unsigned int iInput=0;iInput<n_inputs;iInput++)
+      for(unsigned int iState=0;iState<this->n_states;iState++)
+         for(unsigned int iRuleC=0;iRuleC<this->n_compressed_rules;iRuleC++)
+            this->flat_lut[(iInput*this->n_states+iState)*this->n_flat_words+iRuleC] = this->lut[iInput][iState][iRuleC];
 }
 
 void ruletable_algo::PackTransition(const vector< vector<state> > & inputs,
@@ -664,7 +691,7 @@ const char* ruletable_algo::DefaultRule() {
 }
 
 ruletable_algo::ruletable_algo()
-   : n_states(8), neighborhood(vonNeumann), n_compressed_rules(0)
+   : n_states(8), neighborhood(vonNeumann), n_compressed_rules(0), n_flat_words(0)
 {
    maxCellStates = n_states;
 }
@@ -674,118 +701,131 @@ ruletable_algo::~ruletable_algo()
 }
 
 // --- the update function ---
-state ruletable_algo::slowcalc(state nw, state n, state ne, state w, state c, state e,
-                        state sw, state s, state se) 
-{
-   TBits is_match = 0;  // AKT: explicitly initialized to avoid gcc warning
 
-   switch (this->neighborhood) {
-      case vonNeumann: // c,n,e,s,w
-         for(unsigned int iRuleC=0;iRuleC<this->n_compressed_rules;iRuleC++)
-         {
-            // quit early if possible
-            is_match = this->lut[0][c][iRuleC] & this->lut[1][n][iRuleC];
-            if (is_match) {
-               is_match &= this->lut[2][e][iRuleC] & this->lut[3][s][iRuleC] & this->lut[4][w][iRuleC];
+// Each cell's inputs are taken from the 3x3 window around it (numbered
+// nw,n,ne,w,c,e,sw,s,se from 0 to 8) in the order the lut expects them.
+static const int nbhood_inputs[4][9] = {
+   { 4, 1, 5, 7, 3 },                // vonNeumann: c,n,e,s,w
+   { 4, 1, 2, 5, 8, 7, 6, 3, 0 },    // Moore: c,n,ne,e,se,s,sw,w,nw
+   { 4, 1, 5, 8, 7, 3, 0 },          // hexagonal: c,n,e,se,s,w,nw
+   { 4, 3, 5 }                       // oneDimensional: c,w,e
+};
 
-               // if any of them matched, return the output of the first
-               if(is_match)
-               {
-                  // find the least significant bit of is_match
-                  unsigned int iBit=0;
-                  TBits mask=1;
-                  while(!(is_match&mask))
-                  {
-                     ++iBit;
-                     mask <<= 1;
-                  }
-                  return this->output[ iRuleC*sizeof(TBits)*8 + iBit ]; // find the uncompressed rule index
-               }
-            }
-         }
-         break;
+static inline unsigned int lowestbit(unsigned long long x)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+   unsigned long r;
+   _BitScanForward64(&r, x);
+   return r;
+#elif defined(__GNUC__)
+   return (unsigned int)__builtin_ctzll(x);
+#else
+   unsigned int r = 0;
+   while (!(x & 1)) {
+      x >>= 1;
+      r++;
+   }
+   return r;
+#endif
+}
 
-      case Moore: // c,n,ne,e,se,s,sw,w,nw
-         for(unsigned int iRuleC=0;iRuleC<this->n_compressed_rules;iRuleC++)
-         {
-            // quit early if possible
-            is_match = this->lut[0][c][iRuleC] & this->lut[1][n][iRuleC];
-            if (is_match) {
-               is_match &= this->lut[2][ne][iRuleC] & this->lut[3][e][iRuleC];
-               if (is_match) {
-                  is_match &= this->lut[4][se][iRuleC] & this->lut[5][s][iRuleC];
-                  if (is_match) {
-                     is_match &= this->lut[6][sw][iRuleC] & this->lut[7][w][iRuleC] & this->lut[8][nw][iRuleC];
-
-                     // if any of them matched, return the output of the first
-                     if(is_match)
-                     {
-                        // find the least significant bit of is_match
-                        unsigned int iBit=0;
-                        TBits mask=1;
-                        while(!(is_match&mask))
-                        {
-                           ++iBit;
-                           mask <<= 1;
-                        }
-                        return this->output[ iRuleC*sizeof(TBits)*8 + iBit ]; // find the uncompressed rule index
-                     }
-                  }
-               }
-            }
+// Evaluate a block of cells for one neighborhood.  The number of inputs
+// is a compile-time constant so the loops over them unroll, and the
+// compressed rules are scanned a SIMD vector of words at a time.
+template <int NBHOOD, int NINPUTS>
+void ruletable_algo::calcblock(const state *c, int stride, state *res, int wd, int ht)
+{
+   const int off[9] = { 0, 1, 2, stride, stride+1, stride+2,
+                        2*stride, 2*stride+1, 2*stride+2 };
+   const unsigned int nwords = this->n_flat_words;
+   if (nwords == 0) {
+      // no rules: nothing changes
+      for (int y=0; y<ht; y++, c+=stride)
+         for (int x=0; x<wd; x++)
+            *res++ = c[x+off[4]];
+      return;
+   }
+   const TBits *base = &this->flat_lut[0];
+   const size_t inputsize = (size_t)this->n_states * nwords;
+   for (int y=0; y<ht; y++, c+=stride) {
+      for (int x=0; x<wd; x++) {
+         const state *p = c + x;
+         const TBits *in[NINPUTS];
+         for (int i=0; i<NINPUTS; i++)
+            in[i] = base + i*inputsize + (size_t)p[off[nbhood_inputs[NBHOOD][i]]] * nwords;
+         state result = p[off[4]]; // default: no change
+         for (unsigned int iw=0; iw<nwords; iw+=LUT_VECWORDS) {
+            // quit early if the first two inputs already rule these out
+#if defined(__AVX2__)
+            __m256i m = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(in[0]+iw)),
+                                         _mm256_loadu_si256((const __m256i*)(in[1]+iw)));
+            if (_mm256_testz_si256(m, m))
+               continue;
+            for (int i=2; i<NINPUTS; i++)
+               m = _mm256_and_si256(m, _mm256_loadu_si256((const __m256i*)(in[i]+iw)));
+            if (_mm256_testz_si256(m, m))
+               continue;
+            TBits words[LUT_VECWORDS];
+            _mm256_storeu_si256((__m256i*)words, m);
+#elif defined(__SSE2__)
+            const __m128i zero = _mm_setzero_si128();
+            __m128i m = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in[0]+iw)),
+                                      _mm_loadu_si128((const __m128i*)(in[1]+iw)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(m, zero)) == 0xffff)
+               continue;
+            for (int i=2; i<NINPUTS; i++)
+               m = _mm_and_si128(m, _mm_loadu_si128((const __m128i*)(in[i]+iw)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(m, zero)) == 0xffff)
+               continue;
+            TBits words[LUT_VECWORDS];
+            _mm_storeu_si128((__m128i*)words, m);
+#else
+            TBits words[LUT_VECWORDS];
+            words[0] = in[0][iw] & in[1][iw];
+            if (!words[0])
+               continue;
+            for (int i=2; i<NINPUTS; i++)
+               words[0] &= in[i][iw];
+            if (!words[0])
+               continue;
+#endif
+            // if any of them matched, return the output of the first
+            int k = 0;
+            while (!words[k])
+               k++;
+            result = this->output[ (iw+k)*sizeof(TBits)*8 + lowestbit(words[k]) ]; // find the uncompressed rule index
+            break;
          }
-         break;
+         *res++ = result;
+      }
+   }
+}
 
-      case hexagonal: // c,n,e,se,s,w,nw
-         for(unsigned int iRuleC=0;iRuleC<this->n_compressed_rules;iRuleC++)
-         {
-            // quit early if possible
-            is_match = this->lut[0][c][iRuleC] & this->lut[1][n][iRuleC];
-            if (is_match) {
-               is_match &= this->lut[2][e][iRuleC] & this->lut[3][se][iRuleC];
-               if (is_match) {
-                  is_match &= this->lut[4][s][iRuleC] & this->lut[5][w][iRuleC] & this->lut[6][nw][iRuleC];
-
-                  // if any of them matched, return the output of the first
-                  if(is_match)
-                  {
-                     // find the least significant bit of is_match
-                     unsigned int iBit=0;
-                     TBits mask=1;
-                     while(!(is_match&mask))
-                     {
-                        ++iBit;
-                        mask <<= 1;
-                     }
-                     return this->output[ iRuleC*sizeof(TBits)*8 + iBit ]; // find the uncompressed rule index
-                  }
-               }
-            }
-         }
+void ruletable_algo::slowcalcblock(const state *c, int stride, state *res, int wd, int ht)
+{
+   switch (this->neighborhood) {
+      case vonNeumann:
+         calcblock<vonNeumann, 5>(c, stride, res, wd, ht);
          break;
-
-      case oneDimensional: // c,w,e
-         for(unsigned int iRuleC=0;iRuleC<this->n_compressed_rules;iRuleC++)
-         {
-            is_match = this->lut[0][c][iRuleC] & this->lut[1][w][iRuleC] & this->lut[2][e][iRuleC];
-
-            // if any of them matched, return the output of the first
-            if(is_match)
-            {
-               // find the least significant bit of is_match
-               unsigned int iBit=0;
-               TBits mask=1;
-               while(!(is_match&mask))
-               {
-                  ++iBit;
-                  mask <<= 1;
-               }
-               return this->output[ iRuleC*sizeof(TBits)*8 + iBit ]; // find the uncompressed rule index
-            }
-         }
+      case Moore:
+         calcblock<Moore, 9>(c, stride, res, wd, ht);
+         break;
+      case hexagonal:
+         calcblock<hexagonal, 7>(c, stride, res, wd, ht);
+         break;
+      case oneDimensional:
+         calcblock<oneDimensional, 3>(c, stride, res, wd, ht);
          break;
    }
-   return c; // default: no change
+}
+
+state ruletable_algo::slowcalc(state nw, state n, state ne, state w, state c, state e,
+                        state sw, state s, state se) 
+{
+   state cells[9] = { nw, n, ne, w, c, e, sw, s, se };
+   state result = c;
+   ruletable_algo::slowcalcblock(cells, 3, &result, 1, 1);
+   return result;
 }
 
 static lifealgo *creator() { return new ruletable_algo(); }
@@ -18,6 +18,8 @@ public:
    virtual ~ruletable_algo() ;
    virtual state slowcalc(state nw, state n, state ne, state w, state c,
                           state e, state sw, state s, state se) ;
+   virtual void slowcalcblock(const state *c, int stride, state *res,
+                              int wd, int ht) ;
    virtual const char* setrule(const char* s) ;
    virtual const char* getrule() ;
    virtual const char* DefaultRule() ;
@@ -34,6 +36,9 @@ protected:
    void PackTransitions(const std::string& symmetries, int n_inputs, 
                         const std::vector< std::pair< std::vector< std::vector<state> >, state> > & transition_table);
    void PackTransition(const std::vector< std::vector<state> > & inputs, state output);
+   void FlattenLut();
+   template <int NBHOOD, int NINPUTS>
+   void calcblock(const state *c, int stride, state *res, int wd, int ht);
                         
 protected:
 
@@ -47,6 +52,11 @@ protected:
    typedef unsigned long long int TBits; // we can use unsigned int if we hit portability issues (not much slower)
    std::vector< std::vector< std::vector<TBits> > > lut; // TBits lut[neighbourhood_size][n_states][n_compressed_rules];
    unsigned int n_compressed_rules;
+   // the same table flattened for the update kernels: the words for input i
+   // in state s start at flat_lut[(i*n_states+s)*n_flat_words], and each row
+   // is zero-padded to a whole number of SIMD vectors
+   std::vector<TBits> flat_lut;
+   unsigned int n_flat_words;
    std::vector<state> output; // state output[n_rules];
 
 };
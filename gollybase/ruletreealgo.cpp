@@ -178,6 +178,7 @@ const char* ruletreealgo::setrule(const char* s) {
    a = na ;
    b = nb ;
    base = noff[noff.size()-1] ;
+   buildlookup((int)dat.size(), (int)datb.size()) ;
    maxCellStates = num_states ;
    ghashbase::setrule(rule_name.c_str()) ;
    
@@ -205,7 +206,8 @@ const char* ruletreealgo::DefaultRule() {
 
 ruletreealgo::ruletreealgo() : ghashbase(), a(0), base(0), b(0),
                                num_neighbors(0),
-                               num_states(0), num_nodes(0) {
+                               num_states(0), num_nodes(0),
+                               lookup(0), lookupbits(0), a16(0), b16(0) {
    rule[0] = 0 ;
 }
 
@@ -218,16 +220,168 @@ ruletreealgo::~ruletreealgo() {
       free(b) ;
       b = 0 ;
    }
+   freelookup() ;
 }
 
-state ruletreealgo::slowcalc(state nw, state n, state ne, state w, state c, state e,
-                        state sw, state s, state se) {
+/*
+ *   Largest direct lookup table we build, as a power of two; 2^18 states
+ *   is 256K, which still sits comfortably in L2.  That covers up to four
+ *   states in the Moore neighborhood (WireWorld among them) and up to
+ *   eight in the von Neumann neighborhood.
+ */
+static const int MAXLOOKUPBITS = 18 ;
+
+void ruletreealgo::freelookup() {
+   if (lookup) {
+      free(lookup) ;
+      lookup = 0 ;
+   }
+   if (a16) {
+      free(a16) ;
+      a16 = 0 ;
+   }
+   if (b16) {
+      free(b16) ;
+      b16 = 0 ;
+   }
+}
+
+/*
+ *   Compile the tree we just loaded into something faster to walk.
+ *   Failing to get memory for either form is not an error; we just fall
+ *   back to walking the tree itself.
+ */
+void ruletreealgo::buildlookup(int asize, int bsize) {
+   freelookup() ;
+   int ninputs = num_neighbors + 1 ;
+   int bits = 1 ;
+   while ((1 << bits) < num_states)
+      bits++ ;
+   if (bits * ninputs <= MAXLOOKUPBITS) {
+      int size = 1 << (bits * ninputs) ;
+      lookup = (state *)calloc(sizeof(state), size) ;
+      if (lookup) {
+         lookupbits = bits ;
+         int mask = (1 << bits) - 1 ;
+         for (int i=0; i<size; i++) {
+            // the first input in tree order is in the top bits
+            int off = base ;
+            int sh = bits * ninputs ;
+            for (int j=0; j<ninputs; j++) {
+               sh -= bits ;
+               int v = (i >> sh) & mask ;
+               if (v >= num_states) {
+                  off = -1 ;
+                  break ;
+               }
+               if (j < num_neighbors)
+                  off = a[off + v] ;
+               else
+                  off += v ;
+            }
+            if (off >= 0)
+               lookup[i] = b[off] ;
+         }
+         return ;
+      }
+   }
+   if (asize > 65536 || bsize > 65536)
+      return ;
+   /*
+    *   Lay the nodes out again breadth-first from the root, so the first
+    *   few levels (which every lookup touches) share a handful of cache
+    *   lines, and shrink the offsets to 16 bits.  Every child is exactly
+    *   one level down, so the queue holds one level at a time.
+    */
+   vector<int> remapa(asize, -1), remapb(bsize, -1) ;
+   vector<char> lev2(asize, 0) ;
+   vector<int> queue ;
+   int na = 0, nb = 0 ;
+   remapa[base] = na ;
+   na += num_states ;
+   queue.push_back(base) ;
+   for (int lev = num_neighbors + 1; lev >= 2; lev--) {
+      vector<int> next ;
+      for (unsigned int q=0; q<queue.size(); q++) {
+         lev2[queue[q]] = (lev == 2) ;
+         for (int i=0; i<num_states; i++) {
+            int child = a[queue[q] + i] ;
+            if (lev > 2) {
+               if (remapa[child] < 0) {
+                  remapa[child] = na ;
+                  na += num_states ;
+                  next.push_back(child) ;
+               }
+            } else if (remapb[child] < 0) {
+               remapb[child] = nb ;
+               nb += num_states ;
+            }
+         }
+      }
+      queue.swap(next) ;
+   }
+   unsigned short *na16 = (unsigned short *)calloc(sizeof(unsigned short), na) ;
+   state *nb16 = (state *)calloc(sizeof(state), nb) ;
+   if (na16 == 0 || nb16 == 0) {
+      if (na16)
+         free(na16) ;
+      if (nb16)
+         free(nb16) ;
+      return ;
+   }
+   for (int i=0; i<asize; i += num_states)
+      if (remapa[i] >= 0)
+         for (int j=0; j<num_states; j++) {
+            int child = a[i + j] ;
+            na16[remapa[i] + j] =
+               (unsigned short)(lev2[i] ? remapb[child] : remapa[child]) ;
+         }
+   for (int i=0; i<bsize; i += num_states)
+      if (remapb[i] >= 0)
+         for (int j=0; j<num_states; j++)
+            nb16[remapb[i] + j] = b[i + j] ;
+   a16 = na16 ;
+   b16 = nb16 ;
+}
+
+inline state ruletreealgo::calc(state nw, state n, state ne, state w, state c,
+                                state e, state sw, state s, state se) {
+   if (lookup) {
+      int k = lookupbits ;
+      if (num_neighbors == 4)
+         return lookup[(((((((n << k) | w) << k) | e) << k) | s) << k) | c] ;
+      int i = (((((((nw << k) | ne) << k) | sw) << k) | se) << k) | n ;
+      return lookup[(((((((i << k) | w) << k) | e) << k) | s) << k) | c] ;
+   }
+   if (a16) {
+      const unsigned short *t = a16 ;
+      if (num_neighbors == 4)
+         return b16[t[t[t[t[n]+w]+e]+s]+c] ;
+      else
+         return b16[t[t[t[t[t[t[t[t[nw]+ne]+sw]+se]+n]+w]+e]+s]+c] ;
+   }
    if (num_neighbors == 4)
      return b[a[a[a[a[base+n]+w]+e]+s]+c] ;
    else
      return b[a[a[a[a[a[a[a[a[base+nw]+ne]+sw]+se]+n]+w]+e]+s]+c] ;
 }
 
+state ruletreealgo::slowcalc(state nw, state n, state ne, state w, state c, state e,
+                        state sw, state s, state se) {
+   return calc(nw, n, ne, w, c, e, sw, s, se) ;
+}
+
+void ruletreealgo::slowcalcblock(const state *c, int stride, state *res,
+                                 int wd, int ht) {
+   for (int y=0; y<ht; y++, c += stride)
+      for (int x=0; x<wd; x++) {
+         const state *p = c + x ;
+         *res++ = calc(p[0], p[1], p[2],
+                       p[stride], p[stride+1], p[stride+2],
+                       p[2*stride], p[2*stride+1], p[2*stride+2]) ;
+      }
+}
+
 static lifealgo *creator() { return new ruletreealgo() ; }
 
 void ruletreealgo::doInitializeAlgoInfo(staticAlgoInfo &ai) {
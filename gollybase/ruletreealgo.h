@@ -13,6 +13,8 @@ public:
    virtual ~ruletreealgo() ;
    virtual state slowcalc(state nw, state n, state ne, state w, state c,
                           state e, state sw, state s, state se) ;
+   virtual void slowcalcblock(const state *c, int stride, state *res,
+                              int wd, int ht) ;
    virtual const char* setrule(const char* s) ;
    virtual const char* getrule() ;
    virtual const char* DefaultRule() ;
@@ -24,9 +26,21 @@ public:
    const char* LoadTree(FILE* rulefile, int lineno, char endchar, const char* s);
 
 private:
+   inline state calc(state nw, state n, state ne, state w, state c,
+                     state e, state sw, state s, state se) ;
+   void buildlookup(int asize, int bsize) ;
+   void freelookup() ;
    int *a, base ;
    state *b ;
    int num_neighbors, num_states, num_nodes ;
+   // When the whole rule fits in a small table, lookup holds the result
+   // for every neighborhood, each input taking lookupbits bits of the
+   // index in tree order.  Otherwise, if the tree is small enough, a16
+   // and b16 hold it again in breadth-first order with 16-bit offsets.
+   state *lookup ;
+   int lookupbits ;
+   unsigned short *a16 ;
+   state *b16 ;
    char rule[MAXRULESIZE] ;
 };
 #endif
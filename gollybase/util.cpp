@@ -4,6 +4,11 @@
 #include "util.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -189,6 +194,184 @@ double gollySecondCount() {
 }
 #endif
 
+/*
+ *   The worker pool.  Deques are plain mutex-protected std::deques;
+ *   tasks are coarse (the algorithms only fork large pieces of work)
+ *   so the locking is never the bottleneck.  Idle workers sleep on a
+ *   condition variable until something is queued.
+ */
+struct lifetaskqueue {
+   std::mutex lock ;
+   std::deque<lifetask *> tasks ;
+} ;
+struct lifethreadsimpl {
+   lifetaskqueue *queues ;
+   std::vector<std::thread> threads ;
+   std::mutex sleeplock ;
+   std::condition_variable wake ;
+   std::atomic<int> queued ;
+   bool quit ;
+} ;
+lifethreads::lifethreads(int n) {
+   if (n < 1)
+      n = 1 ;
+   nworkers = n ;
+   impl = new lifethreadsimpl ;
+   impl->queues = new lifetaskqueue[n] ;
+   impl->queued = 0 ;
+   impl->quit = false ;
+   for (int i=1; i<n; i++)
+      impl->threads.push_back(std::thread(&lifethreads::workerloop, this, i)) ;
+}
+lifethreads::~lifethreads() {
+   {
+      std::lock_guard<std::mutex> lk(impl->sleeplock) ;
+      impl->quit = true ;
+   }
+   impl->wake.notify_all() ;
+   for (size_t i=0; i<impl->threads.size(); i++)
+      impl->threads[i].join() ;
+   delete [] impl->queues ;
+   delete impl ;
+}
+void lifethreads::spawn(int worker, lifetask *t, lifetaskgroup &g) {
+   t->group = &g ;
+   g.pending++ ;
+   {
+      std::lock_guard<std::mutex> lk(impl->queues[worker].lock) ;
+      impl->queues[worker].tasks.push_back(t) ;
+   }
+   {
+      std::lock_guard<std::mutex> lk(impl->sleeplock) ;
+      impl->queued++ ;
+   }
+   impl->wake.notify_one() ;
+}
+bool lifethreads::runone(int worker) {
+   if (impl->queued <= 0)
+      return false ;
+   lifetask *t = 0 ;
+   for (int i=0; t == 0 && i<nworkers; i++) {
+      int victim = (worker + i) % nworkers ;
+      lifetaskqueue &q = impl->queues[victim] ;
+      std::lock_guard<std::mutex> lk(q.lock) ;
+      if (q.tasks.empty())
+         continue ;
+      if (i == 0) {
+         t = q.tasks.back() ;
+         q.tasks.pop_back() ;
+      } else {
+         t = q.tasks.front() ;
+         q.tasks.pop_front() ;
+      }
+   }
+   if (t == 0)
+      return false ;
+   impl->queued-- ;
+   lifetaskgroup *g = t->group ;
+   t->run(worker) ;
+   g->pending-- ;
+   return true ;
+}
+void lifethreads::wait(int worker, lifetaskgroup &g) {
+   while (g.pending > 0)
+      if (!runone(worker))
+         std::this_thread::yield() ;
+}
+void lifethreads::workerloop(int worker) {
+   for (;;) {
+      if (runone(worker))
+         continue ;
+      std::unique_lock<std::mutex> lk(impl->sleeplock) ;
+      while (!impl->quit && impl->queued <= 0)
+         impl->wake.wait(lk) ;
+      if (impl->quit)
+         return ;
+   }
+}
+int lifethreads::hardwarethreads() {
+   int n = (int)std::thread::hardware_concurrency() ;
+   return n < 1 ? 1 : n ;
+}
+
+/*
+ *   Pattern hashing.  The multipliers are arbitrary values below the
+ *   prime; their inverses come from Fermat's little theorem.
+ */
+unsigned long long patternhash::xp2[64], patternhash::yp2[64] ;
+unsigned long long patternhash::xq2[64], patternhash::yq2[64] ;
+unsigned long long patternhash::upper[256], patternhash::lower[256] ;
+static struct patternhashinit {
+   patternhashinit() { patternhash::init() ; }
+} patternhashinit ;
+unsigned long long patternhash::mul(unsigned long long a,
+                                    unsigned long long b) {
+   /* schoolbook multiply in 32-bit halves, using 2^61 == 1 (mod prime) */
+   unsigned long long a1 = a >> 32, a0 = a & 0xffffffff ;
+   unsigned long long b1 = b >> 32, b0 = b & 0xffffffff ;
+   unsigned long long hi = a1 * b1 ;
+   unsigned long long mid = a1 * b0 + a0 * b1 ;
+   unsigned long long lo = a0 * b0 ;
+   unsigned long long r = (hi << 3) + (mid >> 29) +
+                          ((mid & ((1ULL << 29) - 1)) << 32) +
+                          (lo >> 61) + (lo & prime) ;
+   r = (r & prime) + (r >> 61) ;
+   r = (r & prime) + (r >> 61) ;
+   return r >= prime ? r - prime : r ;
+}
+static unsigned long long powtab(const unsigned long long *pos,
+                                 const unsigned long long *neg, long long n) {
+   const unsigned long long *t = pos ;
+   unsigned long long u = (unsigned long long)n ;
+   if (n < 0) {
+      t = neg ;
+      u = 0 - u ;
+   }
+   unsigned long long r = 1 ;
+   for (int k=0; u; k++, u >>= 1)
+      if (u & 1)
+         r = patternhash::mul(r, t[k]) ;
+   return r ;
+}
+unsigned long long patternhash::xpow(long long n) {
+   return powtab(xp2, xq2, n) ;
+}
+unsigned long long patternhash::ypow(long long n) {
+   return powtab(yp2, yq2, n) ;
+}
+void patternhash::init() {
+   const unsigned long long x = 0x0d1c5a3b9e7f2461ULL ;
+   const unsigned long long y = 0x153a7c9e0b2d4f87ULL ;
+   unsigned long long xi = 1, yi = 1, xs = x, ys = y ;
+   for (unsigned long long e=prime-2; e; e >>= 1) {
+      if (e & 1) {
+         xi = mul(xi, xs) ;
+         yi = mul(yi, ys) ;
+      }
+      xs = mul(xs, xs) ;
+      ys = mul(ys, ys) ;
+   }
+   xp2[0] = x ;
+   yp2[0] = y ;
+   xq2[0] = xi ;
+   yq2[0] = yi ;
+   for (int k=1; k<64; k++) {
+      xp2[k] = mul(xp2[k-1], xp2[k-1]) ;
+      yp2[k] = mul(yp2[k-1], yp2[k-1]) ;
+      xq2[k] = mul(xq2[k-1], xq2[k-1]) ;
+      yq2[k] = mul(yq2[k-1], yq2[k-1]) ;
+   }
+   /* a byte holds two rows of four cells, west cell in the high bit */
+   for (int b=0; b<256; b++) {
+      unsigned long long h = 0 ;
+      for (int i=0; i<8; i++)
+         if (b & (1 << i))
+            h = add(h, mul(xpow(3 - (i & 3)), ypow(1 - (i >> 2)))) ;
+      upper[b] = h ;
+      lower[b] = mul(h, ypow(2)) ;
+   }
+}
+
 /*
  *   Reporting.
  *   The node count listed here wants to be big to reduce the number
@@ -249,9 +432,10 @@ void hperf::reportStep(hperf &mark, hperf &ratemark, double newGen, int verbose)
       double nodespergen = nodeCount / inc ;
       double fps = (frames - mark.frames) / elapsed ;
       sprintf(perfstatusline,
-          "PERF gps %g nps %g fps %g depth %g half %g npg %g nodes %g",
+          "PERF gps %g nps %g fps %g depth %g half %g npg %g nodes %g gcs %g gcsec %g",
           genspersec, nodeCount/elapsed, fps, 1+depthDelta/nodeCount, halfFrac,
-          nodespergen, nodeCount) ;
+          nodespergen, nodeCount, gcCount - mark.gcCount,
+          gcSeconds - mark.gcSeconds) ;
       lifestatus(perfstatusline) ;
    }
    genval = newGen ;
@@ -7,6 +7,7 @@
 #ifndef UTIL_H
 #define UTIL_H
 #include <cstdio> // for FILE *
+#include <atomic>
 
 void lifefatal(const char *s) ;
 void lifewarning(const char *s) ;
@@ -71,6 +72,88 @@ public:
  *   point, as a double.
  */
 double gollySecondCount() ;
+/**
+ *   A small fork-join pool of worker threads for the algorithms that
+ *   can split a generation across cores.  Worker 0 is always the thread
+ *   that created the pool; the others are started by the constructor.
+ *   Each worker has its own deque of tasks; a worker pushes and pops
+ *   its own tasks at the back and steals from the front of everyone
+ *   else's when it runs dry.  A thread waiting for a group of tasks
+ *   keeps running tasks rather than blocking, so nested forks cannot
+ *   deadlock.
+ */
+struct lifetaskgroup {
+   lifetaskgroup() : pending(0) {}
+   std::atomic<int> pending ;
+} ;
+class lifetask {
+public:
+   virtual ~lifetask() {}
+   virtual void run(int worker) = 0 ;
+   lifetaskgroup *group ;
+} ;
+struct lifethreadsimpl ;
+class lifethreads {
+public:
+   lifethreads(int nworkers) ;
+   ~lifethreads() ;
+   int size() { return nworkers ; }
+   // queue a task for the given (calling) worker
+   void spawn(int worker, lifetask *t, lifetaskgroup &g) ;
+   // run one queued task, our own first; returns false if none found
+   bool runone(int worker) ;
+   // run queued tasks until every task in the group has finished
+   void wait(int worker, lifetaskgroup &g) ;
+   // how many threads the hardware can run at once (at least 1)
+   static int hardwarethreads() ;
+private:
+   void workerloop(int worker) ;
+   int nworkers ;
+   lifethreadsimpl *impl ;
+} ;
+/**
+ *   Translation-normalized pattern hashes.  A block of cells hashes to
+ *   the sum, modulo the prime 2^61-1, of state * X^dx * Y^dy over its
+ *   live cells, where (dx,dy) is the offset of each cell from the top
+ *   left corner of the block.  The value is linear in the cells, so the
+ *   hash of a quadtree node is a fixed combination of the hashes of its
+ *   four children and the hashlife algorithms can remember it per
+ *   canonical node.  Every algorithm must give the same value for the
+ *   same cells.
+ */
+class patternhash {
+public:
+   static const unsigned long long prime = 0x1fffffffffffffffULL ;
+   static unsigned long long add(unsigned long long a, unsigned long long b) {
+      a += b ;
+      return a >= prime ? a - prime : a ;
+   }
+   static unsigned long long mul(unsigned long long a, unsigned long long b) ;
+   // X^n and Y^n; n may be negative
+   static unsigned long long xpow(long long n) ;
+   static unsigned long long ypow(long long n) ;
+   // X^(2^k) and Y^(2^k) for k < 64; the offsets between quadtree children
+   static unsigned long long xstep(int k) { return xp2[k] ; }
+   static unsigned long long ystep(int k) { return yp2[k] ; }
+   // combine the hashes of four children of size 2^k
+   static unsigned long long quad(unsigned long long nw, unsigned long long ne,
+                                  unsigned long long sw, unsigned long long se,
+                                  int k) {
+      return add(add(nw, mul(xp2[k], ne)),
+                 mul(yp2[k], add(sw, mul(xp2[k], se)))) ;
+   }
+   // a 4x4 block of two-state cells, bit 15 at top left and bit 0 at
+   // bottom right (the layout of an hlifealgo leaf quadrant)
+   static unsigned long long block4x4(unsigned short bits) {
+      return add(upper[bits >> 8], lower[bits & 255]) ;
+   }
+   // fold a hash to the int the scripting commands return
+   static int toint(unsigned long long h) { return (int)(h ^ (h >> 32)) ; }
+   static void init() ;
+private:
+   static unsigned long long xp2[64], yp2[64], xq2[64], yq2[64] ;
+   static unsigned long long upper[256], lower[256] ;
+} ;
 /*
  *   Performance data.  We keep running values here.  We can copy this
  *   to "mark" variables, and then report performance for deltas.
@@ -84,6 +167,8 @@ struct hperf {
       genval = 0 ;
       frames = 0 ;
       halfNodes = 0 ;
+      gcCount = 0 ;
+      gcSeconds = 0 ;
    }
    void report(hperf&, int verbose) ;
    void reportStep(hperf&, hperf&, double genval, int verbose) ;
@@ -109,6 +194,8 @@ struct hperf {
    double depthSum ;
    double timeStamp ;
    double genval ;
+   double gcCount ;
+   double gcSeconds ;
    static int reportMask ;
    static double reportInterval ;
 } ;
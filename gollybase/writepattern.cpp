@@ -3,7 +3,7 @@
 
 #include "writepattern.h"
 #include "lifealgo.h"
-#include "util.h"          // for *progress calls
+#include "util.h"          // for *progress calls, lifethreads
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
@@ -11,6 +11,8 @@
 #ifdef ZLIB
 #include <zlib.h>
 #include <streambuf>
+#include <cstdio>
+#include <vector>
 #endif
 
 #ifdef __APPLE__
@@ -44,14 +46,14 @@ const int WRLE_NEWLINE = -1 ;
 void AddRun(std::ostream &f,
             int state,                // in: state of cell to write
             int multistate,           // true if #cell states > 2
-            unsigned int &run,        // in and out
+            unsigned long long &run,  // in and out
             unsigned int &linelen)    // ditto
 {
    unsigned int i, numlen;
    char numstr[32];
 
    if ( run > 1 ) {
-      sprintf(numstr, "%u", run);
+      sprintf(numstr, "%llu", run);
       numlen = (int)strlen(numstr);
    } else {
       numlen = 0;                      // no run count shown if 1
@@ -83,16 +85,91 @@ void AddRun(std::ostream &f,
    run = 0;                           // reset run count
 }
 
+// turns the live cells handed over by lifealgo::visitrows, in row order,
+// into RLE runs; positions are relative to the top left corner of the
+// pattern and so are the gaps between cells, so we never have to look
+// at the dead cells in between
+class rlewriter : public liferowvisitor {
+public:
+   rlewriter(std::ostream &os, int multistate, double maxcount)
+      : os(os), multistate(multistate), maxcount(maxcount),
+        curx(0), cury(0), orun(0), dollrun(0), linelen(0),
+        laststate(WRLE_NONE), accumcount(0), currcount(0) {}
+
+   virtual bool cell(long long x, long long y, int state) {
+      if (y != cury) {
+         // end of current row; forget dead cells at end of it
+         if (orun > 0)
+            AddRun(os, laststate, multistate, orun, linelen);
+         dollrun += y - cury;
+         cury = y;
+         curx = 0;
+         laststate = WRLE_NONE;
+      }
+      if (x == curx && state == laststate) {
+         orun++;
+      } else {
+         if (orun > 0)
+            // output current run of live cells
+            AddRun(os, laststate, multistate, orun, linelen);
+         if (dollrun > 0)
+            // output current run of $ chars
+            AddRun(os, WRLE_NEWLINE, multistate, dollrun, linelen);
+         unsigned long long brun = x - curx;
+         if (brun > 0)
+            // output run of dead cells before this one
+            AddRun(os, 0, multistate, brun, linelen);
+         laststate = state;
+         orun = 1;
+      }
+      curx = x + 1;
+      if (++currcount > 1024) {
+         char msg[128];
+         accumcount += currcount;
+         currcount = 0;
+         sprintf(msg, "File size: %.2f MB", os.tellp() / 1048576.0);
+         if (lifeabortprogress(accumcount / maxcount, msg)) return false;
+      }
+      return true;
+   }
+
+   void finish() {
+      if (orun > 0)
+         AddRun(os, laststate, multistate, orun, linelen);
+      // terminate RLE data
+      dollrun = 1;
+      AddRun(os, WRLE_EOP, multistate, dollrun, linelen);
+      putchar('\n', os);
+   }
+
+private:
+   std::ostream &os;
+   int multistate;
+   double maxcount;
+   long long curx, cury;          // where the next cell would continue a run
+   unsigned long long orun;       // current run of live cells
+   unsigned long long dollrun;    // pending run of $ chars
+   unsigned int linelen;
+   int laststate;
+   double accumcount;
+   int currcount;
+};
+
 // write current pattern to file using extended RLE format
 const char *writerle(std::ostream &os, char *comments, lifealgo &imp,
-                     int top, int left, int bottom, int right,
+                     const bigint &top, const bigint &left,
+                     const bigint &bottom, const bigint &right,
                      bool xrle)
 {
+   long long wd, ht;
+   if (!lifealgo::rowsize(top, left, bottom, right, wd, ht))
+      return "Pattern is too big to write in RLE format.";
+
    badwrite = false;
    if (xrle) {
       // write out #CXRLE line; note that the XRLE indicator is prefixed
       // with #C so apps like Life32 and MCell will ignore the line
-      os << "#CXRLE Pos=" << left << ',' << top;
+      os << "#CXRLE Pos=" << left.tostring('\0') << ',' << top.tostring('\0');
       if (imp.getGeneration() > bigint::zero)
          os << " Gen=" << imp.getGeneration().tostring('\0');
       os << '\n';
@@ -117,96 +194,20 @@ const char *writerle(std::ostream &os, char *comments, lifealgo &imp,
       if (*p != '\0') endcomms = p;
    }
 
-   if ( imp.isEmpty() || top > bottom || left > right ) {
+   if ( imp.isEmpty() || wd <= 0 || ht <= 0 ) {
       // empty pattern
       os << "x = 0, y = 0, rule = " << imp.getrule() << "\n!\n";
    } else {
       // do header line
-      unsigned int wd = right - left + 1;
-      unsigned int ht = bottom - top + 1;
-      sprintf(outbuff, "x = %u, y = %u, rule = %s\n", wd, ht, imp.getrule());
+      sprintf(outbuff, "x = %lld, y = %lld, rule = %s\n", wd, ht, imp.getrule());
       outpos = strlen(outbuff);
 
-      // do RLE data
-      unsigned int linelen = 0;
-      unsigned int brun = 0;
-      unsigned int orun = 0;
-      unsigned int dollrun = 0;
-      int laststate = WRLE_NONE ;
-      int multistate = imp.NumCellStates() > 2 ;
-      int cx, cy;
-      
-      // for showing accurate progress we need to add pattern height to pop count
-      // in case this is a huge pattern with many blank rows
-      double maxcount = imp.getPopulation().todouble() + ht;
-      double accumcount = 0;
-      int currcount = 0;
-      int v = 0 ;
-      for ( cy=top; cy<=bottom; cy++ ) {
-         // set lastchar to anything except 'o' or 'b'
-         laststate = WRLE_NONE ;
-         currcount++;
-         for ( cx=left; cx<=right; cx++ ) {
-            int skip = imp.nextcell(cx, cy, v);
-            if (skip + cx > right)
-               skip = -1;           // pretend we found no more live cells
-            if (skip > 0) {
-               // have exactly "skip" dead cells here
-               if (laststate == 0) {
-                  brun += skip;
-               } else {
-                  if (orun > 0) {
-                     // output current run of live cells
-                     AddRun(os, laststate, multistate, orun, linelen);
-                  }
-                  laststate = 0 ;
-                  brun = skip;
-               }
-            }
-            if (skip >= 0) {
-               // found next live cell in this row
-               cx += skip;
-               if (laststate == v) {
-                  orun++;
-               } else {
-                  if (dollrun > 0)
-                     // output current run of $ chars
-                     AddRun(os, WRLE_NEWLINE, multistate, dollrun, linelen);
-                  if (brun > 0)
-                     // output current run of dead cells
-                     AddRun(os, 0, multistate, brun, linelen);
-                  if (orun > 0)
-                     AddRun(os, laststate, multistate, orun, linelen) ;
-                  laststate = v ;
-                  orun = 1;
-               }
-               currcount++;
-            } else {
-               cx = right + 1;  // done this row
-            }
-            if (currcount > 1024) {
-               char msg[128];
-               accumcount += currcount;
-               currcount = 0;
-               sprintf(msg, "File size: %.2f MB", os.tellp() / 1048576.0);
-               if (lifeabortprogress(accumcount / maxcount, msg)) break;
-            }
-         }
-         // end of current row
-         if (isaborted()) break;
-         if (laststate == 0)
-            // forget dead cells at end of row
-            brun = 0;
-         else if (laststate >= 0)
-            // output current run of live cells
-            AddRun(os, laststate, multistate, orun, linelen);
-         dollrun++;
-      }
-      
-      // terminate RLE data
-      dollrun = 1;
-      AddRun(os, WRLE_EOP, multistate, dollrun, linelen);
-      putchar('\n', os);
+      // do RLE data; the algo walks the pattern in row order for us
+      rlewriter rle(os, imp.NumCellStates() > 2,
+                    imp.getPopulation().todouble() + 1);
+      if (imp.visitrows(rle, top, left, bottom, right) < 0)
+         return "Pattern is outside the range this algorithm can write.";
+      rle.finish();
 
       // flush outbuff
       if (outpos > 0 && !badwrite && !os.write(outbuff, outpos))
@@ -290,11 +291,191 @@ public:
 private:
    gzFile file;
 };
+
+// Block-parallel gzip, after pigz: the data is cut into blocks that are
+// deflated independently by a pool of threads, each block primed with the
+// 32K of data before it so little is lost in compression.  Every block
+// but the last ends on a byte boundary with a sync flush, so the blocks
+// concatenate into one deflate stream, and their crcs can be combined.
+class pgzbuf : public std::streambuf
+{
+public:
+   pgzbuf() : file(NULL), threads(NULL), bad(false) { }
+   ~pgzbuf() { close(); }
+
+   pgzbuf *open(const char *path, int nthreads)
+   {
+      if (file) return NULL;
+      file = fopen(path, "wb");
+      if (!file) return NULL;
+      // gzip header: no name, no time, default compression, Unix
+      static const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+      bad = fwrite(header, 1, sizeof(header), file) != sizeof(header);
+      written = sizeof(header);
+      crc = crc32(0L, Z_NULL, 0);
+      total = 0;
+      dict.clear();
+      threads = new lifethreads(nthreads);
+      // a couple of blocks per thread keeps them all busy
+      blocks.resize(2 * nthreads);
+      buff.resize(blocks.size() * BLOCKSIZE);
+      setp(&buff[0], &buff[0] + buff.size());
+      return this;
+   }
+
+   pgzbuf *close()
+   {
+      if (!file) return NULL;
+      compress(true);
+      // gzip trailer: crc and length, both little-endian
+      unsigned char trailer[8];
+      for (int i = 0; i < 4; i++) {
+         trailer[i] = (unsigned char)(crc >> (8 * i));
+         trailer[i + 4] = (unsigned char)(total >> (8 * i));
+      }
+      if (fwrite(trailer, 1, sizeof(trailer), file) != sizeof(trailer)) bad = true;
+      if (fclose(file) != 0) bad = true;
+      file = NULL;
+      delete threads;
+      threads = NULL;
+      return bad ? NULL : this;
+   }
+
+   bool is_open() const { return file!=NULL; }
+
+   int overflow(int c=EOF)
+   {
+      compress(false);
+      if (bad) return EOF;
+      if (c != EOF) {
+         *pptr() = (char)c;
+         pbump(1);
+      }
+      return c == EOF ? 0 : c;
+   }
+
+   int sync()
+   {
+      compress(false);
+      return bad || fflush(file) != 0 ? -1 : 0;
+   }
+
+   pos_type seekoff(off_type off, std::ios_base::seekdir way, std::ios_base::openmode which)
+   {
+      // compressed size so far (only used in progress dialog)
+      if (file && off == 0 && way == std::ios_base::cur && which == std::ios_base::out)
+         return pos_type(written);
+      return pos_type(off_type(-1));
+   }
+
+private:
+   static const size_t BLOCKSIZE = 128 * 1024;
+   static const size_t DICTSIZE = 32 * 1024;
+
+   struct block : public lifetask {
+      const char *in;               // data to compress
+      size_t len;
+      const char *dict;             // data before it
+      size_t dictlen;
+      bool last;                    // end of the stream?
+      std::vector<unsigned char> out;
+      uLong crc;
+      bool ok;
+
+      virtual void run(int)
+      {
+         z_stream strm;
+         memset(&strm, 0, sizeof(strm));
+         ok = deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                           Z_DEFAULT_STRATEGY) == Z_OK;
+         if (!ok) return;
+         if (dictlen > 0)
+            deflateSetDictionary(&strm, (const Bytef *)dict, (uInt)dictlen);
+         strm.next_in = (Bytef *)in;
+         strm.avail_in = (uInt)len;
+         out.resize(deflateBound(&strm, (uLong)len) + 64);
+         size_t have = 0;
+         int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+         for (;;) {
+            strm.next_out = &out[have];
+            strm.avail_out = (uInt)(out.size() - have);
+            int r = deflate(&strm, flush);
+            have = out.size() - strm.avail_out;
+            if (r == Z_STREAM_END || (!last && strm.avail_out != 0)) break;
+            if (r != Z_OK && r != Z_BUF_ERROR) {
+               ok = false;
+               break;
+            }
+            out.resize(2 * out.size());
+         }
+         out.resize(have);
+         deflateEnd(&strm);
+         crc = crc32(0L, (const Bytef *)in, (uInt)len);
+      }
+   };
+
+   // compress and write out the buffered data; the final call also
+   // ends the deflate stream, with an empty block if need be
+   void compress(bool last)
+   {
+      size_t n = pptr() - pbase();
+      if (bad || (n == 0 && !last)) return;
+      size_t nblocks = n == 0 ? 1 : (n + BLOCKSIZE - 1) / BLOCKSIZE;
+      lifetaskgroup g;
+      for (size_t i = 0; i < nblocks; i++) {
+         block &b = blocks[i];
+         size_t start = i * BLOCKSIZE;
+         b.in = pbase() + start;
+         b.len = n - start < BLOCKSIZE ? n - start : BLOCKSIZE;
+         if (i == 0) {
+            b.dict = dict.empty() ? NULL : &dict[0];
+            b.dictlen = dict.size();
+         } else {
+            b.dict = b.in - DICTSIZE;
+            b.dictlen = DICTSIZE;
+         }
+         b.last = last && i == nblocks - 1;
+         threads->spawn(0, &b, g);
+      }
+      threads->wait(0, g);
+      for (size_t i = 0; i < nblocks; i++) {
+         block &b = blocks[i];
+         if (!b.ok || fwrite(&b.out[0], 1, b.out.size(), file) != b.out.size()) {
+            bad = true;
+            return;
+         }
+         written += b.out.size();
+         crc = crc32_combine(crc, b.crc, (z_off_t)b.len);
+         total += b.len;
+      }
+      // keep the last 32K for priming the next block
+      if (n >= DICTSIZE) {
+         dict.assign(pptr() - DICTSIZE, pptr());
+      } else {
+         dict.insert(dict.end(), pbase(), pptr());
+         if (dict.size() > DICTSIZE)
+            dict.erase(dict.begin(), dict.end() - DICTSIZE);
+      }
+      setp(&buff[0], &buff[0] + buff.size());
+   }
+
+   FILE *file;
+   lifethreads *threads;
+   std::vector<block> blocks;
+   std::vector<char> buff;          // room for all the blocks
+   std::vector<char> dict;
+   uLong crc;
+   unsigned long long total;        // uncompressed length
+   unsigned long long written;      // compressed length
+   bool bad;
+};
 #endif
 
 const char *writepattern(const char *filename, lifealgo &imp,
                          pattern_format format, output_compression compression,
-                         int top, int left, int bottom, int right)
+                         const bigint &top, const bigint &left,
+                         const bigint &bottom, const bigint &right,
+                         int gzthreads)
 {
    // extract any comments if file exists so we can copy them to new file
    char *commptr = NULL;
@@ -322,6 +503,7 @@ const char *writepattern(const char *filename, lifealgo &imp,
    std::filebuf filebuf;
 #ifdef ZLIB
    gzbuf gzbuf;
+   pgzbuf pgzbuf;
 #endif
 
    switch (compression)
@@ -332,7 +514,10 @@ const char *writepattern(const char *filename, lifealgo &imp,
 
    case gzip_compression:
 #ifdef ZLIB
-      streambuf = gzbuf.open(filename);
+      if (gzthreads > 1)
+         streambuf = pgzbuf.open(filename, gzthreads);
+      else
+         streambuf = gzbuf.open(filename);
       break;
 #else
       if (commptr) free(commptr);
@@ -368,6 +553,11 @@ const char *writepattern(const char *filename, lifealgo &imp,
 
    if (errmsg == NULL && !os.flush())
       errmsg = "Error occurred writing file; maybe disk is full?";
+#ifdef ZLIB
+   // the parallel compressor finishes the stream when it is closed
+   if (pgzbuf.is_open() && !pgzbuf.close() && errmsg == NULL)
+      errmsg = "Error occurred writing file; maybe disk is full?";
+#endif
 
    lifeendprogress();
 
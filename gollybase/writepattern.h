@@ -4,6 +4,7 @@
 #ifndef WRITEPATTERN_H
 #define WRITEPATTERN_H
 class lifealgo;
+class bigint;
 
 typedef enum {
    RLE_format,          // run length encoded
@@ -17,12 +18,15 @@ typedef enum {
 } output_compression;
 
 /*
- *   Save current pattern to a file.
+ *   Save current pattern to a file.  With gzip compression, more than
+ *   one gzthreads compresses blocks of the file in parallel.
  */
 const char *writepattern(const char *filename,
                          lifealgo &imp,
                          pattern_format format,
                          output_compression compression,
-                         int top, int left, int bottom, int right);
+                         const bigint &top, const bigint &left,
+                         const bigint &bottom, const bigint &right,
+                         int gzthreads = 1);
 
 #endif
@@ -896,7 +896,8 @@ void OpenFile(const char* path, bool remember)
 const char* WritePattern(const char* path,
                          pattern_format format,
                          output_compression compression,
-                         int top, int left, int bottom, int right)
+                         const bigint& top, const bigint& left,
+                         const bigint& bottom, const bigint& right)
 {
     // if the format is RLE_format and the grid is bounded then force XRLE_format so that
     // position info is recorded (this position will be used when the file is read)
@@ -940,38 +941,16 @@ void SaveSucceeded(const std::string& path)
 bool SavePattern(const std::string& path, pattern_format format, output_compression compression)
 {
     bigint top, left, bottom, right;
-    int itop, ileft, ibottom, iright;
     currlayer->algo->findedges(&top, &left, &bottom, &right);
 
-    if (currlayer->algo->hyperCapable()) {
-        // algorithm uses hashlife
-        if ( OutsideLimits(top, left, bottom, right) ) {
-            // too big so only allow saving as MC file
-            if (format != MC_format) {
-                Warning("Pattern is outside +/- 10^9 boundary and can't be saved in RLE format.");
-                return false;
-            }
-            itop = ileft = ibottom = iright = 0;
-        } else {
-            // allow saving as MC or RLE file
-            itop = top.toint();
-            ileft = left.toint();
-            ibottom = bottom.toint();
-            iright = right.toint();
-        }
-    } else {
-        // allow saving file only if pattern is small enough
-        if ( OutsideLimits(top, left, bottom, right) ) {
-            Warning("Pattern is outside +/- 10^9 boundary and can't be saved.");
-            return false;
-        }
-        itop = top.toint();
-        ileft = left.toint();
-        ibottom = bottom.toint();
-        iright = right.toint();
+    // algorithms that use hashlife can save any pattern as MC or RLE file,
+    // otherwise allow saving file only if pattern is small enough
+    if ( !currlayer->algo->hyperCapable() && OutsideLimits(top, left, bottom, right) ) {
+        Warning("Pattern is outside +/- 10^9 boundary and can't be saved.");
+        return false;
     }
 
-    const char* err = WritePattern(path.c_str(), format, compression, itop, ileft, ibottom, iright);
+    const char* err = WritePattern(path.c_str(), format, compression, top, left, bottom, right);
     if (err) {
         Warning(err);
         return false;
@@ -20,7 +20,7 @@ bool CopyTextToClipboard(const char* text);
 bool GetTextFromClipboard(std::string& text);
 bool SavePattern(const std::string& path, pattern_format format, output_compression compression);
 const char* WritePattern(const char* path, pattern_format format, output_compression compression,
-                         int top, int left, int bottom, int right);
+                         const bigint& top, const bigint& left, const bigint& bottom, const bigint& right);
 void UnzipFile(const std::string& zippath, const std::string& entry);
 void GetURL(const std::string& url, const std::string& pageurl);
 bool DownloadFile(const std::string& url, const std::string& filepath);
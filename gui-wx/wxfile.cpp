@@ -1465,14 +1465,15 @@ void MainFrame::ClearAllScripts()
 const char* MainFrame::WritePattern(const wxString& path,
                                     pattern_format format,
                                     output_compression compression,
-                                    int top, int left, int bottom, int right)
+                                    const bigint& top, const bigint& left,
+                                    const bigint& bottom, const bigint& right)
 {
     // if the format is RLE_format and the grid is bounded then force XRLE_format so that
     // position info is recorded (this position will be used when the file is read)
     if (format == RLE_format && (currlayer->algo->gridwd > 0 || currlayer->algo->gridht > 0))
         format = XRLE_format;
     const char* err = writepattern(FILEPATH, *currlayer->algo, format,
-                                   compression, top, left, bottom, right);    
+                                   compression, top, left, bottom, right, gzipthreads);
     return err;
 }
 
@@ -1514,38 +1515,22 @@ bool MainFrame::SavePattern()
     }
     
     bigint top, left, bottom, right;
-    int itop, ileft, ibottom, iright;
     currlayer->algo->findedges(&top, &left, &bottom, &right);
     
     if (currlayer->algo->hyperCapable()) {
-        // algorithm uses hashlife
-        if ( viewptr->OutsideLimits(top, left, bottom, right) ) {
-            // too big so only allow saving as MC file
-            itop = ileft = ibottom = iright = 0;
-            filetypes = MCfiles;
-            MCindex = 0;
-        } else {
-            // allow saving as MC or RLE file
-            itop = top.toint();
-            ileft = left.toint();
-            ibottom = bottom.toint();
-            iright = right.toint();
-            filetypes = MCfiles;
-            filetypes += _("|");
-            filetypes += RLEfiles;
-            MCindex = 0;
-            RLEindex = 1;
-        }
+        // algorithm uses hashlife so allow saving as MC or RLE file
+        // (the RLE writer can handle patterns beyond the +/- 10^9 boundary)
+        filetypes = MCfiles;
+        filetypes += _("|");
+        filetypes += RLEfiles;
+        MCindex = 0;
+        RLEindex = 1;
     } else {
         // allow saving file only if pattern is small enough
         if ( viewptr->OutsideLimits(top, left, bottom, right) ) {
             statusptr->ErrorMessage(_("Pattern is outside +/- 10^9 boundary."));
             return false;
         }
-        itop = top.toint();
-        ileft = left.toint();
-        ibottom = bottom.toint();
-        iright = right.toint();
         filetypes = RLEfiles;
         RLEindex = 0;
     }
@@ -1584,7 +1569,7 @@ bool MainFrame::SavePattern()
         }
         
         const char* err = WritePattern(savedlg.GetPath(), format, compression,
-                                       itop, ileft, ibottom, iright);
+                                       top, left, bottom, right);
         if (err) {
             statusptr->ErrorMessage(wxString(err,wxConvLocal));
         } else {
@@ -1603,7 +1588,6 @@ bool MainFrame::SavePattern()
 const char* MainFrame::SaveFile(const wxString& path, const wxString& fileformat, bool remember)
 {
     bigint top, left, bottom, right;
-    int itop, ileft, ibottom, iright;
     currlayer->algo->findedges(&top, &left, &bottom, &right);
     
     wxString format = fileformat.Lower();
@@ -1615,27 +1599,23 @@ const char* MainFrame::SaveFile(const wxString& path, const wxString& fileformat
     // check that given file format is valid
     pattern_format pattfmt;
     if (format.StartsWith(wxT("rle"))) {
-        if ( viewptr->OutsideLimits(top, left, bottom, right) ) {
+        if ( !currlayer->algo->hyperCapable() &&
+             viewptr->OutsideLimits(top, left, bottom, right) ) {
             return "Pattern is too big to save as RLE.";
         }
         pattfmt = savexrle ? XRLE_format : RLE_format;
-        itop = top.toint();
-        ileft = left.toint();
-        ibottom = bottom.toint();
-        iright = right.toint();
     } else if (format.StartsWith(wxT("mc"))) {
         if (!currlayer->algo->hyperCapable()) {
             return "Macrocell format is not supported by the current algorithm.";
         }
         pattfmt = MC_format;
-        // writepattern will ignore itop, ileft, ibottom, iright
-        itop = ileft = ibottom = iright = 0;
+        // writepattern will ignore top, left, bottom, right
     } else {
         return "Unknown pattern format.";
     }
     
     const char* err = WritePattern(path, pattfmt, compression,
-                                   itop, ileft, ibottom, iright);
+                                   top, left, bottom, right);
     if (!err) {
         if (remember) AddRecentPattern(path);
         SaveSucceeded(path);
@@ -406,7 +406,7 @@ static int g_store(lua_State* L)
     // if grid is bounded then force XRLE_format so that position info is recorded
     if (tempalgo->gridwd > 0 || tempalgo->gridht > 0) format = XRLE_format;
     err = writepattern(FILENAME, *tempalgo, format, no_compression,
-                       top.toint(), left.toint(), bottom.toint(), right.toint());
+                       top, left, bottom, right);
     delete tempalgo;
     if (err) GollyError(L, err);
     
@@ -1634,6 +1634,36 @@ static int g_run(lua_State* L)
 
 // -----------------------------------------------------------------------------
 
+static int g_findperiod(lua_State* L)
+{
+    AUTORELEASE_POOL
+    CheckEvents(L);
+
+    int maxperiod = luaL_checkinteger(L, 1);
+    int maxgens = luaL_checkinteger(L, 2);
+    if (maxperiod < 1) GollyError(L, "findperiod error: maximum period must be > 0.");
+
+    perioddetector pd(maxperiod);
+    for (int gens = 0; !pd.observe(*currlayer->algo); gens++) {
+        if (gens >= maxgens) break;
+        mainptr->NextGeneration(false);       // step 1 gen
+        CheckEvents(L);
+    }
+    DoAutoUpdate();
+
+    lua_newtable(L);
+    if (pd.period > 0) {
+        lua_pushinteger(L, pd.period);  lua_rawseti(L, -2, 1);
+        lua_pushinteger(L, pd.dx);      lua_rawseti(L, -2, 2);
+        lua_pushinteger(L, pd.dy);      lua_rawseti(L, -2, 3);
+        lua_pushstring(L, pd.firstgen.tostring());  lua_rawseti(L, -2, 4);
+    }
+
+    return 1;   // result is a table (empty or {period, dx, dy, gen})
+}
+
+// -----------------------------------------------------------------------------
+
 static int g_step(lua_State* L)
 {
     AUTORELEASE_POOL
@@ -3176,6 +3206,7 @@ static const struct luaL_Reg gollyfuncs [] = {
     // control
     { "empty",        g_empty },        // return true if universe is empty
     { "run",          g_run },          // run current pattern for given number of gens
+    { "findperiod",   g_findperiod },   // run current pattern until it repeats
     { "step",         g_step },         // run current pattern for current step
     { "setstep",      g_setstep },      // set step exponent
     { "getstep",      g_getstep },      // return current step exponent
@@ -66,7 +66,8 @@ public:
     const char* SaveFile(const wxString& path, const wxString& format, bool remember);
     const char* WritePattern(const wxString& path, pattern_format format,
                              output_compression compression,
-                             int top, int left, int bottom, int right);
+                             const bigint& top, const bigint& left,
+                             const bigint& bottom, const bigint& right);
     void CheckBeforeRunning(const wxString& scriptpath, bool remember,
                             const wxString& zippath);
     bool ExtractZipEntry(const wxString& zippath,
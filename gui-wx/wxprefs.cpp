@@ -174,6 +174,7 @@ int numpatterns = 0;             // current number of recent pattern files
 int numscripts = 0;              // current number of recent script files
 int maxpatterns = 20;            // maximum number of recent pattern files (1..MAX_RECENT)
 int maxscripts = 20;             // maximum number of recent script files (1..MAX_RECENT)
+int gzipthreads = 1;             // number of threads compressing .gz files (1..MAX_GZIP_THREADS)
 wxArrayString namedrules;        // initialized in GetPrefs
 
 wxColor* borderrgb;              // color for border around bounded grid
@@ -1616,6 +1617,7 @@ void SavePrefs()
     fprintf(f, "show_files=%d\n", showfiles ? 1 : 0);
     fprintf(f, "max_patterns=%d (1..%d)\n", maxpatterns, MAX_RECENT);
     fprintf(f, "max_scripts=%d (1..%d)\n", maxscripts, MAX_RECENT);
+    fprintf(f, "gzip_threads=%d (1..%d)\n", gzipthreads, MAX_GZIP_THREADS);
 
     if (numpatterns > 0) {
         fputs("\n", f);
@@ -2313,6 +2315,11 @@ void GetPrefs()
             if (maxscripts < 1) maxscripts = 1;
             if (maxscripts > MAX_RECENT) maxscripts = MAX_RECENT;
 
+        } else if (strcmp(keyword, "gzip_threads") == 0) {
+            sscanf(value, "%d", &gzipthreads);
+            if (gzipthreads < 1) gzipthreads = 1;
+            if (gzipthreads > MAX_GZIP_THREADS) gzipthreads = MAX_GZIP_THREADS;
+
         } else if (strcmp(keyword, "recent_pattern") == 0) {
             // append path to Open Recent submenu
             if (numpatterns < maxpatterns && value[0]) {
@@ -2676,6 +2683,7 @@ enum {
     PREF_OPEN_CURSOR,
     PREF_MAX_PATTERNS,
     PREF_MAX_SCRIPTS,
+    PREF_GZIP_THREADS,
     PREF_EDITOR_BUTT,
     PREF_EDITOR_BOX,
     PREF_DOWNLOAD_BUTT,
@@ -3036,11 +3044,14 @@ void PrefsDialog::OnSpinCtrlChar(wxKeyEvent& event)
         if ( currpage == FILE_PAGE ) {
             wxSpinCtrl* s1 = (wxSpinCtrl*) FindWindowById(PREF_MAX_PATTERNS);
             wxSpinCtrl* s2 = (wxSpinCtrl*) FindWindowById(PREF_MAX_SCRIPTS);
+            wxSpinCtrl* s3 = (wxSpinCtrl*) FindWindowById(PREF_GZIP_THREADS);
             wxTextCtrl* t1 = s1->GetText();
             wxTextCtrl* t2 = s2->GetText();
+            wxTextCtrl* t3 = s3->GetText();
             wxWindow* focus = FindFocus();
             if ( focus == t1 ) { s2->SetFocus(); s2->SetSelection(ALL_TEXT); }
-            if ( focus == t2 ) { s1->SetFocus(); s1->SetSelection(ALL_TEXT); }
+            if ( focus == t2 ) { s3->SetFocus(); s3->SetSelection(ALL_TEXT); }
+            if ( focus == t3 ) { s1->SetFocus(); s1->SetSelection(ALL_TEXT); }
         } else if ( currpage == EDIT_PAGE ) {
             // only one spin ctrl on this page
             wxSpinCtrl* s1 = (wxSpinCtrl*) FindWindowById(PREF_RANDOM_FILL);
@@ -3358,8 +3369,13 @@ wxPanel* PrefsDialog::CreateFilePrefs(wxWindow* parent)
     minbox->Add(new wxStaticText(panel, wxID_STATIC, _("Maximum number of recent scripts:")),
                 0, wxALL, 0);
 
-    // align spin controls by setting minbox same width as maxbox
+    wxBoxSizer* gzbox = new wxBoxSizer(wxHORIZONTAL);
+    gzbox->Add(new wxStaticText(panel, wxID_STATIC, _("Threads for compressing files:")),
+               0, wxALL, 0);
+
+    // align spin controls by setting minbox and gzbox same width as maxbox
     minbox->SetMinSize( maxbox->GetMinSize() );
+    gzbox->SetMinSize( maxbox->GetMinSize() );
 
     wxSpinCtrl* spin1 = new MySpinCtrl(panel, PREF_MAX_PATTERNS, wxEmptyString,
                                        wxDefaultPosition, wxDefaultSize);
@@ -3375,6 +3391,13 @@ wxPanel* PrefsDialog::CreateFilePrefs(wxWindow* parent)
     hsbox->Add(minbox, 0, wxALIGN_CENTER_VERTICAL, 0);
     hsbox->Add(spin2, 0, wxLEFT | wxRIGHT | wxALIGN_CENTER_VERTICAL, SPINGAP);
 
+    wxSpinCtrl* spin3 = new MySpinCtrl(panel, PREF_GZIP_THREADS, wxEmptyString,
+                                       wxDefaultPosition, wxDefaultSize);
+
+    wxBoxSizer* hgbox = new wxBoxSizer(wxHORIZONTAL);
+    hgbox->Add(gzbox, 0, wxALIGN_CENTER_VERTICAL, 0);
+    hgbox->Add(spin3, 0, wxLEFT | wxRIGHT | wxALIGN_CENTER_VERTICAL, SPINGAP);
+
     wxButton* editorbutt = new wxButton(panel, PREF_EDITOR_BUTT, _("Text Editor..."));
     wxStaticText* editorbox = new wxStaticText(panel, PREF_EDITOR_BOX, texteditor);
     neweditor = texteditor;
@@ -3398,6 +3421,8 @@ wxPanel* PrefsDialog::CreateFilePrefs(wxWindow* parent)
     vbox->Add(hpbox, 0, wxLEFT | wxRIGHT, LRGAP);
     vbox->AddSpacer(S2VGAP);
     vbox->Add(hsbox, 0, wxLEFT | wxRIGHT, LRGAP);
+    vbox->AddSpacer(S2VGAP);
+    vbox->Add(hgbox, 0, wxLEFT | wxRIGHT, LRGAP);
     vbox->AddSpacer(10);
     vbox->Add(hebox, 0, wxLEFT | wxRIGHT, LRGAP);
     vbox->AddSpacer(10);
@@ -3414,6 +3439,7 @@ wxPanel* PrefsDialog::CreateFilePrefs(wxWindow* parent)
     choice4->SetSelection(opencursindex);
     spin1->SetRange(1, MAX_RECENT); spin1->SetValue(maxpatterns);
     spin2->SetRange(1, MAX_RECENT); spin2->SetValue(maxscripts);
+    spin3->SetRange(1, MAX_GZIP_THREADS); spin3->SetValue(gzipthreads);
     spin1->SetFocus();
     spin1->SetSelection(ALL_TEXT);
 
@@ -4677,6 +4703,8 @@ bool PrefsDialog::ValidatePage()
             return false;
         if ( BadSpinVal(PREF_MAX_SCRIPTS, 1, MAX_RECENT, _("Maximum number of recent scripts")) )
             return false;
+        if ( BadSpinVal(PREF_GZIP_THREADS, 1, MAX_GZIP_THREADS, _("Threads for compressing files")) )
+            return false;
 
     } else if (currpage == EDIT_PAGE) {
         if ( BadSpinVal(PREF_RANDOM_FILL, 1, 100, _("Random fill percentage")) )
@@ -4764,6 +4792,7 @@ bool PrefsDialog::TransferDataFromWindow()
     opencursindex = GetChoiceVal(PREF_OPEN_CURSOR);
     maxpatterns   = GetSpinVal(PREF_MAX_PATTERNS);
     maxscripts    = GetSpinVal(PREF_MAX_SCRIPTS);
+    gzipthreads   = GetSpinVal(PREF_GZIP_THREADS);
     texteditor    = neweditor;
     downloaddir   = newdownloaddir;
 
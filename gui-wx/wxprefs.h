@@ -135,6 +135,7 @@ extern int numpatterns;          // current number of recent pattern files
 extern int numscripts;           // current number of recent script files
 extern int maxpatterns;          // maximum number of recent pattern files
 extern int maxscripts;           // maximum number of recent script files
+extern int gzipthreads;          // number of threads compressing .gz files
 
 extern wxArrayString namedrules;
 // We maintain an array of named rules, where each string is of the form
@@ -311,6 +312,7 @@ const int mininfowd = 400;       // info window's minimum width
 const int mininfoht = 100;       // info window's minimum height
 
 const int MAX_RECENT = 100;      // maximum value of maxpatterns and maxscripts
+const int MAX_GZIP_THREADS = 64; // maximum value of gzipthreads
 const int MAX_SPACING = 1000;    // maximum value of boldspacing
 const int MIN_MEM_MB = 0;        // minimum value of maximum memory
 const int MAX_MEM_MB =           // maximum value of maximum memory
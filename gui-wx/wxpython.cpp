@@ -670,7 +670,7 @@ static PyObject* py_store(PyObject* self, PyObject* args)
     // if grid is bounded then force XRLE_format so that position info is recorded
     if (tempalgo->gridwd > 0 || tempalgo->gridht > 0) format = XRLE_format;
     err = writepattern(FILENAME, *tempalgo, format, no_compression,
-                       top.toint(), left.toint(), bottom.toint(), right.toint());
+                       top, left, bottom, right);
     delete tempalgo;
     if (err) PYTHON_ERROR(err);
     
@@ -1796,6 +1796,33 @@ static PyObject* py_run(PyObject* self, PyObject* args)
 
 // -----------------------------------------------------------------------------
 
+static PyObject* py_findperiod(PyObject* self, PyObject* args)
+{
+    AUTORELEASE_POOL
+    if (PythonScriptAborted()) return NULL;
+    wxUnusedVar(self);
+    int maxperiod, maxgens;
+    
+    if (!G_PyArg_ParseTuple(args, (char*)"ii", &maxperiod, &maxgens)) return NULL;
+    if (maxperiod < 1) PYTHON_ERROR("findperiod error: maximum period must be > 0.");
+    
+    perioddetector pd(maxperiod);
+    for (int gens = 0; !pd.observe(*currlayer->algo); gens++) {
+        if (gens >= maxgens) break;
+        mainptr->NextGeneration(false);       // step 1 gen
+        if (PythonScriptAborted()) return NULL;
+    }
+    DoAutoUpdate();
+    
+    if (pd.period > 0) {
+        return G_Py_BuildValue((char*)"[iiis]", pd.period, pd.dx, pd.dy,
+                               pd.firstgen.tostring());
+    }
+    return G_PyList_New(0);
+}
+
+// -----------------------------------------------------------------------------
+
 static PyObject* py_step(PyObject* self, PyObject* args)
 {
     AUTORELEASE_POOL
@@ -3203,6 +3230,7 @@ static PyMethodDef py_methods[] = {
     // control
     { "empty",        py_empty,      METH_VARARGS, "return true if universe is empty" },
     { "run",          py_run,        METH_VARARGS, "run current pattern for given number of gens" },
+    { "findperiod",   py_findperiod, METH_VARARGS, "run current pattern until it repeats" },
     { "step",         py_step,       METH_VARARGS, "run current pattern for current step" },
     { "setstep",      py_setstep,    METH_VARARGS, "set step exponent" },
     { "getstep",      py_getstep,    METH_VARARGS, "return current step exponent" },
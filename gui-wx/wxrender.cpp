@@ -86,6 +86,7 @@ GLuint rgbatexture = 0;                 // texture name for drawing RGBA bitmaps
 GLuint icontexture = 0;                 // texture name for drawing icons
 GLuint celltexture = 0;                 // texture name for drawing magnified cells
 GLuint tiletexture = 0;                 // texture name for tiled drawing
+GLuint frametexture = 0;                // texture name for the kept pattern frame
 unsigned char* iconatlas = NULL;        // pointer to texture atlas for current set of icons
 unsigned char* cellatlas = NULL;        // pointer to texture atlas for current set of magnified cells
 unsigned char* itemgrid = NULL;         // pointer to buffer for 16x16 cell/icon grid
@@ -897,6 +898,125 @@ void golly_render::getcolors(unsigned char** r, unsigned char** g, unsigned char
 
 // -----------------------------------------------------------------------------
 
+// When the current layer is drawn at 1:1 or zoomed out, frame_render keeps
+// the pattern's pixels from one frame to the next so the algorithm only
+// redraws what changed (see liferender::keepsframe).  The kept pixels live
+// in framebuf, and only the damaged parts are uploaded to frametexture.
+
+class frame_render : public golly_render
+{
+public:
+    frame_render() : framebuf(NULL), framewd(0), frameht(0) {}
+    virtual ~frame_render() { free(framebuf); }
+    virtual int keepsframe() { return 1; }
+    virtual void damage(int x, int y, int w, int h);
+    virtual void pixblit(int x, int y, int w, int h, unsigned char* pm, int pmscale);
+    bool CanDraw(int wd, int ht);
+    void DrawPattern(lifealgo* algo, viewport& view);
+private:
+    unsigned int* framebuf;             // RGBA pixels of the last frame
+    int framewd, frameht;
+    std::vector<wxRect> damaged;        // what to upload when the draw is done
+};
+
+frame_render framerenderer;     // create instance
+
+// -----------------------------------------------------------------------------
+
+void frame_render::damage(int x, int y, int w, int h)
+{
+    wxRect r(x, y, w, h);
+    r.Intersect(wxRect(0, 0, framewd, frameht));
+    if (r.IsEmpty()) return;
+
+    unsigned char dead[4] = { currlayer->cellr[0], currlayer->cellg[0], currlayer->cellb[0], dead_alpha };
+    unsigned int deadRGBA;
+    memcpy(&deadRGBA, dead, 4);
+    for (int row = r.y; row < r.y + r.height; row++) {
+        unsigned int* p = framebuf + row * framewd + r.x;
+        for (int i = 0; i < r.width; i++) *p++ = deadRGBA;
+    }
+    damaged.push_back(r);
+}
+
+// -----------------------------------------------------------------------------
+
+void frame_render::pixblit(int x, int y, int w, int h, unsigned char* pmdata, int pmscale)
+{
+    // only used when pmscale is 1, and the tracker has already damaged
+    // (and so will upload) every area the algorithm blits into
+    wxRect r(x, y, w, h);
+    r.Intersect(wxRect(0, 0, framewd, frameht));
+    if (r.IsEmpty()) return;
+
+    for (int row = r.y; row < r.y + r.height; row++) {
+        memcpy(framebuf + row * framewd + r.x, pmdata + ((row - y) * w + (r.x - x)) * 4, r.width * 4);
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+bool frame_render::CanDraw(int wd, int ht)
+{
+    // the frame is one non-power-of-2 texture
+    return glMajor >= 2 && wd > 0 && ht > 0 && wd <= glMaxTextureSize && ht <= glMaxTextureSize;
+}
+
+// -----------------------------------------------------------------------------
+
+void frame_render::DrawPattern(lifealgo* algo, viewport& view)
+{
+    EnableTextures();
+    if (frametexture == 0) glGenTextures(1, &frametexture);
+    glBindTexture(GL_TEXTURE_2D, frametexture);
+
+    int wd = view.getwidth();
+    int ht = view.getheight();
+    if (wd != framewd || ht != frameht) {
+        free(framebuf);
+        framebuf = (unsigned int*)malloc(wd * ht * 4);
+        if (!framebuf) Fatal(_("Could not allocate frame buffer!"));
+        framewd = wd;
+        frameht = ht;
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, wd, ht, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        // nothing kept from before is any good, so the next draw repaints everything
+        newframe();
+    }
+
+    damaged.clear();
+    algo->draw(view, *this);
+
+    // upload the damaged areas (the algorithm may have bound other textures)
+    EnableTextures();
+    glBindTexture(GL_TEXTURE_2D, frametexture);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, framewd);
+    for (size_t i = 0; i < damaged.size(); i++) {
+        wxRect& r = damaged[i];
+        glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.width, r.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                        framebuf + r.y * framewd + r.x);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    // draw the whole frame
+    glTexCoordPointer(2, GL_SHORT, 0, texture_coordinates);
+    GLfloat vertices[] = {
+        0,         0,
+        (float)wd, 0,
+        0,         (float)ht,
+        (float)wd, (float)ht,
+    };
+    glVertexPointer(2, GL_FLOAT, 0, vertices);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+// -----------------------------------------------------------------------------
+
 void DrawSelection(wxRect& rect, bool active)
 {
     // draw semi-transparent rectangle
@@ -1808,7 +1928,12 @@ void DrawView(int tileindex)
     } else {
         // no scaling
         currscale = 1;
-        currlayer->algo->draw(*currlayer->view, renderer);
+        if (savelayer == NULL && currmag <= 0 && framerenderer.CanDraw(currwd, currht)) {
+            // only redraw what changed since the last frame
+            framerenderer.DrawPattern(currlayer->algo, *currlayer->view);
+        } else {
+            currlayer->algo->draw(*currlayer->view, renderer);
+        }
     }
 
     if ( viewptr->GridVisible() ) {
@@ -11,6 +11,8 @@
 #include <limits.h>        // for INT_MAX
 #include "wx/filename.h"   // for wxFileName
 
+#include "util.h"          // for patternhash
+
 #include "wxgolly.h"       // for wxGetApp, mainptr, viewptr, statusptr
 #include "wxmain.h"        // for mainptr->...
 #include "wxselect.h"      // for Selection
@@ -642,35 +644,9 @@ const char* GSF_checkrect(int x, int y, int wd, int ht)
 
 int GSF_hash(int x, int y, int wd, int ht)
 {
-    // calculate a hash value for pattern in given rect
-    int hash = 31415962;
-    int right = x + wd - 1;
-    int bottom = y + ht - 1;
-    int cx, cy;
-    int v = 0;
-    lifealgo* curralgo = currlayer->algo;
-    bool multistate = curralgo->NumCellStates() > 2;
-
-    for ( cy=y; cy<=bottom; cy++ ) {
-        int yshift = cy - y;
-        for ( cx=x; cx<=right; cx++ ) {
-            int skip = curralgo->nextcell(cx, cy, v);
-            if (skip >= 0) {
-                // found next live cell in this row (v is >= 1 if multistate)
-                cx += skip;
-                if (cx <= right) {
-                    // need to use a good hash function for patterns like AlienCounter.rle
-                    hash = (hash * 1000003) ^ yshift;
-                    hash = (hash * 1000003) ^ (cx - x);
-                    if (multistate) hash = (hash * 1000003) ^ v;
-                }
-            } else {
-                cx = right;  // done this row
-            }
-        }
-    }
-
-    return hash;
+    // calculate a hash value for pattern in given rect; the hashlife
+    // algorithms answer this from per-node hashes without visiting cells
+    return patternhash::toint(currlayer->algo->getRectHash(x, y, wd, ht));
 }
 
 // -----------------------------------------------------------------------------